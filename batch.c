@@ -0,0 +1,1091 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#define STDOUT_FILENO 1
+#else
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+#include "batch.h"
+#include "feed.h"
+#include "fileio.h"
+#include "scheduler.h"
+#include "query.h"
+#include "recurrence.h"
+
+#define BATCH_MAX_FIELDS 6
+// Most tasks the applier links per writer mutex acquisition
+#define BATCH_INGEST_BATCH 256
+
+/*
+batchSweep() - Unlinks completed and deleted tasks from the list in one pass
+ - Time: O(n), Space: O(1)
+ - complete and delete only mark tasks, so a run of them costs O(1) each
+   instead of an O(n) unlink. Readers skip marked tasks, so sweeping can
+   wait until marked tasks are a good share of the list.
+ - Readers may be walking the list: links change with atomic stores, an
+   unlinked task keeps its next pointer so a reader standing on it carries
+   on, and deleted tasks are retired rather than freed
+ */
+static void batchSweep(batchstore* store) {
+    if (store->unswept == 0) return;
+
+    task** link = &store->list->head;
+    task* t;
+    while ((t = *link) != NULL) {
+        if (t->completed) {
+            __atomic_store_n(link, t->next, __ATOMIC_RELEASE);
+            store->linked--;
+        } else {
+            link = &t->next;
+        }
+    }
+
+    for (int i = 0; i < store->removed_count; i++) epochRetire(&store->epoch, store->removed[i]);
+    store->removed_count = 0;
+    store->unswept = 0;
+}
+
+// Sweeps when marked tasks make up a quarter of the list, O(1) amortized
+static void batchMaybeSweep(batchstore* store) {
+    if (store->unswept >= store->sweep_min && store->unswept * 4 >= store->linked) batchSweep(store);
+}
+
+// Indexes t and links it at the head of the list; -1 if out of memory
+static int batchLink(batchstore* store, task* t) {
+    if (todoIndexInsert(&store->index, t) != 0) return -1;
+    t->next = store->list->head;
+    __atomic_store_n(&store->list->head, t, __ATOMIC_RELEASE);
+    store->linked++;
+    return 0;
+}
+
+// Marks an active task deleted: the sweep unlinks it and retires it.
+// Returns -1 if out of memory (the task is left as it was).
+static int batchMarkRemoved(batchstore* store, task* t) {
+    if (store->removed_count == store->removed_cap) {
+        int cap = store->removed_cap ? store->removed_cap * 2 : 256;
+        task** grown = (task**)realloc(store->removed, sizeof(task*) * cap);
+        if (!grown) return -1;
+        store->removed = grown;
+        store->removed_cap = cap;
+    }
+    todoIndexRemove(&store->index, t);
+    __atomic_store_n(&t->completed, 1, __ATOMIC_RELEASE);
+    store->removed[store->removed_count++] = t;
+    store->unswept++;
+    return 0;
+}
+
+// Adds the next occurrence of t, a recurring task just completed, as
+// todoComplete() does; batchExecute() journals it after the command
+static void batchAddOccurrence(batchstore* store, const task* t) {
+    if (todoAddOccurrence(store->list, &store->index, t, store->today, NULL) != TODO_OK) return;
+    store->linked++;
+    if (store->journal) store->spawned++;
+}
+
+// Takes out the occurrence completing t added, if it is still active and
+// due on the date completing t gave it, as todoUndo() does. The journal
+// gets it as a delete ahead of the undo line.
+static void batchRemoveOccurrence(batchstore* store, const task* t) {
+    date due;
+    if (t->repeat.kind == RECUR_NONE || !t->due_date_set || recurNext(&t->repeat, t->duedate, &due) != 0) {
+        return;
+    }
+    task* next = todoIndexFind(&store->index, t->name);
+    if (!next || next->repeat.kind == RECUR_NONE || !next->due_date_set ||
+        compareDates(next->duedate, due) != 0 || batchMarkRemoved(store, next) != 0) {
+        return;
+    }
+    feedRecord(FEED_DELETE, next, NULL, 0);
+    if (store->journal) {
+        char line[BATCH_LINE_MAX];
+        snprintf(line, sizeof(line), "delete|%s", next->name);
+        store->journal(store->journal_context, store->journal_id, line);
+    }
+}
+
+/*
+batchTaskLine() - Writes the batch command that recreates t, without tags
+ - Time: O(1), Space: O(1)
+ - Returns the length, or -1 if it does not fit in size
+ - Example: batchTaskLine(line, sizeof(line), "add", t) -> "add|Report|Q3 numbers|1|05/11/2026"
+ */
+int batchTaskLine(char* line, size_t size, const char* command, const task* t) {
+    int n = snprintf(line, size, "%s|%s|%s|%d|", command, t->name, t->description, t->priority);
+    if (n >= 0 && (size_t)n < size && t->due_date_set) {
+        n += snprintf(line + n, size - n, "%02d/%02d/%04d",
+                      t->duedate.day, t->duedate.month, t->duedate.year);
+    }
+    return n >= 0 && (size_t)n < size ? n : -1;
+}
+
+// Tells the journal about t as command, followed by its tags after an add
+static void batchJournalTask(batchstore* store, const char* command, const task* t) {
+    char line[BATCH_LINE_MAX];
+    if (batchTaskLine(line, sizeof(line), command, t) < 0) return;
+    store->journal(store->journal_context, store->journal_id, line);
+    if (strcmp(command, "add") != 0) return;
+    for (int i = 0; i < t->tag_count; i++) {
+        snprintf(line, sizeof(line), "tag|%s|%s", t->name, t->tags[i]);
+        store->journal(store->journal_context, store->journal_id, line);
+    }
+}
+
+// Reads used by query and stats, which may run while the writer changes the task
+static int isCompleted(const task* t) {
+    return __atomic_load_n(&t->completed, __ATOMIC_ACQUIRE);
+}
+
+static TaskStatus currentStatus(const task* t) {
+    return (TaskStatus)__atomic_load_n(&t->status, __ATOMIC_RELAXED);
+}
+
+/*
+batchStoreInit() - Prepares the shared state for running commands on a list
+ - Time: O(n), Space: O(n) for the name index
+ - Returns 0 on success, -1 if out of memory
+ */
+int batchStoreInit(batchstore* store, tasklist* list, completedstack* stack) {
+    memset(store, 0, sizeof(*store));
+    store->list = list;
+    store->stack = stack;
+    store->today = getToday();
+    store->sweep_min = BATCH_SWEEP_MIN;
+    if (todoIndexBuild(&store->index, list->head) != 0) {
+        todoIndexFree(&store->index);
+        return -1;
+    }
+    for (task* t = list->head; t; t = t->next) store->linked++;
+    todoRefreshStatuses(list->head, store->today);
+    pthread_mutex_init(&store->writer, NULL);
+    epochInit(&store->epoch);
+    return 0;
+}
+
+/*
+batchStoreFree() - Unlinks pending completed/deleted tasks and frees the store
+ - Time: O(n), Space: O(1)
+ - The list and stack stay valid and keep their tasks; no readers may be active
+ */
+void batchStoreFree(batchstore* store) {
+    batchSweep(store);
+    epochDrain(&store->epoch);
+    pthread_mutex_destroy(&store->writer);
+    todoIndexFree(&store->index);
+    free(store->removed);
+    store->removed = NULL;
+    store->removed_cap = 0;
+}
+
+// Removes leading and trailing whitespace in place, returns the start
+static char* trimField(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+// Splits a command line on '|', returns the number of fields
+static int splitFields(char* line, char* fields[]) {
+    int count = 0;
+    char* p = line;
+    while (count < BATCH_MAX_FIELDS) {
+        char* bar = strchr(p, '|');
+        if (bar) *bar = '\0';
+        fields[count++] = trimField(p);
+        if (!bar) break;
+        p = bar + 1;
+    }
+    return count;
+}
+
+// Parses DD/MM/YYYY; "" or "-" means no due date
+static int parseDueDate(const char* text, date* d, int* is_set) {
+    *is_set = 0;
+    if (text[0] == '\0' || strcmp(text, "-") == 0) return 0;
+
+    int day, month, year;
+    char extra;
+    if (sscanf(text, "%d/%d/%d%c", &day, &month, &year, &extra) != 3 ||
+        !isValidDate(day, month, year)) {
+        return -1;
+    }
+    d->day = day;
+    d->month = month;
+    d->year = year;
+    *is_set = 1;
+    return 0;
+}
+
+void batchOk(batchsession* session) {
+    outbufPut(session->out, "OK\n", 3);
+}
+
+void batchError(batchsession* session, const char* message, const char* detail) {
+    session->errors++;
+    outbufPuts(session->out, "ERR line ");
+    outbufPutInt(session->out, session->line_number, 0);
+    outbufPuts(session->out, ": ");
+    outbufPuts(session->out, message);
+    if (detail) {
+        outbufPuts(session->out, ": ");
+        outbufPuts(session->out, detail);
+    }
+    outbufPut(session->out, "\n", 1);
+}
+
+// Unlike updateTaskStatuses(), also turns overdue tasks back to pending
+// when the date moves back
+static void batchUpdateStatuses(batchsession* session) {
+    todoRefreshStatuses(session->store->list->head, session->store->today);
+}
+
+// Builds a task from name|description|priority|DD/MM/YYYY fields;
+// reports the error and returns NULL if they are invalid
+static task* batchParseTask(batchsession* session, char* fields[], int count, date today) {
+    int priority;
+    char extra;
+    if (sscanf(fields[3], "%d%c", &priority, &extra) != 1) priority = 0;
+
+    date due = {0, 0, 0};
+    int due_set;
+    if (parseDueDate(count > 4 ? fields[4] : "", &due, &due_set) != 0) {
+        batchError(session, "invalid date", fields[4]);
+        return NULL;
+    }
+
+    task* t;
+    todostatus status = todoCreateTask(fields[1], fields[2], priority, due_set ? &due : NULL, today, &t);
+    if (status != TODO_OK) {
+        batchError(session, todoStatusText(status),
+                   status == TODO_INVALID_PRIORITY ? fields[3] :
+                   status == TODO_INVALID_NAME ? fields[1] : NULL);
+        return NULL;
+    }
+    return t;
+}
+
+// add|name|description|priority|DD/MM/YYYY
+static void batchAdd(batchsession* session, char* fields[], int count) {
+    if (count < 4) {
+        batchError(session, "usage", "add|name|description|priority|DD/MM/YYYY");
+        return;
+    }
+    if (todoIndexFind(&session->store->index, fields[1])) {
+        batchError(session, "task already exists", fields[1]);
+        return;
+    }
+
+    task* t = batchParseTask(session, fields, count, session->store->today);
+    if (!t) return;
+    if (batchLink(session->store, t) != 0) {
+        free(t);
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+    feedRecord(FEED_ADD, t, NULL, 0);
+    batchOk(session);
+}
+
+// put|name|description|priority|DD/MM/YYYY - adds the task, or replaces the
+// one with that name (keeping its tags). With an ingest ring the task is
+// queued and applied later, so OK means accepted rather than applied.
+static void batchPut(batchsession* session, char* fields[], int count) {
+    if (count < 4) {
+        batchError(session, "usage", "put|name|description|priority|DD/MM/YYYY");
+        return;
+    }
+    batchingest* ingest = session->store->ingest;
+    // Queued tasks get their status from the applier, which owns today
+    date today = {0, 0, 0};
+    task* t = batchParseTask(session, fields, count, ingest ? today : session->store->today);
+    if (!t) return;
+
+    if (ingest) {
+        batchIngestPush(ingest, t);
+    } else if (batchApply(session->store, &t, 1) != 1) {
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+    batchOk(session);
+}
+
+// complete|name
+static void batchComplete(batchsession* session, char* fields[], int count) {
+    task* t = count > 1 ? todoIndexFind(&session->store->index, fields[1]) : NULL;
+    if (!t) {
+        batchError(session, "task not found", count > 1 ? fields[1] : "");
+        return;
+    }
+    stacknode* node = (stacknode*)malloc(sizeof(stacknode));
+    if (!node) {
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+
+    todoIndexRemove(&session->store->index, t);
+    t->completed_date = session->store->today;
+    __atomic_store_n(&t->status, COMPLETED, __ATOMIC_RELAXED);
+    __atomic_store_n(&t->completed, 1, __ATOMIC_RELEASE);
+    session->store->unswept++;
+
+    node->task_data = t;
+    node->next = session->store->stack->top;
+    __atomic_store_n(&session->store->stack->top, node, __ATOMIC_RELEASE);
+    feedRecord(FEED_COMPLETE, t, NULL, 0);
+    batchAddOccurrence(session->store, t);
+    batchMaybeSweep(session->store);
+    batchOk(session);
+}
+
+// undo
+static void batchUndo(batchsession* session) {
+    stacknode* node = session->store->stack->top;
+    if (!node) {
+        batchError(session, "no completed tasks to undo", NULL);
+        return;
+    }
+    // The task goes back as a copy: readers may still be on the old one,
+    // and relinking it would send them round the list a second time
+    task* t = (task*)malloc(sizeof(task));
+    if (!t) {
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+    if (node->task_data) batchRemoveOccurrence(session->store, node->task_data);
+    batchSweep(session->store);
+
+    task* old = node->task_data;
+    __atomic_store_n(&session->store->stack->top, node->next, __ATOMIC_RELEASE);
+    *t = *old;
+    t->completed = 0;
+    t->status = todoStatusForDate(t, session->store->today);
+    t->next = session->store->list->head;
+    __atomic_store_n(&session->store->list->head, t, __ATOMIC_RELEASE);
+    session->store->linked++;
+    epochRetire(&session->store->epoch, node);
+    epochRetire(&session->store->epoch, old);
+
+    if (!todoIndexFind(&session->store->index, t->name)) todoIndexInsert(&session->store->index, t);
+    feedRecord(FEED_UNDO, t, NULL, 0);
+    batchOk(session);
+}
+
+// delete|name
+static void batchDelete(batchsession* session, char* fields[], int count) {
+    task* t = count > 1 ? todoIndexFind(&session->store->index, fields[1]) : NULL;
+    if (!t) {
+        batchError(session, "task not found", count > 1 ? fields[1] : "");
+        return;
+    }
+    // Marked like a completed task so the sweep unlinks it, then retired
+    if (batchMarkRemoved(session->store, t) != 0) {
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+    feedRecord(FEED_DELETE, t, NULL, 0);
+    batchMaybeSweep(session->store);
+    batchOk(session);
+}
+
+// tag|name|tag
+static void batchTag(batchsession* session, char* fields[], int count) {
+    if (count < 3) {
+        batchError(session, "usage", "tag|name|tag");
+        return;
+    }
+    task* t = todoIndexFind(&session->store->index, fields[1]);
+    if (!t) {
+        batchError(session, "task not found", fields[1]);
+        return;
+    }
+    todostatus status = todoAddTag(t, fields[2]);
+    if (status == TODO_INVALID_TAG) {
+        batchError(session, "invalid tag", fields[2]);
+        return;
+    }
+    if (status == TODO_TAGS_FULL) {
+        batchError(session, todoStatusText(status), t->name);
+        return;
+    }
+    // Adding a tag the task already has is not an error
+    batchOk(session);
+}
+
+// One query result row: name|description|priority|date|status|tags
+static void batchRow(outbuf* rows, const task* t) {
+    static const char* status_names[] = {"pending", "completed", "overdue"};
+
+    outbufPuts(rows, t->name);
+    outbufPut(rows, "|", 1);
+    outbufPuts(rows, t->description);
+    outbufPut(rows, "|", 1);
+    outbufPutInt(rows, t->priority, 0);
+    outbufPut(rows, "|", 1);
+    if (t->due_date_set) outbufPutDate(rows, t->duedate);
+    else outbufPut(rows, "-", 1);
+    outbufPut(rows, "|", 1);
+    outbufPuts(rows, status_names[currentStatus(t)]);
+    outbufPut(rows, "|", 1);
+    int tag_count = __atomic_load_n(&t->tag_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < tag_count; i++) {
+        if (i > 0) outbufPut(rows, ";", 1);
+        outbufPuts(rows, t->tags[i]);
+    }
+    outbufPut(rows, "\n", 1);
+}
+
+// Reads a filter, field|value, into query: all, name|text, description|text,
+// keyword|text, tag|tag, priority|n or n-m, status|pending|overdue|completed,
+// due|DD/MM/YYYY[-DD/MM/YYYY], due|- for none, or expr|expression (see
+// query.h), compiled into program. Returns -1 after answering with the error.
+static int batchParseQuery(batchsession* session, const char* field, const char* value, todoquery* query,
+                           queryprogram* program) {
+    *query = (todoquery){TODO_MATCH_ALL, value, 0, 0, PENDING, {0}, {0}, program};
+
+    if (strcmp(field, "name") == 0) query->type = TODO_MATCH_NAME;
+    else if (strcmp(field, "description") == 0) query->type = TODO_MATCH_DESCRIPTION;
+    else if (strcmp(field, "keyword") == 0) query->type = TODO_MATCH_KEYWORD;
+    else if (strcmp(field, "tag") == 0) query->type = TODO_MATCH_TAG;
+    else if (strcmp(field, "priority") == 0) {
+        query->type = TODO_MATCH_PRIORITY;
+        if (sscanf(value, "%d-%d", &query->min_priority, &query->max_priority) != 2) {
+            query->min_priority = query->max_priority = atoi(value);
+        }
+    } else if (strcmp(field, "status") == 0) {
+        // Completed tasks are counted from the stack; the list ones are skipped
+        query->type = TODO_MATCH_STATUS;
+        if (strcmp(value, "completed") == 0) query->status = COMPLETED;
+        else if (strcmp(value, "overdue") == 0) query->status = OVERDUE;
+    } else if (strcmp(field, "due") == 0) {
+        char from[32], to[32];
+        int from_set, to_set;
+        size_t split = strcspn(value, "-");
+        snprintf(from, sizeof(from), "%.*s", (int)split, value);
+        snprintf(to, sizeof(to), "%s", value[split] ? value + split + 1 : from);
+        if (parseDueDate(from, &query->from, &from_set) != 0 ||
+            parseDueDate(to, &query->to, &to_set) != 0 || from_set != to_set) {
+            batchError(session, "invalid date", value);
+            return -1;
+        }
+        query->type = from_set ? TODO_MATCH_DUE_RANGE : TODO_MATCH_NO_DUE_DATE;
+    } else if (strcmp(field, "expr") == 0) {
+        char error[80];
+        if (queryCompile(value, session->store->today, 0, program, error, sizeof(error)) != TODO_OK) {
+            batchError(session, "invalid expression", error);
+            return -1;
+        }
+        query->type = TODO_MATCH_EXPRESSION;
+    } else if (strcmp(field, "all") != 0) {
+        batchError(session, "unknown query field", field);
+        return -1;
+    }
+    return 0;
+}
+
+// query|field|value, with the filters of batchParseQuery()
+static void batchQuery(batchsession* session, char* fields[], int count) {
+    const char* field = count > 1 && fields[1][0] ? fields[1] : "all";
+    todoquery query;
+    queryprogram program;
+    if (batchParseQuery(session, field, count > 2 ? fields[2] : "", &query, &program) != 0) return;
+
+    // Rows go to a side buffer so the count can come first
+    outbuf rows;
+    if (outbufInit(&rows, -1, 4096) != 0) {
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+    long matches = 0;
+    task* t = __atomic_load_n(&session->store->list->head, __ATOMIC_ACQUIRE);
+    for (; t; t = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE)) {
+        if (!isCompleted(t) && todoMatches(t, &query)) {
+            batchRow(&rows, t);
+            matches++;
+        }
+    }
+    stacknode* node = __atomic_load_n(&session->store->stack->top, __ATOMIC_ACQUIRE);
+    for (; node; node = node->next) {
+        if (node->task_data && todoMatches(node->task_data, &query)) {
+            batchRow(&rows, node->task_data);
+            matches++;
+        }
+    }
+    if (rows.error) {
+        outbufFree(&rows);
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+
+    outbufPuts(session->out, "OK ");
+    outbufPutInt(session->out, matches, 0);
+    outbufPut(session->out, "\n", 1);
+    outbufPut(session->out, rows.data, rows.len);
+    outbufFree(&rows);
+}
+
+// bulk|action|field|value[|argument] - one action on every active task the
+// filter matches (fields as in query): complete, delete, tag|..|tag,
+// untag|..|tag, priority|..|n. Answers "OK <tasks changed>". Completed and
+// deleted tasks are only marked, as one at a time, and swept together at
+// most once; the journal gets the one bulk line rather than a line per task.
+static void batchBulk(batchsession* session, char* fields[], int count) {
+    static const char* const actions[] = {"complete", "delete", "tag", "untag", "priority"};
+    int action = -1;
+    for (int i = 0; count > 1 && i < (int)(sizeof(actions) / sizeof(actions[0])); i++) {
+        if (strcmp(fields[1], actions[i]) == 0) action = i;
+    }
+    if (action < 0 || count < 3) {
+        batchError(session, "usage", "bulk|action|field|value[|argument]");
+        return;
+    }
+    const char* argument = count > 4 ? fields[4] : "";
+    int priority = atoi(argument);
+    if ((action == TODO_BULK_TAG || action == TODO_BULK_UNTAG) &&
+        (argument[0] == '\0' || strlen(argument) >= MAX_TAG_LENGTH)) {
+        batchError(session, "invalid tag", argument);
+        return;
+    }
+    if (action == TODO_BULK_PRIORITY && (priority < 1 || priority > 3)) {
+        batchError(session, "invalid priority", argument);
+        return;
+    }
+    todoquery query;
+    queryprogram program;
+    if (batchParseQuery(session, fields[2], count > 3 ? fields[3] : "", &query, &program) != 0) return;
+
+    batchstore* store = session->store;
+    long changed = 0, removed = 0;
+    int failed = 0;
+    for (task* t = store->list->head; t && !failed; t = t->next) {
+        if (t->completed || !todoMatches(t, &query)) continue;
+        if (action == TODO_BULK_COMPLETE) {
+            stacknode* node = (stacknode*)malloc(sizeof(stacknode));
+            if (!node) {
+                failed = 1;
+                continue;
+            }
+            todoIndexRemove(&store->index, t);
+            t->completed_date = store->today;
+            __atomic_store_n(&t->status, COMPLETED, __ATOMIC_RELAXED);
+            __atomic_store_n(&t->completed, 1, __ATOMIC_RELEASE);
+            store->unswept++;
+            node->task_data = t;
+            node->next = store->stack->top;
+            __atomic_store_n(&store->stack->top, node, __ATOMIC_RELEASE);
+            feedRecord(FEED_COMPLETE, t, NULL, 0);
+            // At the head of the list, so this walk does not reach it
+            batchAddOccurrence(store, t);
+            removed++;
+        } else if (action == TODO_BULK_DELETE) {
+            if (batchMarkRemoved(store, t) != 0) {
+                failed = 1;
+                continue;
+            }
+            feedRecord(FEED_DELETE, t, NULL, 0);
+            removed++;
+        } else if (action == TODO_BULK_TAG) {
+            if (todoAddTag(t, argument) != TODO_OK) continue;
+        } else if (action == TODO_BULK_UNTAG) {
+            if (todoRemoveTag(t, argument) != TODO_OK) continue;
+        } else {
+            if (t->priority == priority) continue;
+            int previous = t->priority;
+            __atomic_store_n(&t->priority, priority, __ATOMIC_RELAXED);
+            feedRecord(FEED_PRIORITY, t, NULL, previous);
+        }
+        changed++;
+    }
+
+    batchMaybeSweep(store);
+    if (failed) {
+        batchError(session, "out of memory", NULL);
+        return;
+    }
+    outbufPuts(session->out, "OK ");
+    outbufPutInt(session->out, changed, 0);
+    outbufPut(session->out, "\n", 1);
+}
+
+// stats
+static void batchStats(batchsession* session) {
+    long pending = 0, overdue = 0, completed = 0, by_priority[4] = {0};
+
+    task* t = __atomic_load_n(&session->store->list->head, __ATOMIC_ACQUIRE);
+    for (; t; t = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE)) {
+        if (isCompleted(t)) continue;
+        if (currentStatus(t) == OVERDUE) overdue++;
+        else pending++;
+        if (t->priority >= 1 && t->priority <= 3) by_priority[t->priority]++;
+    }
+    stacknode* node = __atomic_load_n(&session->store->stack->top, __ATOMIC_ACQUIRE);
+    for (; node; node = node->next) completed++;
+
+    outbufPuts(session->out, "OK pending=");
+    outbufPutInt(session->out, pending, 0);
+    outbufPuts(session->out, " overdue=");
+    outbufPutInt(session->out, overdue, 0);
+    outbufPuts(session->out, " completed=");
+    outbufPutInt(session->out, completed, 0);
+    outbufPuts(session->out, " high=");
+    outbufPutInt(session->out, by_priority[1], 0);
+    outbufPuts(session->out, " medium=");
+    outbufPutInt(session->out, by_priority[2], 0);
+    outbufPuts(session->out, " low=");
+    outbufPutInt(session->out, by_priority[3], 0);
+    outbufPut(session->out, "\n", 1);
+}
+
+// Journals the count tasks a command just put at the head of the list, oldest first
+static void batchJournalAdded(batchstore* store, int count) {
+    task** added = (task**)malloc(sizeof(task*) * (count ? count : 1));
+    if (!added) return;
+    task* t = store->list->head;
+    for (int i = 0; i < count && t; i++, t = t->next) added[i] = t;
+    for (int i = count - 1; i >= 0; i--) batchJournalTask(store, "add", added[i]);
+    free(added);
+}
+
+// import|file answers "OK <imported>"; export|file uses exportTasksTxt(),
+// which prints its own report, so flush first to keep the output in order.
+// A failed export answers ERR; why it failed goes to stderr.
+static void batchFileCommand(batchsession* session, char* fields[], int count, int is_import) {
+    if (count < 2 || fields[1][0] == '\0') {
+        batchError(session, "usage", is_import ? "import|file" : "export|file");
+        return;
+    }
+    batchSweep(session->store);
+
+    if (is_import) {
+        todoimportresult result;
+        todostatus status = todoImportFile(session->store->list, fields[1], session->store->today, &result);
+        session->store->linked += result.imported;
+        if (todoIndexBuild(&session->store->index, session->store->list->head) != 0) {
+            batchError(session, "out of memory", NULL);
+            return;
+        }
+        if (session->store->journal) batchJournalAdded(session->store, result.imported);
+        feedRecordAdded(session->store->list->head, result.imported);
+        if (status != TODO_OK) {
+            batchError(session, todoStatusText(status), fields[1]);
+            return;
+        }
+        outbufPuts(session->out, "OK ");
+        outbufPutInt(session->out, result.imported, 0);
+        outbufPut(session->out, "\n", 1);
+    } else {
+        outbufFlush(session->out);
+        int failed = exportTasksTxt(session->store->list->head, session->store->stack, fields[1]) != 0;
+        fflush(stdout);
+        if (failed) batchError(session, "export failed", fields[1]);
+        else batchOk(session);
+    }
+}
+
+// today|DD/MM/YYYY - sets the date used for overdue checks
+static void batchToday(batchsession* session, char* fields[], int count) {
+    date today;
+    int is_set;
+    if (count < 2 || parseDueDate(fields[1], &today, &is_set) != 0 || !is_set) {
+        batchError(session, "invalid date", count > 1 ? fields[1] : "");
+        return;
+    }
+    session->store->today = today;
+    batchUpdateStatuses(session);
+    batchOk(session);
+}
+
+// clear - frees all completed tasks
+static void batchClear(batchsession* session) {
+    batchSweep(session->store);
+    stacknode* node = session->store->stack->top;
+    __atomic_store_n(&session->store->stack->top, NULL, __ATOMIC_RELEASE);
+    while (node) {
+        stacknode* next = node->next;
+        if (node->task_data) feedRecord(FEED_CLEAR, node->task_data, NULL, 0);
+        epochRetire(&session->store->epoch, node->task_data);
+        epochRetire(&session->store->epoch, node);
+        node = next;
+    }
+    batchOk(session);
+}
+
+// True if the line's command word is word
+static int batchIsCommand(const char* line, const char* word) {
+    while (isspace((unsigned char)*line)) line++;
+    size_t n = strcspn(line, "| \t\r\n");
+    return n == strlen(word) && strncmp(line, word, n) == 0;
+}
+
+// Commands the journal repeats as they are; put is journaled by batchApply()
+// and import by batchJournalAdded(), as the tasks they link. Followers get
+// tasks without repeat rules, so the next occurrences complete and bulk add
+// are journaled as adds after the command, and the one undo takes out as
+// a delete before it.
+static int batchIsJournaled(const char* line) {
+    static const char* const words[] = {"add", "complete", "undo", "delete", "tag", "bulk", "today", "clear"};
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        if (batchIsCommand(line, words[i])) return 1;
+    }
+    return 0;
+}
+
+// query and stats only read the store, so they can run beside the writer
+static int batchIsReadOnly(const char* line) {
+    return batchIsCommand(line, "query") || batchIsCommand(line, "stats");
+}
+
+/*
+batchExecute() - Runs one command line and appends its response to session->out
+ - Time: see runBatch(), Space: O(1) apart from query rows
+ - The line is modified in place (split on '|'); blank and '#' lines are ignored
+ */
+void batchExecute(batchsession* session, char* line) {
+    // Splitting changes the line, so keep the text for the journal first
+    char journal_line[BATCH_LINE_MAX];
+    int journaled = session->store->journal && batchIsJournaled(line);
+    if (journaled) {
+        snprintf(journal_line, sizeof(journal_line), "%s", line);
+        journal_line[strcspn(journal_line, "\r\n")] = '\0';
+    }
+    long errors = session->errors;
+    // Journaled commands all run under the writer mutex; query and stats
+    // may run beside them, so they leave the writer's count alone
+    if (journaled) session->store->spawned = 0;
+
+    char* fields[BATCH_MAX_FIELDS];
+    int count = splitFields(line, fields);
+    const char* command = fields[0];
+
+    if (command[0] == '\0' || command[0] == '#') return;
+
+    if (strcmp(command, "add") == 0) batchAdd(session, fields, count);
+    else if (strcmp(command, "put") == 0) batchPut(session, fields, count);
+    else if (strcmp(command, "complete") == 0) batchComplete(session, fields, count);
+    else if (strcmp(command, "undo") == 0) batchUndo(session);
+    else if (strcmp(command, "delete") == 0) batchDelete(session, fields, count);
+    else if (strcmp(command, "tag") == 0) batchTag(session, fields, count);
+    else if (strcmp(command, "bulk") == 0) batchBulk(session, fields, count);
+    else if (strcmp(command, "query") == 0) batchQuery(session, fields, count);
+    else if (strcmp(command, "stats") == 0) batchStats(session);
+    else if (strcmp(command, "import") == 0) batchFileCommand(session, fields, count, 1);
+    else if (strcmp(command, "export") == 0) batchFileCommand(session, fields, count, 0);
+    else if (strcmp(command, "today") == 0) batchToday(session, fields, count);
+    else if (strcmp(command, "clear") == 0) batchClear(session);
+    else batchError(session, "unknown command", command);
+
+    if (journaled && session->errors == errors) {
+        batchstore* store = session->store;
+        store->journal(store->journal_context, store->journal_id, journal_line);
+        if (store->spawned) batchJournalAdded(store, store->spawned);
+    }
+}
+
+/*
+batchExecuteShared() - batchExecute() for a store used by several threads
+ - Time: see runBatch(), Space: O(1)
+ - query and stats run without a lock inside an epoch read section, so
+   readers never wait for the writer or each other; put only pushes to the
+   ingest ring when the store has one; other commands are serialized on
+   the store's writer mutex. session->reader_slot comes from
+   epochRegister(); -1 sends reads through the writer mutex too.
+ */
+void batchExecuteShared(batchsession* session, char* line) {
+    batchstore* store = session->store;
+    if (session->reader_slot >= 0 && batchIsReadOnly(line)) {
+        epochEnter(&store->epoch, session->reader_slot);
+        batchExecute(session, line);
+        epochExit(&store->epoch, session->reader_slot);
+    } else if (store->ingest && batchIsCommand(line, "put")) {
+        batchExecute(session, line);
+    } else {
+        pthread_mutex_lock(&store->writer);
+        batchExecute(session, line);
+        pthread_mutex_unlock(&store->writer);
+    }
+}
+
+/*
+batchApply() - Links new or updated tasks into the store
+ - Time: O(1) average per task, Space: O(1) amortized
+ - A task whose name is active replaces that task, which is marked deleted
+   and retired by the next sweep; the new one keeps its tags if it has none
+ - Caller holds the writer mutex (or is the only thread using the store)
+ - Returns the number of tasks applied; the rest are freed (out of memory)
+ - Example: batchApply(&store, batch, 256) -> 256
+ */
+int batchApply(batchstore* store, task* tasks[], int count) {
+    int applied = 0;
+    for (int i = 0; i < count; i++) {
+        task* t = tasks[i];
+        task* old = todoIndexFind(&store->index, t->name);
+        if (old) {
+            if (t->tag_count == 0) {
+                memcpy(t->tags, old->tags, sizeof(t->tags));
+                t->tag_count = old->tag_count;
+            }
+            if (batchMarkRemoved(store, old) != 0) {
+                free(t);
+                continue;
+            }
+        }
+        t->completed = 0;
+        t->status = todoStatusForDate(t, store->today);
+        if (batchLink(store, t) != 0) {
+            free(t);
+            continue;
+        }
+        if (store->journal) batchJournalTask(store, "put", t);
+        feedRecord(FEED_ADD, t, NULL, 0);
+        applied++;
+    }
+    batchMaybeSweep(store);
+    return applied;
+}
+
+/*
+batchAdopt() - Links a task into the store unless its name is taken
+ - Time: O(1) average, Space: O(1) amortized
+ - Caller holds the writer mutex; returns 0 if linked, 1 if the name is
+   already active (t is left to the caller), -1 if out of memory
+ */
+int batchAdopt(batchstore* store, task* t) {
+    if (todoIndexFind(&store->index, t->name)) return 1;
+    t->completed = 0;
+    t->status = todoStatusForDate(t, store->today);
+    if (batchLink(store, t) != 0) return -1;
+    if (store->journal) batchJournalTask(store, "add", t);
+    feedRecord(FEED_ADD, t, NULL, 0);
+    batchMaybeSweep(store);
+    return 0;
+}
+
+/*
+batchReset() - Empties the store: active tasks are deleted, completed ones freed
+ - Time: O(n), Space: O(n) for the deleted list
+ - Caller holds the writer mutex; readers see the tasks go as after delete
+   and clear, and the change feed gets the same events. Not journaled: a
+   follower uses it before a fresh snapshot.
+ - Returns 0, or -1 if out of memory (some tasks are left)
+ */
+int batchReset(batchstore* store) {
+    int status = 0;
+    for (task* t = store->list->head; t; t = t->next) {
+        if (t->completed) continue;
+        if (batchMarkRemoved(store, t) != 0) {
+            status = -1;
+            break;
+        }
+        feedRecord(FEED_DELETE, t, NULL, 0);
+    }
+    batchSweep(store);
+    stacknode* node = store->stack->top;
+    __atomic_store_n(&store->stack->top, NULL, __ATOMIC_RELEASE);
+    while (node) {
+        stacknode* next = node->next;
+        if (node->task_data) feedRecord(FEED_CLEAR, node->task_data, NULL, 0);
+        epochRetire(&store->epoch, node->task_data);
+        epochRetire(&store->epoch, node);
+        node = next;
+    }
+    return status;
+}
+
+// Waits a little longer the longer the ring has been empty
+static void ingestIdle(int rounds) {
+#ifdef _WIN32
+    Sleep(rounds < 64 ? 0 : 1);
+#else
+    if (rounds < 64) {
+        sched_yield();
+    } else {
+        struct timespec pause = {0, 200 * 1000};
+        nanosleep(&pause, NULL);
+    }
+#endif
+}
+
+/*
+ingestApplier() - The single consumer: drains the ring into the store
+ - Time: O(1) per task, Space: O(BATCH_INGEST_BATCH)
+ - Takes up to BATCH_INGEST_BATCH tasks at a time and applies them under one
+   writer mutex acquisition; after a stop request it empties the ring first
+ */
+static void* ingestApplier(void* arg) {
+    batchingest* ingest = (batchingest*)arg;
+    task* batch[BATCH_INGEST_BATCH];
+    int idle = 0;
+
+    for (;;) {
+        int count = dequeueBatch(&ingest->queue, batch, BATCH_INGEST_BATCH);
+        if (count == 0) {
+            // Read the stop flag before the final check, so a task pushed
+            // before the stop request is still seen
+            if (__atomic_load_n(&ingest->stop, __ATOMIC_ACQUIRE) && isQueueEmpty(&ingest->queue)) break;
+            ingestIdle(idle++);
+            continue;
+        }
+        idle = 0;
+        if (!ingest->route) {
+            pthread_mutex_lock(&ingest->store->writer);
+            int applied = batchApply(ingest->store, batch, count);
+            pthread_mutex_unlock(&ingest->store->writer);
+            __atomic_fetch_add(&ingest->applied, applied, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&ingest->batches, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        // Sharded: one lock per store the batch touches, tasks kept in order
+        batchstore* dest[BATCH_INGEST_BATCH];
+        for (int i = 0; i < count; i++) dest[i] = ingest->route(ingest->route_context, batch[i]);
+        for (int i = 0; i < count; i++) {
+            if (!batch[i]) continue;
+            batchstore* store = dest[i];
+            task* group[BATCH_INGEST_BATCH];
+            int size = 0;
+            for (int j = i; j < count; j++) {
+                if (batch[j] && dest[j] == store) {
+                    group[size++] = batch[j];
+                    batch[j] = NULL;
+                }
+            }
+            pthread_mutex_lock(&store->writer);
+            int applied = batchApply(store, group, size);
+            pthread_mutex_unlock(&store->writer);
+            __atomic_fetch_add(&ingest->applied, applied, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&ingest->batches, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/*
+batchIngestStart() - Creates the ring and starts its applier thread
+ - Time: O(capacity), Space: O(capacity)
+ - Also sets store->ingest, so put commands run through batchExecuteShared()
+   only push to the ring. To feed several stores, set ingest->route (and
+   each store's ingest) before the first push.
+ - Returns 0 on success, -1 if the ring or thread could not be created
+ */
+int batchIngestStart(batchingest* ingest, batchstore* store, int capacity) {
+    memset(ingest, 0, sizeof(*ingest));
+    ingest->store = store;
+    if (initQueue(&ingest->queue, capacity) != 0) return -1;
+    if (pthread_create(&ingest->applier, NULL, ingestApplier, ingest) != 0) {
+        freeQueue(&ingest->queue);
+        return -1;
+    }
+    store->ingest = ingest;
+    return 0;
+}
+
+/*
+batchIngestPush() - Queues a new or updated task; safe from any thread
+ - Time: O(1), Space: O(1)
+ - If the ring is full, yields until the applier makes room, so fast
+   producers are held back instead of losing tasks
+ - The ingest owns t from here on
+ */
+void batchIngestPush(batchingest* ingest, task* t) {
+    if (enqueue(&ingest->queue, t) == 0) return;
+    __atomic_fetch_add(&ingest->full_waits, 1, __ATOMIC_RELAXED);
+    int rounds = 0;
+    while (enqueue(&ingest->queue, t) != 0) ingestIdle(rounds++);
+}
+
+/*
+batchIngestStop() - Applies everything queued, then stops the applier
+ - Time: O(queued), Space: O(1)
+ - Producers must have stopped pushing; clears store->ingest
+ */
+void batchIngestStop(batchingest* ingest) {
+    __atomic_store_n(&ingest->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(ingest->applier, NULL);
+    freeQueue(&ingest->queue);
+    ingest->store->ingest = NULL;
+}
+
+/*
+runBatch() - Runs commands from a file (or stdin) with no prompts or pauses
+ - Time: O(1) average per add/complete/delete/tag, O(n) per query/stats/bulk,
+   Space: O(n) for the name index
+ - One command per line, fields separated by '|', '#' starts a comment:
+     add|name|description|priority|DD/MM/YYYY   (date may be empty or -)
+     put|name|description|priority|DD/MM/YYYY   (add, or replace by name)
+     complete|name      undo      delete|name      tag|name|tag
+     query|all  query|name|text  query|description|text  query|keyword|text
+     query|tag|tag  query|priority|n[-m]  query|status|pending|overdue|completed
+     query|due|DD/MM/YYYY[-DD/MM/YYYY]  query|due|-  (no due date)
+     bulk|complete|<filter>  bulk|delete|<filter>  bulk|tag|<filter>|tag
+     bulk|untag|<filter>|tag  bulk|priority|<filter>|n  (filter: as query)
+     stats      import|file      export|file      today|DD/MM/YYYY   clear
+ - Each command answers "OK" or "ERR line N: message"; query answers
+   "OK <count>" followed by one name|description|priority|date|status|tags
+   row per match, bulk "OK <tasks changed>". Responses are buffered and
+   written in large blocks.
+ - Returns 0 if every command succeeded, 1 otherwise
+ - Sample Case:
+    Input:
+      add|Report|Quarterly report|1|15/06/2025
+      tag|Report|work
+      complete|Report
+      query|tag|work
+    Output:
+      OK
+      OK
+      OK
+      OK 1
+      Report|Quarterly report|1|15/06/2025|completed|work
+ */
+int runBatch(tasklist* list, completedstack* stack, const char* filename) {
+    FILE* in = stdin;
+    if (filename && strcmp(filename, "-") != 0) {
+        in = fopen(filename, "r");
+        if (!in) {
+            perror("Failed to open batch file");
+            return 1;
+        }
+    }
+
+    batchstore store;
+    outbuf out;
+    batchsession session = {&store, &out, 0, 0, -1};
+    if (outbufInit(&out, STDOUT_FILENO, OUTBUF_DEFAULT_SIZE) != 0 ||
+        batchStoreInit(&store, list, stack) != 0) {
+        printf("Memory allocation failed for batch mode.\n");
+        outbufFree(&out);
+        if (in != stdin) fclose(in);
+        return 1;
+    }
+
+    char line[BATCH_LINE_MAX];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        session.line_number++;
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            // Skip the rest of an overlong line
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n') {}
+            batchError(&session, "line too long", NULL);
+            continue;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        batchExecute(&session, line);
+    }
+
+    batchStoreFree(&store);
+    outbufFlush(&out);
+    int failed = session.errors > 0 || out.error;
+
+    outbufFree(&out);
+    if (in != stdin) fclose(in);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <pthread.h>
+#include "task_management.h"
+#include "epoch.h"
+#include "libtodo.h"
+#include "outbuf.h"
+
+// Longest command line, including the newline
+#define BATCH_LINE_MAX 1024
+// Sweep once this many tasks are marked (the default sweep_min) and they
+// make up a quarter of the list
+#define BATCH_SWEEP_MIN 1024
+
+struct batchingest;
+
+// Told about every change to a store, as the batch command that repeats
+// it, while the writer mutex is held (see replication.h)
+typedef void (*batchjournalfn)(void* context, int store_id, const char* line);
+
+// Task list state shared by every command of a batch run or server.
+// One writer at a time changes it; readers may walk the list and stack
+// meanwhile (see batchExecuteShared()).
+typedef struct {
+    tasklist* list;
+    completedstack* stack;
+    date today;
+    todoindex index;
+    task** removed;   // deleted tasks, freed by the next sweep
+    int removed_count;
+    int removed_cap;
+    int unswept;      // completed or deleted tasks still linked in the list
+    int linked;       // tasks linked in the list, marked ones included
+    int sweep_min;    // marked tasks before a sweep is considered
+    pthread_mutex_t writer;
+    epochdomain epoch;  // unlinked tasks and stack nodes wait here for readers
+    struct batchingest* ingest;  // if set, put queues tasks here instead of taking the lock
+    batchjournalfn journal;      // optional change log
+    void* journal_context;
+    int journal_id;              // passed to journal, e.g. the shard number
+    int spawned;                 // next occurrences the running command added, if journaled
+} batchstore;
+
+// Many producer threads push new or updated tasks into a lock-free ring;
+// one applier thread drains it in batches into the store, taking the
+// writer mutex once per batch rather than once per task.
+typedef struct batchingest {
+    batchstore* store;
+    // Optional: picks the store for each task when one ring feeds several
+    batchstore* (*route)(void* context, const task* t);
+    void* route_context;
+    taskqueue queue;
+    pthread_t applier;
+    int stop;
+    long long applied;     // tasks linked into the store
+    long long batches;     // writer mutex acquisitions
+    long long full_waits;  // times a producer found the ring full
+} batchingest;
+
+// One command stream: where its responses go and its line count for errors
+typedef struct {
+    batchstore* store;
+    outbuf* out;
+    long line_number;
+    long errors;
+    int reader_slot;  // epoch slot of the thread running it, -1 if none
+} batchsession;
+
+int batchStoreInit(batchstore* store, tasklist* list, completedstack* stack);
+void batchStoreFree(batchstore* store);
+void batchOk(batchsession* session);
+void batchError(batchsession* session, const char* message, const char* detail);
+void batchExecute(batchsession* session, char* line);
+void batchExecuteShared(batchsession* session, char* line);
+int batchApply(batchstore* store, task* tasks[], int count);
+int batchAdopt(batchstore* store, task* t);
+int batchReset(batchstore* store);
+int batchTaskLine(char* line, size_t size, const char* command, const task* t);
+int batchIngestStart(batchingest* ingest, batchstore* store, int capacity);
+void batchIngestPush(batchingest* ingest, task* t);
+void batchIngestStop(batchingest* ingest);
+int runBatch(tasklist* list, completedstack* stack, const char* filename);
+
+#endif
@@ -0,0 +1,2208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+#include <pthread.h>
+#include "benchmark.h"
+#include "batch.h"
+#include "cluster.h"
+#include "shard.h"
+#include "feed.h"
+#include "fileio.h"
+#include "libtodo.h"
+#include "pool.h"
+#include "reminder.h"
+#include "replication.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "task_management.h"
+#include "undo.h"
+#include "query.h"
+#include "plan.h"
+#include "bitmap.h"
+#include "views.h"
+#include "rank.h"
+
+#define BENCH_FILE "bench_export_tmp.txt"
+#define BENCH_ARCHIVE "bench_archive_tmp.txt"
+// Address space the capped process needs besides the export's own buffers
+// (program image, libc, stdio)
+#define BENCH_ARCHIVE_SLACK (64L * 1024 * 1024)
+
+
+/*
+benchNow() - Monotonic clock in seconds for timing
+ - Time: O(1), Space: O(1)
+ */
+double benchNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Fills in generated task i; seed carries the random state between calls
+static void syntheticTask(task* t, int i, unsigned int* seed) {
+    static const char* tag_pool[] = {"work", "home", "school", "urgent", "waiting", "errand"};
+
+    *seed = *seed * 1103515245u + 12345u;
+    unsigned int r = *seed;
+
+    snprintf(t->name, sizeof(t->name), "Task %d", i);
+    snprintf(t->description, sizeof(t->description), "Generated task number %d", i);
+    t->priority = 1 + (int)(r >> 16) % 3;
+    t->due_date_set = (r >> 8) % 8 != 0;
+    t->duedate.day = 1 + (int)(r >> 4) % 28;
+    t->duedate.month = 1 + (int)(r >> 12) % 12;
+    t->duedate.year = 2025 + (int)(r >> 20) % 2;
+    t->status = (r >> 24) % 5 == 0 ? OVERDUE : PENDING;
+    t->completed = 0;
+    t->tag_count = (int)(r >> 2) % 4;
+    for (int j = 0; j < t->tag_count; j++) {
+        strcpy(t->tags[j], tag_pool[(i + j) % 6]);
+    }
+    if (i % 4 == 3) {
+        t->completed = 1;
+        t->status = COMPLETED;
+    }
+}
+
+/*
+buildSyntheticTasks() - Fills list and stack with generated tasks
+ - Time: O(n), Space: O(n)
+ - Every 4th task is completed (pushed on the stack), about 1/5 are overdue,
+   1/8 have no due date, and tasks carry 0-3 tags
+ - Example: buildSyntheticTasks(&list, &stack, 1000) -> 750 active, 250 completed
+ */
+void buildSyntheticTasks(tasklist* list, completedstack* stack, int count) {
+    unsigned int seed = 12345;
+
+    for (int i = 0; i < count; i++) {
+        task* t = (task*)calloc(1, sizeof(task));
+        if (!t) {
+            printf("Memory allocation failed after %d tasks.\n", i);
+            return;
+        }
+        syntheticTask(t, i, &seed);
+
+        if (t->completed) {
+            stacknode* node = (stacknode*)malloc(sizeof(stacknode));
+            if (!node) {
+                free(t);
+                return;
+            }
+            node->task_data = t;
+            node->next = stack->top;
+            stack->top = node;
+        } else {
+            t->next = list->head;
+            list->head = t;
+        }
+    }
+}
+
+// Old exporter row: sprintf for the date, ternaries for priority,
+// strcat for tags and one fprintf per row; status NULL for the completed
+// table
+static void legacyExportRow(FILE* file, int number, task* t, const char* status) {
+    char date_str[15] = "Not Set";
+    if (t->due_date_set)
+        sprintf(date_str, "%02d/%02d/%04d", t->duedate.day, t->duedate.month, t->duedate.year);
+
+    char* priority_str = (t->priority == 1 ? "High" :
+                          t->priority == 2 ? "Medium" :
+                          t->priority == 3 ? "Low" : "Unknown");
+
+    char tags_str[100] = "";
+    for (int j = 0; j < t->tag_count; j++) {
+        if (j > 0) strcat(tags_str, ", ");
+        strcat(tags_str, t->tags[j]);
+    }
+
+    if (status) {
+        fprintf(file, "%-3d %-25s %-10s %-15s %-10s %-20s\n",
+                number, t->name, priority_str, date_str, status, tags_str);
+    } else {
+        fprintf(file, "%-3d %-25s %-10s %-15s %-20s\n",
+                number, t->name, priority_str, date_str, tags_str);
+    }
+}
+
+typedef struct {
+    task* t;
+    int seq;
+} legacyentry;
+
+// The order the old bubble sorts left overdue tasks in: by due date, ties
+// in list order
+static int compareLegacyOverdue(const void* a, const void* b) {
+    const legacyentry* x = (const legacyentry*)a;
+    const legacyentry* y = (const legacyentry*)b;
+    int order = compareDates(x->t->duedate, y->t->duedate);
+    return order ? order : x->seq - y->seq;
+}
+
+// ... and pending tasks in: dated ones by due date, then those without one,
+// ties in list order
+static int compareLegacyPending(const void* a, const void* b) {
+    const legacyentry* x = (const legacyentry*)a;
+    const legacyentry* y = (const legacyentry*)b;
+    if (x->t->due_date_set != y->t->due_date_set) return x->t->due_date_set ? -1 : 1;
+    int order = x->t->due_date_set ? compareDates(x->t->duedate, y->t->duedate) : 0;
+    return order ? order : x->seq - y->seq;
+}
+
+/*
+legacyExport() - The exporter as it was before the buffered writer, for comparison
+ - Time: O(n log n), Space: O(n)
+ - The same passes, fprintf calls and output as the old exportTasksTxt();
+   only its fixed 200-task arrays are sized to the list and its bubble
+   sorts replaced by qsort() into the same order, so it runs on 1M tasks
+ */
+static void legacyExport(task* head, completedstack* stack, const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        perror("Failed to open benchmark file");
+        return;
+    }
+
+    date today = getToday();
+    int pending_count = 0, completed_count = 0, overdue_count = 0;
+    int high_count = 0, medium_count = 0, low_count = 0;
+    int total_exported = 0;
+
+    fprintf(file, "===== TO-DO LIST EXPORT =====\n");
+    fprintf(file, "Date Exported: %02d/%02d/%04d\n\n", today.day, today.month, today.year);
+
+    int total = 0;
+    for (task* current = head; current; current = current->next) {
+        total++;
+        if (!current->completed) {
+            if (current->status == OVERDUE) overdue_count++;
+            else pending_count++;
+
+            switch(current->priority) {
+                case 1: high_count++; break;
+                case 2: medium_count++; break;
+                case 3: low_count++; break;
+            }
+        }
+    }
+    for (stacknode* node = stack->top; node; node = node->next) completed_count++;
+
+    fprintf(file, "SUMMARY: Overdue: %d | Pending: %d | Completed: %d\n", overdue_count, pending_count, completed_count);
+    fprintf(file, "PRIORITIES: High: %d | Medium: %d | Low: %d\n\n", high_count, medium_count, low_count);
+
+    legacyentry* overdue_tasks = (legacyentry*)malloc(sizeof(legacyentry) * (total + 1));
+    legacyentry* priority_tasks[3];
+    int overdue_tasks_count = 0;
+    int priority_tasks_count[3] = {0};
+    for (int p = 0; p < 3; p++) priority_tasks[p] = (legacyentry*)malloc(sizeof(legacyentry) * (total + 1));
+    if (!overdue_tasks || !priority_tasks[0] || !priority_tasks[1] || !priority_tasks[2]) {
+        free(overdue_tasks);
+        for (int p = 0; p < 3; p++) free(priority_tasks[p]);
+        fclose(file);
+        return;
+    }
+
+    int seq = 0;
+    for (task* current = head; current; current = current->next, seq++) {
+        if (!current->completed) {
+            if (current->status == OVERDUE) {
+                overdue_tasks[overdue_tasks_count++] = (legacyentry){current, seq};
+            } else {
+                int priority_idx = current->priority - 1;
+                if (priority_idx >= 0 && priority_idx < 3) {
+                    priority_tasks[priority_idx][priority_tasks_count[priority_idx]++] = (legacyentry){current, seq};
+                }
+            }
+        }
+    }
+    qsort(overdue_tasks, overdue_tasks_count, sizeof(legacyentry), compareLegacyOverdue);
+    for (int p = 0; p < 3; p++) {
+        qsort(priority_tasks[p], priority_tasks_count[p], sizeof(legacyentry), compareLegacyPending);
+    }
+
+    fprintf(file, "%-3s %-25s %-10s %-15s %-10s %-20s\n", "#", "Name", "Priority", "Due Date", "Status", "Tags");
+    fprintf(file, "--------------------------------------------------------------------------------\n");
+
+    int count = 1;
+    for (int i = 0; i < overdue_tasks_count; i++, total_exported++) {
+        legacyExportRow(file, count++, overdue_tasks[i].t, "OVERDUE");
+    }
+    for (int p = 0; p < 3; p++) {
+        for (int i = 0; i < priority_tasks_count[p]; i++, total_exported++) {
+            legacyExportRow(file, count++, priority_tasks[p][i].t, "Pending");
+        }
+    }
+
+    fprintf(file, "\n===== COMPLETED TASKS =====\n");
+    fprintf(file, "%-3s %-25s %-10s %-15s %-20s\n", "#", "Name", "Priority", "Due Date", "Tags");
+    fprintf(file, "--------------------------------------------------------------------------------\n");
+
+    count = 1;
+    for (stacknode* node = stack->top; node; node = node->next) {
+        if (node->task_data) {
+            legacyExportRow(file, count++, node->task_data, NULL);
+            total_exported++;
+        }
+    }
+
+    fprintf(file, "\n===== EXPORT SUMMARY =====\n");
+    fprintf(file, "Total Tasks Exported: %d\n", total_exported);
+    fprintf(file, "Pending Tasks: %d\n", pending_count);
+    fprintf(file, "Overdue Tasks: %d\n", overdue_count);
+    fprintf(file, "Completed Tasks: %d\n", completed_count);
+    fprintf(file, "High Priority: %d\n", high_count);
+    fprintf(file, "Medium Priority: %d\n", medium_count);
+    fprintf(file, "Low Priority: %d\n", low_count);
+
+    free(overdue_tasks);
+    for (int p = 0; p < 3; p++) free(priority_tasks[p]);
+    fclose(file);
+}
+
+/*
+benchmarkExport() - Compares buffered export with the fprintf exporter it replaced
+ - Time: O(n log n), Space: O(n)
+ - Both write the same file byte for byte
+ - Sample Case:
+    Input: 1000000 tasks
+    Output:
+      fprintf export:   2.16 s  (462537 rows/s)
+      buffered export:  0.57 s  (1757809 rows/s)
+      Speedup: 3.8x
+ */
+static void benchmarkExport(int count) {
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+
+    printf("\n--- Export: %d tasks ---\n", count);
+    double start = benchNow();
+    buildSyntheticTasks(&list, &stack, count);
+    printf("Generated in %.2f s\n", benchNow() - start);
+
+    start = benchNow();
+    legacyExport(list.head, &stack, BENCH_FILE);
+    double legacy_time = benchNow() - start;
+    // Each export starts from no file: replacing the old one would make the
+    // buffered export's fsync() also write back the fprintf output
+    remove(BENCH_FILE);
+
+    start = benchNow();
+    exportTasksTxt(list.head, &stack, BENCH_FILE);
+    double export_time = benchNow() - start;
+    remove(BENCH_FILE);
+
+    printf("fprintf export:   %.2f s  (%.0f rows/s)\n",
+           legacy_time, legacy_time > 0 ? count / legacy_time : 0);
+    printf("buffered export:  %.2f s  (%.0f rows/s)\n",
+           export_time, export_time > 0 ? count / export_time : 0);
+    if (export_time > 0) {
+        printf("Speedup: %.1fx\n", legacy_time / export_time);
+    }
+
+    freeTasks(&list);
+    list.head = NULL;
+    freeStack(&stack);
+}
+
+// Prints one row of the library benchmark
+static void reportOps(const char* label, long ops, double seconds) {
+    printf("%-22s %8.2f ms  (%6.0f ns/op)\n", label, seconds * 1000, ops > 0 ? seconds * 1e9 / ops : 0);
+}
+
+/*
+benchmarkLibrary() - Times the libtodo calls the menu and batch mode are built on
+ - Time: O(n), Space: O(n)
+ - Tasks are completed newest first, so each todoComplete() finds its task at
+   the head and the time is the call itself rather than the list walk
+ - Sample Case:
+    Input: 1000000 tasks
+    Output:
+      todoAdd (indexed)       1697.18 ms  (  1697 ns/op)
+      todoMatches (tag)         85.84 ms  (    86 ns/op)
+ */
+static void benchmarkLibrary(int count) {
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    todoindex index = {NULL, 0, 0};
+    date today = {1, 6, 2025};
+    task generated;
+    unsigned int seed = 12345;
+    int added = 0;
+
+    printf("\n--- Library calls: %d tasks ---\n", count);
+    if (todoIndexBuild(&index, NULL) != 0) {
+        printf("Memory allocation failed.\n");
+        return;
+    }
+
+    double start = benchNow();
+    for (int i = 0; i < count; i++) {
+        syntheticTask(&generated, i, &seed);
+        if (todoAdd(&list, &index, generated.name, generated.description, generated.priority,
+                    generated.due_date_set ? &generated.duedate : NULL, today, NULL) != TODO_OK) {
+            printf("todoAdd failed after %d tasks.\n", i);
+            break;
+        }
+        added++;
+    }
+    reportOps("todoAdd (indexed)", added, benchNow() - start);
+
+    start = benchNow();
+    for (task* t = list.head; t; t = t->next) todoAddTag(t, (t->priority == 1) ? "work" : "home");
+    reportOps("todoAddTag", added, benchNow() - start);
+
+    todoquery query = {TODO_MATCH_TAG, "work", 0, 0, PENDING, {0}, {0}, NULL};
+    int matches = 0;
+    start = benchNow();
+    for (task* t = list.head; t; t = t->next) matches += todoMatches(t, &query);
+    reportOps("todoMatches (tag)", added, benchNow() - start);
+
+    start = benchNow();
+    int overdue = todoRefreshStatuses(list.head, today);
+    reportOps("todoRefreshStatuses", added, benchNow() - start);
+
+    int lookups = 0;
+    start = benchNow();
+    for (task* t = list.head; t; t = t->next) lookups += todoIndexFind(&index, t->name) == t;
+    reportOps("todoIndexFind", added, benchNow() - start);
+
+    int completed = 0;
+    start = benchNow();
+    while (list.head && completed < added / 2) {
+        todoComplete(&list, &stack, &index, list.head->name, today, NULL);
+        completed++;
+    }
+    reportOps("todoComplete", completed, benchNow() - start);
+
+    start = benchNow();
+    for (int i = 0; i < completed; i++) todoUndo(&list, &stack, &index, NULL);
+    reportOps("todoUndo", completed, benchNow() - start);
+
+    printf("%d tagged work, %d overdue, %d found by name\n", matches, overdue, lookups);
+
+    todoIndexFree(&index);
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+#define STRESS_TASKS 2000
+
+// One thread of the concurrent reads benchmark
+typedef struct {
+    pthread_t thread;
+    batchstore* store;
+    int id;
+    int ops;
+    long reads;
+    long writes;
+} stressworker;
+
+// Runs a 95/5 read/write mix of batch commands against the shared store
+static void* stressThread(void* arg) {
+    static const char* reads[] = {"stats", "query|tag|work", "query|name|Task 19", "query|status|overdue"};
+    stressworker* sw = (stressworker*)arg;
+    outbuf out;
+    char line[128];
+    unsigned int seed = 777u + (unsigned int)sw->id;
+
+    if (outbufInit(&out, -1, 64 * 1024) != 0) return NULL;
+    batchsession session = {sw->store, &out, 0, 0, epochRegister(&sw->store->epoch)};
+
+    for (int i = 0; i < sw->ops; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned int r = seed >> 8;
+        if (r % 100 < 95) {
+            snprintf(line, sizeof(line), "%s", reads[r / 100 % 4]);
+            sw->reads++;
+        } else {
+            // Each thread works on its own names; undo and clear free shared memory
+            int k = (int)(r / 100 % 64);
+            switch (r / 6400 % 6) {
+                case 0: snprintf(line, sizeof(line), "add|st%d-%d|stress|%d|15/06/2025", sw->id, k, 1 + k % 3); break;
+                case 1: snprintf(line, sizeof(line), "tag|st%d-%d|work", sw->id, k); break;
+                case 2: snprintf(line, sizeof(line), "complete|st%d-%d", sw->id, k); break;
+                case 3: snprintf(line, sizeof(line), "delete|st%d-%d", sw->id, k); break;
+                case 4: snprintf(line, sizeof(line), "undo"); break;
+                default: snprintf(line, sizeof(line), "%s", k == 0 ? "clear" : "today|01/06/2025"); break;
+            }
+            sw->writes++;
+        }
+        batchExecuteShared(&session, line);
+        out.len = 0;
+    }
+    outbufFree(&out);
+    return NULL;
+}
+
+/*
+benchmarkConcurrentReads() - Scaling of lock-free reads
+ - Time: O(threads * ops * n), Space: O(n)
+ - Threads run 95% query/stats and 5% add/tag/complete/delete/undo/clear on
+   one store. Reads take no lock while writers unlink and retire tasks; the
+   same mix runs under -fsanitize=thread in tests/concurrency_stress.c
+   (make tsan-check).
+ - Prints reads/s for 1, 2, 4, ... threads up to twice the core count, and
+   checks that everything retired was freed
+ - Sample Case:
+    threads      reads/s   writes/s    retired  reclaimed
+          1        51230       2701       1388       1388
+ */
+static void benchmarkConcurrentReads(int ops) {
+#ifdef _WIN32
+    long cores = 4;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    int max_threads = cores > 0 && cores < EPOCH_MAX_READERS / 2 ? (int)cores * 2 : 8;
+    if (max_threads < 4) max_threads = 4;
+
+    printf("\n--- Concurrent reads: %d tasks, %d ops per thread, 95%% reads ---\n", STRESS_TASKS, ops);
+    printf("%7s %12s %10s %10s %10s\n", "threads", "reads/s", "writes/s", "retired", "reclaimed");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        tasklist list = {NULL};
+        completedstack stack = {NULL};
+        batchstore store;
+        stressworker workers[EPOCH_MAX_READERS];
+
+        buildSyntheticTasks(&list, &stack, STRESS_TASKS);
+        if (batchStoreInit(&store, &list, &stack) != 0) {
+            printf("Memory allocation failed.\n");
+            freeTasks(&list);
+            freeStack(&stack);
+            return;
+        }
+
+        double start = benchNow();
+        for (int i = 0; i < threads; i++) {
+            workers[i] = (stressworker){0, &store, i, ops, 0, 0};
+            pthread_create(&workers[i].thread, NULL, stressThread, &workers[i]);
+        }
+        long reads = 0, writes = 0;
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i].thread, NULL);
+            reads += workers[i].reads;
+            writes += workers[i].writes;
+        }
+        double elapsed = benchNow() - start;
+
+        // Frees the rest of the retired memory; the counters stay readable
+        batchStoreFree(&store);
+        printf("%7d %12.0f %10.0f %10lld %10lld%s\n", threads, reads / elapsed, writes / elapsed,
+               store.epoch.retired, store.epoch.reclaimed,
+               store.epoch.reclaimed == store.epoch.retired ? "" : "  LEAK");
+
+        freeTasks(&list);
+        freeStack(&stack);
+    }
+}
+
+#define INGEST_MAX_PRODUCERS 32
+
+// One producer thread of the ingest benchmark
+typedef struct {
+    pthread_t thread;
+    batchingest* ingest;
+    task** tasks;        // built before the clock starts
+    double* latencies;   // seconds per batchIngestPush()
+    int count;
+} ingestproducer;
+
+static void* ingestProducer(void* arg) {
+    ingestproducer* p = (ingestproducer*)arg;
+    for (int i = 0; i < p->count; i++) {
+        double start = benchNow();
+        batchIngestPush(p->ingest, p->tasks[i]);
+        p->latencies[i] = benchNow() - start;
+    }
+    return NULL;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Makes producer id's tasks; every 8th one updates an earlier name
+static int buildIngestTasks(ingestproducer* p, int id, int count, date today) {
+    char name[32];
+    p->tasks = (task**)malloc(sizeof(task*) * count);
+    p->latencies = (double*)malloc(sizeof(double) * count);
+    if (!p->tasks || !p->latencies) return -1;
+    for (int k = 0; k < count; k++) {
+        int n = k % 8 == 7 ? k - 7 : k;
+        date due = {1 + k % 28, 1 + k % 12, 2025};
+        snprintf(name, sizeof(name), "in%d-%d", id, n);
+        if (todoCreateTask(name, "ingest", 1 + k % 3, &due, today, &p->tasks[k]) != TODO_OK) {
+            p->count = k;
+            return -1;
+        }
+    }
+    p->count = count;
+    return 0;
+}
+
+/*
+benchmarkIngest() - Throughput and tail latency of the lock-free ingest ring
+ - Time: O(producers * count), Space: O(producers * count)
+ - 1, 2, 4, ... 32 producers push prebuilt tasks (1 in 8 an update) while
+   the applier links them into a store of STRESS_TASKS tasks. Prints pushes/s,
+   push latency percentiles, how often the ring was full, and checks that
+   every task arrived.
+ - Sample Case:
+    producers     pushes/s   p50 ns   p99 ns  p99.9 ns  full  batches  check
+            1      8912345       45      120      2300     0      412     ok
+ */
+static void benchmarkIngest(int count) {
+    date today = getToday();
+    printf("\n--- Ingest ring: %d tasks per producer, ring of %d ---\n", count, TASKQUEUE_DEFAULT_SIZE);
+    printf("%9s %12s %8s %8s %9s %7s %8s %6s\n",
+           "producers", "pushes/s", "p50 ns", "p99 ns", "p99.9 ns", "full", "batches", "check");
+
+    for (int producers = 1; producers <= INGEST_MAX_PRODUCERS; producers *= 2) {
+        tasklist list = {NULL};
+        completedstack stack = {NULL};
+        batchstore store;
+        batchingest ingest;
+        ingestproducer ps[INGEST_MAX_PRODUCERS];
+        memset(ps, 0, sizeof(ps));
+
+        buildSyntheticTasks(&list, &stack, STRESS_TASKS);
+        int built = batchStoreInit(&store, &list, &stack) == 0;
+        for (int i = 0; built && i < producers; i++) {
+            ps[i].ingest = &ingest;
+            if (buildIngestTasks(&ps[i], i, count, today) != 0) built = 0;
+        }
+        if (!built || batchIngestStart(&ingest, &store, TASKQUEUE_DEFAULT_SIZE) != 0) {
+            printf("Memory allocation failed.\n");
+            for (int i = 0; i < producers; i++) {
+                for (int k = 0; k < ps[i].count; k++) free(ps[i].tasks[k]);
+                free(ps[i].tasks);
+                free(ps[i].latencies);
+            }
+            freeTasks(&list);
+            freeStack(&stack);
+            return;
+        }
+
+        long initial = 0;
+        for (task* t = list.head; t; t = t->next) initial++;
+
+        double start = benchNow();
+        for (int i = 0; i < producers; i++) pthread_create(&ps[i].thread, NULL, ingestProducer, &ps[i]);
+        for (int i = 0; i < producers; i++) pthread_join(ps[i].thread, NULL);
+        double elapsed = benchNow() - start;
+        batchIngestStop(&ingest);
+
+        long total = (long)producers * count;
+        double* all = (double*)malloc(sizeof(double) * total);
+        if (all) {
+            for (int i = 0; i < producers; i++) memcpy(all + (long)i * count, ps[i].latencies, sizeof(double) * count);
+            qsort(all, (size_t)total, sizeof(double), compareDoubles);
+        }
+
+        // Updates replace their task, so each producer leaves count - count/8 names
+        long active = 0;
+        for (task* t = list.head; t; t = t->next) {
+            if (!t->completed) active++;
+        }
+        int ok = ingest.applied == total && active == initial + (long)producers * (count - count / 8);
+        printf("%9d %12.0f %8.0f %8.0f %9.0f %7lld %8lld %6s\n", producers, total / elapsed,
+               all ? all[total / 2] * 1e9 : 0, all ? all[total * 99 / 100] * 1e9 : 0,
+               all ? all[total * 999 / 1000] * 1e9 : 0, ingest.full_waits, ingest.batches,
+               ok ? "ok" : "LOST");
+        free(all);
+
+        batchStoreFree(&store);
+        for (int i = 0; i < producers; i++) {
+            free(ps[i].tasks);
+            free(ps[i].latencies);
+        }
+        freeTasks(&list);
+        freeStack(&stack);
+    }
+}
+
+// Work for the pool benchmark: the checks a status refresh and priority
+// adjustment do, without changing the tasks
+typedef struct {
+    task** tasks;
+    long count;
+    date today;
+    int skewed;      // the first eighth of the list costs 16 times as much
+    long overdue;
+} poolscan;
+
+static void poolScanRange(void* arg, long begin, long end) {
+    poolscan* scan = (poolscan*)arg;
+    long overdue = 0;
+    for (long i = begin; i < end; i++) {
+        int repeat = scan->skewed && i < scan->count / 8 ? 16 : 1;
+        for (int r = 0; r < repeat; r++) {
+            task* t = scan->tasks[i];
+            if (todoStatusForDate(t, scan->today) == OVERDUE ||
+                (t->due_date_set && getDaysBetween(scan->today, t->duedate) <= 2)) {
+                overdue += r == 0;
+            }
+        }
+    }
+    __atomic_fetch_add(&scan->overdue, overdue, __ATOMIC_RELAXED);
+}
+
+/*
+benchmarkPool() - Scaling and balance of the work-stealing pool
+ - Time: O(workers * n), Space: O(n)
+ - Scans count generated tasks in 8192-task chunks with 1, 2, 4, ... workers,
+   once with even chunks and once with the first eighth 16 times as costly,
+   which only spreads out if idle workers steal. Prints time, mean worker
+   utilization, steals and the deepest any deque got, then the per-worker
+   table for the largest pool.
+ - Sample Case:
+    workers   even ms  skewed ms   busy %   steals  max queued
+          1      31.2      118.4     97.1        0           7
+ */
+static void benchmarkPool(int count) {
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    buildSyntheticTasks(&list, &stack, count);
+
+    poolscan scan = {(task**)malloc(sizeof(task*) * count), 0, getToday(), 0, 0};
+    if (!scan.tasks) {
+        printf("Memory allocation failed.\n");
+        freeTasks(&list);
+        freeStack(&stack);
+        return;
+    }
+    for (task* t = list.head; t; t = t->next) scan.tasks[scan.count++] = t;
+
+#ifdef _WIN32
+    long cores = 4;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    int max_workers = cores > 0 && cores * 2 < POOL_MAX_WORKERS ? (int)cores * 2 : POOL_MAX_WORKERS;
+    if (max_workers < 4) max_workers = 4;
+
+    double start = benchNow();
+    poolScanRange(&scan, 0, scan.count);
+    printf("\n--- Work-stealing pool: %ld tasks, chunks of 8192 ---\n", scan.count);
+    printf("Single thread, no pool: %.1f ms\n", (benchNow() - start) * 1000);
+    printf("%7s %9s %10s %8s %8s %11s\n", "workers", "even ms", "skewed ms", "busy %", "steals", "max queued");
+
+    for (int workers = 1; workers <= max_workers; workers *= 2) {
+        taskpool pool;
+        if (poolInit(&pool, workers) != 0) {
+            printf("Could not start %d workers.\n", workers);
+            break;
+        }
+        double ms[2];
+        for (int skewed = 0; skewed <= 1; skewed++) {
+            poolgroup group = {0};
+            scan.skewed = skewed;
+            start = benchNow();
+            poolFor(&pool, &group, scan.count, 8192, poolScanRange, &scan);
+            poolWait(&pool, &group);
+            ms[skewed] = (benchNow() - start) * 1000;
+        }
+
+        poolstats stats;
+        poolGetStats(&pool, &stats);
+        double busy = 0;
+        long long steals = 0;
+        long max_depth = 0;
+        for (int i = 0; i < stats.workers; i++) {
+            busy += stats.utilization[i];
+            steals += stats.steals[i];
+            if (stats.max_depth[i] > max_depth) max_depth = stats.max_depth[i];
+        }
+        printf("%7d %9.1f %10.1f %8.1f %8lld %11ld\n", stats.workers, ms[0], ms[1],
+               busy * 100 / stats.workers, steals, max_depth);
+        if (workers * 2 > max_workers) poolPrintStats(&pool);
+        poolShutdown(&pool);
+    }
+
+    free(scan.tasks);
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+// One writer thread of the sharding benchmark
+typedef struct {
+    pthread_t thread;
+    shardset* set;
+    int id;
+    int ops;
+} shardwriter;
+
+// add, tag, complete, add and delete on the thread's own names, through the router
+static void* shardWriterThread(void* arg) {
+    shardwriter* sw = (shardwriter*)arg;
+    shardsession session;
+    outbuf out;
+    char line[128];
+
+    if (outbufInit(&out, -1, 64 * 1024) != 0) return NULL;
+    memset(&session, 0, sizeof(session));
+    session.set = sw->set;
+    session.out = &out;
+    shardRegisterReaders(sw->set, session.reader_slots);
+
+    for (int i = 0; i < sw->ops; i++) {
+        int k = i / 5;
+        switch (i % 5) {
+            case 0: snprintf(line, sizeof(line), "add|sh%d-%d|shard test|%d|15/06/2025", sw->id, k, 1 + k % 3); break;
+            case 1: snprintf(line, sizeof(line), "tag|sh%d-%d|work", sw->id, k); break;
+            case 2: snprintf(line, sizeof(line), "complete|sh%d-%d", sw->id, k); break;
+            case 3: snprintf(line, sizeof(line), "add|tmp%d-%d|scratch|3|15/06/2025", sw->id, k); break;
+            default: snprintf(line, sizeof(line), "delete|tmp%d-%d", sw->id, k); break;
+        }
+        session.line_number++;
+        shardExecute(&session, line);
+        out.len = 0;
+    }
+    outbufFree(&out);
+    return NULL;
+}
+
+/*
+benchmarkShards() - Write scaling of one locked store against a sharded one
+ - Time: O(threads * ops), Space: O(threads * ops)
+ - 1, 2, 4, ... threads each run add/tag/complete/delete on their own names,
+   first on a single shard (every write takes the same lock), then on one
+   shard per thread. Each run checks the merged stats against the work done.
+ - Sample Case:
+    threads   1 shard w/s   N shards w/s   speedup  check
+          4        812000        2950000      3.63     ok
+ */
+static void benchmarkShards(int ops) {
+#ifdef _WIN32
+    long cores = 4;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    int max_threads = cores > 0 && cores * 2 < EPOCH_MAX_READERS ? (int)cores * 2 : 8;
+    if (max_threads < 4) max_threads = 4;
+
+    printf("\n--- Sharded writes: %d ops per thread ---\n", ops);
+    printf("%7s %14s %14s %9s %6s\n", "threads", "1 shard w/s", "N shards w/s", "speedup", "check");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double rate[2];
+        int ok = 1;
+        for (int run = 0; run < 2; run++) {
+            tasklist list = {NULL};
+            completedstack stack = {NULL};
+            shardset set;
+            shardwriter writers[EPOCH_MAX_READERS];
+            if (shardSetInit(&set, &list, &stack, run == 0 ? 1 : threads) != 0) {
+                printf("Memory allocation failed.\n");
+                return;
+            }
+
+            double start = benchNow();
+            for (int i = 0; i < threads; i++) {
+                writers[i] = (shardwriter){0, &set, i, ops};
+                pthread_create(&writers[i].thread, NULL, shardWriterThread, &writers[i]);
+            }
+            for (int i = 0; i < threads; i++) pthread_join(writers[i].thread, NULL);
+            rate[run] = (double)threads * ops / (benchNow() - start);
+
+            // Every complete must have landed on some shard's stack
+            outbuf out;
+            shardsession session;
+            memset(&session, 0, sizeof(session));
+            session.set = &set;
+            if (outbufInit(&out, -1, 256) == 0) {
+                char line[] = "stats";
+                session.out = &out;
+                shardRegisterReaders(&set, session.reader_slots);
+                shardExecute(&session, line);
+                long completed = -1;
+                const char* found = out.len ? strstr(out.data, "completed=") : NULL;
+                if (found) completed = atol(found + 10);
+                if (completed != (long)threads * ((ops + 2) / 5)) ok = 0;
+                outbufFree(&out);
+            }
+            shardSetFree(&set, &list, &stack);
+            freeTasks(&list);
+            freeStack(&stack);
+        }
+        printf("%7d %14.0f %14.0f %9.2f %6s\n", threads, rate[0], rate[1], rate[1] / rate[0], ok ? "ok" : "BAD");
+    }
+}
+
+/*
+benchmarkRing() - Keys moved when a node joins or leaves the cluster ring
+ - Time: O(keys * nodes), Space: O(keys)
+ - For 1 to 16 nodes, assigns `keys` names with the consistent-hash ring,
+   adds a node (and, separately, removes the first one) and counts the names
+   whose node changed, against the 1/N ideal and against hash % nodes.
+   Balance is the largest node's share over the average.
+ - Sample Case:
+    nodes  join moved  ideal   leave moved  modulo moved  balance
+        4      22.1%   20.0%        26.1%        79.8%      1.04
+ */
+static void benchmarkRing(int keys) {
+    static const int sizes[] = {1, 2, 3, 4, 8, 16};
+    char (*paths)[32] = (char (*)[32])malloc(sizeof(*paths) * 17);
+    int* owner = (int*)malloc(sizeof(int) * keys);
+    if (!paths || !owner) {
+        free(paths);
+        free(owner);
+        printf("Memory allocation failed.\n");
+        return;
+    }
+    const char* names[17];
+    for (int n = 0; n < 17; n++) {
+        snprintf(paths[n], sizeof(paths[n]), "/tmp/todolist.sock.%d", n);
+        names[n] = paths[n];
+    }
+
+    printf("\n--- Consistent-hash ring: %d keys, %d points per node ---\n", keys, CLUSTER_VNODES);
+    printf("%5s %11s %7s %13s %13s %8s\n", "nodes", "join moved", "ideal", "leave moved", "modulo moved", "balance");
+    char name[32];
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        int nodes = sizes[s];
+        hashring ring, joined, left;
+        if (ringBuild(&ring, names, nodes) != 0 || ringBuild(&joined, names, nodes + 1) != 0 ||
+            ringBuild(&left, names + 1, nodes > 1 ? nodes - 1 : 1) != 0) {
+            printf("Memory allocation failed.\n");
+            break;
+        }
+        long join_moved = 0, leave_moved = 0, modulo_moved = 0, load[17] = {0};
+        for (int k = 0; k < keys; k++) {
+            snprintf(name, sizeof(name), "task-%d", k);
+            owner[k] = ringLookup(&ring, name);
+            load[owner[k]]++;
+            join_moved += ringLookup(&joined, name) != owner[k];
+            // Ring without node 0: the others are numbered from 1
+            if (nodes > 1) leave_moved += ringLookup(&left, name) + 1 != owner[k];
+            unsigned int h = shardHash(name);
+            modulo_moved += h % (unsigned int)nodes != h % (unsigned int)(nodes + 1);
+        }
+        long largest = 0;
+        for (int n = 0; n < nodes; n++) if (load[n] > largest) largest = load[n];
+
+        char leave_text[16];
+        if (nodes > 1) snprintf(leave_text, sizeof(leave_text), "%.1f%%", 100.0 * leave_moved / keys);
+        else snprintf(leave_text, sizeof(leave_text), "-");
+        printf("%5d %10.1f%% %6.1f%% %13s %12.1f%% %8.2f\n", nodes, 100.0 * join_moved / keys,
+               100.0 / (nodes + 1), leave_text, 100.0 * modulo_moved / keys,
+               (double)largest * nodes / keys);
+        ringFree(&ring);
+        ringFree(&joined);
+        ringFree(&left);
+    }
+    free(paths);
+    free(owner);
+}
+
+/*
+writeSyntheticArchive() - Streams generated tasks to an archive file
+ - Time: O(n), Space: O(1)
+ - Same tasks as buildSyntheticTasks(), written one line at a time so the
+   archive can be far larger than memory
+ */
+static int writeSyntheticArchive(const char* filename, long count) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        perror("Failed to create benchmark archive");
+        return -1;
+    }
+
+    unsigned int seed = 12345;
+    task t;
+    for (long i = 0; i < count; i++) {
+        syntheticTask(&t, (int)i, &seed);
+        const char* status = t.completed ? "completed" : t.status == OVERDUE ? "overdue" : "pending";
+        fprintf(file, "%s,%s,%d,%02d/%02d/%04d,%s", t.name, t.description, t.priority,
+                t.due_date_set ? t.duedate.day : 0, t.due_date_set ? t.duedate.month : 0,
+                t.due_date_set ? t.duedate.year : 0, status);
+        for (int j = 0; j < t.tag_count; j++) {
+            fprintf(file, "%c%s", j == 0 ? ',' : ';', t.tags[j]);
+        }
+        fputc('\n', file);
+    }
+
+    if (fclose(file) != 0) {
+        perror("Failed to write benchmark archive");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+benchmarkArchive() - Times the external-memory export under a memory cap
+ - Time: O(n log n), Space: O(memory_mb)
+ - The export runs in a child process limited with setrlimit(RLIMIT_AS),
+   the same limit `ulimit -v` sets, so going over the budget fails the run
+   instead of swapping. Peak memory is the child's maximum resident size.
+   macOS does not enforce RLIMIT_AS; the peak is still reported there.
+ - Sample Case:
+    Input: 3000000 tasks, 64 MB
+    Output:
+      Archive written in 2.73 s
+      Archive export:   6.95 s  (431470 rows/s)
+      Peak memory:      62.1 MB (limit 128 MB)
+ */
+static void benchmarkArchive(long count, int memory_mb) {
+    printf("\n--- Archive export: %ld tasks, %d MB ---\n", count, memory_mb);
+
+    double start = benchNow();
+    if (writeSyntheticArchive(BENCH_ARCHIVE, count) != 0) return;
+    printf("Archive written in %.2f s\n", benchNow() - start);
+    fflush(stdout);
+
+    size_t budget = (size_t)memory_mb * 1024 * 1024;
+    int ok;
+    start = benchNow();
+#ifdef _WIN32
+    ok = exportArchiveTxt(BENCH_ARCHIVE, BENCH_FILE, budget) == 0;
+    double elapsed = benchNow() - start;
+#else
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        remove(BENCH_ARCHIVE);
+        return;
+    }
+    if (pid == 0) {
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = (rlim_t)(budget + BENCH_ARCHIVE_SLACK);
+        if (setrlimit(RLIMIT_AS, &limit) != 0) perror("setrlimit failed");
+        int rc = exportArchiveTxt(BENCH_ARCHIVE, BENCH_FILE, budget);
+        fflush(stdout);
+        _exit(rc == 0 ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    double elapsed = benchNow() - start;
+    ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+    remove(BENCH_ARCHIVE);
+    remove(BENCH_FILE);
+
+    if (!ok) {
+        printf("Archive export failed within the memory limit.\n");
+        return;
+    }
+    printf("Archive export:   %.2f s  (%.0f rows/s)\n",
+           elapsed, elapsed > 0 ? count / elapsed : 0);
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+#ifdef __APPLE__
+    double peak_mb = usage.ru_maxrss / (1024.0 * 1024.0);  // bytes on macOS
+#else
+    double peak_mb = usage.ru_maxrss / 1024.0;             // kilobytes on Linux
+#endif
+    printf("Peak memory:      %.1f MB (limit %ld MB)\n",
+           peak_mb, (long)((budget + BENCH_ARCHIVE_SLACK) / (1024 * 1024)));
+#endif
+}
+
+#ifndef _WIN32
+// Reads a follower's stream, remembering the seq of the newest change in it
+typedef struct {
+    pthread_t thread;
+    int fd;
+    long long bytes;
+    unsigned long received;
+} repldrain;
+
+static void* replDrainThread(void* arg) {
+    repldrain* d = (repldrain*)arg;
+    char buffer[64 * 1024];
+    char line[32];
+    size_t line_len = 0;
+    ssize_t n;
+    while ((n = read(d->fd, buffer, sizeof(buffer))) > 0) {
+        d->bytes += n;
+        for (ssize_t i = 0; i < n; i++) {
+            if (buffer[i] != '\n') {
+                if (line_len < sizeof(line) - 1) line[line_len++] = buffer[i];
+                continue;
+            }
+            line[line_len] = '\0';
+            line_len = 0;
+            if (line[0] >= '0' && line[0] <= '9') {
+                __atomic_store_n(&d->received, strtoul(line, NULL, 10), __ATOMIC_RELEASE);
+            }
+        }
+    }
+    return NULL;
+}
+#endif
+
+/*
+benchmarkReplication() - What journaling writes for a follower costs the writer
+ - Time: O(ops), Space: O(ops)
+ - One writer runs add/tag/complete/delete on a 4-shard store three times:
+   with no journal, journaling with nobody following (a counter only), and
+   with one follower whose stream another thread reads. Catch-up is how
+   long after the last write the follower had received it.
+ - Sample Case:
+    journal            writes/s  bytes/change  catch-up ms
+    none                1160000             -            -
+    no followers        1060000             -            -
+    1 follower           430000            50          0.2
+ */
+static void benchmarkReplication(int ops) {
+#ifdef _WIN32
+    (void)ops;
+    printf("Replication needs Unix domain sockets and is not available on Windows.\n");
+#else
+    static const char* const modes[] = {"none", "no followers", "1 follower"};
+    printf("\n--- Replication journal: %d writes on 4 shards ---\n", ops);
+    printf("%-14s %12s %13s %12s\n", "journal", "writes/s", "bytes/change", "catch-up ms");
+    for (int mode = 0; mode < 3; mode++) {
+        tasklist list = {NULL};
+        completedstack stack = {NULL};
+        shardset set;
+        repljournal journal;
+        if (shardSetInit(&set, &list, &stack, 4) != 0) {
+            printf("Memory allocation failed.\n");
+            return;
+        }
+        int journaled = mode > 0 && replJournalStart(&journal) == 0;
+        if (journaled) shardSetJournal(&set, replRecord, &journal);
+
+        repldrain drain;
+        memset(&drain, 0, sizeof(drain));
+        int fds[2];
+        int following = 0;
+        if (mode == 2 && journaled && socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0) {
+            drain.fd = fds[1];
+            if (replAttach(&journal, &set, fds[0]) == 0 &&
+                pthread_create(&drain.thread, NULL, replDrainThread, &drain) == 0) {
+                following = 1;
+            } else {
+                close(fds[1]);
+            }
+        }
+
+        shardwriter writer = {0, &set, 0, ops};
+        double start = benchNow();
+        shardWriterThread(&writer);
+        double elapsed = benchNow() - start;
+        double catch_up = 0;
+        if (following) {
+            unsigned long last = __atomic_load_n(&journal.seq, __ATOMIC_RELAXED);
+            struct timespec pause = {0, 100 * 1000};
+            while (__atomic_load_n(&drain.received, __ATOMIC_ACQUIRE) < last && benchNow() - start < elapsed + 10) {
+                nanosleep(&pause, NULL);
+            }
+            catch_up = (benchNow() - start - elapsed) * 1000;
+        }
+        // Stopping the journal closes the follower's end, which ends the drain
+        if (journaled) replJournalStop(&journal);
+        if (following) {
+            pthread_join(drain.thread, NULL);
+            close(fds[1]);
+            printf("%-14s %12.0f %13.0f %12.1f\n", modes[mode], ops / elapsed,
+                   (double)drain.bytes / (journal.seq ? journal.seq : 1), catch_up);
+        } else {
+            printf("%-14s %12.0f %13s %12s\n", modes[mode], ops / elapsed, "-", "-");
+        }
+        shardSetFree(&set, &list, &stack);
+        freeTasks(&list);
+        freeStack(&stack);
+    }
+#endif
+}
+
+/*
+benchmarkSnapshot() - What a dashboard pays for the numbers: export file or snapshot
+ - Time: O(n), Space: O(n)
+ - Without snapshots another process has to read an export file to get
+   counts or look a task up. This times writing and reading that file
+   against publishing a snapshot of a 4-shard store and reading it from
+   shared memory: open and map, the counts in the header, and name lookups
+   (active tasks only, so a quarter of the generated names miss).
+ - Sample Case:
+    Input: 1000000 tasks
+    Output:
+      export file:          624.8 ms
+      read it back:          52.2 ms  (1000000 rows)
+      publish snapshot:     418.4 ms  (105.8 MB)
+      open and stats:        0.08 ms  (pending=158512)
+      snapshot lookup:        646 ns/op  (75000/100000 found, 1000000 tasks)
+ */
+static void benchmarkSnapshot(int count) {
+#ifdef _WIN32
+    (void)count;
+    printf("Snapshots need POSIX shared memory and are not available on Windows.\n");
+#else
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    shardset set;
+    printf("\n--- Snapshot for other processes: %d tasks ---\n", count);
+    buildSyntheticTasks(&list, &stack, count);
+
+    double start = benchNow();
+    exportTasksTxt(list.head, &stack, BENCH_FILE);
+    double export_time = benchNow() - start;
+
+    // The reader's side: read the file back, counting the task rows
+    start = benchNow();
+    long rows = 0;
+    FILE* file = fopen(BENCH_FILE, "r");
+    char row[512];
+    while (file && fgets(row, sizeof(row), file)) rows += row[0] >= '0' && row[0] <= '9';
+    if (file) fclose(file);
+    double read_time = benchNow() - start;
+    remove(BENCH_FILE);
+
+    if (shardSetInit(&set, &list, &stack, 4) != 0) {
+        printf("Memory allocation failed.\n");
+        freeTasks(&list);
+        freeStack(&stack);
+        return;
+    }
+    char name[SNAP_NAME_MAX];
+    snprintf(name, sizeof(name), "/todolist-bench.%ld", (long)getpid());
+    snapwriter writer;
+    snapreader reader;
+    int slots[SHARD_MAX];
+    shardRegisterReaders(&set, slots);
+    if (snapWriterOpen(&writer, name) != 0) {
+        shardSetFree(&set, &list, &stack);
+        freeTasks(&list);
+        freeStack(&stack);
+        return;
+    }
+
+    // The first publish sizes the writer's buffers; the second is the steady state
+    snapPublishShards(&writer, &set, slots, 0);
+    start = benchNow();
+    int published = snapPublishShards(&writer, &set, slots, 1) == 0;
+    double publish_time = benchNow() - start;
+
+    const snapheader* view = NULL;
+    start = benchNow();
+    if (published && snapOpen(&reader, name) == 0) view = snapAcquire(&reader);
+    long pending = view ? view->pending : -1;
+    double open_time = benchNow() - start;
+
+    printf("export file:       %8.1f ms\n", export_time * 1000);
+    printf("read it back:      %8.1f ms  (%ld rows)\n", read_time * 1000, rows);
+    if (view) {
+        int lookups = 100000, found = 0;
+        char key[32];
+        start = benchNow();
+        for (int i = 0; i < lookups; i++) {
+            snprintf(key, sizeof(key), "Task %d", (int)((i * 7919L) % count));
+            found += snapFind(view, key) != NULL;
+        }
+        double find_time = benchNow() - start;
+        printf("publish snapshot:  %8.1f ms  (%.1f MB)\n", publish_time * 1000, view->size / (1024.0 * 1024.0));
+        printf("open and stats:    %8.2f ms  (pending=%ld)\n", open_time * 1000, pending);
+        printf("snapshot lookup:   %8.0f ns/op  (%d/%d found, %d tasks)\n", find_time * 1e9 / lookups,
+               found, lookups, view->task_count);
+        snapClose(&reader);
+    } else {
+        printf("Snapshot could not be published or read.\n");
+    }
+    snapWriterClose(&writer);
+    shardSetFree(&set, &list, &stack);
+    freeTasks(&list);
+    freeStack(&stack);
+#endif
+}
+
+// Follows the feed with a cursor until told to stop, pausing after each
+// read when slow (a reader that cannot keep up)
+typedef struct {
+    pthread_t thread;
+    changefeed* feed;
+    int slow;
+    int stop;
+    long events;
+    unsigned long lost;
+} feedreader;
+
+static void* feedReaderThread(void* arg) {
+    feedreader* r = (feedreader*)arg;
+    feedcursor cursor;
+    feedevent events[64];
+    struct timespec pause = {0, 1000 * 1000};
+    feedSubscribe(r->feed, &cursor, 1);
+    for (;;) {
+        int stop = __atomic_load_n(&r->stop, __ATOMIC_ACQUIRE);
+        int n = feedRead(&cursor, events, 64);
+        r->events += n;
+        if (n == 0 && stop) break;
+        if (r->slow || n == 0) nanosleep(&pause, NULL);
+    }
+    r->lost = cursor.lost;
+    return NULL;
+}
+
+/*
+benchmarkFeed() - What recording every change in the change feed costs writers
+ - Time: O(threads * ops), Space: O(FEED_DEFAULT_EVENTS)
+ - 4 writer threads run add/tag/complete/delete on a 4-shard store with no
+   feed, with a feed nobody reads, with a reader keeping up, and with a
+   reader that sleeps 1 ms after every 64 events. Writers never wait for
+   readers, so the slow reader loses events instead of slowing them down.
+ - Sample Case:
+    feed               writes/s   events read      lost
+    none                 973000             -         -
+    no readers           972000             -         -
+    1 reader             849000        800000         0
+    1 slow reader       1153000         56000    744000
+ */
+static void benchmarkFeed(int ops) {
+    static const char* const modes[] = {"none", "no readers", "1 reader", "1 slow reader"};
+    int threads = 4;
+    printf("\n--- Change feed: %d writes on 4 shards, %d slots ---\n", ops, FEED_DEFAULT_EVENTS);
+    printf("%-14s %12s %13s %9s\n", "feed", "writes/s", "events read", "lost");
+    // The session's own feed (if any) is set aside while this runs
+    changefeed* session = feedDefault();
+    for (int mode = 0; mode < 4; mode++) {
+        tasklist list = {NULL};
+        completedstack stack = {NULL};
+        shardset set;
+        changefeed feed;
+        if (shardSetInit(&set, &list, &stack, 4) != 0 ||
+            (mode > 0 && feedInit(&feed, FEED_DEFAULT_EVENTS) != 0)) {
+            printf("Memory allocation failed.\n");
+            return;
+        }
+        feedSetDefault(mode > 0 ? &feed : NULL);
+        feedreader reader = {0, &feed, mode == 3, 0, 0, 0};
+        int reading = mode >= 2 && pthread_create(&reader.thread, NULL, feedReaderThread, &reader) == 0;
+
+        shardwriter writers[4];
+        double start = benchNow();
+        for (int i = 0; i < threads; i++) {
+            writers[i] = (shardwriter){0, &set, i, ops / threads};
+            pthread_create(&writers[i].thread, NULL, shardWriterThread, &writers[i]);
+        }
+        for (int i = 0; i < threads; i++) pthread_join(writers[i].thread, NULL);
+        double elapsed = benchNow() - start;
+
+        if (reading) {
+            __atomic_store_n(&reader.stop, 1, __ATOMIC_RELEASE);
+            pthread_join(reader.thread, NULL);
+            printf("%-14s %12.0f %13ld %9lu\n", modes[mode], ops / elapsed, reader.events, reader.lost);
+        } else {
+            printf("%-14s %12.0f %13s %9s\n", modes[mode], ops / elapsed, "-", "-");
+        }
+        if (mode > 0) {
+            feedSetDefault(NULL);
+            feedFree(&feed);
+        }
+        shardSetFree(&set, &list, &stack);
+        freeTasks(&list);
+        freeStack(&stack);
+    }
+    feedSetDefault(session);
+}
+
+/*
+benchmarkReminders() - Timer wheel against scanning every task each day
+ - Time: O(count * days) for the scan, O(count + days) for the wheel, Space: O(count)
+ - count tasks due over 2026-2027, each with reminders 7 and 1 days before.
+   The date is advanced one day at a time through both years, then a fresh
+   wheel jumps the whole two years at once (simulateDayChange() far ahead).
+ - Sample Case (100000 tasks):
+    schedule:          18.9 ms  (200000 reminders)
+    wheel, daily:      64.3 ms  (200000 fired, 321 ns per reminder)
+    scan, daily:     1899.9 ms  (200000 fired)
+    wheel, one jump:  110.9 ms  (100000 in the digest)
+ */
+static void benchmarkReminders(int count) {
+    static const int offsets[] = {7, 1};
+    date first = {1, 1, 2026};
+    date last = {31, 12, 2027};
+    unsigned int seed = 4242;
+    task** all = (task**)malloc(sizeof(task*) * count);
+    if (!all) {
+        printf("Memory allocation failed.\n");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        all[i] = (task*)calloc(1, sizeof(task));
+        if (!all[i]) {
+            printf("Memory allocation failed.\n");
+            for (int j = 0; j < i; j++) free(all[j]);
+            free(all);
+            return;
+        }
+        seed = seed * 1103515245u + 12345u;
+        snprintf(all[i]->name, sizeof(all[i]->name), "Task %d", i);
+        all[i]->due_date_set = 1;
+        all[i]->duedate.day = 8 + (int)(seed >> 4) % 21;
+        all[i]->duedate.month = 1 + (int)(seed >> 12) % 12;
+        all[i]->duedate.year = 2026 + (int)(seed >> 20) % 2;
+    }
+    long from = todoDayNumber(first), to = todoDayNumber(last);
+    printf("\n--- Reminders: %d tasks, %ld days ---\n", count, to - from + 1);
+
+    reminderwheel wheel;
+    reminderWheelInit(&wheel, first);
+    double start = benchNow();
+    for (int i = 0; i < count; i++) {
+        for (int k = 0; k < 2; k++) reminderAdd(&wheel, all[i], offsets[k]);
+    }
+    printf("schedule:        %8.1f ms  (%ld reminders)\n", (benchNow() - start) * 1000, wheel.pending);
+
+    // Day by day: the dates are walked by day number and turned back into dates
+    date* days = (date*)malloc(sizeof(date) * (to - from + 1));
+    long day_count = 0;
+    for (int y = first.year; y <= last.year && days; y++) {
+        for (int m = 1; m <= 12; m++) {
+            for (int d = 1; isValidDate(d, m, y); d++) days[day_count++] = (date){d, m, y};
+        }
+    }
+    long fired = 0;
+    start = benchNow();
+    for (long i = 0; i < day_count; i++) {
+        reminder* digest;
+        int n = reminderAdvance(&wheel, days[i], &digest);
+        free(digest);
+        fired += n;
+    }
+    double wheel_time = benchNow() - start;
+    printf("wheel, daily:    %8.1f ms  (%ld fired, %.0f ns per reminder)\n", wheel_time * 1000, fired,
+           fired ? wheel_time * 1e9 / fired : 0);
+
+    long scanned = 0;
+    start = benchNow();
+    for (long i = 0; i < day_count; i++) {
+        long today = from + i;
+        for (int t = 0; t < count; t++) {
+            long due = todoDayNumber(all[t]->duedate);
+            for (int k = 0; k < all[t]->reminder_count; k++) {
+                scanned += due - all[t]->reminder_days[k] == today;
+            }
+        }
+    }
+    printf("scan, daily:     %8.1f ms  (%ld fired)\n", (benchNow() - start) * 1000, scanned);
+    reminderWheelFree(&wheel);
+
+    reminderWheelInit(&wheel, first);
+    for (int i = 0; i < count; i++) reminderSchedule(&wheel, all[i]);
+    reminder* digest;
+    start = benchNow();
+    int n = reminderAdvance(&wheel, last, &digest);
+    printf("wheel, one jump: %8.1f ms  (%d in the digest)\n", (benchNow() - start) * 1000, n);
+    free(digest);
+    reminderWheelFree(&wheel);
+
+    free(days);
+    for (int i = 0; i < count; i++) free(all[i]);
+    free(all);
+}
+
+// Runs "complete|name" for every active task tagged work, one line each; returns the OKs
+static long batchCompleteByName(batchstore* store, outbuf* out, const todoquery* query) {
+    batchsession session = {store, out, 0, 0, -1};
+    char line[BATCH_LINE_MAX];
+    long done = 0;
+    task* t = store->list->head;
+    while (t) {
+        task* next = t->next;
+        if (!t->completed && todoMatches(t, query)) {
+            snprintf(line, sizeof(line), "complete|%s", t->name);
+            batchExecute(&session, line);
+            done++;
+        }
+        t = next;
+    }
+    out->len = 0;
+    return done - session.errors;
+}
+
+/*
+benchmarkBulk() - One bulk pass against one call per task, for retiring a tag
+ - Time: O(count * sample) for the one-by-one estimate, O(count) otherwise,
+   Space: O(count)
+ - The synthetic list's work-tagged tasks are completed: by todoComplete()
+   per name (as the menu does, each call walking the list; a sample is
+   timed and scaled up), by one todoBulk() pass, then in a batch store by
+   one complete|name line each (the walk that finds the names included)
+   against a single bulk line
+ - Sample Case (200000 tasks):
+    todoComplete by name:  est. 131705 ms  (41667 tasks, 2000 timed)
+    todoBulk:                  18.5 ms  (41667 completed)
+    batch complete|name:       57.7 ms  (41667 lines)
+    batch bulk|complete:       47.2 ms  (1 line, OK 41667)
+ */
+static void benchmarkBulk(int count) {
+    todoquery query = {TODO_MATCH_TAG, "work", 0, 0, PENDING, {0}, {0}, NULL};
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    buildSyntheticTasks(&list, &stack, count);
+
+    int matches = 0;
+    for (task* t = list.head; t; t = t->next) matches += todoMatches(t, &query);
+    printf("\n--- Bulk operations: %d tasks, %d active ones tagged work ---\n", count, matches);
+    char (*names)[sizeof(((task*)0)->name)] = malloc(sizeof(*names) * (matches ? matches : 1));
+    if (!names) {
+        printf("Memory allocation failed.\n");
+        freeTasks(&list);
+        freeStack(&stack);
+        return;
+    }
+    int n = 0;
+    for (task* t = list.head; t; t = t->next) {
+        if (todoMatches(t, &query)) memcpy(names[n++], t->name, sizeof(names[0]));
+    }
+
+    // Matches spread over the whole list, so the walks are not all short
+    int sample = matches < 2000 ? matches : 2000;
+    int timed = 0;
+    double start = benchNow();
+    for (int i = matches - 1; i >= 0 && timed < sample; i -= matches / sample) {
+        if (todoComplete(&list, &stack, NULL, names[i], getToday(), NULL) == TODO_OK) timed++;
+    }
+    double each = timed ? (benchNow() - start) / timed : 0;
+    printf("todoComplete by name:  est. %.0f ms  (%d tasks, %d timed)\n", each * matches * 1000, matches, timed);
+    for (int i = 0; i < timed; i++) todoUndo(&list, &stack, NULL, NULL);
+
+    todobulk op = {TODO_BULK_COMPLETE, NULL, 0};
+    todobulkresult result;
+    start = benchNow();
+    todoBulk(&list, &stack, NULL, &query, &op, getToday(), &result);
+    printf("todoBulk:              %8.1f ms  (%d completed)\n", (benchNow() - start) * 1000, result.changed);
+    freeTasks(&list);
+    freeStack(&stack);
+    list.head = NULL;
+    free(names);
+
+    outbuf out;
+    if (outbufInit(&out, -1, 1 << 20) != 0) {
+        printf("Memory allocation failed.\n");
+        return;
+    }
+    for (int run = 0; run < 2; run++) {
+        batchstore store;
+        buildSyntheticTasks(&list, &stack, count);
+        if (batchStoreInit(&store, &list, &stack) != 0) {
+            printf("Memory allocation failed.\n");
+            break;
+        }
+        start = benchNow();
+        if (run == 0) {
+            long done = batchCompleteByName(&store, &out, &query);
+            printf("batch complete|name:   %8.1f ms  (%ld lines)\n", (benchNow() - start) * 1000, done);
+        } else {
+            char line[] = "bulk|complete|tag|work";
+            batchsession session = {&store, &out, 0, 0, -1};
+            batchExecute(&session, line);
+            printf("batch bulk|complete:   %8.1f ms  (1 line, %.*s)\n", (benchNow() - start) * 1000,
+                   (int)(out.len ? out.len - 1 : 0), out.data);
+            out.len = 0;
+        }
+        batchStoreFree(&store);
+        freeTasks(&list);
+        freeStack(&stack);
+        list.head = NULL;
+    }
+    outbufFree(&out);
+}
+
+// Reads a positive number, keeping the default on empty or invalid input
+/*
+benchmarkUndo() - Undo log cost: bytes per record and time to record, undo and redo
+ - Time: O(count), Space: O(count)
+ - Every task's priority is changed (as edit() does), then every task is
+   deleted from the head of the list; each is undone and redone one step
+   at a time with the name index to find tasks. Record sizes are set
+   against storing a whole task per change. Last, the priority pass is
+   repeated under the default budget to show how much history 1 MB keeps.
+ - Sample Case (200000 tasks):
+    priority edit:  record  229 ns, undo  833 ns, redo  878 ns, 36 bytes (a task copy: 568)
+    delete:         record  471 ns, undo 1836 ns, redo 1243 ns, 87 bytes (a task copy: 568)
+    1 MB budget keeps the newest 29358 of 150000 priority edits
+ */
+static void benchmarkUndo(int count) {
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    todoindex index = {NULL, 0, 0};
+    undolog log;
+    undoresult result;
+    date today = getToday();
+    buildSyntheticTasks(&list, &stack, count);
+    if (todoIndexBuild(&index, list.head) != 0) {
+        printf("Memory allocation failed.\n");
+        freeTasks(&list);
+        freeStack(&stack);
+        return;
+    }
+    // The session's own history (if any) is set aside while this runs
+    undolog* session = undoDefault();
+    undoInit(&log, (size_t)-1);
+    undoSetDefault(&log);
+    printf("\n--- Undo log: %d tasks ---\n", count);
+
+    for (int pass = 0; pass < 2; pass++) {
+        long changes = 0;
+        double start = benchNow();
+        if (pass == 0) {
+            for (task* t = list.head; t; t = t->next, changes++) {
+                undoRecordFields(t, UNDO_PRIORITY, NULL);
+                t->priority = t->priority % 3 + 1;
+            }
+        } else {
+            // The head always matches first, so todoDelete() does not walk
+            while (list.head && todoDelete(&list, &index, list.head->name) == TODO_OK) changes++;
+        }
+        double record = benchNow() - start;
+        double bytes = changes ? (double)log.bytes / changes : 0;
+        long undone = 0, redone = 0;
+        start = benchNow();
+        while (undoApply(&log, 0, &list, &stack, &index, today, &result) == TODO_OK) undone++;
+        double undo = benchNow() - start;
+        start = benchNow();
+        while (undoApply(&log, 1, &list, &stack, &index, today, &result) == TODO_OK) redone++;
+        double redo = benchNow() - start;
+        printf("%-15s record %4.0f ns, undo %4.0f ns, redo %4.0f ns, %.0f bytes (a task copy: %zu)\n",
+               pass == 0 ? "priority edit:" : "delete:", changes ? record * 1e9 / changes : 0,
+               undone ? undo * 1e9 / undone : 0, redone ? redo * 1e9 / redone : 0, bytes,
+               sizeof(task));
+        // Undo the deletions again so the tasks are back for what follows
+        if (pass == 1) while (undoApply(&log, 0, &list, &stack, &index, today, &result) == TODO_OK) {}
+        undoClear(&log);
+    }
+
+    log.budget = UNDO_DEFAULT_BUDGET;
+    long edits = 0;
+    for (task* t = list.head; t; t = t->next, edits++) {
+        undoRecordFields(t, UNDO_PRIORITY, NULL);
+        t->priority = t->priority % 3 + 1;
+    }
+    printf("1 MB budget keeps the newest %ld of %ld priority edits\n", log.undo_count, edits);
+
+    undoSetDefault(session);
+    undoFree(&log);
+    todoIndexFree(&index);
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+// Counts the tasks in the list and on the stack that query matches
+static long countMatches(task* head, stacknode* node, const todoquery* query) {
+    long matches = 0;
+    for (; head; head = head->next) matches += todoMatches(head, query);
+    for (; node; node = node->next) matches += todoMatches(node->task_data, query);
+    return matches;
+}
+
+/*
+benchmarkQuery() - A compiled query expression against one search per field
+ - Time: O(count * terms), Space: O(count)
+ - The naive way runs one todoMatches() pass per criterion over every task
+   (what intersecting single-criterion searches costs) and ANDs the
+   results; the compiled program tests each task once, first in the order
+   written and then cheapest test first
+ - Sample Case (1000000 tasks):
+    one pass per field:       634.8 ms  (3450 matches)
+    compiled, as written:     204.7 ms  (3450 matches)
+    compiled, cheap first:    120.1 ms  (3450 matches)
+    compile:                    1.5 us per expression
+ */
+static void benchmarkQuery(int count) {
+    static const char* expression = "\"number 1\" tag:work priority:1 -status:overdue "
+                                    "due:01/01/2026..31/12/2026";
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    buildSyntheticTasks(&list, &stack, count);
+    unsigned char* keep = (unsigned char*)malloc((size_t)count + 1);
+    if (!keep) {
+        printf("Memory allocation failed.\n");
+        freeTasks(&list);
+        freeStack(&stack);
+        return;
+    }
+    printf("\n--- Query: %s ---\n", expression);
+
+    // The same criteria as separate searches; the status one is negated
+    todoquery fields[] = {
+        {TODO_MATCH_KEYWORD, "number 1", 0, 0, PENDING, {0}, {0}, NULL},
+        {TODO_MATCH_TAG, "work", 0, 0, PENDING, {0}, {0}, NULL},
+        {TODO_MATCH_PRIORITY, NULL, 1, 1, PENDING, {0}, {0}, NULL},
+        {TODO_MATCH_STATUS, NULL, 0, 0, OVERDUE, {0}, {0}, NULL},
+        {TODO_MATCH_DUE_RANGE, NULL, 0, 0, PENDING, {1, 1, 2026}, {31, 12, 2026}, NULL},
+    };
+    int field_count = (int)(sizeof(fields) / sizeof(fields[0]));
+    double start = benchNow();
+    memset(keep, 1, (size_t)count);
+    for (int f = 0; f < field_count; f++) {
+        int negate = fields[f].type == TODO_MATCH_STATUS;
+        long i = 0;
+        for (task* t = list.head; t; t = t->next, i++) keep[i] &= todoMatches(t, &fields[f]) != negate;
+        for (stacknode* node = stack.top; node; node = node->next, i++) {
+            keep[i] &= todoMatches(node->task_data, &fields[f]) != negate;
+        }
+    }
+    long naive = 0;
+    for (int i = 0; i < count; i++) naive += keep[i];
+    printf("one pass per field:    %8.1f ms  (%ld matches)\n", (benchNow() - start) * 1000, naive);
+
+    queryprogram program;
+    todoquery query = {TODO_MATCH_EXPRESSION, NULL, 0, 0, PENDING, {0}, {0}, &program};
+    date today = {1, 6, 2026};
+    for (int ordered = 0; ordered < 2; ordered++) {
+        queryCompile(expression, today, ordered ? 0 : QUERY_KEEP_ORDER, &program, NULL, 0);
+        start = benchNow();
+        long matches = countMatches(list.head, stack.top, &query);
+        printf("compiled, %-12s %8.1f ms  (%ld matches)\n", ordered ? "cheap first:" : "as written:",
+               (benchNow() - start) * 1000, matches);
+    }
+
+    int compiles = 100000;
+    start = benchNow();
+    for (int i = 0; i < compiles; i++) queryCompile(expression, today, 0, &program, NULL, 0);
+    printf("compile:               %8.1f us per expression\n", (benchNow() - start) * 1e6 / compiles);
+
+    free(keep);
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+/*
+benchmarkPlanner() - Planned queries against scanning every task
+ - Time: O(n * text length) to build the indexes, then per query O(n) for
+   the scan and O(postings + candidates) planned, Space: O(n * trigrams)
+ - Each query is run both ways and must find the same matches; "est." is
+   the candidates the planner expected, "rows" those it rechecked
+ - Sample Case (200000 tasks, indexes built in 275.7 ms, 24.9 MB of postings):
+    query                                plan                            est.    rows  planned ms   scan ms
+    "number 123"                         probe "number 123"              1599    1131      0.482    39.237
+    tag:urgent "number 4"                intersect "number 4" + tag:urg  2778    2775      1.860    23.375
+    due:01/03/2025..07/03/2025 tag:work  probe due:01/03/2025..07/03/20  1623    1821      0.292     9.938
+    due:none tag:errand priority:1       intersect due:none + tag:erran  6250    6250      0.711     9.446
+    name:"Task 19" OR tag:school         scan                          200000  200000    21.855    21.436
+ */
+static void benchmarkPlanner(int count) {
+    static const char* const expressions[] = {
+        "\"number 123\"",
+        "tag:urgent \"number 4\"",
+        "due:01/03/2025..07/03/2025 tag:work",
+        "due:none tag:errand priority:1",
+        "name:\"Task 19\" OR tag:school",
+        "priority:1..2 status:pending",
+    };
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    planindex set;
+    buildSyntheticTasks(&list, &stack, count);
+    planInit(&set);
+    int* rows = (int*)malloc(sizeof(int) * ((size_t)count + 1));
+    if (!rows || planBuild(&set, &list, &stack) != 0) {
+        printf("Memory allocation failed.\n");
+        free(rows);
+        freeTasks(&list);
+        freeStack(&stack);
+        return;
+    }
+    printf("\n--- Query planner: %d tasks, indexes built in %.1f ms ---\n", count, set.build_ms);
+    printf("%d tags, %ld trigrams, %ld postings (%.1f MB), %ld due dates over %d months\n", set.tag_count,
+           set.gram_count, set.postings, set.postings * sizeof(int) / 1048576.0, set.due_count, set.months);
+    printf("%-38s %-30s %7s %7s %10s %9s\n", "query", "plan", "est.", "rows", "planned ms", "scan ms");
+
+    date today = {1, 6, 2026};
+    int runs = 5;
+    for (size_t q = 0; q < sizeof(expressions) / sizeof(expressions[0]); q++) {
+        queryprogram program;
+        queryplan plan;
+        char summary[80];
+        queryCompile(expressions[q], today, 0, &program, NULL, 0);
+
+        long planned = 0;
+        double start = benchNow();
+        for (int run = 0; run < runs; run++) {
+            planQuery(&set, &program, &plan);
+            planned = planExecute(&set, &plan, &program, rows, count);
+        }
+        double planned_ms = (benchNow() - start) * 1000 / runs;
+
+        long scanned = 0;
+        start = benchNow();
+        for (int run = 0; run < runs; run++) {
+            scanned = 0;
+            for (long i = 0; i < set.count; i++) scanned += queryRun(&program, set.rows[i]);
+        }
+        double scan_ms = (benchNow() - start) * 1000 / runs;
+
+        planSummary(&plan, &program, summary, sizeof(summary));
+        printf("%-38s %-30.30s %7ld %7ld %10.3f %9.3f%s\n", expressions[q], summary, plan.estimate,
+               plan.candidates, planned_ms, scan_ms, planned == scanned ? "" : "  MISMATCH");
+    }
+
+    planFree(&set);
+    free(rows);
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+// Rows of a combined tag query, from sorted int lists: a AND b AND NOT c
+static long intersectPostings(const int* a, long na, const int* b, long nb, const int* c, long nc, int* out) {
+    long n = 0, j = 0, k = 0;
+    for (long i = 0; i < na && j < nb; i++) {
+        while (j < nb && b[j] < a[i]) j++;
+        if (j == nb || b[j] != a[i]) continue;
+        while (k < nc && c[k] < a[i]) k++;
+        if (k == nc || c[k] != a[i]) out[n++] = a[i];
+    }
+    return n;
+}
+
+/*
+benchmarkTagBitmaps() - Three-tag queries on compressed bitmaps against scans and int lists
+ - Time: O(rows) to build, then per query O(containers * 1024 words) on
+   bitmaps, O(rows) scanning a byte of tag bits per row, O(postings) merging
+   sorted int lists, Space: O(rows)
+ - The rows get tags as buildSyntheticTasks() gives them (each of the six
+   tags on about a quarter of rows) without allocating tasks, so 10 million
+   rows fit in memory. Each query is "a AND b AND NOT c"; the bitmaps count
+   the result without listing it ("count"), builds it ("bitmap"), or takes
+   an AND then an AND NOT with a bitmap in between ("2 steps").
+ - Sample Case (10000000 rows):
+    6 tag bitmaps: 7.2 MB (int lists: 57.2 MB)
+    query                             matches    count   bitmap  2 steps     scan    lists  (ms)
+    work AND home AND NOT school       833334    0.611    1.561    2.716   28.950   18.439
+ */
+static void benchmarkTagBitmaps(int count) {
+    static const char* const names[] = {"work", "home", "school", "urgent", "waiting", "errand"};
+    static const int queries[][3] = {{0, 1, 2}, {3, 4, 0}, {5, 0, 1}};
+    bitmap tags[6];
+    int* lists[6];
+    long lengths[6] = {0};
+    unsigned char* masks = (unsigned char*)malloc((size_t)count);
+    int* out = (int*)malloc(sizeof(int) * ((size_t)count / 2 + 1));
+    int ok = masks && out;
+    for (int t = 0; t < 6; t++) {
+        bitmapInit(&tags[t]);
+        lists[t] = (int*)malloc(sizeof(int) * ((size_t)count / 2 + 1));
+        ok = ok && lists[t];
+    }
+
+    unsigned int seed = 12345;
+    double start = benchNow();
+    for (int i = 0; i < count && ok; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int tag_count = (int)(seed >> 2) % 4;
+        masks[i] = 0;
+        for (int j = 0; j < tag_count; j++) {
+            int t = (i + j) % 6;
+            masks[i] |= (unsigned char)(1 << t);
+            lists[t][lengths[t]++] = i;
+            ok = bitmapAdd(&tags[t], (unsigned int)i) == 0;
+        }
+    }
+    if (!ok) {
+        printf("Memory allocation failed.\n");
+    } else {
+        size_t bytes = 0;
+        long postings = 0;
+        for (int t = 0; t < 6; t++) bytes += bitmapBytes(&tags[t]), postings += lengths[t];
+        printf("\n--- Tag bitmaps: %d rows, built in %.1f ms ---\n", count, (benchNow() - start) * 1000);
+        printf("6 tag bitmaps: %.1f MB (int lists: %.1f MB)\n", bytes / 1048576.0, postings * sizeof(int) / 1048576.0);
+        printf("%-32s %8s %8s %8s %8s %8s %8s  (ms)\n", "query", "matches", "count", "bitmap", "2 steps",
+               "scan", "lists");
+    }
+
+    int runs = 20;
+    for (size_t q = 0; ok && q < sizeof(queries) / sizeof(queries[0]); q++) {
+        int a = queries[q][0], b = queries[q][1], c = queries[q][2];
+        char label[64];
+        snprintf(label, sizeof(label), "%s AND %s AND NOT %s", names[a], names[b], names[c]);
+
+        const bitmap* with[] = {&tags[a], &tags[b]};
+        const bitmap* without[] = {&tags[c]};
+        long matches = 0;
+        start = benchNow();
+        for (int run = 0; run < runs && ok; run++) {
+            bitmap result;
+            matches = bitmapAndMany(with, 2, without, 1, &result);
+            ok = matches >= 0;
+            bitmapFree(&result);
+        }
+        double bitmap_ms = (benchNow() - start) * 1000 / runs;
+
+        long counted = 0;
+        start = benchNow();
+        for (int run = 0; run < runs; run++) counted = bitmapAndMany(with, 2, without, 1, NULL);
+        double count_ms = (benchNow() - start) * 1000 / runs;
+
+        long stepped = 0;
+        start = benchNow();
+        for (int run = 0; run < runs && ok; run++) {
+            bitmap both, result;
+            ok = bitmapAnd(&tags[a], &tags[b], &both) == 0 && bitmapAndNot(&both, &tags[c], &result) == 0;
+            stepped = bitmapCardinality(&result);
+            bitmapFree(&both);
+            bitmapFree(&result);
+        }
+        double step_ms = (benchNow() - start) * 1000 / runs;
+
+        long scanned = 0;
+        unsigned char want = (unsigned char)(1 << a | 1 << b), mask = (unsigned char)(want | 1 << c);
+        start = benchNow();
+        for (int run = 0; run < runs; run++) {
+            scanned = 0;
+            for (int i = 0; i < count; i++) scanned += (masks[i] & mask) == want;
+        }
+        double scan_ms = (benchNow() - start) * 1000 / runs;
+
+        long merged = 0;
+        start = benchNow();
+        for (int run = 0; run < runs; run++) {
+            merged = intersectPostings(lists[a], lengths[a], lists[b], lengths[b], lists[c], lengths[c], out);
+        }
+        double list_ms = (benchNow() - start) * 1000 / runs;
+
+        printf("%-32s %8ld %8.3f %8.3f %8.3f %8.3f %8.3f%s\n", label, matches, count_ms, bitmap_ms, step_ms,
+               scan_ms, list_ms,
+               matches == scanned && scanned == merged && counted == matches && stepped == matches ? "" : "  MISMATCH");
+    }
+
+    for (int t = 0; t < 6; t++) {
+        bitmapFree(&tags[t]);
+        free(lists[t]);
+    }
+    free(masks);
+    free(out);
+}
+
+/*
+benchmarkViews() - Twenty saved views kept current against running the twenty searches again
+ - Time: O(n) per view to save, then per round O(changes * views) to
+   refresh, O(k log k) to open views of k tasks, O(n * views) to rescan,
+   Space: O(n + matches)
+ - Each round retags or reprioritizes random tasks through the library (so
+   the views hear of it), then brings all 20 views up to date, opens each
+   one and compares its count with a scan
+ - Sample Case (200000 tasks, 20 views saved in 609.6 ms):
+    changes  refresh ms  open all ms  rescan ms
+         10       0.091        1.627    658.649
+       1000       2.484        0.897    569.252
+     100000     169.699        0.910    614.569
+ */
+static void benchmarkViews(int count) {
+    static const char* const expressions[] = {
+        "tag:work", "tag:home priority:1", "tag:urgent NOT status:overdue", "tag:waiting OR tag:errand",
+        "priority:1 status:overdue", "due:none", "due:none tag:school", "due:01/01/2025..31/03/2025",
+        "due:01/06/2026.. priority:1..2", "status:completed tag:work", "tag:work tag:urgent -tag:waiting",
+        "priority:3 -tag:home", "name:\"Task 1\"", "\"number 42\"", "desc:7 tag:errand",
+        "tag:school OR priority:1", "status:pending due:..31/12/2025", "tag:home tag:errand",
+        "NOT tag:work NOT tag:home", "priority:2 tag:urgent",
+    };
+    static const char* const tags[] = {"work", "home", "school", "urgent", "waiting", "errand"};
+    static const int rounds[] = {10, 1000, 100000};
+    const int views = (int)(sizeof(expressions) / sizeof(expressions[0]));
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    viewset set;
+    date today = {1, 6, 2026};
+    unsigned int seed = 7;
+
+    // Changes below go to this set alone, not the session's feed or undo log
+    changefeed* session_feed = feedDefault();
+    undolog* session_log = undoDefault();
+    feedSetDefault(NULL);
+    undoSetDefault(NULL);
+
+    buildSyntheticTasks(&list, &stack, count);
+    long active = 0;
+    for (task* t = list.head; t; t = t->next) active++;
+    task** pool = (task**)malloc(sizeof(task*) * (active + 1));
+    task** out = (task**)malloc(sizeof(task*) * ((size_t)count + 1));
+    queryprogram* programs = (queryprogram*)malloc(sizeof(queryprogram) * views);
+    viewsInit(&set, today);
+    int ok = pool && out && programs;
+    active = 0;
+    for (task* t = list.head; ok && t; t = t->next) pool[active++] = t;
+
+    double start = benchNow();
+    for (int v = 0; ok && v < views; v++) {
+        char name[16];
+        snprintf(name, sizeof(name), "view %d", v + 1);
+        ok = viewsAdd(&set, name, expressions[v], &list, &stack, NULL, 0) == TODO_OK &&
+             queryCompile(expressions[v], today, 0, &programs[v], NULL, 0) == TODO_OK;
+    }
+    if (!ok || !active) {
+        printf("Memory allocation failed.\n");
+    } else {
+        printf("\n--- Saved views: %d tasks, %d views saved in %.1f ms ---\n", count, views,
+               (benchNow() - start) * 1000);
+        printf("%8s %11s %12s %10s\n", "changes", "refresh ms", "open all ms", "rescan ms");
+        viewsSetDefault(&set);
+    }
+
+    for (size_t r = 0; ok && active && r < sizeof(rounds) / sizeof(rounds[0]); r++) {
+        for (int i = 0; i < rounds[r]; i++) {
+            seed = seed * 1103515245u + 12345u;
+            task* t = pool[(seed >> 8) % active];
+            const char* tag = tags[(seed >> 4) % 6];
+            if (seed % 3 == 0) {
+                int previous = t->priority;
+                t->priority = 1 + (int)(seed >> 20) % 3;
+                feedRecord(FEED_PRIORITY, t, NULL, previous);
+            } else if (todoRemoveTag(t, tag) == TODO_NOT_FOUND) {
+                todoAddTag(t, tag);
+            }
+        }
+
+        start = benchNow();
+        viewsRefresh(&set, &list, &stack, today);
+        double refresh_ms = (benchNow() - start) * 1000;
+
+        long opened[sizeof(expressions) / sizeof(expressions[0])];
+        start = benchNow();
+        for (int v = 0; v < views; v++) opened[v] = viewsMembers(&set, v, out, count);
+        double open_ms = (benchNow() - start) * 1000;
+
+        int mismatch = 0;
+        start = benchNow();
+        for (int v = 0; v < views; v++) {
+            long scanned = 0;
+            for (task* t = list.head; t; t = t->next) scanned += queryRun(&programs[v], t);
+            for (stacknode* node = stack.top; node; node = node->next) {
+                scanned += queryRun(&programs[v], node->task_data);
+            }
+            if (scanned != opened[v]) mismatch = 1;
+        }
+        double scan_ms = (benchNow() - start) * 1000;
+        printf("%8d %11.3f %12.3f %10.3f%s\n", rounds[r], refresh_ms, open_ms, scan_ms,
+               mismatch ? "  MISMATCH" : "");
+    }
+
+    viewsSetDefault(NULL);
+    viewsFree(&set);
+    feedSetDefault(session_feed);
+    undoSetDefault(session_log);
+    free(pool);
+    free(out);
+    free(programs);
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+// Word i of the ranked search benchmark's vocabulary: two syllables for
+// the first 400, three for the rest (up to 8000)
+static void rankBenchWord(int i, char* out, size_t size) {
+    static const char* const syllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo", "de", "fa",
+                                            "gu", "ho", "ji", "pe", "qu", "re", "so", "tu", "wa", "ze"};
+    if (i < 400) snprintf(out, size, "%s%s", syllables[i % 20], syllables[i / 20]);
+    else snprintf(out, size, "%s%s%s", syllables[i % 20], syllables[i / 20 % 20], syllables[i / 400 % 20]);
+}
+
+// Fills text with words drawn so that low-numbered words are far more common
+static void rankBenchText(char* text, size_t size, int words, unsigned int* seed) {
+    size_t used = 0;
+    text[0] = '\0';
+    for (int i = 0; i < words; i++) {
+        char word[8];
+        *seed = *seed * 1103515245u + 12345u;
+        double u = (*seed >> 8) / 16777216.0;
+        rankBenchWord((int)(8000 * u * u * u), word, sizeof(word));
+        int n = snprintf(text + used, size - used, "%s%s", i ? " " : "", word);
+        if (n < 0 || used + n >= size) break;
+        used += n;
+    }
+}
+
+/*
+benchmarkRanked() - Top-10 ranked search latency as the corpus grows
+ - Time: O(total words) per index build, then per query O(postings read *
+   log k) with MaxScore, O(postings) exhaustive, O(n) for a keyword scan,
+   Space: O(n)
+ - Tasks get 2-5 name words and 6-20 description words from an 8000-word
+   vocabulary skewed toward its first words, so some words are in most
+   tasks and others in a handful. Each query is run with MaxScore pruning
+   and scoring every task holding a word; both must return the same top
+   10. "scan" is the unranked keyword search for the query's first word.
+ - Sample Case:
+       tasks  build ms  query                          postings      read  top-10 ms    all ms   scan ms
+     1000000    3090.6  kalo lomi                         58790     34569      1.320     2.069   185.800
+     1000000    3090.6  ruka rutine                       98287      3284      0.197     3.046   155.453
+     1000000    3090.6  kaka deka kane kakalo kasati     647501     26133      1.218    22.866   175.082
+ */
+static void benchmarkRanked(int largest) {
+    static const int queries[][5] = {{20, 41}, {4, 1324}, {30, 90, 200}, {5210}, {0, 8, 60, 400, 2500}};
+    static const int lengths[] = {2, 2, 3, 1, 5};
+    const int runs = 20;
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    rankindex set;
+    rankhit pruned[RANK_DEFAULT_K], all[RANK_DEFAULT_K];
+    unsigned int seed = 99;
+    int count = 0;
+
+    // The index is built below without the session's feed, so it never
+    // mistakes these tasks for current ones
+    changefeed* session = feedDefault();
+    feedSetDefault(NULL);
+    rankInit(&set);
+    printf("\n--- Ranked search: top %d as the corpus grows ---\n", RANK_DEFAULT_K);
+    printf("%8s %9s  %-28s %10s %9s %10s %9s %9s\n", "tasks", "build ms", "query", "postings", "read",
+           "top-10 ms", "all ms", "scan ms");
+
+    for (int size = 10000; size <= largest; size *= 10) {
+        for (; count < size; count++) {
+            task* t = (task*)calloc(1, sizeof(task));
+            if (!t) break;
+            rankBenchText(t->name, sizeof(t->name), 2 + (int)(seed >> 12) % 4, &seed);
+            rankBenchText(t->description, sizeof(t->description), 6 + (int)(seed >> 12) % 15, &seed);
+            t->priority = 2;
+            t->next = list.head;
+            list.head = t;
+        }
+        if (count < size || rankBuild(&set, &list, &stack) != 0) {
+            printf("Memory allocation failed.\n");
+            break;
+        }
+
+        for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+            char text[64] = "", word[8];
+            for (int i = 0; i < lengths[q]; i++) {
+                rankBenchWord(queries[q][i], word, sizeof(word));
+                snprintf(text + strlen(text), sizeof(text) - strlen(text), "%s%s", i ? " " : "", word);
+            }
+            rankstats stats;
+            int found = rankSearch(&set, text, RANK_DEFAULT_K, 0, pruned, &stats), found_all = 0;
+            double start = benchNow();
+            for (int run = 0; run < runs; run++) found = rankSearch(&set, text, RANK_DEFAULT_K, 0, pruned, &stats);
+            double pruned_ms = (benchNow() - start) * 1000 / runs;
+            start = benchNow();
+            for (int run = 0; run < runs; run++) {
+                found_all = rankSearch(&set, text, RANK_DEFAULT_K, RANK_EXHAUSTIVE, all, NULL);
+            }
+            double all_ms = (benchNow() - start) * 1000 / runs;
+
+            rankBenchWord(queries[q][0], word, sizeof(word));
+            todoquery keyword = {TODO_MATCH_KEYWORD, word, 0, 0, PENDING, {0}, {0}, NULL};
+            long matches = 0;
+            start = benchNow();
+            for (task* t = list.head; t; t = t->next) matches += todoMatches(t, &keyword);
+            double scan_ms = (benchNow() - start) * 1000;
+
+            int same = found == found_all;
+            for (int i = 0; same && i < found; i++) same = pruned[i].row == all[i].row && pruned[i].score == all[i].score;
+            printf("%8d %9.1f  %-28s %10ld %9ld %10.3f %9.3f %9.3f%s\n", count, set.build_ms, text,
+                   stats.postings, stats.read, pruned_ms, all_ms, scan_ms, same && matches ? "" : "  MISMATCH");
+        }
+    }
+
+    rankFree(&set);
+    feedSetDefault(session);
+    freeTasks(&list);
+}
+
+static long readPositive(const char* prompt, long value) {
+    char buffer[32];
+    long input;
+
+    printf("%s", prompt);
+    if (fgets(buffer, sizeof(buffer), stdin) != NULL &&
+        sscanf(buffer, "%ld", &input) == 1 && input > 0) {
+        return input;
+    }
+    return value;
+}
+
+/*
+runPerformanceAnalysis() - Hidden menu option: timing for large task lists
+ - Time: depends on size, Space: O(n)
+ - Example: runPerformanceAnalysis() -> asks for a benchmark and its size, prints timings
+ */
+void runPerformanceAnalysis() {
+    printf("\n=== Performance Analysis ===\n");
+    printf("1. Export throughput\n");
+    printf("2. Archive export with a memory limit\n");
+    printf("3. Library calls (add, tag, search, complete)\n");
+    printf("4. Concurrent reads with a writer\n");
+    printf("5. Ingest ring with 1 to 32 producers\n");
+    printf("6. Work-stealing pool scaling\n");
+    printf("7. Sharded store write scaling\n");
+    printf("8. Cluster ring rebalancing\n");
+    printf("9. Replication journal overhead\n");
+    printf("10. Shared-memory snapshot against an export file\n");
+    printf("11. Change feed overhead\n");
+    printf("12. Reminder timer wheel against a daily scan\n");
+    printf("13. Bulk operations against one call per task\n");
+    printf("14. Undo log record size and undo/redo time\n");
+    printf("15. Compiled query expressions against one search per field\n");
+    printf("16. Query planner against a full scan\n");
+    printf("17. Tag bitmaps against scans and sorted lists\n");
+    printf("18. Saved views kept current against running searches again\n");
+    printf("19. Ranked top-10 search as the corpus grows\n");
+    long choice = readPositive("Select a benchmark (default 1): ", 1);
+    // The benchmarks free tasks of their own lists without recording it, so
+    // the session's saved views must not hold on to them
+    viewset* session = viewsDefault();
+    viewsSetDefault(NULL);
+
+    if (choice == 2) {
+        long count = readPositive("Number of tasks (default 10000000): ", 10000000);
+        long memory_mb = readPositive("Memory limit in MB (default 256): ", 256);
+        benchmarkArchive(count, (int)memory_mb);
+    } else if (choice == 3) {
+        long count = readPositive("Number of tasks (default 1000000): ", 1000000);
+        benchmarkLibrary((int)count);
+    } else if (choice == 4) {
+        long ops = readPositive("Operations per thread (default 20000): ", 20000);
+        benchmarkConcurrentReads((int)ops);
+    } else if (choice == 5) {
+        long count = readPositive("Tasks per producer (default 10000): ", 10000);
+        benchmarkIngest((int)count);
+    } else if (choice == 6) {
+        long count = readPositive("Number of tasks (default 1000000): ", 1000000);
+        benchmarkPool((int)count);
+    } else if (choice == 7) {
+        long ops = readPositive("Operations per thread (default 200000): ", 200000);
+        benchmarkShards((int)ops);
+    } else if (choice == 8) {
+        long keys = readPositive("Number of keys (default 1000000): ", 1000000);
+        benchmarkRing((int)keys);
+    } else if (choice == 9) {
+        long ops = readPositive("Number of writes (default 500000): ", 500000);
+        benchmarkReplication((int)ops);
+    } else if (choice == 10) {
+        long count = readPositive("Number of tasks (default 1000000): ", 1000000);
+        benchmarkSnapshot((int)count);
+    } else if (choice == 11) {
+        long ops = readPositive("Number of writes (default 800000): ", 800000);
+        benchmarkFeed((int)ops);
+    } else if (choice == 12) {
+        long count = readPositive("Number of tasks (default 100000): ", 100000);
+        benchmarkReminders((int)count);
+    } else if (choice == 13) {
+        long count = readPositive("Number of tasks (default 200000): ", 200000);
+        benchmarkBulk((int)count);
+    } else if (choice == 14) {
+        long count = readPositive("Number of tasks (default 200000): ", 200000);
+        benchmarkUndo((int)count);
+    } else if (choice == 15) {
+        long count = readPositive("Number of tasks (default 1000000): ", 1000000);
+        benchmarkQuery((int)count);
+    } else if (choice == 16) {
+        long count = readPositive("Number of tasks (default 200000): ", 200000);
+        benchmarkPlanner((int)count);
+    } else if (choice == 17) {
+        long count = readPositive("Number of rows (default 10000000): ", 10000000);
+        benchmarkTagBitmaps((int)count);
+    } else if (choice == 18) {
+        long count = readPositive("Number of tasks (default 200000): ", 200000);
+        benchmarkViews((int)count);
+    } else if (choice == 19) {
+        long count = readPositive("Largest corpus in tasks (default 1000000): ", 1000000);
+        benchmarkRanked((int)count);
+    } else {
+        long count = readPositive("Number of tasks (default 1000000): ", 1000000);
+        benchmarkExport((int)count);
+    }
+    viewsSetDefault(session);
+}
@@ -0,0 +1,10 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "task_management.h"
+
+double benchNow();
+void buildSyntheticTasks(tasklist* list, completedstack* stack, int count);
+void runPerformanceAnalysis();
+
+#endif
@@ -0,0 +1,648 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap.h"
+
+// Bits set in a word; without a popcount instruction, the shift-and-add
+// form, which the loops over whole bitsets vectorize
+static inline int wordBits(unsigned long long x) {
+#ifdef __POPCNT__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+static int countWords(const unsigned long long* words) {
+    int count = 0;
+    for (int i = 0; i < BITMAP_WORDS; i++) count += wordBits(words[i]);
+    return count;
+}
+
+static void containerFree(bitmapcontainer* c) {
+    free(c->values);
+    free(c->words);
+}
+
+// Makes c an empty array container with room for capacity rows
+static int newArray(bitmapcontainer* c, unsigned int key, int capacity) {
+    memset(c, 0, sizeof(*c));
+    c->key = key;
+    c->capacity = capacity > 0 ? capacity : 1;
+    c->values = (unsigned short*)malloc(sizeof(unsigned short) * c->capacity);
+    return c->values ? 0 : -1;
+}
+
+// Makes c a bitset container, cleared if zero (else the caller fills every word)
+static int newBits(bitmapcontainer* c, unsigned int key, int zero) {
+    memset(c, 0, sizeof(*c));
+    c->key = key;
+    c->bits = 1;
+    c->words = zero ? (unsigned long long*)calloc(BITMAP_WORDS, sizeof(unsigned long long))
+                    : (unsigned long long*)malloc(sizeof(unsigned long long) * BITMAP_WORDS);
+    return c->words ? 0 : -1;
+}
+
+static int copyContainer(bitmapcontainer* out, const bitmapcontainer* c) {
+    if (c->bits) {
+        if (newBits(out, c->key, 0) != 0) return -1;
+        memcpy(out->words, c->words, sizeof(unsigned long long) * BITMAP_WORDS);
+    } else {
+        if (newArray(out, c->key, c->cardinality) != 0) return -1;
+        memcpy(out->values, c->values, sizeof(unsigned short) * c->cardinality);
+    }
+    out->cardinality = c->cardinality;
+    return 0;
+}
+
+// Turns an array container into a bitset
+static int toBits(bitmapcontainer* c) {
+    unsigned long long* words = (unsigned long long*)calloc(BITMAP_WORDS, sizeof(unsigned long long));
+    if (!words) return -1;
+    for (int i = 0; i < c->cardinality; i++) words[c->values[i] >> 6] |= 1ULL << (c->values[i] & 63);
+    free(c->values);
+    c->values = NULL;
+    c->capacity = 0;
+    c->words = words;
+    c->bits = 1;
+    return 0;
+}
+
+// Turns a bitset holding few rows into an array (left a bitset if out of memory)
+static void toArray(bitmapcontainer* c) {
+    unsigned short* values = (unsigned short*)malloc(sizeof(unsigned short) * (c->cardinality ? c->cardinality : 1));
+    if (!values) return;
+    int n = 0;
+    for (int i = 0; i < BITMAP_WORDS; i++) {
+        for (unsigned long long w = c->words[i]; w; w &= w - 1) {
+            values[n++] = (unsigned short)(i * 64 + __builtin_ctzll(w));
+        }
+    }
+    free(c->words);
+    c->words = NULL;
+    c->values = values;
+    c->capacity = c->cardinality ? c->cardinality : 1;
+    c->bits = 0;
+}
+
+// First index in values[0..n) holding at least low
+static int lowerBound(const unsigned short* values, int n, unsigned short low) {
+    int first = 0;
+    while (first < n) {
+        int mid = first + (n - first) / 2;
+        if (values[mid] < low) first = mid + 1;
+        else n = mid;
+    }
+    return first;
+}
+
+// Index of the container for key, or of where it would go
+static int findContainer(const bitmap* b, unsigned int key) {
+    int first = 0, n = b->count;
+    if (n && b->containers[n - 1].key < key) return n;
+    while (first < n) {
+        int mid = first + (n - first) / 2;
+        if (b->containers[mid].key < key) first = mid + 1;
+        else n = mid;
+    }
+    return first;
+}
+
+// Room for one more container at index at
+static bitmapcontainer* insertContainer(bitmap* b, int at) {
+    if (b->count == b->capacity) {
+        int grown = b->capacity ? b->capacity * 2 : 4;
+        bitmapcontainer* bigger = (bitmapcontainer*)realloc(b->containers, sizeof(bitmapcontainer) * grown);
+        if (!bigger) return NULL;
+        b->containers = bigger;
+        b->capacity = grown;
+    }
+    memmove(&b->containers[at + 1], &b->containers[at], sizeof(bitmapcontainer) * (b->count - at));
+    b->count++;
+    return &b->containers[at];
+}
+
+// Appends a finished container to out, or drops it if empty; frees c on failure
+static int keepContainer(bitmap* out, bitmapcontainer* c) {
+    if (c->cardinality == 0) {
+        containerFree(c);
+        return 0;
+    }
+    if (c->bits && c->cardinality <= BITMAP_ARRAY_MAX) toArray(c);
+    bitmapcontainer* slot = insertContainer(out, out->count);
+    if (!slot) {
+        containerFree(c);
+        return -1;
+    }
+    *slot = *c;
+    return 0;
+}
+
+/*
+bitmapInit() - Makes an empty bitmap
+ - Time: O(1), Space: O(1)
+ */
+void bitmapInit(bitmap* b) {
+    b->containers = NULL;
+    b->count = 0;
+    b->capacity = 0;
+}
+
+/*
+bitmapFree() - Frees a bitmap's containers and leaves it empty
+ - Time: O(containers), Space: O(1)
+ */
+void bitmapFree(bitmap* b) {
+    for (int i = 0; i < b->count; i++) containerFree(&b->containers[i]);
+    free(b->containers);
+    bitmapInit(b);
+}
+
+/*
+bitmapAdd() - Adds a row (no change if it is there)
+ - Time: O(1) for rows added in increasing order, else O(log containers +
+   4096) to insert into an array, Space: O(1) amortized
+ - An array container becomes a bitset when it passes 4096 rows
+ - Returns 0, or -1 if out of memory
+ - Example: bitmapAdd(&b, 70000) -> container 1 holds 4464
+ */
+int bitmapAdd(bitmap* b, unsigned int row) {
+    unsigned int key = row >> 16;
+    unsigned short low = (unsigned short)(row & 0xFFFF);
+    int at = findContainer(b, key);
+    if (at == b->count || b->containers[at].key != key) {
+        bitmapcontainer c;
+        if (newArray(&c, key, 4) != 0) return -1;
+        bitmapcontainer* slot = insertContainer(b, at);
+        if (!slot) {
+            containerFree(&c);
+            return -1;
+        }
+        *slot = c;
+    }
+    bitmapcontainer* c = &b->containers[at];
+
+    if (c->bits) {
+        unsigned long long bit = 1ULL << (low & 63);
+        if (!(c->words[low >> 6] & bit)) {
+            c->words[low >> 6] |= bit;
+            c->cardinality++;
+        }
+        return 0;
+    }
+    int pos = c->cardinality;
+    if (pos && c->values[pos - 1] >= low) {
+        pos = lowerBound(c->values, c->cardinality, low);
+        if (c->values[pos] == low) return 0;
+    }
+    if (c->cardinality == BITMAP_ARRAY_MAX) {
+        if (toBits(c) != 0) return -1;
+        c->words[low >> 6] |= 1ULL << (low & 63);
+        c->cardinality++;
+        return 0;
+    }
+    if (c->cardinality == c->capacity) {
+        int grown = c->capacity * 2 < BITMAP_ARRAY_MAX ? c->capacity * 2 : BITMAP_ARRAY_MAX;
+        unsigned short* bigger = (unsigned short*)realloc(c->values, sizeof(unsigned short) * grown);
+        if (!bigger) return -1;
+        c->values = bigger;
+        c->capacity = grown;
+    }
+    memmove(&c->values[pos + 1], &c->values[pos], sizeof(unsigned short) * (c->cardinality - pos));
+    c->values[pos] = low;
+    c->cardinality++;
+    return 0;
+}
+
+/*
+bitmapFill() - Makes b hold exactly the rows 0 .. rows-1 (the "every task" set for NOT)
+ - Time: O(rows / 64), Space: O(rows / 8)
+ - Returns 0, or -1 if out of memory (b is left empty)
+ */
+int bitmapFill(bitmap* b, unsigned int rows) {
+    bitmapFree(b);
+    for (unsigned int key = 0; (unsigned long)key << 16 < rows; key++) {
+        unsigned long left = rows - ((unsigned long)key << 16);
+        int n = left < 65536 ? (int)left : 65536;
+        bitmapcontainer c;
+        if (n <= BITMAP_ARRAY_MAX) {
+            if (newArray(&c, key, n) != 0) goto failed;
+            for (int i = 0; i < n; i++) c.values[i] = (unsigned short)i;
+        } else {
+            if (newBits(&c, key, 1) != 0) goto failed;
+            memset(c.words, 0xFF, sizeof(unsigned long long) * (n / 64));
+            if (n % 64) c.words[n / 64] = (1ULL << (n % 64)) - 1;
+        }
+        c.cardinality = n;
+        if (keepContainer(b, &c) != 0) goto failed;
+    }
+    return 0;
+
+failed:
+    bitmapFree(b);
+    return -1;
+}
+
+/*
+bitmapContains() - Whether a row is in the bitmap
+ - Time: O(log containers + log 4096), Space: O(1)
+ */
+int bitmapContains(const bitmap* b, unsigned int row) {
+    int at = findContainer(b, row >> 16);
+    if (at == b->count || b->containers[at].key != row >> 16) return 0;
+    const bitmapcontainer* c = &b->containers[at];
+    unsigned short low = (unsigned short)(row & 0xFFFF);
+    if (c->bits) return (c->words[low >> 6] >> (low & 63)) & 1;
+    int pos = lowerBound(c->values, c->cardinality, low);
+    return pos < c->cardinality && c->values[pos] == low;
+}
+
+/*
+bitmapCardinality() - Number of rows, from the containers' counts
+ - Time: O(containers), Space: O(1)
+ - Example: 10000000 rows of which a quarter are set -> 153 containers summed
+ */
+long bitmapCardinality(const bitmap* b) {
+    long count = 0;
+    for (int i = 0; i < b->count; i++) count += b->containers[i].cardinality;
+    return count;
+}
+
+/*
+bitmapRank() - Number of rows below row
+ - Time: O(containers + 1024), Space: O(1)
+ - Example: rows {1, 5, 9}: bitmapRank(&b, 6) -> 2
+ */
+long bitmapRank(const bitmap* b, unsigned int row) {
+    unsigned int key = row >> 16;
+    unsigned short low = (unsigned short)(row & 0xFFFF);
+    long count = 0;
+    for (int i = 0; i < b->count && b->containers[i].key <= key; i++) {
+        const bitmapcontainer* c = &b->containers[i];
+        if (c->key < key) {
+            count += c->cardinality;
+        } else if (c->bits) {
+            for (int w = 0; w < low >> 6; w++) count += wordBits(c->words[w]);
+            if (low & 63) count += wordBits(c->words[low >> 6] & ((1ULL << (low & 63)) - 1));
+        } else {
+            count += lowerBound(c->values, c->cardinality, low);
+        }
+    }
+    return count;
+}
+
+// Rows of two containers with the same key that are in both
+static int andContainers(const bitmapcontainer* a, const bitmapcontainer* b, bitmapcontainer* out) {
+    if (a->bits && b->bits) {
+        if (newBits(out, a->key, 0) != 0) return -1;
+        for (int i = 0; i < BITMAP_WORDS; i++) out->words[i] = a->words[i] & b->words[i];
+        out->cardinality = countWords(out->words);
+        return 0;
+    }
+    if (a->bits) {
+        const bitmapcontainer* t = a;
+        a = b;
+        b = t;
+    }
+    if (newArray(out, a->key, a->cardinality < b->cardinality ? a->cardinality : b->cardinality) != 0) {
+        return -1;
+    }
+    int n = 0;
+    if (b->bits) {
+        for (int i = 0; i < a->cardinality; i++) {
+            unsigned short v = a->values[i];
+            out->values[n] = v;
+            n += (int)((b->words[v >> 6] >> (v & 63)) & 1);
+        }
+    } else {
+        for (int i = 0, j = 0; i < a->cardinality && j < b->cardinality;) {
+            if (a->values[i] < b->values[j]) i++;
+            else if (a->values[i] > b->values[j]) j++;
+            else {
+                out->values[n++] = a->values[i];
+                i++;
+                j++;
+            }
+        }
+    }
+    out->cardinality = n;
+    return 0;
+}
+
+// Rows of two containers with the same key that are in either
+static int orContainers(const bitmapcontainer* a, const bitmapcontainer* b, bitmapcontainer* out) {
+    if (!a->bits && !b->bits && a->cardinality + b->cardinality <= BITMAP_ARRAY_MAX) {
+        if (newArray(out, a->key, a->cardinality + b->cardinality) != 0) return -1;
+        int n = 0, i = 0, j = 0;
+        while (i < a->cardinality && j < b->cardinality) {
+            if (a->values[i] < b->values[j]) out->values[n++] = a->values[i++];
+            else if (a->values[i] > b->values[j]) out->values[n++] = b->values[j++];
+            else {
+                out->values[n++] = a->values[i++];
+                j++;
+            }
+        }
+        while (i < a->cardinality) out->values[n++] = a->values[i++];
+        while (j < b->cardinality) out->values[n++] = b->values[j++];
+        out->cardinality = n;
+        return 0;
+    }
+    if (!a->bits) {
+        const bitmapcontainer* t = a;
+        a = b;
+        b = t;
+    }
+    if (newBits(out, a->key, !a->bits) != 0) return -1;
+    if (!a->bits) {
+        // Two arrays too long to merge into one
+        for (int i = 0; i < a->cardinality; i++) out->words[a->values[i] >> 6] |= 1ULL << (a->values[i] & 63);
+    } else if (b->bits) {
+        for (int i = 0; i < BITMAP_WORDS; i++) out->words[i] = a->words[i] | b->words[i];
+        out->cardinality = countWords(out->words);
+        return 0;
+    } else {
+        memcpy(out->words, a->words, sizeof(unsigned long long) * BITMAP_WORDS);
+    }
+    for (int i = 0; i < b->cardinality; i++) out->words[b->values[i] >> 6] |= 1ULL << (b->values[i] & 63);
+    out->cardinality = countWords(out->words);
+    return 0;
+}
+
+// Rows of container a (same key as b) that are not in b
+static int andNotContainers(const bitmapcontainer* a, const bitmapcontainer* b, bitmapcontainer* out) {
+    if (a->bits) {
+        if (newBits(out, a->key, 0) != 0) return -1;
+        if (b->bits) {
+            for (int i = 0; i < BITMAP_WORDS; i++) out->words[i] = a->words[i] & ~b->words[i];
+        } else {
+            memcpy(out->words, a->words, sizeof(unsigned long long) * BITMAP_WORDS);
+            for (int i = 0; i < b->cardinality; i++) {
+                out->words[b->values[i] >> 6] &= ~(1ULL << (b->values[i] & 63));
+            }
+        }
+        out->cardinality = countWords(out->words);
+        return 0;
+    }
+    if (newArray(out, a->key, a->cardinality) != 0) return -1;
+    int n = 0;
+    if (b->bits) {
+        for (int i = 0; i < a->cardinality; i++) {
+            unsigned short v = a->values[i];
+            out->values[n] = v;
+            n += (int)(((b->words[v >> 6] >> (v & 63)) & 1) ^ 1);
+        }
+    } else {
+        int j = 0;
+        for (int i = 0; i < a->cardinality; i++) {
+            while (j < b->cardinality && b->values[j] < a->values[i]) j++;
+            if (j == b->cardinality || b->values[j] != a->values[i]) out->values[n++] = a->values[i];
+        }
+    }
+    out->cardinality = n;
+    return 0;
+}
+
+/*
+bitmapAnd() - Rows in both a and b
+ - Time: O(containers + 1024 words per pair of bitsets, or the shorter
+   array per array/bitset pair), Space: O(result)
+ - out is made fresh (free it first if it held rows) and must not be a or b
+ - Returns 0, or -1 if out of memory (out is left empty)
+ - Example: rows tagged work AND rows tagged urgent
+ */
+int bitmapAnd(const bitmap* a, const bitmap* b, bitmap* out) {
+    bitmapInit(out);
+    for (int i = 0, j = 0; i < a->count && j < b->count;) {
+        const bitmapcontainer* x = &a->containers[i];
+        const bitmapcontainer* y = &b->containers[j];
+        if (x->key < y->key) i++;
+        else if (x->key > y->key) j++;
+        else {
+            bitmapcontainer c;
+            if (andContainers(x, y, &c) != 0 || keepContainer(out, &c) != 0) goto failed;
+            i++;
+            j++;
+        }
+    }
+    return 0;
+
+failed:
+    bitmapFree(out);
+    return -1;
+}
+
+/*
+bitmapOr() - Rows in a or b
+ - Time: O(containers of both + their rows), Space: O(result)
+ - out is made fresh (free it first if it held rows) and must not be a or b
+ - Returns 0, or -1 if out of memory (out is left empty)
+ */
+int bitmapOr(const bitmap* a, const bitmap* b, bitmap* out) {
+    bitmapInit(out);
+    int i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        const bitmapcontainer* x = i < a->count ? &a->containers[i] : NULL;
+        const bitmapcontainer* y = j < b->count ? &b->containers[j] : NULL;
+        bitmapcontainer c;
+        int status;
+        if (x && (!y || x->key < y->key)) {
+            status = copyContainer(&c, x);
+            i++;
+        } else if (y && (!x || y->key < x->key)) {
+            status = copyContainer(&c, y);
+            j++;
+        } else {
+            status = orContainers(x, y, &c);
+            i++;
+            j++;
+        }
+        if (status != 0 || keepContainer(out, &c) != 0) goto failed;
+    }
+    return 0;
+
+failed:
+    bitmapFree(out);
+    return -1;
+}
+
+/*
+bitmapAndNot() - Rows in a that are not in b
+ - Time: O(containers of both + rows of a), Space: O(result)
+ - out is made fresh (free it first if it held rows) and must not be a or b
+ - Returns 0, or -1 if out of memory (out is left empty)
+ - Example: rows tagged work AND NOT rows tagged waiting
+ */
+int bitmapAndNot(const bitmap* a, const bitmap* b, bitmap* out) {
+    bitmapInit(out);
+    for (int i = 0, j = 0; i < a->count; i++) {
+        const bitmapcontainer* x = &a->containers[i];
+        while (j < b->count && b->containers[j].key < x->key) j++;
+        bitmapcontainer c;
+        int status = j < b->count && b->containers[j].key == x->key
+                         ? andNotContainers(x, &b->containers[j], &c)
+                         : copyContainer(&c, x);
+        if (status != 0 || keepContainer(out, &c) != 0) goto failed;
+    }
+    return 0;
+
+failed:
+    bitmapFree(out);
+    return -1;
+}
+
+// Whether a container holds low
+static int containerHas(const bitmapcontainer* c, unsigned short low) {
+    if (c->bits) return (int)((c->words[low >> 6] >> (low & 63)) & 1);
+    int pos = lowerBound(c->values, c->cardinality, low);
+    return pos < c->cardinality && c->values[pos] == low;
+}
+
+/*
+bitmapAndMany() - Rows in every bitmap of all and in none of none, in one pass
+ - Time: O(containers + 1024 words per key the all bitmaps share, or the
+   smallest array's rows when one is an array), Space: O(result), with the
+   words of each key combined in one buffer and no bitmap in between
+ - For "a AND b AND NOT c" this is one pass where bitmapAnd() then
+   bitmapAndNot() make and free a whole bitmap for a AND b
+ - n must be at least 1. out is made fresh (free it first if it held rows)
+   and must not be one of the inputs; with out NULL the rows are only
+   counted.
+ - Returns the number of rows, or -1 if out of memory (out is left empty)
+ - Example: bitmapAndMany((const bitmap*[]){&work, &urgent}, 2, (const bitmap*[]){&waiting}, 1, NULL) -> 812
+ */
+long bitmapAndMany(const bitmap* const* all, int n, const bitmap* const* none, int m, bitmap* out) {
+    int cursors[BITMAP_OPERANDS_MAX];
+    const bitmapcontainer* with[BITMAP_OPERANDS_MAX];
+    const bitmapcontainer* without[BITMAP_OPERANDS_MAX];
+    unsigned long long words[BITMAP_WORDS];
+    unsigned short values[BITMAP_ARRAY_MAX];
+    long total = 0;
+
+    if (out) bitmapInit(out);
+    if (n < 1 || n + m > BITMAP_OPERANDS_MAX) return -1;
+    memset(cursors, 0, sizeof(cursors));
+
+    // Walk the keys of the bitmap with the fewest containers
+    int lead = 0;
+    for (int i = 1; i < n; i++) {
+        if (all[i]->count < all[lead]->count) lead = i;
+    }
+    for (int k = 0; k < all[lead]->count; k++) {
+        unsigned int key = all[lead]->containers[k].key;
+        int present = 1, without_count = 0;
+        for (int i = 0; i < n + m && present; i++) {
+            const bitmap* b = i < n ? all[i] : none[i - n];
+            while (cursors[i] < b->count && b->containers[cursors[i]].key < key) cursors[i]++;
+            int found = cursors[i] < b->count && b->containers[cursors[i]].key == key;
+            if (i < n) {
+                present = found;
+                with[i] = found ? &b->containers[cursors[i]] : NULL;
+            } else if (found) {
+                without[without_count++] = &b->containers[cursors[i]];
+            }
+        }
+        if (!present) continue;
+
+        // An array among them bounds the result: test each of its rows
+        int smallest = -1;
+        for (int i = 0; i < n; i++) {
+            if (!with[i]->bits && (smallest < 0 || with[i]->cardinality < with[smallest]->cardinality)) smallest = i;
+        }
+        bitmapcontainer c;
+        int count = 0;
+        if (smallest >= 0) {
+            const bitmapcontainer* base = with[smallest];
+            for (int v = 0; v < base->cardinality; v++) {
+                unsigned short low = base->values[v];
+                int keep = 1;
+                for (int i = 0; i < n && keep; i++) keep = i == smallest || containerHas(with[i], low);
+                for (int i = 0; i < without_count && keep; i++) keep = !containerHas(without[i], low);
+                values[count] = low;
+                count += keep;
+            }
+        } else {
+            memcpy(words, with[0]->words, sizeof(words));
+            for (int i = 1; i < n; i++) {
+                const unsigned long long* w = with[i]->words;
+                for (int j = 0; j < BITMAP_WORDS; j++) words[j] &= w[j];
+            }
+            for (int i = 0; i < without_count; i++) {
+                if (without[i]->bits) {
+                    const unsigned long long* w = without[i]->words;
+                    for (int j = 0; j < BITMAP_WORDS; j++) words[j] &= ~w[j];
+                } else {
+                    for (int v = 0; v < without[i]->cardinality; v++) {
+                        unsigned short low = without[i]->values[v];
+                        words[low >> 6] &= ~(1ULL << (low & 63));
+                    }
+                }
+            }
+            count = countWords(words);
+        }
+        total += count;
+        if (!out || count == 0) continue;
+
+        // Keep it in the smaller form
+        if (count <= BITMAP_ARRAY_MAX) {
+            if (newArray(&c, key, count) != 0) goto failed;
+            if (smallest >= 0) {
+                memcpy(c.values, values, sizeof(unsigned short) * count);
+            } else {
+                int v = 0;
+                for (int j = 0; j < BITMAP_WORDS; j++) {
+                    for (unsigned long long w = words[j]; w; w &= w - 1) {
+                        c.values[v++] = (unsigned short)(j * 64 + __builtin_ctzll(w));
+                    }
+                }
+            }
+        } else {
+            if (newBits(&c, key, 0) != 0) goto failed;
+            memcpy(c.words, words, sizeof(words));
+        }
+        c.cardinality = count;
+        if (keepContainer(out, &c) != 0) goto failed;
+    }
+    return total;
+
+failed:
+    bitmapFree(out);
+    return -1;
+}
+
+/*
+bitmapToArray() - Lists the rows in increasing order
+ - Time: O(rows + 1024 words per bitset), Space: O(1)
+ - Writes at most max rows to out; returns how many it wrote
+ */
+long bitmapToArray(const bitmap* b, unsigned int* out, long max) {
+    long n = 0;
+    for (int i = 0; i < b->count && n < max; i++) {
+        const bitmapcontainer* c = &b->containers[i];
+        unsigned int high = c->key << 16;
+        if (!c->bits) {
+            for (int k = 0; k < c->cardinality && n < max; k++) out[n++] = high | c->values[k];
+            continue;
+        }
+        for (int w = 0; w < BITMAP_WORDS && n < max; w++) {
+            for (unsigned long long word = c->words[w]; word && n < max; word &= word - 1) {
+                out[n++] = high | (unsigned int)(w * 64 + __builtin_ctzll(word));
+            }
+        }
+    }
+    return n;
+}
+
+/*
+bitmapBytes() - Memory the bitmap holds
+ - Time: O(containers), Space: O(1)
+ */
+size_t bitmapBytes(const bitmap* b) {
+    size_t bytes = sizeof(bitmapcontainer) * (size_t)b->capacity;
+    for (int i = 0; i < b->count; i++) {
+        const bitmapcontainer* c = &b->containers[i];
+        bytes += c->bits ? sizeof(unsigned long long) * BITMAP_WORDS : sizeof(unsigned short) * c->capacity;
+    }
+    return bytes;
+}
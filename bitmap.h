@@ -0,0 +1,51 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+// Compressed bitmaps of row numbers, in the style of Roaring bitmaps: rows
+// are grouped by their high 16 bits into containers of up to 65536, and
+// each container is either a sorted array of the low 16 bits (up to 4096 of
+// them, 2 bytes a row) or a bitset of 65536 bits (8 KB, for denser ones).
+// A tag held by a quarter of 10 million tasks takes 1.2 MB instead of the
+// 10 MB of an int per row, and a tag held by a few takes a few bytes.
+//
+// AND, OR and AND NOT work container by container: two bitsets are
+// combined a 64-bit word at a time in loops the compiler vectorizes, arrays
+// are merged, and an array against a bitset tests each of its rows.
+// bitmapAndMany() takes a whole "a AND b AND NOT c" chain at once, so no
+// bitmap is built for the steps in between. Each container keeps its
+// count, so the rows of a result are counted without listing them.
+
+#define BITMAP_ARRAY_MAX 4096
+#define BITMAP_WORDS 1024
+#define BITMAP_OPERANDS_MAX 64   // bitmaps one bitmapAndMany() can take
+
+typedef struct {
+    unsigned int key;              // high 16 bits of the rows in it
+    int bits;                      // 1: words is a bitset; 0: values is a sorted array
+    int cardinality;
+    int capacity;                  // values allocated
+    unsigned short* values;
+    unsigned long long* words;
+} bitmapcontainer;
+
+typedef struct {
+    bitmapcontainer* containers;   // sorted by key
+    int count;
+    int capacity;
+} bitmap;
+
+void bitmapInit(bitmap* b);
+void bitmapFree(bitmap* b);
+int bitmapAdd(bitmap* b, unsigned int row);
+int bitmapFill(bitmap* b, unsigned int rows);
+int bitmapContains(const bitmap* b, unsigned int row);
+long bitmapCardinality(const bitmap* b);
+long bitmapRank(const bitmap* b, unsigned int row);
+int bitmapAnd(const bitmap* a, const bitmap* b, bitmap* out);
+int bitmapOr(const bitmap* a, const bitmap* b, bitmap* out);
+int bitmapAndNot(const bitmap* a, const bitmap* b, bitmap* out);
+long bitmapAndMany(const bitmap* const* all, int n, const bitmap* const* none, int m, bitmap* out);
+long bitmapToArray(const bitmap* b, unsigned int* out, long max);
+size_t bitmapBytes(const bitmap* b);
+
+#endif
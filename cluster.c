@@ -0,0 +1,1129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#endif
+#include "cluster.h"
+#include "server.h"
+#include "shard.h"
+#include "fileio.h"
+#include "libtodo.h"
+
+static int comparePoints(const void* a, const void* b) {
+    const ringpoint* x = (const ringpoint*)a;
+    const ringpoint* y = (const ringpoint*)b;
+    if (x->point != y->point) return x->point < y->point ? -1 : 1;
+    return x->node - y->node;
+}
+
+/*
+ringBuild() - Places CLUSTER_VNODES points per node on the ring
+ - Time: O(P log P) for P = nodes * CLUSTER_VNODES, Space: O(P)
+ - A node's points are hashes of "<node>#<i>", so it keeps the same arcs
+   whichever other nodes are on the ring and in whatever order
+ - Returns 0, or -1 if out of memory
+ - Example: ringBuild(&ring, paths, 3) then ringLookup(&ring, "Report") -> 0..2
+ */
+int ringBuild(hashring* ring, const char* const nodes[], int count) {
+    ring->count = 0;
+    ring->points = (ringpoint*)malloc(sizeof(ringpoint) * ((size_t)count * CLUSTER_VNODES + 1));
+    if (!ring->points) return -1;
+
+    char key[256];
+    for (int n = 0; n < count; n++) {
+        for (int v = 0; v < CLUSTER_VNODES; v++) {
+            snprintf(key, sizeof(key), "%s#%d", nodes[n], v);
+            ring->points[ring->count].point = shardHash(key);
+            ring->points[ring->count].node = n;
+            ring->count++;
+        }
+    }
+    qsort(ring->points, (size_t)ring->count, sizeof(ringpoint), comparePoints);
+    return 0;
+}
+
+/*
+ringLookup() - The node that owns a name
+ - Time: O(log P), Space: O(1)
+ - Binary search for the first point at or after the name's hash, wrapping
+   around past the last one; -1 on an empty ring
+ */
+int ringLookup(const hashring* ring, const char* name) {
+    if (ring->count == 0) return -1;
+    unsigned int h = shardHash(name);
+    int low = 0, high = ring->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (ring->points[mid].point < h) low = mid + 1;
+        else high = mid;
+    }
+    return ring->points[low == ring->count ? 0 : low].node;
+}
+
+/*
+ringFree() - Releases the ring's points
+ - Time: O(1), Space: O(1)
+ */
+void ringFree(hashring* ring) {
+    free(ring->points);
+    ring->points = NULL;
+    ring->count = 0;
+}
+
+#ifndef _WIN32
+
+#define ROUTER_INPUT_SIZE (16 * 1024)
+#define ROUTER_NODE_INPUT (16 * 1024)
+// Point requests sent to one node before its answers are read back; small
+// enough that the answers always fit in the socket buffer
+#define ROUTER_WINDOW 512
+// A node that takes longer than this to read or answer is treated as down
+#define ROUTER_TIMEOUT_S 10
+// Stop reading from a client whose unsent answers pass this size
+#define ROUTER_OUTPUT_LIMIT (1024 * 1024)
+#define ROUTER_POLL_MS 200
+
+// Connection to one node, used by the router thread only
+typedef struct {
+    char path[108];
+    int fd;          // -1 while unreachable
+    outbuf out;      // requests not sent yet
+    int queued;      // requests in out
+    char in[ROUTER_NODE_INPUT];
+    size_t in_len;
+} clusternode;
+
+typedef struct {
+    int fd;
+    char in[ROUTER_INPUT_SIZE];
+    size_t in_len;
+    int discarding;    // skipping the rest of an overlong line
+    outbuf out;
+    size_t out_sent;
+    long line_number;
+    int closing;       // close once its answers are handed out
+} routerclient;
+
+// A request sent to a node whose answer has not been read yet
+typedef struct {
+    routerclient* client;  // NULL for the router's own requests
+    int node;
+    long line_number;
+    int is_complete;       // log the node for undo if it succeeds
+    char* ok;              // if set, gets 1 if the answer was OK
+} routerpending;
+
+static struct {
+    clusternode nodes[CLUSTER_MAX_NODES];
+    int node_count;
+    hashring ring;
+    routerpending* pending;
+    int pending_count;
+    int pending_cap;
+    outbuf scratch;
+    unsigned char* undo_log;  // node of each completion made through the router, oldest first
+    long undo_count;
+    long undo_cap;
+    long long requests;
+} router;
+
+// Set by SIGINT/SIGTERM; the poll() timeout makes the loop notice it
+static int router_stop;
+
+static void stopRouter(int sig) {
+    (void)sig;
+    __atomic_store_n(&router_stop, 1, __ATOMIC_RELAXED);
+}
+
+static void routerError(outbuf* out, long line_number, const char* message, const char* detail) {
+    batchsession err = {NULL, out, line_number, 0, -1};
+    batchError(&err, message, detail);
+}
+
+static void logCompletion(int node) {
+    if (router.undo_count == router.undo_cap) {
+        long cap = router.undo_cap ? router.undo_cap * 2 : 1024;
+        unsigned char* grown = (unsigned char*)realloc(router.undo_log, (size_t)cap);
+        if (!grown) return;
+        router.undo_log = grown;
+        router.undo_cap = cap;
+    }
+    router.undo_log[router.undo_count++] = (unsigned char)node;
+}
+
+// Rebuilds the ring over the first node_count nodes; -1 keeps the old one
+static int routerRing() {
+    const char* paths[CLUSTER_MAX_NODES];
+    hashring ring;
+    for (int n = 0; n < router.node_count; n++) paths[n] = router.nodes[n].path;
+    if (ringBuild(&ring, paths, router.node_count) != 0) return -1;
+    ringFree(&router.ring);
+    router.ring = ring;
+    return 0;
+}
+
+static void nodeDown(clusternode* node) {
+    if (node->fd >= 0) close(node->fd);
+    node->fd = -1;
+    node->in_len = 0;
+}
+
+// Connects a node that is down; 0 if it is up
+static int nodeConnect(clusternode* node) {
+    if (node->fd >= 0) return 0;
+    node->fd = serverConnect(node->path);
+    if (node->fd < 0) return -1;
+    struct timeval timeout = {ROUTER_TIMEOUT_S, 0};
+    setsockopt(node->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(node->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    node->in_len = 0;
+    return 0;
+}
+
+// Sends the queued requests in one write; on failure the node is marked down
+static int nodeSend(clusternode* node) {
+    int failed = nodeConnect(node) != 0 || writeAll(node->fd, node->out.data, node->out.len) != 0;
+    node->out.len = 0;
+    node->queued = 0;
+    if (failed) nodeDown(node);
+    return failed ? -1 : 0;
+}
+
+// Appends one answer line, newline included, to dst
+static int nodeReadLine(clusternode* node, outbuf* dst) {
+    for (;;) {
+        char* eol = node->in_len ? (char*)memchr(node->in, '\n', node->in_len) : NULL;
+        if (eol) {
+            size_t n = (size_t)(eol - node->in) + 1;
+            outbufPut(dst, node->in, n);
+            node->in_len -= n;
+            memmove(node->in, node->in + n, node->in_len);
+            return 0;
+        }
+        if (node->fd < 0 || node->in_len == sizeof(node->in)) break;
+        ssize_t got = read(node->fd, node->in + node->in_len, sizeof(node->in) - node->in_len);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        node->in_len += (size_t)got;
+    }
+    nodeDown(node);
+    return -1;
+}
+
+// Reads a whole answer: a query's "OK n" line is followed by n rows
+static int nodeReadAnswer(clusternode* node, outbuf* dst, int is_query) {
+    size_t start = dst->len;
+    if (nodeReadLine(node, dst) != 0) return -1;
+    if (is_query && strncmp(dst->data + start, "OK ", 3) == 0) {
+        long rows = atol(dst->data + start + 3);
+        for (long i = 0; i < rows; i++) {
+            if (nodeReadLine(node, dst) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+// One request and its whole answer; only call with nothing queued
+static int nodeCall(int n, const char* line, outbuf* answer) {
+    clusternode* node = &router.nodes[n];
+    outbufPuts(&node->out, line);
+    outbufPut(&node->out, "\n", 1);
+    if (nodeSend(node) != 0) return -1;
+    return nodeReadAnswer(node, answer, strncmp(line, "query", 5) == 0);
+}
+
+// Copies a node's answer for a client, renumbering "ERR line n:" to the
+// client's own line
+static void putAnswer(outbuf* out, long line_number, const char* data, size_t len) {
+    const char* colon = len > 9 && strncmp(data, "ERR line ", 9) == 0 ? (const char*)memchr(data, ':', len) : NULL;
+    if (!colon) {
+        outbufPut(out, data, len);
+        return;
+    }
+    outbufPuts(out, "ERR line ");
+    outbufPutInt(out, line_number, 0);
+    outbufPut(out, colon, len - (size_t)(colon - data));
+}
+
+/*
+routerFlush() - Sends every queued request and hands out the answers
+ - Time: O(queued requests), Space: O(1)
+ - Each node gets its queued requests in one write and answers them in
+   order, so reading the pending list front to back pairs every answer
+   with its request; clients get their answers in the order they asked
+ */
+static void routerFlush() {
+    for (int n = 0; n < router.node_count; n++) {
+        if (router.nodes[n].queued > 0) nodeSend(&router.nodes[n]);
+    }
+    for (int i = 0; i < router.pending_count; i++) {
+        routerpending* p = &router.pending[i];
+        clusternode* node = &router.nodes[p->node];
+        router.scratch.len = 0;
+        int answered = nodeReadLine(node, &router.scratch) == 0;
+        int ok = answered && strncmp(router.scratch.data, "OK", 2) == 0;
+        if (p->ok) *p->ok = (char)ok;
+        if (ok && p->is_complete) logCompletion(p->node);
+        if (!p->client) continue;
+        if (answered) putAnswer(&p->client->out, p->line_number, router.scratch.data, router.scratch.len);
+        else routerError(&p->client->out, p->line_number, "node unavailable", node->path);
+    }
+    router.pending_count = 0;
+}
+
+// Queues a single-line request for a node; the answer comes with routerFlush()
+static int queueRequest(int n, const char* line, routerclient* client, long line_number,
+                        int is_complete, char* ok) {
+    if (router.pending_count == router.pending_cap) {
+        int cap = router.pending_cap ? router.pending_cap * 2 : 1024;
+        routerpending* grown = (routerpending*)realloc(router.pending, sizeof(routerpending) * cap);
+        if (!grown) return -1;
+        router.pending = grown;
+        router.pending_cap = cap;
+    }
+    clusternode* node = &router.nodes[n];
+    outbufPuts(&node->out, line);
+    outbufPut(&node->out, "\n", 1);
+    router.pending[router.pending_count++] = (routerpending){client, n, line_number, is_complete, ok};
+    if (++node->queued >= ROUTER_WINDOW) routerFlush();
+    return 0;
+}
+
+/*
+routerFanOut() - Sends a command to every node and merges the answers
+ - Time: O(nodes + answer size), Space: O(answer size)
+ - Every node gets the request before any answer is read, so they work on
+   it at the same time; answers merge as in shardGather()
+ - Returns 0 if every node answered OK
+ */
+static int routerFanOut(routerclient* c, const char* line) {
+    outbuf parts[CLUSTER_MAX_NODES];
+    int count = router.node_count, ready = 0, down = -1;
+    int result = -1;
+
+    for (; ready < count; ready++) {
+        if (outbufInit(&parts[ready], -1, 256) != 0) break;
+    }
+    if (ready < count) {
+        routerError(&c->out, c->line_number, "out of memory", NULL);
+    } else {
+        for (int n = 0; n < count; n++) {
+            outbufPuts(&router.nodes[n].out, line);
+            outbufPut(&router.nodes[n].out, "\n", 1);
+            nodeSend(&router.nodes[n]);
+        }
+        int is_query = strncmp(line, "query", 5) == 0;
+        for (int n = 0; n < count; n++) {
+            if (nodeReadAnswer(&router.nodes[n], &parts[n], is_query) != 0 && down < 0) down = n;
+        }
+        if (down >= 0) {
+            routerError(&c->out, c->line_number, "node unavailable", router.nodes[down].path);
+        } else {
+            // bulk|complete: each node's "OK <n>" is n completions to log for undo
+            char action[16];
+            shardLineField(line, 1, action, sizeof(action));
+            if (strncmp(line, "bulk", 4) == 0 && strcmp(action, "complete") == 0) {
+                for (int n = 0; n < count; n++) {
+                    if (parts[n].len < 3 || strncmp(parts[n].data, "OK ", 3) != 0) continue;
+                    for (long k = strtol(parts[n].data + 3, NULL, 10); k > 0; k--) logCompletion(n);
+                }
+            }
+            router.scratch.len = 0;
+            result = shardGather(&router.scratch, parts, count);
+            putAnswer(&c->out, c->line_number, router.scratch.data, router.scratch.len);
+        }
+    }
+    for (int n = 0; n < ready; n++) outbufFree(&parts[n]);
+    return result;
+}
+
+// Splits a query answer in place into NUL-terminated rows; -1 if out of memory
+static long answerRows(outbuf* answer, char*** rows) {
+    char* first_end = (char*)memchr(answer->data, '\n', answer->len);
+    long count = first_end && answer->len > 3 ? atol(answer->data + 3) : 0;
+    *rows = (char**)malloc(sizeof(char*) * (count + 1));
+    if (!*rows) return -1;
+
+    char* row = first_end ? first_end + 1 : NULL;
+    long found = 0;
+    while (found < count && row < answer->data + answer->len) {
+        char* eol = (char*)memchr(row, '\n', (size_t)(answer->data + answer->len - row));
+        if (!eol) break;
+        *eol = '\0';
+        (*rows)[found++] = row;
+        row = eol + 1;
+    }
+    return found;
+}
+
+static int rowIsCompleted(const char* row) {
+    char status[16];
+    shardLineField(row, 4, status, sizeof(status));
+    return strcmp(status, "completed") == 0;
+}
+
+/*
+queueMove() - Queues the requests that recreate a task on another node
+ - Time: O(tags), Space: O(1)
+ - row is a query row (name|description|priority|date|status|tags): "add"
+   with its first four fields, a "tag" per tag, then "complete" if
+   `completed`. *ok tells whether the add succeeded.
+ */
+static void queueMove(const char* row, int to, char* ok, int completed) {
+    char line[BATCH_LINE_MAX + 16], name[BATCH_LINE_MAX], tags[MAX_TAGS * MAX_TAG_LENGTH + 8];
+    const char* end = row;
+    for (int i = 0; i < 4 && end; i++) end = strchr(end + (i > 0), '|');
+    shardLineField(row, 0, name, sizeof(name));
+
+    *ok = 0;
+    snprintf(line, sizeof(line), "add|%.*s", end ? (int)(end - row) : (int)strlen(row), row);
+    if (queueRequest(to, line, NULL, 0, 0, ok) != 0) return;
+
+    shardLineField(row, 5, tags, sizeof(tags));
+    for (char* tag = tags; *tag;) {
+        size_t n = strcspn(tag, ";");
+        snprintf(line, sizeof(line), "tag|%s|%.*s", name, (int)n, tag);
+        queueRequest(to, line, NULL, 0, 0, NULL);
+        tag += n + (tag[n] == ';');
+    }
+    if (completed) {
+        snprintf(line, sizeof(line), "complete|%s", name);
+        queueRequest(to, line, NULL, 0, 1, NULL);
+    }
+}
+
+/*
+moveTasks() - Moves the tasks of node `from` that the ring gives to other nodes
+ - Time: O(tasks on from), Space: O(tasks on from)
+ - Active tasks are recreated on their new owner, then deleted from `from`
+   once the add succeeded. Completed tasks are only moved when `from` is
+   leaving: they are completed on the new owner oldest first, so undo still
+   meets them newest first. A task whose add fails (say its name is
+   already active there) stays where it was and counts as failed.
+ */
+static void moveTasks(int from, int leaving, long* moved, long* failed) {
+    outbuf answer;
+    char** rows = NULL;
+    if (outbufInit(&answer, -1, 4096) != 0) return;
+    long count = nodeCall(from, "query|all", &answer) == 0 ? answerRows(&answer, &rows) : -1;
+    char* ok = count >= 0 ? (char*)malloc((size_t)count + 1) : NULL;
+    int* owner = count >= 0 ? (int*)malloc(sizeof(int) * (count + 1)) : NULL;
+    if (!ok || !owner) {
+        (*failed)++;
+        count = 0;
+    }
+
+    // Completed rows follow the active ones, newest first: turn them around
+    long first_completed = 0;
+    while (first_completed < count && !rowIsCompleted(rows[first_completed])) first_completed++;
+    for (long i = first_completed, j = count - 1; i < j; i++, j--) {
+        char* swap = rows[i];
+        rows[i] = rows[j];
+        rows[j] = swap;
+    }
+
+    char name[BATCH_LINE_MAX], line[BATCH_LINE_MAX + 16];
+    for (long begin = 0; begin < count; begin += ROUTER_WINDOW) {
+        long end = begin + ROUTER_WINDOW < count ? begin + ROUTER_WINDOW : count;
+        for (long i = begin; i < end; i++) {
+            shardLineField(rows[i], 0, name, sizeof(name));
+            owner[i] = ringLookup(&router.ring, name);
+            if (owner[i] == from || (!leaving && i >= first_completed)) owner[i] = -1;
+            else queueMove(rows[i], owner[i], &ok[i], i >= first_completed);
+        }
+        routerFlush();
+        for (long i = begin; i < end; i++) {
+            if (owner[i] < 0) continue;
+            if (ok[i]) (*moved)++;
+            else (*failed)++;
+            if (ok[i] && !leaving) {
+                shardLineField(rows[i], 0, name, sizeof(name));
+                snprintf(line, sizeof(line), "delete|%s", name);
+                queueRequest(from, line, NULL, 0, 0, NULL);
+            }
+        }
+        routerFlush();
+    }
+    free(ok);
+    free(owner);
+    free(rows);
+    outbufFree(&answer);
+}
+
+static int findNode(const char* path) {
+    for (int n = 0; n < router.node_count; n++) {
+        if (strcmp(router.nodes[n].path, path) == 0) return n;
+    }
+    return -1;
+}
+
+static void answerMoved(routerclient* c, long moved, long failed) {
+    outbufPuts(&c->out, "OK moved=");
+    outbufPutInt(&c->out, moved, 0);
+    outbufPuts(&c->out, " failed=");
+    outbufPutInt(&c->out, failed, 0);
+    outbufPuts(&c->out, " nodes=");
+    outbufPutInt(&c->out, router.node_count, 0);
+    outbufPut(&c->out, "\n", 1);
+}
+
+// join|socket - adds a running node; each old node hands over its share
+static void routerJoin(routerclient* c, const char* path) {
+    if (findNode(path) >= 0) {
+        routerError(&c->out, c->line_number, "node already in the cluster", path);
+        return;
+    }
+    if (router.node_count == CLUSTER_MAX_NODES || strlen(path) >= sizeof(router.nodes[0].path)) {
+        routerError(&c->out, c->line_number, router.node_count == CLUSTER_MAX_NODES ? "too many nodes" : "socket path too long", path);
+        return;
+    }
+    clusternode* node = &router.nodes[router.node_count];
+    strcpy(node->path, path);
+    node->fd = -1;
+    node->queued = 0;
+    if (outbufInit(&node->out, -1, 4096) != 0) {
+        routerError(&c->out, c->line_number, "out of memory", NULL);
+        return;
+    }
+    if (nodeConnect(node) != 0) {
+        outbufFree(&node->out);
+        routerError(&c->out, c->line_number, "node unavailable", path);
+        return;
+    }
+    router.node_count++;
+    if (routerRing() != 0) {
+        router.node_count--;
+        nodeDown(node);
+        outbufFree(&node->out);
+        routerError(&c->out, c->line_number, "out of memory", NULL);
+        return;
+    }
+
+    long moved = 0, failed = 0;
+    for (int n = 0; n < router.node_count - 1; n++) moveTasks(n, 0, &moved, &failed);
+    answerMoved(c, moved, failed);
+}
+
+// leave|socket - gives every task of a node to the others and drops it
+static void routerLeave(routerclient* c, const char* path) {
+    int n = findNode(path);
+    if (n < 0 || router.node_count == 1) {
+        routerError(&c->out, c->line_number, n < 0 ? "node not in the cluster" : "cannot remove the last node", path);
+        return;
+    }
+
+    // Swap the node to the end, so the ring over the others keeps its indices
+    int last = router.node_count - 1;
+    if (n != last) {
+        static clusternode swap;
+        swap = router.nodes[n];
+        router.nodes[n] = router.nodes[last];
+        router.nodes[last] = swap;
+        for (long i = 0; i < router.undo_count; i++) {
+            if (router.undo_log[i] == n) router.undo_log[i] = (unsigned char)last;
+            else if (router.undo_log[i] == last) router.undo_log[i] = (unsigned char)n;
+        }
+    }
+    router.node_count--;
+    if (routerRing() != 0) {
+        router.node_count++;
+        routerError(&c->out, c->line_number, "out of memory", NULL);
+        return;
+    }
+
+    // Its completions are re-made on the new owners and logged there
+    long kept = 0;
+    for (long i = 0; i < router.undo_count; i++) {
+        if (router.undo_log[i] != last) router.undo_log[kept++] = router.undo_log[i];
+    }
+    router.undo_count = kept;
+
+    long moved = 0, failed = 0;
+    moveTasks(last, 1, &moved, &failed);
+    nodeDown(&router.nodes[last]);
+    outbufFree(&router.nodes[last].out);
+    answerMoved(c, moved, failed);
+}
+
+// nodes - "OK n" and one socket path per node
+static void routerNodes(routerclient* c) {
+    outbufPuts(&c->out, "OK ");
+    outbufPutInt(&c->out, router.node_count, 0);
+    outbufPut(&c->out, "\n", 1);
+    for (int n = 0; n < router.node_count; n++) {
+        outbufPuts(&c->out, router.nodes[n].path);
+        outbufPut(&c->out, "\n", 1);
+    }
+}
+
+/*
+routerUndo() - undo: the newest completion made through the router
+ - Time: O(completed tasks on that node), Space: O(same)
+ - The log says which node it went to. If the ring has given the name to
+   another node since (a join), the restored task moves there.
+ */
+static void routerUndo(routerclient* c) {
+    if (router.undo_count == 0) {
+        routerError(&c->out, c->line_number, "no completed tasks to undo", NULL);
+        return;
+    }
+    int n = router.undo_log[router.undo_count - 1];
+    outbuf top, answer;
+    if (outbufInit(&top, -1, 1024) != 0) {
+        routerError(&c->out, c->line_number, "out of memory", NULL);
+        return;
+    }
+    if (outbufInit(&answer, -1, 256) != 0) {
+        outbufFree(&top);
+        routerError(&c->out, c->line_number, "out of memory", NULL);
+        return;
+    }
+
+    // The node's newest completion is the task that comes back
+    char** rows = NULL;
+    long count = nodeCall(n, "query|status|completed", &top) == 0 ? answerRows(&top, &rows) : 0;
+    if (nodeCall(n, "undo", &answer) != 0) {
+        routerError(&c->out, c->line_number, "node unavailable", router.nodes[n].path);
+    } else {
+        router.undo_count--;
+        if (count > 0 && strncmp(answer.data, "OK", 2) == 0) {
+            char name[BATCH_LINE_MAX], line[BATCH_LINE_MAX + 16], ok = 0;
+            shardLineField(rows[0], 0, name, sizeof(name));
+            int owner = ringLookup(&router.ring, name);
+            if (owner != n) {
+                queueMove(rows[0], owner, &ok, 0);
+                routerFlush();
+                if (ok) {
+                    snprintf(line, sizeof(line), "delete|%s", name);
+                    queueRequest(n, line, NULL, 0, 0, NULL);
+                    routerFlush();
+                }
+            }
+        }
+        putAnswer(&c->out, c->line_number, answer.data, answer.len);
+    }
+    free(rows);
+    outbufFree(&top);
+    outbufFree(&answer);
+}
+
+/*
+routerImport() - import|file: reads the file here and adds each task on its node
+ - Time: O(tasks), Space: O(tasks)
+ - Answers "OK <imported>"; names already active on their node are skipped,
+   as are tasks whose name or description holds a '|'
+ */
+static void routerImport(routerclient* c, const char* file) {
+    tasklist incoming = {NULL};
+    todoimportresult result;
+    todostatus status = todoImportFile(&incoming, file, getToday(), &result);
+
+    char ok[ROUTER_WINDOW], line[BATCH_LINE_MAX + 16];
+    long imported = 0;
+    task* t = incoming.head;
+    while (t) {
+        int queued = 0;
+        for (; t && queued < ROUTER_WINDOW; t = t->next) {
+            if (strchr(t->name, '|') || strchr(t->description, '|')) continue;
+            int length = snprintf(line, sizeof(line), "add|%s|%s|%d|", t->name, t->description, t->priority);
+            if (t->due_date_set) {
+                snprintf(line + length, sizeof(line) - length, "%02d/%02d/%04d",
+                         t->duedate.day, t->duedate.month, t->duedate.year);
+            }
+            if (queueRequest(ringLookup(&router.ring, t->name), line, NULL, 0, 0, &ok[queued]) == 0) queued++;
+        }
+        routerFlush();
+        for (int i = 0; i < queued; i++) imported += ok[i];
+    }
+    freeTasks(&incoming);
+
+    if (status != TODO_OK) {
+        routerError(&c->out, c->line_number, todoStatusText(status), file);
+        return;
+    }
+    outbufPuts(&c->out, "OK ");
+    outbufPutInt(&c->out, imported, 0);
+    outbufPut(&c->out, "\n", 1);
+}
+
+// Rebuilds a task from a query row: name|description|priority|date|status|tags
+static task* rowTask(const char* row, date today) {
+    char name[100], description[300], number[16], due_text[16], status[16];
+    char tags[MAX_TAGS * MAX_TAG_LENGTH + 8];
+    shardLineField(row, 0, name, sizeof(name));
+    shardLineField(row, 1, description, sizeof(description));
+    shardLineField(row, 2, number, sizeof(number));
+    shardLineField(row, 3, due_text, sizeof(due_text));
+    shardLineField(row, 4, status, sizeof(status));
+    shardLineField(row, 5, tags, sizeof(tags));
+
+    date due;
+    int has_due = sscanf(due_text, "%d/%d/%d", &due.day, &due.month, &due.year) == 3;
+    task* t;
+    if (todoCreateTask(name, description, atoi(number), has_due ? &due : NULL, today, &t) != TODO_OK) return NULL;
+    for (char* tag = tags; *tag;) {
+        size_t n = strcspn(tag, ";");
+        char end = tag[n];
+        tag[n] = '\0';
+        todoAddTag(t, tag);
+        tag += n + (end == ';');
+    }
+    if (strcmp(status, "completed") == 0) {
+        t->completed = 1;
+        t->status = COMPLETED;
+    } else if (strcmp(status, "overdue") == 0) {
+        t->status = OVERDUE;
+    }
+    return t;
+}
+
+static int pushCompleted(completedstack* stack, const char* row, date today) {
+    stacknode* node = (stacknode*)malloc(sizeof(stacknode));
+    if (!node) return -1;
+    node->task_data = rowTask(row, today);
+    if (!node->task_data) {
+        free(node);
+        return -1;
+    }
+    node->next = stack->top;
+    stack->top = node;
+    return 0;
+}
+
+/*
+routerExport() - export|file: one report of the tasks on every node
+ - Time: O(n log n), Space: O(n)
+ - Tasks are rebuilt from each node's query rows. Completed tasks made
+   through the router are listed in completion order (the undo log); any
+   others come after them, node by node.
+ */
+static void routerExport(routerclient* c, const char* file) {
+    int count = router.node_count;
+    outbuf answers[CLUSTER_MAX_NODES];
+    char** rows[CLUSTER_MAX_NODES] = {NULL};
+    long row_count[CLUSTER_MAX_NODES], cursor[CLUSTER_MAX_NODES];
+    tasklist all = {NULL};
+    completedstack done = {NULL};
+    date today = getToday();
+    int ready = 0, failed = 0;
+
+    for (; ready < count && !failed; ready++) {
+        if (outbufInit(&answers[ready], -1, 4096) != 0) break;
+        if (nodeCall(ready, "query|all", &answers[ready]) != 0) failed = 1;
+        row_count[ready] = answerRows(&answers[ready], &rows[ready]);
+        if (row_count[ready] < 0) failed = 1;
+    }
+    if (ready < count || failed) {
+        routerError(&c->out, c->line_number, failed ? "node unavailable" : "out of memory",
+                    failed ? router.nodes[ready - 1].path : NULL);
+        count = ready;
+        failed = 1;
+    }
+
+    // Active rows into one list; each node's completed rows start at cursor, newest first
+    task** link = &all.head;
+    for (int n = 0; n < count && !failed; n++) {
+        long i = 0;
+        for (; i < row_count[n] && !rowIsCompleted(rows[n][i]); i++) {
+            task* t = rowTask(rows[n][i], today);
+            if (!t) continue;
+            *link = t;
+            link = &t->next;
+        }
+        cursor[n] = i;
+    }
+
+    // Logged completions, newest first, claim each node's newest rows
+    long* logged = failed ? NULL : (long*)malloc(sizeof(long) * (router.undo_count + 1));
+    int* logged_node = failed ? NULL : (int*)malloc(sizeof(int) * (router.undo_count + 1));
+    long logged_count = 0;
+    if (!failed && (!logged || !logged_node)) failed = 1;
+    for (long i = router.undo_count - 1; i >= 0 && !failed; i--) {
+        int n = router.undo_log[i];
+        if (n < count && cursor[n] < row_count[n]) {
+            logged[logged_count] = cursor[n]++;
+            logged_node[logged_count++] = n;
+        }
+    }
+    // The stack is built oldest first: unlogged completions, then the logged ones
+    for (int n = 0; n < count && !failed; n++) {
+        for (long i = row_count[n] - 1; i >= cursor[n]; i--) pushCompleted(&done, rows[n][i], today);
+    }
+    for (long i = logged_count - 1; i >= 0 && !failed; i--) {
+        pushCompleted(&done, rows[logged_node[i]][logged[i]], today);
+    }
+
+    if (!failed) {
+        int export_failed = exportTasksTxt(all.head, &done, file) != 0;
+        fflush(stdout);
+        if (export_failed) routerError(&c->out, c->line_number, "export failed", file);
+        else outbufPuts(&c->out, "OK\n");
+    }
+    free(logged);
+    free(logged_node);
+    freeTasks(&all);
+    freeStack(&done);
+    for (int n = 0; n < ready; n++) {
+        free(rows[n]);
+        outbufFree(&answers[n]);
+    }
+}
+
+/*
+routerRequest() - Handles one request line from a client
+ - Time: O(1) for point commands (queued until routerFlush()), O(nodes)
+   plus the answers for the others
+ - add, put, tag, complete and delete go to the name's node and are
+   batched per node; anything else first flushes the queue so answers keep
+   the order of the requests
+ */
+static void routerRequest(routerclient* c, char* line) {
+    char command[16], argument[BATCH_LINE_MAX];
+    c->line_number++;
+    router.requests++;
+    shardLineField(line, 0, command, sizeof(command));
+    shardLineField(line, 1, argument, sizeof(argument));
+    if (command[0] == '\0' || command[0] == '#') return;
+
+    if (strcmp(command, "add") == 0 || strcmp(command, "put") == 0 || strcmp(command, "tag") == 0 ||
+        strcmp(command, "complete") == 0 || strcmp(command, "delete") == 0) {
+        int node = ringLookup(&router.ring, argument);
+        if (queueRequest(node, line, c, c->line_number, strcmp(command, "complete") == 0, NULL) != 0) {
+            routerFlush();
+            routerError(&c->out, c->line_number, "out of memory", NULL);
+        }
+        return;
+    }
+
+    routerFlush();
+    if (strcmp(command, "undo") == 0) {
+        routerUndo(c);
+    } else if (strcmp(command, "clear") == 0) {
+        if (routerFanOut(c, line) == 0) router.undo_count = 0;
+    } else if (strcmp(command, "query") == 0 || strcmp(command, "stats") == 0 ||
+               strcmp(command, "today") == 0 || strcmp(command, "bulk") == 0) {
+        routerFanOut(c, line);
+    } else if (strcmp(command, "nodes") == 0) {
+        routerNodes(c);
+    } else if (strcmp(command, "import") == 0 || strcmp(command, "export") == 0 ||
+               strcmp(command, "join") == 0 || strcmp(command, "leave") == 0) {
+        if (argument[0] == '\0') {
+            routerError(&c->out, c->line_number, "usage",
+                        command[0] == 'i' ? "import|file" : command[0] == 'e' ? "export|file" :
+                        command[0] == 'j' ? "join|socket" : "leave|socket");
+        } else if (command[0] == 'i') {
+            routerImport(c, argument);
+        } else if (command[0] == 'e') {
+            routerExport(c, argument);
+        } else if (command[0] == 'j') {
+            routerJoin(c, argument);
+        } else {
+            routerLeave(c, argument);
+        }
+    } else {
+        // Unknown command: node 0 gives the same error batch mode does
+        router.scratch.len = 0;
+        if (nodeCall(0, line, &router.scratch) == 0) {
+            putAnswer(&c->out, c->line_number, router.scratch.data, router.scratch.len);
+        } else {
+            routerError(&c->out, c->line_number, "node unavailable", router.nodes[0].path);
+        }
+    }
+}
+
+// Same error line batch mode gives for an overlong command
+static void routerLineTooLong(routerclient* c) {
+    routerFlush();
+    c->line_number++;
+    routerError(&c->out, c->line_number, "line too long", NULL);
+}
+
+// Reads what the client sent and handles every complete line; -1 to close
+static int routerRead(routerclient* c) {
+    ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+    if (n == 0) return -1;
+    if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    c->in_len += (size_t)n;
+
+    char* start = c->in;
+    char* end = c->in + c->in_len;
+    char* newline;
+    while ((newline = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        *newline = '\0';
+        if (c->discarding) {
+            c->discarding = 0;
+        } else {
+            if (newline > start && newline[-1] == '\r') newline[-1] = '\0';
+            if (newline - start >= BATCH_LINE_MAX) routerLineTooLong(c);
+            else routerRequest(c, start);
+        }
+        start = newline + 1;
+    }
+
+    c->in_len = (size_t)(end - start);
+    memmove(c->in, start, c->in_len);
+    if (c->in_len == sizeof(c->in)) {
+        if (!c->discarding) routerLineTooLong(c);
+        c->discarding = 1;
+        c->in_len = 0;
+    }
+    return 0;
+}
+
+// Writes pending answers without blocking, -1 if the client went away
+static int routerWrite(routerclient* c) {
+    while (c->out_sent < c->out.len) {
+        ssize_t n = write(c->fd, c->out.data + c->out_sent, c->out.len - c->out_sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        c->out_sent += (size_t)n;
+    }
+    c->out.len = 0;
+    c->out_sent = 0;
+    return c->out.error ? -1 : 0;
+}
+
+static routerclient* acceptClient(int listen_fd) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) return NULL;
+    routerclient* c = (routerclient*)calloc(1, sizeof(routerclient));
+    if (!c || outbufInit(&c->out, -1, 4096) != 0) {
+        free(c);
+        close(fd);
+        return NULL;
+    }
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    c->fd = fd;
+    return c;
+}
+
+/*
+runRouter() - Serves one task list spread over several node processes
+ - Time: O(1) per point request, O(nodes) per fanned-out request,
+   Space: O(connections)
+ - Same protocol as runServer(). A single thread polls the clients; point
+   requests read in one round are sent to each node in one write and the
+   answers matched back in order, so the nodes work in parallel while the
+   router stays simple. A node that does not answer within
+   ROUTER_TIMEOUT_S seconds is reported as unavailable and reconnected on
+   the next request.
+ - Runs until SIGINT/SIGTERM, then removes the socket file
+ - Sample Case:
+    $ ./todolist --serve /tmp/n0.sock & ./todolist --serve /tmp/n1.sock &
+    $ ./todolist --router /tmp/todo.sock /tmp/n0.sock /tmp/n1.sock &
+    $ printf 'add|Report|Q2|1|15/06/2025\nstats\n' | nc -U /tmp/todo.sock
+    OK
+    OK pending=1 overdue=0 completed=0 high=1 medium=0 low=0
+ */
+int runRouter(const char* path, const char* const nodes[], int count) {
+    if (count < 1 || count > CLUSTER_MAX_NODES) {
+        printf("A router needs 1 to %d node sockets.\n", CLUSTER_MAX_NODES);
+        return 1;
+    }
+    for (int n = 0; n < count; n++) {
+        clusternode* node = &router.nodes[n];
+        if (strlen(nodes[n]) >= sizeof(node->path) || outbufInit(&node->out, -1, 4096) != 0) {
+            printf("Cannot use node socket %s\n", nodes[n]);
+            return 1;
+        }
+        strcpy(node->path, nodes[n]);
+        node->fd = -1;
+        router.node_count++;
+        if (nodeConnect(node) != 0) printf("Node %s is not answering yet.\n", nodes[n]);
+    }
+    int listen_fd = -1;
+    if (routerRing() != 0 || outbufInit(&router.scratch, -1, 4096) != 0 ||
+        (listen_fd = serverListen(path)) < 0) {
+        if (listen_fd < 0) printf("Router could not start.\n");
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopRouter;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Routing %s to %d nodes (Ctrl+C to stop)\n", path, router.node_count);
+    fflush(stdout);
+
+    routerclient** clients = NULL;
+    int client_count = 0, client_cap = 0;
+    struct pollfd* fds = NULL;
+    int fds_cap = 0;
+    while (!__atomic_load_n(&router_stop, __ATOMIC_RELAXED)) {
+        if (client_count + 1 > fds_cap) {
+            fds_cap = (client_count + 1) * 2;
+            struct pollfd* grown = (struct pollfd*)realloc(fds, sizeof(struct pollfd) * fds_cap);
+            if (!grown) break;
+            fds = grown;
+        }
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < client_count; i++) {
+            routerclient* c = clients[i];
+            fds[i + 1].fd = c->fd;
+            fds[i + 1].events = (c->out.len - c->out_sent < ROUTER_OUTPUT_LIMIT) ? POLLIN : 0;
+            if (c->out.len > c->out_sent) fds[i + 1].events |= POLLOUT;
+        }
+
+        int polled = client_count;
+        if (poll(fds, (nfds_t)polled + 1, ROUTER_POLL_MS) <= 0) continue;
+
+        // Read from everyone first, so one flush serves all their point requests
+        for (int i = 0; i < polled; i++) {
+            if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) clients[i]->closing = routerRead(clients[i]) != 0;
+        }
+        routerFlush();
+        for (int i = polled - 1; i >= 0; i--) {
+            routerclient* c = clients[i];
+            if (!c->closing && c->out.len > c->out_sent) c->closing = routerWrite(c) != 0;
+            if (c->closing) {
+                close(c->fd);
+                outbufFree(&c->out);
+                free(c);
+                clients[i] = clients[--client_count];
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            routerclient* c;
+            while ((c = acceptClient(listen_fd)) != NULL) {
+                if (client_count == client_cap) {
+                    int cap = client_cap ? client_cap * 2 : 64;
+                    routerclient** grown = (routerclient**)realloc(clients, sizeof(routerclient*) * cap);
+                    if (!grown) {
+                        close(c->fd);
+                        outbufFree(&c->out);
+                        free(c);
+                        break;
+                    }
+                    clients = grown;
+                    client_cap = cap;
+                }
+                clients[client_count++] = c;
+            }
+        }
+    }
+
+    while (client_count > 0) {
+        routerclient* c = clients[--client_count];
+        close(c->fd);
+        outbufFree(&c->out);
+        free(c);
+    }
+    free(clients);
+    free(fds);
+    close(listen_fd);
+    unlink(path);
+    for (int n = 0; n < router.node_count; n++) {
+        nodeDown(&router.nodes[n]);
+        outbufFree(&router.nodes[n].out);
+    }
+    printf("Router stopped after %lld requests.\n", router.requests);
+    ringFree(&router.ring);
+    outbufFree(&router.scratch);
+    free(router.pending);
+    free(router.undo_log);
+    return 0;
+}
+
+// True once every node accepts connections, giving up after about five seconds
+static int waitForNodes(const char* const nodes[], int count) {
+    for (int round = 0; round < 100; round++) {
+        int up = 0;
+        for (int n = 0; n < count; n++) {
+            int fd = serverConnect(nodes[n]);
+            if (fd >= 0) {
+                close(fd);
+                up++;
+            }
+        }
+        if (up == count) return 1;
+        struct timespec pause = {0, 50 * 1000 * 1000};
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+/*
+runCluster() - Starts empty nodes as child processes and routes to them
+ - Time: see runRouter(), Space: O(nodes) processes
+ - Node sockets are <path>.0, <path>.1, ...; the nodes are stopped when
+   the router stops. Meant for trying the cluster on one machine.
+ - Sample Case:
+    $ ./todolist --cluster /tmp/todo.sock 3
+    Serving 0 tasks on /tmp/todo.sock.0 with 4 workers and 4 shards (Ctrl+C to stop)
+    ...
+    Routing /tmp/todo.sock to 3 nodes (Ctrl+C to stop)
+ */
+int runCluster(const char* path, int count) {
+    static char names[CLUSTER_MAX_NODES][108];
+    const char* nodes[CLUSTER_MAX_NODES];
+    pid_t pids[CLUSTER_MAX_NODES];
+    int started = 0;
+
+    if (count < 1 || count > CLUSTER_MAX_NODES) {
+        printf("A cluster needs 1 to %d nodes.\n", CLUSTER_MAX_NODES);
+        return 1;
+    }
+    fflush(stdout);
+    for (; started < count; started++) {
+        snprintf(names[started], sizeof(names[started]), "%s.%d", path, started);
+        nodes[started] = names[started];
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            tasklist list = {NULL};
+            completedstack stack = {NULL};
+            int result = runServer(&list, &stack, names[started]);
+            fflush(stdout);
+            _exit(result);
+        }
+        pids[started] = pid;
+    }
+
+    int result = 1;
+    if (started < count) printf("Could not start every node.\n");
+    else if (!waitForNodes(nodes, count)) printf("Nodes did not start listening.\n");
+    else result = runRouter(path, nodes, count);
+
+    for (int i = 0; i < started; i++) kill(pids[i], SIGTERM);
+    for (int i = 0; i < started; i++) waitpid(pids[i], NULL, 0);
+    return result;
+}
+
+#else
+
+int runRouter(const char* path, const char* const nodes[], int count) {
+    (void)path;
+    (void)nodes;
+    (void)count;
+    printf("Cluster mode needs Unix domain sockets and is not available on Windows.\n");
+    return 1;
+}
+
+int runCluster(const char* path, int nodes) {
+    (void)path;
+    (void)nodes;
+    printf("Cluster mode needs Unix domain sockets and is not available on Windows.\n");
+    return 1;
+}
+
+#endif
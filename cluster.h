@@ -0,0 +1,35 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+// Several task-store processes (--serve) behind one router process. The
+// router owns no tasks: it answers the batch protocol (see runBatch()) by
+// forwarding each command to the node that owns the task name on a
+// consistent-hash ring, and by asking every node for query, stats, today,
+// clear and bulk and merging the answers (shardGather()). Adding or removing a
+// node moves only the names whose arc of the ring changes owner, about 1/N.
+// Extra router commands:
+//   join|socket    adds a running node and moves its share of the tasks to it
+//   leave|socket   moves a node's tasks to the others and drops it
+//   nodes          "OK n" and one socket path per node
+
+#define CLUSTER_MAX_NODES 64
+#define CLUSTER_VNODES 128   // ring points per node
+
+typedef struct {
+    unsigned int point;
+    int node;
+} ringpoint;
+
+// Consistent-hash ring: a name belongs to the first point at or after its hash
+typedef struct {
+    ringpoint* points;
+    int count;
+} hashring;
+
+int ringBuild(hashring* ring, const char* const nodes[], int count);
+int ringLookup(const hashring* ring, const char* name);
+void ringFree(hashring* ring);
+int runRouter(const char* path, const char* const nodes[], int count);
+int runCluster(const char* path, int nodes);
+
+#endif
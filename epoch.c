@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include "epoch.h"
+
+
+/*
+epochInit() - Prepares an empty reclamation domain
+ - Time: O(1), Space: O(1)
+ */
+void epochInit(epochdomain* d) {
+    memset(d, 0, sizeof(*d));
+}
+
+/*
+epochRegister() - Reserves a reader slot for the calling thread
+ - Time: O(1), Space: O(1)
+ - Returns the slot number, or -1 when all EPOCH_MAX_READERS are taken
+ */
+int epochRegister(epochdomain* d) {
+    int slot = __atomic_fetch_add(&d->reader_count, 1, __ATOMIC_RELAXED);
+    return slot < EPOCH_MAX_READERS ? slot : -1;
+}
+
+/*
+epochEnter() - Starts a read section
+ - Time: O(1), Space: O(1)
+ - Nothing retired after this point is freed until epochExit()
+ */
+void epochEnter(epochdomain* d, int slot) {
+    epochreader* r = &d->readers[slot];
+    __atomic_store_n(&r->epoch, __atomic_load_n(&d->epoch, __ATOMIC_SEQ_CST), __ATOMIC_RELAXED);
+    // Publish "active" before any shared pointer is loaded
+    __atomic_store_n(&r->active, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/*
+epochExit() - Ends a read section; pointers read inside it must not be used after
+ - Time: O(1), Space: O(1)
+ */
+void epochExit(epochdomain* d, int slot) {
+    __atomic_store_n(&d->readers[slot].active, 0, __ATOMIC_RELEASE);
+}
+
+// Frees everything retired in one epoch
+static void freeLimbo(epochdomain* d, int bucket) {
+    for (int i = 0; i < d->limbo_count[bucket]; i++) free(d->limbo[bucket][i]);
+    d->reclaimed += d->limbo_count[bucket];
+    d->limbo_count[bucket] = 0;
+}
+
+/*
+tryAdvance() - Moves to the next epoch if every active reader has caught up
+ - Time: O(readers), Space: O(1)
+ - Readers active now entered in this epoch at the earliest, so memory
+   retired two epochs ago can no longer be reached and is freed
+ */
+static void tryAdvance(epochdomain* d) {
+    unsigned long epoch = __atomic_load_n(&d->epoch, __ATOMIC_RELAXED);
+    int count = __atomic_load_n(&d->reader_count, __ATOMIC_RELAXED);
+    if (count > EPOCH_MAX_READERS) count = EPOCH_MAX_READERS;
+
+    for (int i = 0; i < count; i++) {
+        epochreader* r = &d->readers[i];
+        if (__atomic_load_n(&r->active, __ATOMIC_SEQ_CST) &&
+            __atomic_load_n(&r->epoch, __ATOMIC_ACQUIRE) != epoch) {
+            return;
+        }
+    }
+    __atomic_store_n(&d->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+    freeLimbo(d, (int)((epoch + 2) % 3));
+}
+
+/*
+epochRetire() - Frees ptr once no reader can still reach it
+ - Time: O(readers) amortized, Space: O(1) amortized
+ - Writer only (one at a time); ptr must already be unlinked and come from malloc()
+ - If memory for the limbo list runs out, waits for readers and frees at once
+ */
+void epochRetire(epochdomain* d, void* ptr) {
+    int bucket = (int)(__atomic_load_n(&d->epoch, __ATOMIC_RELAXED) % 3);
+    if (d->limbo_count[bucket] == d->limbo_cap[bucket]) {
+        int cap = d->limbo_cap[bucket] ? d->limbo_cap[bucket] * 2 : 64;
+        void** grown = (void**)realloc(d->limbo[bucket], sizeof(void*) * cap);
+        if (!grown) {
+            // Two full advances guarantee no reader still holds ptr
+            unsigned long target = __atomic_load_n(&d->epoch, __ATOMIC_RELAXED) + 2;
+            while (__atomic_load_n(&d->epoch, __ATOMIC_RELAXED) < target) tryAdvance(d);
+            free(ptr);
+            d->retired++;
+            d->reclaimed++;
+            return;
+        }
+        d->limbo[bucket] = grown;
+        d->limbo_cap[bucket] = cap;
+    }
+    d->limbo[bucket][d->limbo_count[bucket]++] = ptr;
+    d->retired++;
+    tryAdvance(d);
+}
+
+/*
+epochDrain() - Frees all retired memory; call only once no readers remain
+ - Time: O(retired), Space: O(1)
+ */
+void epochDrain(epochdomain* d) {
+    for (int i = 0; i < 3; i++) {
+        freeLimbo(d, i);
+        free(d->limbo[i]);
+        d->limbo[i] = NULL;
+        d->limbo_cap[i] = 0;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+// Epoch-based reclamation: lets readers walk shared nodes without locks while
+// a writer unlinks them. The writer retires unlinked memory instead of
+// freeing it; it is freed once every reader that could still hold it has
+// left its read section.
+//
+// Readers: slot = epochRegister(d) once per thread, then
+//          epochEnter(d, slot) ... read ... epochExit(d, slot)
+// Writer:  (one at a time) unlink, then epochRetire(d, ptr)
+
+#define EPOCH_MAX_READERS 64
+
+typedef struct {
+    unsigned long epoch;  // epoch seen on entry
+    int active;           // inside a read section
+    char pad[64 - sizeof(unsigned long) - sizeof(int)];  // one cache line each
+} epochreader;
+
+typedef struct {
+    unsigned long epoch;
+    int reader_count;
+    epochreader readers[EPOCH_MAX_READERS];
+
+    // Writer side: memory retired in each of the last three epochs
+    void** limbo[3];
+    int limbo_count[3];
+    int limbo_cap[3];
+    long long retired;
+    long long reclaimed;
+} epochdomain;
+
+void epochInit(epochdomain* d);
+int epochRegister(epochdomain* d);
+void epochEnter(epochdomain* d, int slot);
+void epochExit(epochdomain* d, int slot);
+void epochRetire(epochdomain* d, void* ptr);
+void epochDrain(epochdomain* d);
+
+#endif
@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+#include "feed.h"
+#include "views.h"
+
+// Slot stamp while a writer fills it
+#define FEED_BUSY ((unsigned long)-1)
+#define FEED_MIN_EVENTS 64
+
+static changefeed* default_feed;
+
+// Wall clock in milliseconds, comparable between processes
+static long long feedNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void feedYield() {
+#ifdef _WIN32
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+}
+
+/*
+feedInit() - Creates an empty ring for at least `events` events
+ - Time: O(events), Space: O(events)
+ - The size is rounded up to a power of two (at least FEED_MIN_EVENTS)
+ - Returns 0 on success, -1 if out of memory
+ - Example: feedInit(&feed, FEED_DEFAULT_EVENTS) -> 16384 slots, about 4 MB
+ */
+int feedInit(changefeed* feed, int events) {
+    unsigned long size = FEED_MIN_EVENTS;
+    while (size < (unsigned long)events) size *= 2;
+    feed->slots = (feedslot*)calloc(size, sizeof(feedslot));
+    feed->mask = size - 1;
+    feed->head = 0;
+    return feed->slots ? 0 : -1;
+}
+
+/*
+feedFree() - Frees the ring
+ - Time: O(1), Space: O(1)
+ - No writer or reader may still use it; unset it as the default first
+ */
+void feedFree(changefeed* feed) {
+    free(feed->slots);
+    feed->slots = NULL;
+}
+
+/*
+feedSetDefault() - Sets the feed the library records into (NULL: none)
+ - Time: O(1), Space: O(1)
+ */
+void feedSetDefault(changefeed* feed) {
+    __atomic_store_n(&default_feed, feed, __ATOMIC_RELEASE);
+}
+
+/*
+feedDefault() - The feed the library records into, or NULL
+ - Time: O(1), Space: O(1)
+ */
+changefeed* feedDefault() {
+    return __atomic_load_n(&default_feed, __ATOMIC_ACQUIRE);
+}
+
+/*
+feedHead() - Sequence number of the newest event recorded (0 if none)
+ - Time: O(1), Space: O(1)
+ - The newest events may still be being written; feedRead() waits for them
+ */
+unsigned long feedHead(const changefeed* feed) {
+    return __atomic_load_n(&feed->head, __ATOMIC_ACQUIRE);
+}
+
+/*
+feedPublish() - Appends an event; safe from any number of threads
+ - Time: O(1), Space: O(1)
+ - Sets event->seq and returns it. Claiming the number is one atomic add;
+   the slot is then taken from whatever it held a lap earlier. Readers
+   never block a writer. Two writers only meet on a slot when one is a
+   whole ring ahead of the other, and then the older event is dropped
+   (readers count it as lost).
+ */
+unsigned long feedPublish(changefeed* feed, feedevent* event) {
+    unsigned long seq = __atomic_add_fetch(&feed->head, 1, __ATOMIC_ACQ_REL);
+    event->seq = seq;
+    unsigned long long words[FEED_WORDS];
+    words[FEED_WORDS - 1] = 0;
+    memcpy(words, event, sizeof(*event));
+
+    feedslot* slot = &feed->slots[seq & feed->mask];
+    unsigned long stamp = __atomic_load_n(&slot->stamp, __ATOMIC_RELAXED);
+    for (;;) {
+        if (stamp == FEED_BUSY) {
+            feedYield();
+            stamp = __atomic_load_n(&slot->stamp, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (stamp > seq) return seq;
+        if (__atomic_compare_exchange_n(&slot->stamp, &stamp, FEED_BUSY, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    // A reader that sees any of the new words also sees the slot busy
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < FEED_WORDS; i++) __atomic_store_n(&slot->words[i], words[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->stamp, seq, __ATOMIC_RELEASE);
+    return seq;
+}
+
+// Copies at most size - 1 bytes of text and terminates it
+static void feedCopy(char* out, size_t size, const char* text) {
+    size_t n = 0;
+    while (n < size - 1 && text[n]) n++;
+    memcpy(out, text, n);
+    out[n] = '\0';
+}
+
+/*
+feedRecord() - Records a change to t in the default feed, if there is one
+ - Time: O(1), Space: O(1)
+ - Called by whoever changed t, after the change (before it for delete and
+   clear, while t is still valid); detail and previous as in feedtype
+ - The default saved views (views.h) are told of the change too
+ - Example: feedRecord(FEED_TAG, t, "work", 0)
+ */
+void feedRecord(feedtype type, const task* t, const char* detail, int previous) {
+    viewsRecord(type, t);
+    changefeed* feed = feedDefault();
+    if (!feed) return;
+
+    feedevent event;
+    memset(&event, 0, sizeof(event));
+    event.ms = feedNowMs();
+    event.type = (unsigned char)type;
+    event.status = (unsigned char)__atomic_load_n(&t->status, __ATOMIC_RELAXED);
+    event.priority = (unsigned char)t->priority;
+    event.previous = (unsigned char)previous;
+    event.due_set = (unsigned char)(t->due_date_set != 0);
+    event.due = t->duedate;
+    feedCopy(event.name, sizeof(event.name), t->name);
+    if (detail) feedCopy(event.detail, sizeof(event.detail), detail);
+    feedPublish(feed, &event);
+}
+
+/*
+feedRecordAdded() - Records the newest `count` tasks of a list as added, oldest first
+ - Time: O(count), Space: O(count)
+ - For imports, which link tasks at the head without recording them
+ */
+void feedRecordAdded(task* head, int count) {
+    if ((!feedDefault() && !viewsDefault()) || count <= 0) return;
+    task** added = (task**)malloc(sizeof(task*) * count);
+    int n = 0;
+    for (task* t = head; t && n < count; t = t->next) {
+        if (added) added[n] = t;
+        else feedRecord(FEED_ADD, t, NULL, 0);
+        n++;
+    }
+    if (!added) return;
+    for (int i = n - 1; i >= 0; i--) feedRecord(FEED_ADD, added[i], NULL, 0);
+    free(added);
+}
+
+/*
+feedSubscribe() - Points a cursor at a feed
+ - Time: O(1), Space: O(1)
+ - from is the first sequence number wanted; 0 (or a number not reached
+   yet) means only events recorded from now on
+ */
+void feedSubscribe(changefeed* feed, feedcursor* cursor, unsigned long from) {
+    unsigned long head = feedHead(feed);
+    cursor->feed = feed;
+    cursor->next = from == 0 || from > head + 1 ? head + 1 : from;
+    cursor->lost = 0;
+}
+
+/*
+feedRead() - Copies up to max events from the cursor on, in order
+ - Time: O(max), Space: O(1)
+ - Returns the number copied; 0 when the cursor has caught up, or the next
+   event is still being written. Events overwritten before the cursor got
+   to them are skipped and added to cursor->lost.
+ - Sample Case:
+    Input: ring of 64, cursor at 10, head 100
+    Output: cursor->lost += 26, events 36.. returned
+ */
+int feedRead(feedcursor* cursor, feedevent events[], int max) {
+    changefeed* feed = cursor->feed;
+    unsigned long long words[FEED_WORDS];
+    int count = 0;
+
+    while (count < max) {
+        unsigned long head = feedHead(feed);
+        if (cursor->next > head) break;
+        unsigned long oldest = head > feed->mask ? head - feed->mask : 1;
+        if (cursor->next < oldest) {
+            cursor->lost += oldest - cursor->next;
+            cursor->next = oldest;
+        }
+
+        feedslot* slot = &feed->slots[cursor->next & feed->mask];
+        unsigned long stamp = __atomic_load_n(&slot->stamp, __ATOMIC_ACQUIRE);
+        if (stamp != cursor->next) {
+            // A newer event has the slot: head has moved on, look again.
+            // Otherwise this one is still being written.
+            if (stamp != FEED_BUSY && stamp > cursor->next) continue;
+            break;
+        }
+        for (size_t i = 0; i < FEED_WORDS; i++) words[i] = __atomic_load_n(&slot->words[i], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->stamp, __ATOMIC_RELAXED) != stamp) continue;
+
+        memcpy(&events[count++], words, sizeof(feedevent));
+        cursor->next++;
+    }
+    return count;
+}
+
+/*
+feedFormat() - Writes an event as one line, without the newline
+ - Time: O(1), Space: O(1)
+ - "<seq> <ms> <type>|<name>|<priority>|<DD/MM/YYYY or ->|<status>|<detail>";
+   for status and priority events the detail is the old value
+ - Returns the length, or -1 if it does not fit in size
+ - Example: "42 1760000000000 tag|Report|1|15/06/2025|pending|work"
+ */
+int feedFormat(const feedevent* event, char* line, size_t size) {
+    static const char* const types[] = {"add", "edit", "complete", "undo", "delete",
+                                        "tag", "untag", "status", "priority", "clear"};
+    static const char* const statuses[] = {"pending", "completed", "overdue"};
+    char due[16] = "-";
+    char previous[16];
+    const char* detail = event->detail;
+
+    if (event->due_set) {
+        snprintf(due, sizeof(due), "%02d/%02d/%04d", event->due.day, event->due.month, event->due.year);
+    }
+    if (event->type == FEED_STATUS) {
+        detail = statuses[event->previous <= OVERDUE ? event->previous : PENDING];
+    } else if (event->type == FEED_PRIORITY) {
+        snprintf(previous, sizeof(previous), "%d", event->previous);
+        detail = previous;
+    }
+    int n = snprintf(line, size, "%lu %lld %s|%s|%d|%s|%s|%s", event->seq, event->ms,
+                     types[event->type <= FEED_CLEAR ? event->type : FEED_EDIT], event->name,
+                     event->priority, due, statuses[event->status <= OVERDUE ? event->status : PENDING],
+                     detail);
+    return n >= 0 && (size_t)n < size ? n : -1;
+}
@@ -0,0 +1,85 @@
+#ifndef FEED_H
+#define FEED_H
+
+// Change feed: every change to a task is recorded as a small event in a ring
+// with a sequence number, for consumers that keep their own view of the
+// tasks (dashboards, counters) and would otherwise diff whole exports.
+// Recording never waits: a writer claims the next sequence number with one
+// atomic add and fills its slot. Readers follow the ring with a cursor and
+// can resume from any sequence number still in it; a reader that falls a
+// whole ring behind is told how many events it lost and carries on from the
+// oldest one left, so a slow reader never holds a writer back.
+//
+// The library (libtodo.c, batch.c, edit() and the scheduler) records into
+// the process feed set with feedSetDefault(), and tells the saved views
+// (views.h) of the change; with neither set, recording costs two atomic
+// loads. The server sends the feed to clients that send
+// "subscribe" (see runServer()).
+
+#include "task_management.h"
+
+#define FEED_DEFAULT_EVENTS 16384
+#define FEED_DETAIL_MAX 100
+
+typedef enum {
+    FEED_ADD,        // new task, or put replacing the active task of that name
+    FEED_EDIT,       // name, description, priority or due date changed; detail = old name
+    FEED_COMPLETE,
+    FEED_UNDO,       // a completed task is active again
+    FEED_DELETE,
+    FEED_TAG,        // detail = the tag added
+    FEED_UNTAG,      // detail = the tag removed (a replaced tag is UNTAG then TAG)
+    FEED_STATUS,     // pending <-> overdue; previous = the old status
+    FEED_PRIORITY,   // raised by the scheduler or set in bulk; previous = the old priority
+    FEED_CLEAR       // a completed task was freed
+} feedtype;
+
+// One change, with the task as it is afterwards
+typedef struct {
+    unsigned long seq;           // 1 for the first event of the process
+    long long ms;                // wall clock when recorded
+    unsigned char type;          // feedtype
+    unsigned char status;        // TaskStatus
+    unsigned char priority;
+    unsigned char previous;      // old status or priority, see feedtype
+    unsigned char due_set;
+    date due;
+    char name[100];
+    char detail[FEED_DETAIL_MAX];
+} feedevent;
+
+#define FEED_WORDS ((sizeof(feedevent) + sizeof(unsigned long long) - 1) / sizeof(unsigned long long))
+
+// The event is kept as words so readers can copy it with atomic loads
+// while a writer may be reusing the slot
+typedef struct {
+    unsigned long stamp;         // seq of the event in it; 0 while being written
+    unsigned long long words[FEED_WORDS];
+} feedslot;
+
+typedef struct {
+    feedslot* slots;
+    unsigned long mask;          // slots - 1, a power of two
+    unsigned long head;          // last sequence number claimed
+} changefeed;
+
+// Where one reader is
+typedef struct {
+    changefeed* feed;
+    unsigned long next;          // the sequence number it reads next
+    unsigned long lost;          // events overwritten before it read them
+} feedcursor;
+
+int feedInit(changefeed* feed, int events);
+void feedFree(changefeed* feed);
+void feedSetDefault(changefeed* feed);
+changefeed* feedDefault();
+unsigned long feedPublish(changefeed* feed, feedevent* event);
+void feedRecord(feedtype type, const task* t, const char* detail, int previous);
+void feedRecordAdded(task* head, int count);
+void feedSubscribe(changefeed* feed, feedcursor* cursor, unsigned long from);
+int feedRead(feedcursor* cursor, feedevent events[], int max);
+unsigned long feedHead(const changefeed* feed);
+int feedFormat(const feedevent* event, char* line, size_t size);
+
+#endif
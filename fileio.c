@@ -2,57 +2,595 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>  
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#define open _open
+#define close _close
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+#include <pthread.h>
 #include "fileio.h"
+#include "libtodo.h"
+#include "feed.h"
+#include "undo.h"
+#include "outbuf.h"
+#include "pool.h"
 #include "scheduler.h"  
 
 
+// Room reserved per row so a row is never split by a flush
+// (99-char name + 5 tags of 19 chars + padding stays well below this)
+#define EXPORT_ROW_MAX 512
+
+// Priority and status columns already padded to "%-10s " width
+static const char* const priority_column[4] = {
+    "Unknown    ", "High       ", "Medium     ", "Low        "
+};
+static const char status_overdue[] = "OVERDUE    ";
+static const char status_pending[] = "Pending    ";
+static const char date_not_set[] = "Not Set         ";
+static const char separator_line[] =
+    "--------------------------------------------------------------------------------\n";
+
+// Export row with its precomputed sort key, so sorting never touches the
+// task structs themselves (they are scattered across the heap)
+typedef struct {
+    long long key;
+    task* t;
+} exportentry;
+
+// Growable array of export rows
+typedef struct {
+    exportentry* items;
+    int count;
+    int cap;
+} exportlist;
+
+// Appends a row, doubling the array when full; returns 1 if out of memory
+static int exportListPush(exportlist* list, task* t, long long key) {
+    if (list->count == list->cap) {
+        int new_cap = list->cap ? list->cap * 2 : 256;
+        exportentry* grown = (exportentry*)realloc(list->items, sizeof(exportentry) * new_cap);
+        if (!grown) return 1;
+        list->items = grown;
+        list->cap = new_cap;
+    }
+    list->items[list->count].key = key;
+    list->items[list->count].t = t;
+    list->count++;
+    return 0;
+}
+
+// Orders like compareDates(); no due date sorts after every real date
+static long long exportSortKey(const task* t, int use_unset_last) {
+    if (use_unset_last && !t->due_date_set) return LLONG_MAX;
+    return ((long long)t->duedate.year << 32) + ((long long)t->duedate.month << 16) + t->duedate.day;
+}
+
 /*
-exportTasksTxt() - Exports all tasks to formatted text file
+sortExportEntries() - Stable merge sort of export rows by key
  - Time: O(n log n), Space: O(n)
+ - Stable, so it gives the same order as the bubble sorts it replaced
+ */
+static void sortExportEntries(exportentry* entries, int count) {
+    if (count < 2) return;
+
+    exportentry* tmp = (exportentry*)malloc(sizeof(exportentry) * count);
+    if (!tmp) {
+        // Fall back to insertion sort, still stable
+        for (int i = 1; i < count; i++) {
+            exportentry e = entries[i];
+            int j = i - 1;
+            while (j >= 0 && entries[j].key > e.key) {
+                entries[j + 1] = entries[j];
+                j--;
+            }
+            entries[j + 1] = e;
+        }
+        return;
+    }
+
+    // Bottom-up merge: runs of width 1, 2, 4, ...
+    exportentry* src = entries;
+    exportentry* dst = tmp;
+    for (int width = 1; width < count; width *= 2) {
+        for (int lo = 0; lo < count; lo += 2 * width) {
+            int mid = lo + width < count ? lo + width : count;
+            int hi = lo + 2 * width < count ? lo + 2 * width : count;
+            int i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                // take from the right only if strictly smaller (keeps it stable)
+                if (src[j].key < src[i].key) dst[k++] = src[j++];
+                else dst[k++] = src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        exportentry* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != entries) memcpy(entries, src, sizeof(exportentry) * count);
+    free(tmp);
+}
+
+// Copies s and pads it with spaces to width, as printf("%-*s"); returns the end
+static char* exportPutPadded(char* p, const char* s, int width) {
+    char* start = p;
+    while (*s) *p++ = *s++;
+    while (p - start < width) *p++ = ' ';
+    return p;
+}
+
+// Writes n (n >= 0) left-justified in width, as printf("%-*d"); returns the end
+static char* exportPutNumber(char* p, int n, int width) {
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n);
+    char* start = p;
+    while (count) *p++ = digits[--count];
+    while (p - start < width) *p++ = ' ';
+    return p;
+}
+
+// Whether d prints as exactly DD/MM/YYYY
+static int exportOrdinaryDate(date d) {
+    return d.day >= 0 && d.day < 100 && d.month >= 0 && d.month < 100 && d.year >= 0 && d.year < 10000;
+}
+
+// Writes an ordinary date as DD/MM/YYYY; returns the end
+static char* exportPutDate(char* p, date d) {
+    p[0] = (char)('0' + d.day / 10);
+    p[1] = (char)('0' + d.day % 10);
+    p[2] = '/';
+    p[3] = (char)('0' + d.month / 10);
+    p[4] = (char)('0' + d.month % 10);
+    p[5] = '/';
+    p[6] = (char)('0' + d.year / 1000);
+    p[7] = (char)('0' + d.year / 100 % 10);
+    p[8] = (char)('0' + d.year / 10 % 10);
+    p[9] = (char)('0' + d.year % 10);
+    return p + 10;
+}
+
+/*
+exportRow() - Formats one export table row into the output buffer
+ - Time: O(1), Space: O(1)
+ - status is the padded status column, or NULL for the completed table
  - Sample Case:
-    Input: Filename: "tasks_backup.txt"
-    Output file content:
-      ===== TO-DO LIST EXPORT =====
-      Date Exported: 02/05/2025
-      
-      #   Name             Priority   Due Date    Status
-      1   Urgent Task      High       03/05/2025  Pending
-      2   Regular Task     Medium     10/05/2025  Pending
-      
-      Summary: 0 overdue, 2 pending, 0 completed
+    Input: 1, task "Essay" (High, 03/05/2025, tags "school"), status_pending
+    Output: "1   Essay                     High       03/05/2025      Pending    school              \n"
  */
-void exportTasksTxt(task* head, completedstack* stack, const char* filename) {
-    char filepath[512];
-    FILE* file;
+static void exportRow(outbuf* out, int number, const task* t, const char* status) {
+    // Written straight to the reserved space: one bounds check per row
+    // instead of one per field
+    char* p = outbufReserve(out, EXPORT_ROW_MAX);
+    if (!p) return;
+
+    p = exportPutNumber(p, number, 3);
+    *p++ = ' ';
+    p = exportPutPadded(p, t->name, 25);
+    *p++ = ' ';
+
+    int priority = (t->priority >= 1 && t->priority <= 3) ? t->priority : 0;
+    memcpy(p, priority_column[priority], 11);
+    p += 11;
+
+    if (t->due_date_set && exportOrdinaryDate(t->duedate)) {
+        p = exportPutDate(p, t->duedate);
+        memset(p, ' ', 6);
+        p += 6;
+    } else if (t->due_date_set) {
+        // Out-of-range fields take outbuf's general path; the reserve
+        // above leaves room for it
+        char* date_start = p;
+        out->len = (size_t)(p - out->data);
+        outbufPutDate(out, t->duedate);
+        p = out->data + out->len;
+        p = exportPutPadded(p, "", 15 - (int)(p - date_start));
+        *p++ = ' ';
+    } else {
+        memcpy(p, date_not_set, sizeof(date_not_set) - 1);
+        p += sizeof(date_not_set) - 1;
+    }
+
+    if (status) {
+        memcpy(p, status, 11);
+        p += 11;
+    }
+
+    char* tags_start = p;
+    for (int j = 0; j < t->tag_count; j++) {
+        if (j > 0) *p++ = ',', *p++ = ' ';
+        p = exportPutPadded(p, t->tags[j], 0);
+    }
+    p = exportPutPadded(p, "", 20 - (int)(p - tags_start));
+    *p++ = '\n';
+    out->len = (size_t)(p - out->data);
+}
+
+// After sorting, rows visit tasks in random heap order; fetch the cache
+// lines a row needs (name, priority/date, tags) a few rows ahead
+#define EXPORT_PREFETCH 8
+static void prefetchTask(const task* t) {
+#if defined(__GNUC__)
+    __builtin_prefetch(t->name);
+    __builtin_prefetch(t->name + 64);
+    __builtin_prefetch(&t->priority);
+    __builtin_prefetch(t->tags[1]);
+    __builtin_prefetch(&t->tag_count);
+#else
+    (void)t;
+#endif
+}
+
+// Writes the column header line of a table
+static void exportHeaderLine(outbuf* out, int with_status) {
+    outbufPutPadded(out, "#", 3);
+    outbufPut(out, " ", 1);
+    outbufPutPadded(out, "Name", 25);
+    outbufPut(out, " ", 1);
+    outbufPutPadded(out, "Priority", 10);
+    outbufPut(out, " ", 1);
+    outbufPutPadded(out, "Due Date", 15);
+    outbufPut(out, " ", 1);
+    if (with_status) {
+        outbufPutPadded(out, "Status", 10);
+        outbufPut(out, " ", 1);
+    }
+    outbufPutPadded(out, "Tags", 20);
+    outbufPut(out, "\n", 1);
+    outbufPuts(out, separator_line);
+}
+
+// Rows per chunk handed to a formatting thread (~1.5 MB of text)
+#define EXPORT_CHUNK_ROWS 16384
+// Below this many rows the thread start-up costs more than it saves
+#define EXPORT_PARALLEL_MIN 50000
+#define EXPORT_MAX_THREADS 8
+
+// A range of sorted rows, formatted into its own buffer by one thread
+typedef struct {
+    const exportentry* items;
+    int count;
+    int first_number;
+    const char* status;   // padded status column, NULL for completed table
+    const outbuf* prefix; // text written before the rows (section header)
+    outbuf out;
+    int done;
+} exportchunk;
+
+typedef struct {
+    exportchunk* chunks;
+    int chunk_count;
+    int next_chunk;       // next chunk to claim, taken with an atomic add
+    pthread_mutex_t lock;
+    pthread_cond_t chunk_done;
+} exportjob;
+
+// Splits one sorted section into chunks; returns the next row number
+static int exportAddChunks(exportjob* job, const exportlist* rows, int first_number,
+                           const char* status, const outbuf* prefix) {
+    int i = 0;
+    do {
+        exportchunk* c = &job->chunks[job->chunk_count++];
+        int n = rows->count - i < EXPORT_CHUNK_ROWS ? rows->count - i : EXPORT_CHUNK_ROWS;
+        c->items = rows->items + i;
+        c->count = n;
+        c->first_number = first_number + i;
+        c->status = status;
+        c->prefix = i == 0 ? prefix : NULL;
+        c->done = 0;
+        c->out.data = NULL;
+        i += n;
+    } while (i < rows->count);
+    return first_number + rows->count;
+}
+
+static int exportChunksNeeded(const exportlist* rows) {
+    return rows->count == 0 ? 1 : (rows->count + EXPORT_CHUNK_ROWS - 1) / EXPORT_CHUNK_ROWS;
+}
+
+// Formats a chunk's rows (after its prefix) into out
+static void exportChunkRows(outbuf* out, const exportchunk* c) {
+    if (c->prefix) outbufPut(out, c->prefix->data, c->prefix->len);
+    for (int i = 0; i < c->count; i++) {
+        if (i + EXPORT_PREFETCH < c->count) prefetchTask(c->items[i + EXPORT_PREFETCH].t);
+        exportRow(out, c->first_number + i, c->items[i].t, c->status);
+    }
+}
+
+/*
+exportWorker() - Formats chunks until none are left
+ - Time: O(rows claimed), Space: O(bytes formatted)
+ - Each chunk goes into its own memory buffer, so threads never share output;
+   the writer picks the buffers up in chunk order
+ */
+static void* exportWorker(void* arg) {
+    exportjob* job = (exportjob*)arg;
+
+    while (1) {
+        int index = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (index >= job->chunk_count) break;
+        exportchunk* c = &job->chunks[index];
+
+        if (outbufInit(&c->out, -1, (size_t)c->count * 96 + 1024) == 0) exportChunkRows(&c->out, c);
+
+        pthread_mutex_lock(&job->lock);
+        c->done = 1;
+        pthread_cond_broadcast(&job->chunk_done);
+        pthread_mutex_unlock(&job->lock);
+    }
+    return NULL;
+}
+
+// Sorts one section on its own thread
+static void* exportSortWorker(void* arg) {
+    exportlist* rows = (exportlist*)arg;
+    sortExportEntries(rows->items, rows->count);
+    return NULL;
+}
+
+static int exportThreadCount(int rows) {
+    if (rows < EXPORT_PARALLEL_MIN) return 0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 2) return 0;
+    return cpus > EXPORT_MAX_THREADS ? EXPORT_MAX_THREADS : (int)cpus;
+}
+
+/*
+exportWriteChunks() - Writes chunk buffers to fd in chunk order as they finish
+ - Time: O(total bytes), Space: O(1)
+ - Consecutive finished chunks go out in one writev(); each buffer is freed
+   right after it is written
+ - Returns 0 on success, -1 on a write or allocation failure
+ */
+static int exportWriteChunks(exportjob* job, int fd) {
+    outbuf* ready[64];
+    int next = 0, failed = 0;
+
+    while (next < job->chunk_count) {
+        int end = next;
+        pthread_mutex_lock(&job->lock);
+        while (!job->chunks[next].done) {
+            pthread_cond_wait(&job->chunk_done, &job->lock);
+        }
+        while (end < job->chunk_count && job->chunks[end].done && end - next < 64) end++;
+        pthread_mutex_unlock(&job->lock);
+
+        int n = 0;
+        for (int i = next; i < end; i++) {
+            if (!job->chunks[i].out.data || job->chunks[i].out.error) failed = 1;
+            else ready[n++] = &job->chunks[i].out;
+        }
+        if (!failed && writeBlocks(fd, ready, n) != 0) failed = 1;
+        for (int i = next; i < end; i++) outbufFree(&job->chunks[i].out);
+        next = end;
+    }
+    return failed ? -1 : 0;
+}
+
+// Writes "label: value\n"
+static void exportCountLine(outbuf* out, const char* label, int value) {
+    outbufPuts(out, label);
+    outbufPutInt(out, value, 0);
+    outbufPut(out, "\n", 1);
+}
+
+// ===== Crash-safe export files =====
 
+#define EXPORT_MAX_BACKUPS 99
+
+// Previous exports kept as file.1 (newest) .. file.N; 0 keeps none
+static int export_backups = 0;
+static int export_temp_counter = 0;
+
+// Export being written to a temporary file next to its target
+typedef struct {
+    int fd;
+    int backups;
+    char target[512];
+    char temp[560];
+} exportfile;
+
+/*
+setExportBackups() - Sets how many previous exports are kept
+ - Time: O(1), Space: O(1)
+ - Example: setExportBackups(2) -> tasks.txt, tasks.txt.1 (previous), tasks.txt.2
+ */
+void setExportBackups(int count) {
+    if (count < 0) count = 0;
+    if (count > EXPORT_MAX_BACKUPS) count = EXPORT_MAX_BACKUPS;
+    __atomic_store_n(&export_backups, count, __ATOMIC_RELAXED);
+}
+
+/*
+openExportFile() - Creates the temporary file an export is written to
+ - Time: O(1), Space: O(1)
+ - The file is next to the target, so commitExportFile() can rename it
+   over the target; the target itself is not touched until then
+ - Returns the fd, or -1 on failure
+ */
+static int openExportFile(exportfile* f, const char* target) {
+    int n = __atomic_fetch_add(&export_temp_counter, 1, __ATOMIC_RELAXED);
+    snprintf(f->target, sizeof(f->target), "%s", target);
+    snprintf(f->temp, sizeof(f->temp), "%s.tmp%ld-%d", target, (long)getpid(), n);
+    f->backups = __atomic_load_n(&export_backups, __ATOMIC_RELAXED);
+#ifdef _WIN32
+    f->fd = open(f->temp, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_TEXT, _S_IREAD | _S_IWRITE);
+#else
+    f->fd = open(f->temp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+#endif
+    return f->fd;
+}
+
+#ifndef _WIN32
+// Flushes the directory entry of path, so a rename inside it survives a crash
+static int fsyncDirectory(const char* path) {
+    char dir[512];
+    const char* slash = strrchr(path, '/');
+    if (slash == path) {
+        strcpy(dir, "/");
+    } else if (slash) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    } else {
+        strcpy(dir, ".");
+    }
+
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return -1;
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+#endif
+
+// Shifts target.1..target.(keep-1) up by one (dropping the oldest) and
+// links the current target as target.1
+static void rotateExports(const char* target, int keep) {
+    char from[600], to[600];
+
+    for (int i = keep - 1; i >= 1; i--) {
+        snprintf(from, sizeof(from), "%s.%d", target, i);
+        snprintf(to, sizeof(to), "%s.%d", target, i + 1);
+        rename(from, to);
+    }
+
+    snprintf(to, sizeof(to), "%s.1", target);
+    remove(to);
+#ifdef _WIN32
+    rename(target, to);
+#else
+    // A hard link keeps the target in place until the new export replaces
+    // it; filesystems without links fall back to moving it
+    if (link(target, to) != 0 && errno != ENOENT) rename(target, to);
+#endif
+}
+
+/*
+commitExportFile() - Makes a finished export durable and moves it into place
+ - Time: O(1) plus the fsync, Space: O(1)
+ - fsync() the data, rename() it over the target, then fsync() the
+   directory so the rename itself survives a crash. A reader sees either
+   the old file or the complete new one, never a partial export.
+ - If failed is set, or any step fails, the temporary file is removed and
+   the target is left as it was
+ - Returns 0 on success, -1 on failure
+ */
+static int commitExportFile(exportfile* f, int failed) {
+#ifdef _WIN32
+    if (!failed && _commit(f->fd) != 0) failed = 1;
+#else
+    if (!failed && fsync(f->fd) != 0) failed = 1;
+#endif
+    if (close(f->fd) != 0) failed = 1;
+    f->fd = -1;
+    if (failed) {
+        remove(f->temp);
+        return -1;
+    }
+
+    if (f->backups > 0) rotateExports(f->target, f->backups);
+#ifdef _WIN32
+    // rename() does not replace an existing file on Windows
+    remove(f->target);
+#endif
+    if (rename(f->temp, f->target) != 0) {
+        remove(f->temp);
+        return -1;
+    }
+#ifndef _WIN32
+    if (fsyncDirectory(f->target) != 0) return -1;
+#endif
+    return 0;
+}
+
+/*
+exportPath() - Resolves the export file path
+ - Time: O(1), Space: O(1)
+ - NULL means exported_tasks.txt on the Desktop
+ - Example: exportPath(NULL, path, size) -> "/Users/me/Desktop/exported_tasks.txt"
+ */
+static int exportPath(const char* filename, char* filepath, size_t size) {
     if (filename == NULL) {
         // ใช้ Desktop เป็นค่าเริ่มต้น
     #ifdef _WIN32
         const char* userProfile = getenv("USERPROFILE");
         if (userProfile) {
-            snprintf(filepath, sizeof(filepath), "%s\\Desktop\\exported_tasks.txt", userProfile);
+            snprintf(filepath, size, "%s\\Desktop\\exported_tasks.txt", userProfile);
         } else {
             fprintf(stderr, "Could not determine Desktop path on Windows.\n");
-            return;
+            return -1;
         }
     #else
         const char* home = getenv("HOME");
         if (home) {
-            snprintf(filepath, sizeof(filepath), "%s/Desktop/exported_tasks.txt", home);
+            snprintf(filepath, size, "%s/Desktop/exported_tasks.txt", home);
         } else {
             fprintf(stderr, "Could not determine Desktop path on macOS/Linux.\n");
-            return;
+            return -1;
         }
     #endif
     } else {
-        strncpy(filepath, filename, sizeof(filepath));
-        filepath[sizeof(filepath) - 1] = '\0';
+        strncpy(filepath, filename, size);
+        filepath[size - 1] = '\0';
     }
+    return 0;
+}
+
+/*
+exportTasksTxt() - Exports all tasks to formatted text file
+ - Time: O(n log n), Space: O(n)
+ - Rows are formatted by hand into large buffers and written with writev()
+   in big blocks instead of several fprintf() calls per task
+ - Large lists are sorted and formatted on several threads; the sorted rows
+   are cut into chunks and written in order, so the file is the same as
+   with one thread
+ - Written to a temporary file that replaces the target only once complete
+   (see commitExportFile()), so a crash never leaves a truncated export
+ - Returns 0 on success, -1 on failure (the reason goes to stderr and the
+   target is left as it was)
+ - Sample Case:
+    Input: Filename: "tasks_backup.txt"
+    Output file content:
+      ===== TO-DO LIST EXPORT =====
+      Date Exported: 02/05/2025
+      
+      #   Name             Priority   Due Date    Status
+      1   Urgent Task      High       03/05/2025  Pending
+      2   Regular Task     Medium     10/05/2025  Pending
+      
+      Summary: 0 overdue, 2 pending, 0 completed
+ */
+int exportTasksTxt(task* head, completedstack* stack, const char* filename) {
+    char filepath[512];
+    exportfile file;
+    int fd;
+
+    if (exportPath(filename, filepath, sizeof(filepath)) != 0) return -1;
 
-    file = fopen(filepath, "w");
-    if (!file) {
+    fd = openExportFile(&file, filepath);
+    if (fd < 0) {
         perror("Failed to open file for export");
-        return;
+        return -1;
+    }
+
+    outbuf out;
+    if (outbufInit(&out, fd, OUTBUF_DEFAULT_SIZE) != 0) {
+        fprintf(stderr, "Memory allocation failed for export buffer.\n");
+        commitExportFile(&file, 1);
+        return -1;
     }
 
     // ========== ดำเนินการเขียนข้อมูล ==========
@@ -61,14 +599,30 @@ void exportTasksTxt(task* head, completedstack* stack, const char* filename) {
     int high_count = 0, medium_count = 0, low_count = 0;
     int total_exported = 0;
 
-    fprintf(file, "===== TO-DO LIST EXPORT =====\n");
-    fprintf(file, "Date Exported: %02d/%02d/%04d\n\n", today.day, today.month, today.year);
+    outbufPuts(&out, "===== TO-DO LIST EXPORT =====\n");
+    outbufPuts(&out, "Date Exported: ");
+    outbufPutDate(&out, today);
+    outbufPuts(&out, "\n\n");
+
+    // One pass over the list: count and collect rows for sorting
+    exportlist overdue_tasks = {NULL, 0, 0};
+    exportlist priority_tasks[3] = {{NULL, 0, 0}, {NULL, 0, 0}, {NULL, 0, 0}};
+    int out_of_memory = 0;
 
     task* current = head;
     while (current) {
         if (!current->completed) {
-            if (current->status == OVERDUE) overdue_count++;
-            else pending_count++;
+            if (current->status == OVERDUE) {
+                overdue_count++;
+                out_of_memory |= exportListPush(&overdue_tasks, current, exportSortKey(current, 0));
+            } else {
+                pending_count++;
+                int priority_idx = current->priority - 1;
+                if (priority_idx >= 0 && priority_idx < 3) {
+                    out_of_memory |= exportListPush(&priority_tasks[priority_idx], current,
+                                                    exportSortKey(current, 1));
+                }
+            }
 
             switch(current->priority) {
                 case 1: high_count++; break;
@@ -79,285 +633,882 @@ void exportTasksTxt(task* head, completedstack* stack, const char* filename) {
         current = current->next;
     }
 
+    // Completed rows keep stack order (most recent first)
+    exportlist completed_tasks = {NULL, 0, 0};
     stacknode* node = stack->top;
     while (node) {
         completed_count++;
+        if (node->task_data) out_of_memory |= exportListPush(&completed_tasks, node->task_data, 0);
         node = node->next;
     }
 
-    fprintf(file, "SUMMARY: Overdue: %d | Pending: %d | Completed: %d\n", overdue_count, pending_count, completed_count);
-    fprintf(file, "PRIORITIES: High: %d | Medium: %d | Low: %d\n\n", high_count, medium_count, low_count);
+    if (out_of_memory) {
+        fprintf(stderr, "Memory allocation failed during export.\n");
+        free(overdue_tasks.items);
+        for (int p = 0; p < 3; p++) free(priority_tasks[p].items);
+        free(completed_tasks.items);
+        outbufFree(&out);
+        commitExportFile(&file, 1);
+        return -1;
+    }
 
-    // เตรียมเรียง task
-    task* overdue_tasks[200];
-    task* priority_tasks[3][200];
-    int overdue_tasks_count = 0;
-    int priority_tasks_count[3] = {0};
+    outbufPuts(&out, "SUMMARY: Overdue: ");
+    outbufPutInt(&out, overdue_count, 0);
+    outbufPuts(&out, " | Pending: ");
+    outbufPutInt(&out, pending_count, 0);
+    outbufPuts(&out, " | Completed: ");
+    outbufPutInt(&out, completed_count, 0);
+    outbufPuts(&out, "\nPRIORITIES: High: ");
+    outbufPutInt(&out, high_count, 0);
+    outbufPuts(&out, " | Medium: ");
+    outbufPutInt(&out, medium_count, 0);
+    outbufPuts(&out, " | Low: ");
+    outbufPutInt(&out, low_count, 0);
+    outbufPuts(&out, "\n\n");
 
-    current = head;
-    while (current) {
-        if (!current->completed) {
-            if (current->status == OVERDUE) {
-                overdue_tasks[overdue_tasks_count++] = current;
-            } else {
-                int priority_idx = current->priority - 1;
-                if (priority_idx >= 0 && priority_idx < 3) {
-                    priority_tasks[priority_idx][priority_tasks_count[priority_idx]++] = current;
-                }
-            }
+    // Sort the four sections; with large lists each gets its own thread
+    int active_rows = overdue_tasks.count + priority_tasks[0].count +
+                      priority_tasks[1].count + priority_tasks[2].count;
+    int threads = exportThreadCount(active_rows + completed_tasks.count);
+    if (threads > 0) {
+        pthread_t sorters[3];
+        int started[3] = {0};
+        for (int p = 0; p < 3; p++) {
+            started[p] = pthread_create(&sorters[p], NULL, exportSortWorker, &priority_tasks[p]) == 0;
+            if (!started[p]) exportSortWorker(&priority_tasks[p]);
         }
-        current = current->next;
+        exportSortWorker(&overdue_tasks);
+        for (int p = 0; p < 3; p++) {
+            if (started[p]) pthread_join(sorters[p], NULL);
+        }
+    } else {
+        exportSortWorker(&overdue_tasks);
+        for (int p = 0; p < 3; p++) exportSortWorker(&priority_tasks[p]);
     }
 
-    // Sort overdue tasks
-    for (int i = 0; i < overdue_tasks_count - 1; i++) {
-        for (int j = 0; j < overdue_tasks_count - i - 1; j++) {
-            if (compareDates(overdue_tasks[j]->duedate, overdue_tasks[j+1]->duedate) > 0) {
-                task* temp = overdue_tasks[j];
-                overdue_tasks[j] = overdue_tasks[j+1];
-                overdue_tasks[j+1] = temp;
-            }
-        }
+    exportHeaderLine(&out, 1);
+
+    // Completed table header goes in front of the first completed chunk
+    outbuf completed_header;
+    exportjob job;
+    job.chunk_count = 0;
+    job.next_chunk = 0;
+    job.chunks = (exportchunk*)malloc(sizeof(exportchunk) *
+        (exportChunksNeeded(&overdue_tasks) + exportChunksNeeded(&priority_tasks[0]) +
+         exportChunksNeeded(&priority_tasks[1]) + exportChunksNeeded(&priority_tasks[2]) +
+         exportChunksNeeded(&completed_tasks)));
+    if (!job.chunks || outbufInit(&completed_header, -1, 1024) != 0) {
+        fprintf(stderr, "Memory allocation failed during export.\n");
+        free(job.chunks);
+        free(overdue_tasks.items);
+        for (int p = 0; p < 3; p++) free(priority_tasks[p].items);
+        free(completed_tasks.items);
+        outbufFree(&out);
+        commitExportFile(&file, 1);
+        return -1;
     }
+    outbufPuts(&completed_header, "\n===== COMPLETED TASKS =====\n");
+    exportHeaderLine(&completed_header, 0);
 
-    // Sort pending tasks
+    // Overdue and pending rows are numbered straight through, completed from 1
+    int count = exportAddChunks(&job, &overdue_tasks, 1, status_overdue, NULL);
     for (int p = 0; p < 3; p++) {
-        for (int i = 0; i < priority_tasks_count[p] - 1; i++) {
-            for (int j = 0; j < priority_tasks_count[p] - i - 1; j++) {
-                task *a = priority_tasks[p][j], *b = priority_tasks[p][j+1];
-                if (!a->due_date_set && b->due_date_set) {
-                    task* temp = a; priority_tasks[p][j] = b; priority_tasks[p][j+1] = temp;
-                } else if (a->due_date_set && b->due_date_set &&
-                           compareDates(a->duedate, b->duedate) > 0) {
-                    task* temp = a; priority_tasks[p][j] = b; priority_tasks[p][j+1] = temp;
-                }
+        count = exportAddChunks(&job, &priority_tasks[p], count, status_pending, NULL);
+    }
+    exportAddChunks(&job, &completed_tasks, 1, NULL, &completed_header);
+    total_exported = active_rows + completed_tasks.count;
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.chunk_done, NULL);
+
+    // Format on worker threads while this thread writes finished chunks in
+    // order. Without threads, format straight into the file buffer: it stays
+    // in cache, where a buffer per chunk would be fresh memory to fault in
+    // and copy once more.
+    pthread_t workers[EXPORT_MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, exportWorker, &job) == 0) started++;
+    }
+    int failed = 0;
+    if (started == 0) {
+        for (int i = 0; i < job.chunk_count; i++) exportChunkRows(&out, &job.chunks[i]);
+    } else {
+        failed = outbufFlush(&out) != 0;
+        if (exportWriteChunks(&job, fd) != 0) failed = 1;
+        for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.chunk_done);
+    free(job.chunks);
+    outbufFree(&completed_header);
+
+    // Summary
+    outbufPuts(&out, "\n===== EXPORT SUMMARY =====\n");
+    exportCountLine(&out, "Total Tasks Exported: ", total_exported);
+    exportCountLine(&out, "Pending Tasks: ", pending_count);
+    exportCountLine(&out, "Overdue Tasks: ", overdue_count);
+    exportCountLine(&out, "Completed Tasks: ", completed_count);
+    exportCountLine(&out, "High Priority: ", high_count);
+    exportCountLine(&out, "Medium Priority: ", medium_count);
+    exportCountLine(&out, "Low Priority: ", low_count);
+
+    free(overdue_tasks.items);
+    for (int p = 0; p < 3; p++) free(priority_tasks[p].items);
+    free(completed_tasks.items);
+
+    if (outbufFlush(&out) != 0) failed = 1;
+    outbufFree(&out);
+    if (commitExportFile(&file, failed) != 0) {
+        perror("Error writing export file");
+        return -1;
+    }
+
+    printf("Tasks exported to: %s\n", filepath);
+    printf("Total %d tasks exported (%d pending, %d overdue, %d completed)\n",
+           total_exported, pending_count, overdue_count, completed_count);
+    return 0;
+}
+
+// ===== External-memory export for archives larger than RAM =====
+
+// Memory below this is not enough to sort runs of useful size
+#define ARCHIVE_MIN_MEMORY (8 * 1024 * 1024)
+// Most runs merged in one pass; more runs are merged in several passes
+#define ARCHIVE_MAX_FANIN 128
+// Rows between progress updates (power of two)
+#define ARCHIVE_PROGRESS_STEP 4096
+
+// Sections in export order; completed tasks keep their input order
+enum { SECTION_OVERDUE, SECTION_HIGH, SECTION_MEDIUM, SECTION_LOW, SECTION_COMPLETED };
+
+// Fixed-size record written to the sorted run files
+typedef struct {
+    long long key;   // section, then due date (see archiveSortKey)
+    long long seq;   // line number, keeps equal keys in input order
+    char name[100];
+    char tags[MAX_TAGS][MAX_TAG_LENGTH];
+    date duedate;
+    int priority;
+    int due_date_set;
+    int tag_count;
+} archiverecord;
+
+typedef struct {
+    long long key;
+    long long seq;
+    int index;
+} archivekey;
+
+// One sorted run being merged
+typedef struct {
+    FILE* file;
+    char* buffer;
+    archiverecord current;
+} archiverun;
+
+// Where merged records go: another run file, or the final report
+typedef struct {
+    FILE* run;
+    outbuf* out;
+    int number;
+    int in_completed;
+    const outbuf* completed_header;
+    long long rows;
+    long long* progress;  // rows written so far, for another thread to read
+} archivesink;
+
+static int archiveSection(long long key) {
+    return (int)(key >> 40);
+}
+
+// Same order as exportSortKey(): by section, then by due date; a pending
+// task without a due date goes last in its section
+static long long archiveSortKey(int section, const archiverecord* r) {
+    long long day_key;
+    if (section == SECTION_COMPLETED) {
+        day_key = 0;
+    } else if (r->due_date_set) {
+        day_key = ((long long)r->duedate.year << 9) | (r->duedate.month << 5) | r->duedate.day;
+    } else {
+        day_key = section == SECTION_OVERDUE ? 0 : (1LL << 40) - 1;
+    }
+    return ((long long)section << 40) | day_key;
+}
+
+static int compareArchiveKeys(const void* a, const void* b) {
+    const archivekey* x = (const archivekey*)a;
+    const archivekey* y = (const archivekey*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+// Removes leading and trailing whitespace in place
+static void trimWhitespace(char* s) {
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+
+    char* start = s;
+    while (*start && isspace((unsigned char)*start)) start++;
+    if (start != s) memmove(s, start, strlen(start) + 1);
+}
+
+/*
+parseArchiveLine() - Parses one archive line into a record
+ - Time: O(m), Space: O(1)
+ - Format is the import format with two optional fields:
+     name,description,priority,DD/MM/YYYY[,pending|overdue|completed[,tag1;tag2]]
+ - A task without a status is overdue when its due date is before today
+ - Returns the section, or -1 if the line cannot be parsed
+ */
+static int parseArchiveLine(const char* line, date today, archiverecord* r) {
+    char desc[300];
+    int day, month, year, used = 0;
+
+    if (sscanf(line, " %99[^,],%299[^,],%d,%d/%d/%d%n",
+               r->name, desc, &r->priority, &day, &month, &year, &used) != 6) {
+        return -1;
+    }
+    trimWhitespace(r->name);
+
+    if (r->priority < 1 || r->priority > 3) r->priority = 2;
+    r->due_date_set = isValidDate(day, month, year);
+    r->duedate.day = r->due_date_set ? day : 0;
+    r->duedate.month = r->due_date_set ? month : 0;
+    r->duedate.year = r->due_date_set ? year : 0;
+    r->tag_count = 0;
+
+    char status[16] = "";
+    const char* rest = line + used;
+    if (*rest == ',') {
+        rest++;
+        int n = 0;
+        while (*rest && *rest != ',' && *rest != '\n' && *rest != '\r') {
+            if (n < (int)sizeof(status) - 1) status[n++] = (char)tolower((unsigned char)*rest);
+            rest++;
+        }
+        status[n] = '\0';
+        trimWhitespace(status);
+    }
+    if (*rest == ',') {
+        rest++;
+        while (*rest && *rest != '\n' && *rest != '\r' && r->tag_count < MAX_TAGS) {
+            int n = 0;
+            char* tag = r->tags[r->tag_count];
+            while (*rest && *rest != ';' && *rest != '\n' && *rest != '\r') {
+                if (n < MAX_TAG_LENGTH - 1) tag[n++] = *rest;
+                rest++;
             }
+            tag[n] = '\0';
+            trimWhitespace(tag);
+            if (tag[0]) r->tag_count++;
+            if (*rest == ';') rest++;
         }
     }
 
-    // Header
-    fprintf(file, "%-3s %-25s %-10s %-15s %-10s %-20s\n", "#", "Name", "Priority", "Due Date", "Status", "Tags");
-    fprintf(file, "--------------------------------------------------------------------------------\n");
+    if (strcmp(status, "completed") == 0) return SECTION_COMPLETED;
+    if (strcmp(status, "overdue") == 0 ||
+        (status[0] == '\0' && r->due_date_set && compareDates(today, r->duedate) > 0)) {
+        return SECTION_OVERDUE;
+    }
+    return r->priority;  // SECTION_HIGH..SECTION_LOW match priorities 1..3
+}
 
-    int count = 1;
-    for (int i = 0; i < overdue_tasks_count; i++) {
-        task* t = overdue_tasks[i];
-        char date_str[15] = "Not Set";
-        if (t->due_date_set)
-            sprintf(date_str, "%02d/%02d/%04d", t->duedate.day, t->duedate.month, t->duedate.year);
+/*
+archiveTempFile() - Opens an anonymous temporary file next to the output
+ - Time: O(1), Space: O(1)
+ - Run files can be as large as the archive, so they go on the output's
+   disk instead of /tmp; the name is unlinked at once and the space is
+   freed when the file is closed
+ */
+static FILE* archiveTempFile(const char* near_path) {
+#ifdef _WIN32
+    (void)near_path;
+    return tmpfile();
+#else
+    char path[600];
+    const char* slash = strrchr(near_path, '/');
+    if (slash) {
+        snprintf(path, sizeof(path), "%.*s/.todo_runXXXXXX", (int)(slash - near_path), near_path);
+    } else {
+        snprintf(path, sizeof(path), ".todo_runXXXXXX");
+    }
 
-        char* priority_str = (t->priority == 1 ? "High" :
-                              t->priority == 2 ? "Medium" :
-                              t->priority == 3 ? "Low" : "Unknown");
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    unlink(path);
+    FILE* file = fdopen(fd, "w+b");
+    if (!file) close(fd);
+    return file;
+#endif
+}
 
-        char tags_str[100] = "";
-        for (int j = 0; j < t->tag_count; j++) {
-            if (j > 0) strcat(tags_str, ", ");
-            strcat(tags_str, t->tags[j]);
-        }
+// Sends one merged record to its sink: a run file or the report
+static int archiveEmit(archivesink* sink, const archiverecord* r) {
+    if (sink->run) {
+        return fwrite(r, sizeof(*r), 1, sink->run) == 1 ? 0 : -1;
+    }
 
-        fprintf(file, "%-3d %-25s %-10s %-15s %-10s %-20s\n",
-                count++, t->name, priority_str, date_str, "OVERDUE", tags_str);
-        total_exported++;
+    if (archiveSection(r->key) == SECTION_COMPLETED && !sink->in_completed) {
+        outbufPut(sink->out, sink->completed_header->data, sink->completed_header->len);
+        sink->in_completed = 1;
+        sink->number = 1;
     }
 
-    for (int p = 0; p < 3; p++) {
-        for (int i = 0; i < priority_tasks_count[p]; i++) {
-            task* t = priority_tasks[p][i];
-            char date_str[15] = "Not Set";
-            if (t->due_date_set)
-                sprintf(date_str, "%02d/%02d/%04d", t->duedate.day, t->duedate.month, t->duedate.year);
-
-            char* priority_str = (t->priority == 1 ? "High" :
-                                  t->priority == 2 ? "Medium" :
-                                  t->priority == 3 ? "Low" : "Unknown");
-
-            char tags_str[100] = "";
-            for (int j = 0; j < t->tag_count; j++) {
-                if (j > 0) strcat(tags_str, ", ");
-                strcat(tags_str, t->tags[j]);
-            }
+    // exportRow() formats tasks, so copy the fields it reads
+    task t;
+    memcpy(t.name, r->name, sizeof(t.name));
+    memcpy(t.tags, r->tags, sizeof(t.tags));
+    t.tag_count = r->tag_count;
+    t.priority = r->priority;
+    t.duedate = r->duedate;
+    t.due_date_set = r->due_date_set;
 
-            fprintf(file, "%-3d %-25s %-10s %-15s %-10s %-20s\n",
-                    count++, t->name, priority_str, date_str, "Pending", tags_str);
-            total_exported++;
+    const char* status = archiveSection(r->key) == SECTION_COMPLETED ? NULL :
+                         archiveSection(r->key) == SECTION_OVERDUE ? status_overdue : status_pending;
+    exportRow(sink->out, sink->number++, &t, status);
+    sink->rows++;
+    if (sink->progress && (sink->rows & (ARCHIVE_PROGRESS_STEP - 1)) == 0) {
+        __atomic_store_n(sink->progress, sink->rows, __ATOMIC_RELAXED);
+    }
+    return sink->out->error ? -1 : 0;
+}
+
+/*
+writeSortedRun() - Sorts the records in memory and writes them as one run
+ - Time: O(n log n), Space: O(1) extra
+ - Only the small keys are sorted; records are written in key order
+ */
+static FILE* writeSortedRun(archiverecord* records, archivekey* keys, int count, const char* near_path) {
+    qsort(keys, count, sizeof(archivekey), compareArchiveKeys);
+
+    FILE* run = archiveTempFile(near_path);
+    if (!run) return NULL;
+    for (int i = 0; i < count; i++) {
+        if (fwrite(&records[keys[i].index], sizeof(archiverecord), 1, run) != 1) {
+            fclose(run);
+            return NULL;
         }
     }
+    if (fflush(run) != 0) {
+        fclose(run);
+        return NULL;
+    }
+    rewind(run);
+    return run;
+}
 
-    // Completed
-    fprintf(file, "\n===== COMPLETED TASKS =====\n");
-    fprintf(file, "%-3s %-25s %-10s %-15s %-20s\n", "#", "Name", "Priority", "Due Date", "Tags");
-    fprintf(file, "--------------------------------------------------------------------------------\n");
+// Heap order for the k-way merge: smallest (key, seq) on top
+static int archiveRunLess(const archiverun* a, const archiverun* b) {
+    if (a->current.key != b->current.key) return a->current.key < b->current.key;
+    return a->current.seq < b->current.seq;
+}
 
-    task* completed_tasks[200];
-    int completed_tasks_count = 0;
-    node = stack->top;
-    while (node) {
-        if (node->task_data) completed_tasks[completed_tasks_count++] = node->task_data;
-        node = node->next;
+static void archiveSiftDown(archiverun** heap, int size, int i) {
+    while (1) {
+        int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < size && archiveRunLess(heap[left], heap[smallest])) smallest = left;
+        if (right < size && archiveRunLess(heap[right], heap[smallest])) smallest = right;
+        if (smallest == i) return;
+        archiverun* swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
     }
+}
 
-    count = 1;
-    for (int i = 0; i < completed_tasks_count; i++) {
-        task* t = completed_tasks[i];
-        char date_str[15] = "Not Set";
-        if (t->due_date_set)
-            sprintf(date_str, "%02d/%02d/%04d", t->duedate.day, t->duedate.month, t->duedate.year);
+/*
+mergeRuns() - K-way merge of sorted runs with a min-heap
+ - Time: O(n log k), Space: O(k * buffer_size)
+ - Each run is read through its own buffer of buffer_size bytes; the runs
+   are closed when done
+ - Returns 0 on success, -1 on a read, write or allocation failure
+ */
+static int mergeRuns(FILE** files, int count, size_t buffer_size, archivesink* sink) {
+    archiverun* runs = (archiverun*)calloc(count, sizeof(archiverun));
+    archiverun** heap = (archiverun**)malloc(sizeof(archiverun*) * count);
+    int size = 0, failed = 0;
 
-        char* priority_str = (t->priority == 1 ? "High" :
-                              t->priority == 2 ? "Medium" :
-                              t->priority == 3 ? "Low" : "Unknown");
+    if (!runs || !heap) failed = 1;
 
-        char tags_str[100] = "";
-        for (int j = 0; j < t->tag_count; j++) {
-            if (j > 0) strcat(tags_str, ", ");
-            strcat(tags_str, t->tags[j]);
+    for (int i = 0; i < count && !failed; i++) {
+        runs[i].file = files[i];
+        runs[i].buffer = (char*)malloc(buffer_size);
+        if (runs[i].buffer) setvbuf(files[i], runs[i].buffer, _IOFBF, buffer_size);
+        if (fread(&runs[i].current, sizeof(archiverecord), 1, files[i]) == 1) {
+            heap[size++] = &runs[i];
         }
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) archiveSiftDown(heap, size, i);
+
+    while (size > 0 && !failed) {
+        archiverun* top = heap[0];
+        if (archiveEmit(sink, &top->current) != 0) failed = 1;
 
-        fprintf(file, "%-3d %-25s %-10s %-15s %-20s\n",
-                count++, t->name, priority_str, date_str, tags_str);
-        total_exported++;
+        if (fread(&top->current, sizeof(archiverecord), 1, top->file) != 1) {
+            if (ferror(top->file)) failed = 1;
+            heap[0] = heap[--size];
+        }
+        archiveSiftDown(heap, size, 0);
     }
 
-    // Summary
-    fprintf(file, "\n===== EXPORT SUMMARY =====\n");
-    fprintf(file, "Total Tasks Exported: %d\n", total_exported);
-    fprintf(file, "Pending Tasks: %d\n", pending_count);
-    fprintf(file, "Overdue Tasks: %d\n", overdue_count);
-    fprintf(file, "Completed Tasks: %d\n", completed_count);
-    fprintf(file, "High Priority: %d\n", high_count);
-    fprintf(file, "Medium Priority: %d\n", medium_count);
-    fprintf(file, "Low Priority: %d\n", low_count);
-
-    fclose(file);
-    printf("Tasks exported to: %s\n", filepath);
-    printf("Total %d tasks exported (%d pending, %d overdue, %d completed)\n",
-           total_exported, pending_count, overdue_count, completed_count);
+    for (int i = 0; i < count; i++) {
+        fclose(files[i]);
+        if (runs) free(runs[i].buffer);
+    }
+    free(runs);
+    free(heap);
+    return failed ? -1 : 0;
 }
 
 /*
-importTasks() - Imports tasks from CSV file
- - Time: O(n*m), Space: O(1)
+writeArchiveReport() - Writes the export report from sorted archive records
+ - Time: O(n log k), Space: O(merge buffers)
+ - Rows come from the sorted runs when run_count > 0 (the runs are closed),
+   otherwise from the in-memory records, which are sorted here by their keys
+ - progress, if not NULL, is updated as rows are written
+ - Returns the number of rows written, or -1 on failure
+ */
+static long long writeArchiveReport(const char* filename, date today,
+                                    const long long counts[5], const long long priority_counts[4],
+                                    FILE** runs, int run_count, size_t memory_limit,
+                                    const archiverecord* records, archivekey* keys, int record_count,
+                                    long long* progress) {
+    exportfile file;
+    int fd = openExportFile(&file, filename);
+    if (fd < 0) {
+        for (int i = 0; i < run_count; i++) fclose(runs[i]);
+        return -1;
+    }
+
+    outbuf out, completed_header;
+    out.data = completed_header.data = NULL;
+    if (outbufInit(&out, fd, OUTBUF_DEFAULT_SIZE) != 0 ||
+        outbufInit(&completed_header, -1, 1024) != 0) {
+        for (int i = 0; i < run_count; i++) fclose(runs[i]);
+        outbufFree(&out);
+        commitExportFile(&file, 1);
+        return -1;
+    }
+
+    long long pending = counts[SECTION_HIGH] + counts[SECTION_MEDIUM] + counts[SECTION_LOW];
+    int failed = 0;
+
+    outbufPuts(&out, "===== TO-DO LIST EXPORT =====\nDate Exported: ");
+    outbufPutDate(&out, today);
+    outbufPuts(&out, "\n\nSUMMARY: Overdue: ");
+    outbufPutInt(&out, (long)counts[SECTION_OVERDUE], 0);
+    outbufPuts(&out, " | Pending: ");
+    outbufPutInt(&out, (long)pending, 0);
+    outbufPuts(&out, " | Completed: ");
+    outbufPutInt(&out, (long)counts[SECTION_COMPLETED], 0);
+    outbufPuts(&out, "\nPRIORITIES: High: ");
+    outbufPutInt(&out, (long)priority_counts[1], 0);
+    outbufPuts(&out, " | Medium: ");
+    outbufPutInt(&out, (long)priority_counts[2], 0);
+    outbufPuts(&out, " | Low: ");
+    outbufPutInt(&out, (long)priority_counts[3], 0);
+    outbufPuts(&out, "\n\n");
+    exportHeaderLine(&out, 1);
+
+    outbufPuts(&completed_header, "\n===== COMPLETED TASKS =====\n");
+    exportHeaderLine(&completed_header, 0);
+
+    archivesink sink = {NULL, &out, 1, 0, &completed_header, 0, progress};
+    if (run_count > 0) {
+        failed = mergeRuns(runs, run_count, memory_limit / (2 * (size_t)run_count), &sink) != 0;
+    } else {
+        qsort(keys, record_count, sizeof(archivekey), compareArchiveKeys);
+        for (int i = 0; i < record_count && !failed; i++) {
+            failed = archiveEmit(&sink, &records[keys[i].index]) != 0;
+        }
+    }
+    if (!sink.in_completed) outbufPut(&out, completed_header.data, completed_header.len);
+
+    outbufPuts(&out, "\n===== EXPORT SUMMARY =====\n");
+    exportCountLine(&out, "Total Tasks Exported: ", (int)sink.rows);
+    exportCountLine(&out, "Pending Tasks: ", (int)pending);
+    exportCountLine(&out, "Overdue Tasks: ", (int)counts[SECTION_OVERDUE]);
+    exportCountLine(&out, "Completed Tasks: ", (int)counts[SECTION_COMPLETED]);
+    exportCountLine(&out, "High Priority: ", (int)priority_counts[1]);
+    exportCountLine(&out, "Medium Priority: ", (int)priority_counts[2]);
+    exportCountLine(&out, "Low Priority: ", (int)priority_counts[3]);
+    if (outbufFlush(&out) != 0) failed = 1;
+
+    outbufFree(&out);
+    outbufFree(&completed_header);
+    if (commitExportFile(&file, failed) != 0) failed = 1;
+    if (progress) __atomic_store_n(progress, sink.rows, __ATOMIC_RELAXED);
+    return failed ? -1 : sink.rows;
+}
+
+/*
+exportArchiveTxt() - Sorted export of a task file too large to load
+ - Time: O(n log n), Space: O(memory_limit)
+ - Reads the archive in runs that fit in memory_limit, sorts each run and
+   writes it to a temporary file, then k-way merges the runs straight into
+   the same report exportTasksTxt() writes. More than ARCHIVE_MAX_FANIN runs
+   are merged in several passes.
+ - Archive lines use the import format plus optional status and tags:
+     Tax Return,File 2024 taxes,1,15/04/2025,pending,finance;home
+ - Returns 0 on success, -1 on failure
  - Sample Case:
-    Input file content:
-      Study for Exam,Review chapters 1-5,1,20/05/2025
-      Buy Groceries,Get milk and eggs,3,10/05/2025
+    Input: archive with 3000000 lines, memory_limit = 64 MB
     Output:
-      "2 tasks imported from tasks.txt"
+      Sorting archive in runs of 222425 tasks...
+      14 runs written, merging...
+      Tasks exported to: archive_export.txt
  */
-void importTasks(tasklist *list, const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("Failed to open file for import");
-        return;
+int exportArchiveTxt(const char* archive_file, const char* filename, size_t memory_limit) {
+    FILE* in = fopen(archive_file, "r");
+    if (!in) {
+        perror("Failed to open archive");
+        return -1;
     }
+    if (memory_limit < ARCHIVE_MIN_MEMORY) memory_limit = ARCHIVE_MIN_MEMORY;
 
-    char name[100];
-    char desc[300];
-    int priority, day, month, year;
-    int imported_count = 0;
-    char line[500]; 
-
-    // Skip header lines if they exist
-    if (fgets(line, sizeof(line), file) != NULL) {
-        // Check if it looks like a header line
-        if (strstr(line, "===") != NULL || strstr(line, "TO-DO") != NULL) {
-            // This is likely a header line, so read the next line
-            fgets(line, sizeof(line), file);
-        } else {
-            // Not a header, rewind to start
-            rewind(file);
-        }
+    // Run buffer: records plus their sort keys, leaving 1/8 for stdio buffers
+    size_t per_record = sizeof(archiverecord) + sizeof(archivekey);
+    int run_capacity = (int)((memory_limit - memory_limit / 8) / per_record);
+    archiverecord* records = (archiverecord*)malloc(sizeof(archiverecord) * run_capacity);
+    archivekey* keys = (archivekey*)malloc(sizeof(archivekey) * run_capacity);
+    FILE** runs = NULL;
+    int run_count = 0, run_cap = 0, failed = 0;
+
+    if (!records || !keys) {
+        printf("Memory allocation failed for archive export.\n");
+        free(records);
+        free(keys);
+        fclose(in);
+        return -1;
     }
 
-    while (fgets(line, sizeof(line), file) != NULL) {
-       
-        if (strstr(line, "===") != NULL || strlen(line) < 5) {
+    date today = getToday();
+    long long counts[5] = {0}, priority_counts[4] = {0}, skipped = 0, seq = 0;
+    int in_run = 0;
+    char line[1024];
+
+    printf("Sorting archive in runs of %d tasks...\n", run_capacity);
+    while (!failed && fgets(line, sizeof(line), in) != NULL) {
+        if (strstr(line, "===") != NULL || strlen(line) < 5) continue;
+
+        archiverecord* r = &records[in_run];
+        int section = parseArchiveLine(line, today, r);
+        if (section < 0) {
+            skipped++;
             continue;
         }
 
-      
-        if (sscanf(line, " %99[^,],%299[^,],%d,%d/%d/%d", name, desc, &priority, &day, &month, &year) == 6) {
-            
-            char* end;
-            
-            // Trim trailing whitespace from name
-            end = name + strlen(name) - 1;
-            while (end > name && isspace((unsigned char)*end)) end--;
-            *(end + 1) = '\0';
-            
-            // Trim leading whitespace from name
-            char* start = name;
-            while (*start && isspace((unsigned char)*start)) start++;
-            if (start != name) {
-                memmove(name, start, strlen(start) + 1);
+        r->seq = seq++;
+        r->key = archiveSortKey(section, r);
+        counts[section]++;
+        if (section != SECTION_COMPLETED) priority_counts[r->priority]++;
+        keys[in_run].key = r->key;
+        keys[in_run].seq = r->seq;
+        keys[in_run].index = in_run;
+        in_run++;
+
+        if (in_run == run_capacity) {
+            if (run_count == run_cap) {
+                run_cap = run_cap ? run_cap * 2 : 16;
+                FILE** grown = (FILE**)realloc(runs, sizeof(FILE*) * run_cap);
+                if (!grown) {
+                    failed = 1;
+                    break;
+                }
+                runs = grown;
             }
-            
-            // trim for description
-            end = desc + strlen(desc) - 1;
-            while (end > desc && isspace((unsigned char)*end)) end--;
-            *(end + 1) = '\0';
-            
-            start = desc;
-            while (*start && isspace((unsigned char)*start)) start++;
-            if (start != desc) {
-                memmove(desc, start, strlen(start) + 1);
+            runs[run_count] = writeSortedRun(records, keys, in_run, filename);
+            if (!runs[run_count]) {
+                failed = 1;
+                break;
             }
+            run_count++;
+            in_run = 0;
+        }
+    }
+    if (ferror(in)) failed = 1;
+    fclose(in);
 
-            // Check if a task with this name already exists
-            if (isTaskNameDuplicate(list, name)) {
-                printf("Warning: Task '%s' already exists. Skipping import.\n", name);
-                continue;
-            }
+    // The last partial run also goes to disk when there are other runs, so
+    // the memory can be handed to the merge buffers
+    if (!failed && run_count > 0 && in_run > 0) {
+        FILE** grown = (FILE**)realloc(runs, sizeof(FILE*) * (run_count + 1));
+        if (grown) {
+            runs = grown;
+            runs[run_count] = writeSortedRun(records, keys, in_run, filename);
+            if (runs[run_count]) run_count++;
+            else failed = 1;
+        } else {
+            failed = 1;
+        }
+        in_run = 0;
+    }
+    if (run_count > 0) {
+        free(records);
+        records = NULL;
+        printf("%d runs written, merging...\n", run_count);
+    }
 
-            // Validate date
-            if (!isValidDate(day, month, year)) {
-                printf("Warning: Invalid date (%d/%d/%d) for task '%s'. Setting no due date.\n", day, month, year, name);
-                day = month = year = 0;
-            }
+    // Reduce to at most ARCHIVE_MAX_FANIN runs, merging the oldest runs first
+    while (!failed && run_count > ARCHIVE_MAX_FANIN) {
+        archivesink sink = {NULL, NULL, 0, 0, NULL, 0, NULL};
+        sink.run = archiveTempFile(filename);
+        if (!sink.run) {
+            failed = 1;
+            break;
+        }
+        size_t buffer_size = memory_limit / (2 * ARCHIVE_MAX_FANIN);
+        if (mergeRuns(runs, ARCHIVE_MAX_FANIN, buffer_size, &sink) != 0 || fflush(sink.run) != 0) {
+            fclose(sink.run);
+            run_count -= ARCHIVE_MAX_FANIN;
+            memmove(runs, runs + ARCHIVE_MAX_FANIN, sizeof(FILE*) * run_count);
+            failed = 1;
+            break;
+        }
+        rewind(sink.run);
+        memmove(runs, runs + ARCHIVE_MAX_FANIN, sizeof(FILE*) * (run_count - ARCHIVE_MAX_FANIN));
+        run_count -= ARCHIVE_MAX_FANIN;
+        runs[run_count++] = sink.run;
+    }
 
-            task* newtask = (task*)malloc(sizeof(task));
-            if (!newtask) {
-                printf("Memory allocation failed during import. Aborting rest.\n");
-                break;
-            }
+    long long rows = -1;
+    if (!failed) {
+        // The merge closes the runs
+        rows = writeArchiveReport(filename, today, counts, priority_counts, runs, run_count,
+                                  memory_limit, records, keys, in_run, NULL);
+        run_count = 0;
+    }
 
-            strcpy(newtask->name, name);
-            strcpy(newtask->description, desc);
-            
-            // Validate priority (1-3)
-            if (priority < 1 || priority > 3) {
-                printf("Warning: Invalid priority %d for task '%s'. Setting to Medium (2).\n", priority, name);
-                newtask->priority = 2;
-            } else {
-                newtask->priority = priority;
-            }
+    for (int i = 0; i < run_count; i++) fclose(runs[i]);
+    free(runs);
+    free(records);
+    free(keys);
+    if (rows < 0) {
+        printf("Archive export failed.\n");
+        return -1;
+    }
 
-            // Only set due date if it's valid
-            if (day > 0 && month > 0 && year > 0) {
-                newtask->duedate.day = day;
-                newtask->duedate.month = month;
-                newtask->duedate.year = year;
-                newtask->due_date_set = 1;
-            } else {
-                newtask->due_date_set = 0;
-            }
+    long long pending = counts[SECTION_HIGH] + counts[SECTION_MEDIUM] + counts[SECTION_LOW];
+    printf("Tasks exported to: %s\n", filename);
+    printf("Total %lld tasks exported (%lld pending, %lld overdue, %lld completed)\n",
+           rows, pending, counts[SECTION_OVERDUE], counts[SECTION_COMPLETED]);
+    if (skipped > 0) printf("%lld lines could not be parsed and were skipped.\n", skipped);
+    return 0;
+}
 
-            newtask->completed = 0;       
-            newtask->status = PENDING;
+// ===== Background export from a snapshot =====
 
-            newtask->next = list->head;
-            list->head = newtask;
-            imported_count++;
-        } else {
-            printf("Warning: Could not parse line: %s\n", line);
+// Smaller lists export in well under a second, so they are written directly
+#define BACKGROUND_EXPORT_MIN 50000
+
+enum { BACKGROUND_IDLE, BACKGROUND_RUNNING, BACKGROUND_DONE, BACKGROUND_FAILED };
+
+// Point-in-time copy of the fields the report needs, exported by a thread
+typedef struct {
+    char filepath[512];
+    date today;
+    archiverecord* records;
+    archivekey* keys;
+    int count;
+    long long counts[5];
+    long long priority_counts[4];
+    long long rows_written;  // progress, read with an atomic load
+    int state;               // BACKGROUND_*, read with an atomic load
+    poolgroup group;         // the export job on the background pool
+} backgroundexport;
+
+static backgroundexport background = {.state = BACKGROUND_IDLE};
+
+// Copies one task into the snapshot; section decides where it is listed
+static void snapshotTask(backgroundexport* job, const task* t, int section) {
+    archiverecord* r = &job->records[job->count];
+    memcpy(r->name, t->name, sizeof(r->name));
+    memcpy(r->tags, t->tags, sizeof(r->tags));
+    r->tag_count = t->tag_count;
+    r->priority = t->priority;
+    r->duedate = t->duedate;
+    r->due_date_set = t->due_date_set;
+    r->seq = job->count;
+    r->key = archiveSortKey(section, r);
+
+    job->keys[job->count].key = r->key;
+    job->keys[job->count].seq = r->seq;
+    job->keys[job->count].index = job->count;
+    job->counts[section]++;
+    job->count++;
+}
+
+static void backgroundExportJob(void* arg) {
+    backgroundexport* job = (backgroundexport*)arg;
+    long long rows = writeArchiveReport(job->filepath, job->today, job->counts, job->priority_counts,
+                                        NULL, 0, 0, job->records, job->keys, job->count,
+                                        &job->rows_written);
+    __atomic_store_n(&job->state, rows < 0 ? BACKGROUND_FAILED : BACKGROUND_DONE, __ATOMIC_RELEASE);
+}
+
+/*
+exportTasksBackground() - Exports a snapshot of the tasks on the background pool
+ - Time: O(n) on the calling thread, O(n log n) in the background
+ - Copies the fields the report needs (not descriptions) in one pass, so
+   tasks can be added, completed, edited or deleted while the file is
+   written; the file shows the tasks as they were when export started.
+   Progress and completion are shown by reportBackgroundExport().
+ - Lists under BACKGROUND_EXPORT_MIN tasks are exported directly with
+   exportTasksTxt(); only one background export runs at a time
+ - Sample Case:
+    Input: 1000000 tasks, Filename: "tasks_export.txt"
+    Output: Exporting 1000000 tasks to tasks_export.txt in the background.
+ */
+void exportTasksBackground(task* head, completedstack* stack, const char* filename) {
+    if (__atomic_load_n(&background.state, __ATOMIC_ACQUIRE) != BACKGROUND_IDLE) {
+        reportBackgroundExport();
+        if (background.state != BACKGROUND_IDLE) {
+            printf("An export is still running. Try again when it is done.\n");
+            return;
+        }
+    }
+
+    int total = 0;
+    for (task* t = head; t; t = t->next) {
+        if (!t->completed) total++;
+    }
+    for (stacknode* node = stack->top; node; node = node->next) {
+        if (node->task_data) total++;
+    }
+    if (total < BACKGROUND_EXPORT_MIN) {
+        exportTasksTxt(head, stack, filename);
+        return;
+    }
+
+    backgroundexport* job = &background;
+    if (exportPath(filename, job->filepath, sizeof(job->filepath)) != 0) return;
+    job->records = (archiverecord*)malloc(sizeof(archiverecord) * total);
+    job->keys = (archivekey*)malloc(sizeof(archivekey) * total);
+    if (!job->records || !job->keys) {
+        printf("Not enough memory for a background export, exporting directly.\n");
+        free(job->records);
+        free(job->keys);
+        exportTasksTxt(head, stack, filename);
+        return;
+    }
+
+    job->today = getToday();
+    job->count = 0;
+    job->rows_written = 0;
+    memset(job->counts, 0, sizeof(job->counts));
+    memset(job->priority_counts, 0, sizeof(job->priority_counts));
+
+    // Same sections as exportTasksTxt(); completed tasks keep stack order
+    for (task* t = head; t; t = t->next) {
+        if (t->completed) continue;
+        if (t->priority >= 1 && t->priority <= 3) job->priority_counts[t->priority]++;
+        if (t->status == OVERDUE) {
+            snapshotTask(job, t, SECTION_OVERDUE);
+        } else if (t->priority >= 1 && t->priority <= 3) {
+            snapshotTask(job, t, t->priority);
         }
     }
+    for (stacknode* node = stack->top; node; node = node->next) {
+        if (node->task_data) snapshotTask(job, node->task_data, SECTION_COMPLETED);
+    }
+
+    // Without a pool the job runs here, before this returns
+    job->state = BACKGROUND_RUNNING;
+    poolSubmit(poolDefault(), &job->group, backgroundExportJob, job);
+    printf("Exporting %d tasks to %s in the background.\n", job->count, job->filepath);
+    printf("Progress is shown above the menu.\n");
+}
+
+/*
+reportBackgroundExport() - Shows progress or the result of a background export
+ - Time: O(1), Space: O(1)
+ - Never waits: prints the rows written so far while the export runs, and
+   the result once (then frees the snapshot) when it has finished
+ - Example: reportBackgroundExport() -> "[Export] tasks_export.txt: 409600/1000000 rows (40%)"
+ */
+void reportBackgroundExport() {
+    backgroundexport* job = &background;
+    int state = __atomic_load_n(&job->state, __ATOMIC_ACQUIRE);
+    if (state == BACKGROUND_IDLE) return;
+
+    if (state == BACKGROUND_RUNNING) {
+        long long rows = __atomic_load_n(&job->rows_written, __ATOMIC_RELAXED);
+        printf("\n[Export] %s: %lld/%d rows (%lld%%)\n",
+               job->filepath, rows, job->count, job->count ? rows * 100 / job->count : 100);
+        return;
+    }
+
+    if (state == BACKGROUND_DONE) {
+        long long pending = job->counts[SECTION_HIGH] + job->counts[SECTION_MEDIUM] +
+                            job->counts[SECTION_LOW];
+        printf("\n[Export] Tasks exported to: %s\n", job->filepath);
+        printf("[Export] Total %d tasks exported (%lld pending, %lld overdue, %lld completed)\n",
+               job->count, pending, job->counts[SECTION_OVERDUE], job->counts[SECTION_COMPLETED]);
+    } else {
+        printf("\n[Export] Export to %s failed.\n", job->filepath);
+    }
+
+    free(job->records);
+    free(job->keys);
+    job->records = NULL;
+    job->keys = NULL;
+    job->state = BACKGROUND_IDLE;
+}
+
+/*
+finishBackgroundExport() - Waits for a running background export
+ - Time: O(remaining export), Space: O(1)
+ - Called before exit so the file is not left half written
+ */
+void finishBackgroundExport() {
+    if (__atomic_load_n(&background.state, __ATOMIC_ACQUIRE) == BACKGROUND_RUNNING) {
+        printf("Waiting for the background export to finish...\n");
+        poolWait(poolDefault(), &background.group);
+    }
+    reportBackgroundExport();
+}
 
-    if (ferror(file)) {
-        perror("Error reading import file");
+/*
+importTasks() - Imports tasks from CSV file
+ - Time: O(n + m), Space: O(n) (name index, see todoImportFile())
+ - Sample Case:
+    Input file content:
+      Study for Exam,Review chapters 1-5,1,20/05/2025
+      Buy Groceries,Get milk and eggs,3,10/05/2025
+    Output:
+      "2 tasks imported from tasks.txt"
+ */
+void importTasks(tasklist *list, const char* filename) {
+    todoimportresult result;
+    todostatus status = todoImportFile(list, filename, getToday(), &result);
+    feedRecordAdded(list->head, result.imported);
+    undoRecordAdded(list->head, result.imported);
+    if (status == TODO_IO_ERROR && result.imported == 0) {
+        perror("Failed to open file for import");
+        return;
+    }
+    if (status != TODO_OK) {
+        printf("Import stopped early: %s.\n", todoStatusText(status));
     }
 
-    fclose(file);
-    printf("%d tasks imported from %s\n", imported_count, filename);
+    if (result.duplicates > 0) {
+        printf("Warning: %d tasks already exist. Skipped.\n", result.duplicates);
+    }
+    if (result.invalid_dates > 0) {
+        printf("Warning: %d tasks had an invalid date. Imported with no due date.\n", result.invalid_dates);
+    }
+    if (result.invalid_priorities > 0) {
+        printf("Warning: %d tasks had an invalid priority. Set to Medium (2).\n", result.invalid_priorities);
+    }
+    if (result.invalid_rules > 0) {
+        printf("Warning: %d tasks had a repeat rule that could not be read. Imported as one-off tasks.\n",
+               result.invalid_rules);
+    }
+    if (result.unparsed_lines > 0) {
+        printf("Warning: Could not parse %d lines.\n", result.unparsed_lines);
+    }
+    printf("%d tasks imported from %s\n", result.imported, filename);
 }
@@ -1,9 +1,15 @@
 #ifndef FILEIO_H
 #define FILEIO_H
 
+#include <stddef.h>
 #include "task_management.h"
 
-void exportTasksTxt(task* head, completedstack* stack, const char* filename);
+int exportTasksTxt(task* head, completedstack* stack, const char* filename);
+void setExportBackups(int count);
 void importTasks(tasklist *list, const char *filename);
+int exportArchiveTxt(const char* archive_file, const char* filename, size_t memory_limit);
+void exportTasksBackground(task* head, completedstack* stack, const char* filename);
+void reportBackgroundExport();
+void finishBackgroundExport();
 
 #endif
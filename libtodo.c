@@ -0,0 +1,1146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "libtodo.h"
+#include "feed.h"
+#include "pool.h"
+#include "reminder.h"
+#include "recurrence.h"
+#include "undo.h"
+#include "query.h"
+
+// Lists at least this long are scanned in chunks on the background pool
+#define TODO_PARALLEL_MIN 65536
+#define TODO_CHUNK 8192
+
+// ===== Scans over long lists =====
+
+typedef int (*taskvisitfn)(task* t, date today);
+
+// A list cut into TODO_CHUNK-task pieces for poolFor()
+typedef struct {
+    task** starts;   // first task of each chunk
+    long chunks;
+    date today;
+    taskvisitfn visit;
+    long total;      // sum of visit() results, added with atomics
+} chunkscan;
+
+static void scanChunks(void* arg, long begin, long end) {
+    chunkscan* scan = (chunkscan*)arg;
+    task* stop = end < scan->chunks ? scan->starts[end] : NULL;
+    long total = 0;
+    for (task* t = scan->starts[begin]; t != stop; t = t->next) total += scan->visit(t, scan->today);
+    __atomic_fetch_add(&scan->total, total, __ATOMIC_RELAXED);
+}
+
+/*
+forEachTask() - Calls visit on every task and sums what it returns
+ - Time: O(n), O(n / workers) on the pool, Space: O(n / TODO_CHUNK)
+ - Lists of TODO_PARALLEL_MIN tasks or more are cut into chunks with one
+   walk and the chunks run on poolDefault(), the caller helping; shorter
+   lists, or no pool, are done on the calling thread. visit must only
+   touch its own task.
+ */
+static long forEachTask(task* head, date today, taskvisitfn visit) {
+    long length = 0;
+    task* t = head;
+    while (t && length < TODO_PARALLEL_MIN) {
+        t = t->next;
+        length++;
+    }
+    taskpool* pool = t ? poolDefault() : NULL;
+
+    chunkscan scan = {NULL, 0, today, visit, 0};
+    if (pool) {
+        long cap = 64;
+        scan.starts = (task**)malloc(sizeof(task*) * cap);
+        length = 0;
+        for (t = head; t && scan.starts; t = t->next, length++) {
+            if (length % TODO_CHUNK != 0) continue;
+            if (scan.chunks == cap) {
+                task** grown = (task**)realloc(scan.starts, sizeof(task*) * cap * 2);
+                if (!grown) {
+                    free(scan.starts);
+                    scan.starts = NULL;
+                    break;
+                }
+                scan.starts = grown;
+                cap *= 2;
+            }
+            scan.starts[scan.chunks++] = t;
+        }
+    }
+    if (!scan.starts) {
+        long total = 0;
+        for (t = head; t; t = t->next) total += visit(t, today);
+        return total;
+    }
+
+    poolgroup group = {0};
+    poolFor(pool, &group, scan.chunks, 1, scanChunks, &scan);
+    poolWait(pool, &group);
+    free(scan.starts);
+    return scan.total;
+}
+
+// ===== Dates =====
+
+/*
+compareDates() - Compares two dates
+ - Time: O(1), Space: O(1)
+ - Sample Case:
+    Input: 
+      d1 = {10, 5, 2025}
+      d2 = {15, 5, 2025}
+    Output: -5 (d1 is earlier than d2)
+ */
+int compareDates(date d1, date d2) {
+    if (d1.year != d2.year) return d1.year - d2.year;
+    if (d1.month != d2.month) return d1.month - d2.month;
+    return d1.day - d2.day;
+}
+
+/*
+getToday() - Gets current system date
+ - Time: O(1), Space: O(1)
+ - Example: getToday() -> returns {2, 5, 2025} (current date)
+ */
+date getToday() {
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+    date today = {t->tm_mday, t->tm_mon + 1, t->tm_year + 1900}; 
+    return today;  
+}
+
+/*
+isValidDate() - Validates date format
+ - Time: O(1), Space: O(1)
+ - Sample Case:
+    Input: day=31, month=2, year=2025
+    Output: 0 (invalid - February doesn't have 31 days)
+ */
+int isValidDate(int day, int month, int year) {
+    if (year < 1900 || month < 1 || month > 12 || day < 1)
+        return 0;
+        
+    // Days in each month
+    int daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    
+    // Adjust for leap years
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || (year % 400 == 0)))
+        daysInMonth[2] = 29;
+        
+    return day <= daysInMonth[month];
+}
+
+/*
+setDueDate() - Sets due date for a task
+ - Time: O(1), Space: O(1)
+ - Example: setDueDate(task_ptr, 10, 5, 2025) -> sets task due date
+ */
+void setDueDate(task* t, int day, int month, int year) {
+    if (t) {
+        t->duedate.day = day;
+        t->duedate.month = month;
+        t->duedate.year = year;
+        t->due_date_set = 1;
+    }
+}
+
+// One task of updateTaskStatuses()
+static int updateTaskStatus(task* t, date today) {
+    if (!t->completed && t->due_date_set) {
+        // Check if task is overdue
+        if (compareDates(today, t->duedate) > 0) {
+            if (t->status != OVERDUE) {
+                TaskStatus previous = t->status;
+                t->status = OVERDUE;
+                feedRecord(FEED_STATUS, t, NULL, previous);
+            }
+        } 
+        // Check if task is due soon (within 2 days)
+        else if (isDateSoon(today, t->duedate, 2) && t->status != PENDING) {
+            TaskStatus previous = t->status;
+            t->status = PENDING;  // Still pending but will mark as urgent in display
+            feedRecord(FEED_STATUS, t, NULL, previous);
+        }
+    }
+    return 0;
+}
+
+/*
+updateTaskStatuses() - Updates task status based on due date
+ - Time: O(n), Space: O(1)
+ - Long lists are done in chunks on the background pool (see forEachTask())
+ - Example: updateTaskStatuses(tasks, today) -> marks overdue tasks
+ */
+void updateTaskStatuses(task* head, date today) {
+    forEachTask(head, today, updateTaskStatus);
+}
+
+/*
+getDaysBetween() - Calculates days between two dates
+ - Time: O(1), Space: O(1)
+ - Sample Case:
+    Input:
+      d1 = {1, 5, 2025}
+      d2 = {5, 5, 2025}
+    Output: 4 (days difference)
+ */
+int getDaysBetween(date d1, date d2) {
+    // Check if dates are valid
+    
+    // Approximate days in each month (ignoring leap years)
+    const int daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    
+    // Convert dates to days since year 0 
+    int days1 = d1.year * 365 + d1.day;
+    int days2 = d2.year * 365 + d2.day;
+    
+    // Add days for months
+    for (int i = 1; i < d1.month; i++) days1 += daysInMonth[i];
+    for (int i = 1; i < d2.month; i++) days2 += daysInMonth[i];
+    
+    // Add leap years 
+    days1 += d1.year / 4;
+    days2 += d2.year / 4;
+    
+    return days2 - days1;
+}
+
+/*
+isDateSoon() - Checks if date is within threshold days
+ - Time: O(1), Space: O(1)
+ - Example: isDateSoon(today, duedate, 2) -> true if due within 2 days
+ */
+int isDateSoon(date today, date duedate, int daysThreshold) {
+    // Check if due date is valid
+    
+    // If years are different
+    if (duedate.year > today.year) {
+        if (duedate.month == 1 && today.month == 12) {
+            // Special case: December -> January transition
+            return (31 - today.day + duedate.day) <= daysThreshold;
+        }
+        return 0; // Not soon if more than a month away
+    }
+    
+    // If within same year but different months
+    if (duedate.month > today.month) {
+        if (duedate.month - today.month == 1) {
+            // Tasks due early next month
+            int daysInCurrentMonth;
+            switch (today.month) {
+                case 2: daysInCurrentMonth = 28; break; // Simplified, ignoring leap years
+                case 4: case 6: case 9: case 11: daysInCurrentMonth = 30; break;
+                default: daysInCurrentMonth = 31;
+            }
+            return (daysInCurrentMonth - today.day + duedate.day) <= daysThreshold;
+        }
+        return 0; // Not soon if more than a month away
+    }
+    
+    // Same month, just compare days
+    return (duedate.day - today.day) <= daysThreshold && (duedate.day - today.day) >= 0;
+}
+
+/*
+isDateWithinDays() - Checks if date within range
+ - Time: O(1), Space: O(1)
+ - Sample Case:
+    Input:
+      today = {1, 5, 2025}
+      check_date = {5, 5, 2025}
+      days = 7
+    Output: 1 (date is within 7 days)
+ */
+int isDateWithinDays(date today, date check_date, int days) {
+    // Calculate total days for both dates 
+    int today_days = today.year * 365 + today.month * 30 + today.day;
+    int check_days = check_date.year * 365 + check_date.month * 30 + check_date.day;
+    
+    // Check if the date is within the specified range
+    int diff = check_days - today_days;
+    return (diff >= 0 && diff <= days);
+}
+
+// ===== Status text =====
+
+/*
+todoStatusText() - Message for a status code
+ - Time: O(1), Space: O(1)
+ - Example: todoStatusText(TODO_DUPLICATE) -> "a task with this name already exists"
+ */
+const char* todoStatusText(todostatus status) {
+    switch (status) {
+        case TODO_OK: return "ok";
+        case TODO_NOT_FOUND: return "task not found";
+        case TODO_DUPLICATE: return "a task with this name already exists";
+        case TODO_INVALID_NAME: return "invalid task name";
+        case TODO_INVALID_PRIORITY: return "priority must be 1, 2 or 3";
+        case TODO_INVALID_DATE: return "invalid date";
+        case TODO_INVALID_TAG: return "invalid tag";
+        case TODO_TAGS_FULL: return "task already has the maximum number of tags";
+        case TODO_INVALID_REMINDER: return "reminders need a due date and 0 to 365 days before it";
+        case TODO_REMINDERS_FULL: return "task already has the maximum number of reminders";
+        case TODO_INVALID_RECURRENCE: return "invalid repeat rule";
+        case TODO_EMPTY: return "nothing to do";
+        case TODO_PARSE_ERROR: return "could not parse line";
+        case TODO_NO_MEMORY: return "out of memory";
+        case TODO_IO_ERROR: return "file error";
+    }
+    return "unknown error";
+}
+
+// ===== Dates and scheduling =====
+
+/*
+todoDayNumber() - Day number of a date, counted from 1 March of year 0
+ - Time: O(1), Space: O(1)
+ - Exact for any valid date, so the difference of two day numbers is the
+   number of days between them (getDaysBetween() only approximates it)
+ - Example: todoDayNumber(01/03/2025) - todoDayNumber(28/02/2025) -> 1
+ */
+long todoDayNumber(date d) {
+    long y = d.year - (d.month <= 2);
+    long era = (y >= 0 ? y : y - 399) / 400;
+    long year_of_era = y - era * 400;
+    long month = (d.month + 9) % 12;  // March is 0
+    long day_of_year = (153 * month + 2) / 5 + d.day - 1;
+    long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era;
+}
+
+/*
+todoDateFromDay() - The date of a day number, inverse of todoDayNumber()
+ - Time: O(1), Space: O(1)
+ - Example: todoDateFromDay(todoDayNumber(28/02/2024) + 1) -> 29/02/2024
+ */
+date todoDateFromDay(long day) {
+    long era = (day >= 0 ? day : day - 146096) / 146097;
+    long day_of_era = day - era * 146097;
+    long year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    long day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    long month = (5 * day_of_year + 2) / 153;  // March is 0
+    date d;
+    d.day = (int)(day_of_year - (153 * month + 2) / 5 + 1);
+    d.month = (int)(month < 10 ? month + 3 : month - 9);
+    d.year = (int)(year_of_era + era * 400 + (d.month <= 2));
+    return d;
+}
+
+/*
+todoWeekday() - Day of the week, 0 for Monday to 6 for Sunday
+ - Time: O(1), Space: O(1)
+ - Example: todoWeekday(19/10/2026) -> 0
+ */
+int todoWeekday(date d) {
+    // 1 March of year 0 was a Wednesday
+    long weekday = (todoDayNumber(d) + 2) % 7;
+    return (int)(weekday < 0 ? weekday + 7 : weekday);
+}
+
+/*
+todoStatusForDate() - Pending or overdue, from the due date
+ - Time: O(1), Space: O(1)
+ - Example: due 10/05/2025, today 12/05/2025 -> OVERDUE
+ */
+TaskStatus todoStatusForDate(const task* t, date today) {
+    if (t->due_date_set && compareDates(today, t->duedate) > 0) return OVERDUE;
+    return PENDING;
+}
+
+// One task of todoRefreshStatuses(); 1 if it is overdue
+static int refreshStatus(task* t, date today) {
+    if (t->completed) return 0;
+    TaskStatus status = todoStatusForDate(t, today);
+    TaskStatus previous = t->status;
+    if (status != previous) {
+        __atomic_store_n(&t->status, status, __ATOMIC_RELAXED);
+        feedRecord(FEED_STATUS, t, NULL, previous);
+    }
+    return status == OVERDUE;
+}
+
+/*
+todoRefreshStatuses() - Sets every active task to pending or overdue
+ - Time: O(n), Space: O(1)
+ - Unlike updateTaskStatuses(), overdue tasks go back to pending when the
+   date moves back; returns the number of overdue tasks
+ - Long lists are done in chunks on the background pool
+ */
+int todoRefreshStatuses(task* head, date today) {
+    return (int)forEachTask(head, today, refreshStatus);
+}
+
+/*
+todoAutoPriority() - Raises a task to High when it is overdue or due within 2 days
+ - Time: O(1), Space: O(1)
+ - Returns 1 if the priority changed
+ - Example: Medium task due tomorrow -> priority 1, returns 1
+ */
+int todoAutoPriority(task* t, date today) {
+    if (t->completed || !t->due_date_set || t->priority == 1) return 0;
+    if (getDaysBetween(today, t->duedate) > 2) return 0;
+    int previous = t->priority;
+    undoRecordFields(t, UNDO_PRIORITY, NULL);
+    t->priority = 1;
+    feedRecord(FEED_PRIORITY, t, NULL, previous);
+    return 1;
+}
+
+/*
+todoAutoPriorityAdjust() - todoAutoPriority() for every task
+ - Time: O(n), Space: O(1)
+ - Long lists are done in chunks on the background pool
+ - Returns the number of tasks raised to High
+ */
+int todoAutoPriorityAdjust(task* head, date today) {
+    return (int)forEachTask(head, today, todoAutoPriority);
+}
+
+// ===== Name index =====
+
+// Marks a slot whose task was removed, so probing continues past it
+static char index_deleted;
+#define INDEX_DELETED ((task*)&index_deleted)
+#define INDEX_MIN_SLOTS 1024
+
+/*
+todoNameHash() - FNV-1a hash of a task name, as used by the index
+ - Time: O(length), Space: O(1)
+ */
+unsigned int todoNameHash(const char* name) {
+    unsigned int hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int indexInit(todoindex* index, int count) {
+    index->cap = INDEX_MIN_SLOTS;
+    while (index->cap < count * 2) index->cap *= 2;
+    index->used = 0;
+    index->slots = (task**)calloc(index->cap, sizeof(task*));
+    return index->slots ? 0 : -1;
+}
+
+static task* indexFindHashed(const todoindex* index, const char* name, unsigned int hash) {
+    unsigned int mask = (unsigned int)index->cap - 1;
+    for (unsigned int i = hash & mask; index->slots[i]; i = (i + 1) & mask) {
+        task* t = index->slots[i];
+        if (t != INDEX_DELETED && strcmp(t->name, name) == 0) return t;
+    }
+    return NULL;
+}
+
+// Puts t in the first free slot from its hash; the table must have room
+static void indexPlace(todoindex* index, task* t, unsigned int hash) {
+    unsigned int mask = (unsigned int)index->cap - 1;
+    unsigned int i = hash & mask;
+    while (index->slots[i] && index->slots[i] != INDEX_DELETED) i = (i + 1) & mask;
+    if (!index->slots[i]) index->used++;
+    index->slots[i] = t;
+}
+
+/*
+todoIndexFind() - Looks up an indexed task by name
+ - Time: O(1) average, Space: O(1)
+ - Example: todoIndexFind(&index, "Report") -> task pointer, or NULL
+ */
+task* todoIndexFind(const todoindex* index, const char* name) {
+    return indexFindHashed(index, name, todoNameHash(name));
+}
+
+// Rebuilds the table at a size that fits live entries, dropping deleted slots
+static int indexGrow(todoindex* index) {
+    todoindex grown;
+    int live = 0;
+    for (int i = 0; i < index->cap; i++) {
+        if (index->slots[i] && index->slots[i] != INDEX_DELETED) live++;
+    }
+    if (indexInit(&grown, live * 2) != 0) return -1;
+
+    for (int i = 0; i < index->cap; i++) {
+        if (index->slots[i] && index->slots[i] != INDEX_DELETED) todoIndexInsert(&grown, index->slots[i]);
+    }
+    free(index->slots);
+    *index = grown;
+    return 0;
+}
+
+/*
+todoIndexInsert() - Adds a task to the index
+ - Time: O(1) average, Space: O(1) amortized
+ - The table is rebuilt when live and deleted slots reach 70% of it
+ - Returns 0 on success, -1 if out of memory
+ */
+int todoIndexInsert(todoindex* index, task* t) {
+    if ((index->used + 1) * 10 > index->cap * 7 && indexGrow(index) != 0) return -1;
+    indexPlace(index, t, todoNameHash(t->name));
+    return 0;
+}
+
+/*
+todoIndexRemove() - Removes a task from the index
+ - Time: O(1) average, Space: O(1)
+ */
+void todoIndexRemove(todoindex* index, const task* t) {
+    unsigned int mask = (unsigned int)index->cap - 1;
+    for (unsigned int i = todoNameHash(t->name) & mask; index->slots[i]; i = (i + 1) & mask) {
+        if (index->slots[i] == t) {
+            index->slots[i] = INDEX_DELETED;
+            return;
+        }
+    }
+}
+
+// Tasks of a long list and their name hashes, hashed in chunks on the pool
+typedef struct {
+    task** tasks;
+    unsigned int* hashes;
+} indexhashjob;
+
+static void hashRange(void* arg, long begin, long end) {
+    indexhashjob* job = (indexhashjob*)arg;
+    for (long i = begin; i < end; i++) job->hashes[i] = todoNameHash(job->tasks[i]->name);
+}
+
+/*
+todoIndexBuild() - Indexes every task in a list (the first of duplicate names)
+ - Time: O(n), Space: O(n)
+ - Any previous table in index is freed; start from {NULL, 0, 0}
+ - For long lists the names are hashed in chunks on the background pool;
+   tasks are then placed in list order on this thread, so the first of
+   duplicate names still wins
+ - Returns 0 on success, -1 if out of memory
+ */
+int todoIndexBuild(todoindex* index, task* head) {
+    int count = 0;
+    for (task* t = head; t; t = t->next) count++;
+
+    free(index->slots);
+    if (indexInit(index, count) != 0) return -1;
+
+    taskpool* pool = count >= TODO_PARALLEL_MIN ? poolDefault() : NULL;
+    indexhashjob job = {NULL, NULL};
+    if (pool) {
+        job.tasks = (task**)malloc(sizeof(task*) * count);
+        job.hashes = (unsigned int*)malloc(sizeof(unsigned int) * count);
+    }
+    if (!job.tasks || !job.hashes) {
+        free(job.tasks);
+        free(job.hashes);
+        for (task* t = head; t; t = t->next) {
+            if (!todoIndexFind(index, t->name) && todoIndexInsert(index, t) != 0) return -1;
+        }
+        return 0;
+    }
+
+    int i = 0;
+    for (task* t = head; t; t = t->next) job.tasks[i++] = t;
+    poolgroup group = {0};
+    poolFor(pool, &group, count, TODO_CHUNK, hashRange, &job);
+    poolWait(pool, &group);
+
+    // Sized for count by indexInit(), so no growth is needed
+    for (i = 0; i < count; i++) {
+        if (!indexFindHashed(index, job.tasks[i]->name, job.hashes[i])) indexPlace(index, job.tasks[i], job.hashes[i]);
+    }
+    free(job.tasks);
+    free(job.hashes);
+    return 0;
+}
+
+void todoIndexFree(todoindex* index) {
+    free(index->slots);
+    index->slots = NULL;
+    index->cap = index->used = 0;
+}
+
+// ===== Tasks =====
+
+/*
+todoCreateTask() - Allocates a validated task (not linked into any list)
+ - Time: O(1), Space: O(1)
+ - due may be NULL for no due date; the status follows from today
+ - Example: todoCreateTask("Report", "Q2", 1, &due, today, &t) -> TODO_OK
+ */
+todostatus todoCreateTask(const char* name, const char* description, int priority,
+                          const date* due, date today, task** out) {
+    size_t name_length = strlen(name);
+    int has_text = 0;
+    for (const char* p = name; *p; p++) {
+        if (!isspace((unsigned char)*p)) has_text = 1;
+    }
+    if (!has_text || name_length >= sizeof(((task*)0)->name)) return TODO_INVALID_NAME;
+    if (priority < 1 || priority > 3) return TODO_INVALID_PRIORITY;
+    if (due && !isValidDate(due->day, due->month, due->year)) return TODO_INVALID_DATE;
+
+    task* t = (task*)calloc(1, sizeof(task));
+    if (!t) return TODO_NO_MEMORY;
+    memcpy(t->name, name, name_length + 1);
+    snprintf(t->description, sizeof(t->description), "%s", description ? description : "");
+    t->priority = priority;
+    if (due) {
+        t->duedate = *due;
+        t->due_date_set = 1;
+    }
+    t->status = todoStatusForDate(t, today);
+    *out = t;
+    return TODO_OK;
+}
+
+/*
+todoFindTask() - Finds an active task by name
+ - Time: O(n), Space: O(1)
+ - Example: todoFindTask(&tasks, "Report") -> task pointer, or NULL
+ */
+task* todoFindTask(tasklist* list, const char* name) {
+    for (task* t = list->head; t; t = t->next) {
+        if (strcmp(t->name, name) == 0) return t;
+    }
+    return NULL;
+}
+
+// Finds a task and the link pointing to it, for unlinking
+static task** findLink(tasklist* list, const char* name) {
+    task** link = &list->head;
+    while (*link && strcmp((*link)->name, name) != 0) link = &(*link)->next;
+    return *link ? link : NULL;
+}
+
+// todoAdd() without the change feed, for imports (their callers record what they keep)
+static todostatus addTask(tasklist* list, todoindex* index, const char* name, const char* description,
+                          int priority, const date* due, date today, task** out) {
+    if (index ? todoIndexFind(index, name) != NULL : todoFindTask(list, name) != NULL) {
+        return TODO_DUPLICATE;
+    }
+
+    task* t;
+    todostatus status = todoCreateTask(name, description, priority, due, today, &t);
+    if (status != TODO_OK) return status;
+    if (index && todoIndexInsert(index, t) != 0) {
+        free(t);
+        return TODO_NO_MEMORY;
+    }
+
+    t->next = list->head;
+    // Release: a reader that sees the new head sees the whole task
+    __atomic_store_n(&list->head, t, __ATOMIC_RELEASE);
+    if (out) *out = t;
+    return TODO_OK;
+}
+
+/*
+todoAdd() - Creates a task and inserts it at the head of the list
+ - Time: O(1) with an index, O(n) without (duplicate check), Space: O(1)
+ - index may be NULL; when given it is used for the duplicate check and
+   kept up to date
+ - Example: todoAdd(&tasks, NULL, "Report", "Q2", 1, NULL, today, NULL) -> TODO_OK
+ */
+todostatus todoAdd(tasklist* list, todoindex* index, const char* name, const char* description,
+                   int priority, const date* due, date today, task** out) {
+    task* t;
+    todostatus status = addTask(list, index, name, description, priority, due, today, &t);
+    if (status != TODO_OK) return status;
+    feedRecord(FEED_ADD, t, NULL, 0);
+    undoRecordAdd(t);
+    if (out) *out = t;
+    return TODO_OK;
+}
+
+/*
+todoAddOccurrence() - Adds the occurrence that follows t, a recurring task being completed
+ - Time: O(1) with an index, Space: O(1)
+ - The new task is a copy of t (name, description, tags, reminders, rule)
+   due on the rule's next date, pending or overdue as of today. It is
+   linked at the head of the list, indexed and recorded in the change feed.
+   t must already be out of index, which holds active tasks by name.
+ - Returns TODO_EMPTY if t does not repeat or its rule has no next date,
+   TODO_NO_MEMORY if the copy cannot be made or indexed
+ - Example: t "Laundry" due 06/01/2025, weekly mon,thu -> new "Laundry" due 09/01/2025
+ */
+todostatus todoAddOccurrence(tasklist* list, todoindex* index, const task* t, date today, task** out) {
+    date due;
+    if (t->repeat.kind == RECUR_NONE || !t->due_date_set) return TODO_EMPTY;
+    if (recurNext(&t->repeat, t->duedate, &due) != 0) return TODO_EMPTY;
+    task* next = (task*)malloc(sizeof(task));
+    if (!next) return TODO_NO_MEMORY;
+    *next = *t;
+    next->duedate = due;
+    next->completed = 0;
+    next->status = todoStatusForDate(next, today);
+    next->reminder_entries = NULL;
+    if (index && todoIndexInsert(index, next) != 0) {
+        free(next);
+        return TODO_NO_MEMORY;
+    }
+    next->next = list->head;
+    __atomic_store_n(&list->head, next, __ATOMIC_RELEASE);
+    reminderwheel* wheel = reminderDefaultIfStarted();
+    if (wheel && next->reminder_count > 0) reminderSchedule(wheel, next);
+    feedRecord(FEED_ADD, next, NULL, 0);
+    if (out) *out = next;
+    return TODO_OK;
+}
+
+/*
+todoComplete() - Moves a task from the list to the completed stack
+ - Time: O(n), Space: O(1)
+ - today is the completion date (the session's date, not the clock's)
+ - A recurring task is followed by its next occurrence, added to the list
+   with the same name, tags, reminders and rule (see recurrence.h)
+ - Example: todoComplete(&tasks, &doneStack, NULL, "Report", today, &t) -> TODO_OK
+ */
+todostatus todoComplete(tasklist* list, completedstack* stack, todoindex* index,
+                        const char* name, date today, task** out) {
+    task** link = findLink(list, name);
+    if (!link) return TODO_NOT_FOUND;
+
+    // Allocate the stack node first so a failure leaves the task in place
+    stacknode* node = (stacknode*)malloc(sizeof(stacknode));
+    if (!node) return TODO_NO_MEMORY;
+
+    task* t = *link;
+    *link = t->next;
+    t->next = NULL;
+    t->status = COMPLETED;
+    t->completed = 1;
+    t->completed_date = today;
+    if (index) todoIndexRemove(index, t);
+    if (t->reminder_entries) reminderCancel(t);
+
+    node->task_data = t;
+    node->next = stack->top;
+    stack->top = node;
+    feedRecord(FEED_COMPLETE, t, NULL, 0);
+    undoRecordComplete(t);
+    todoAddOccurrence(list, index, t, today, NULL);
+    if (out) *out = t;
+    return TODO_OK;
+}
+
+/*
+todoUndo() - Moves the last completed task back to the head of the list
+ - Time: O(1), O(n) for a recurring task, Space: O(1)
+ - A recurring task takes the place of the occurrence its completion added,
+   if that is still in the list unchanged
+ - Example: todoUndo(&tasks, &doneStack, NULL, &t) -> TODO_OK, TODO_EMPTY if none
+ */
+todostatus todoUndo(tasklist* list, completedstack* stack, todoindex* index, task** out) {
+    stacknode* node = stack->top;
+    if (!node) return TODO_EMPTY;
+    if (index && node->task_data && index->slots && todoIndexInsert(index, node->task_data) != 0) {
+        return TODO_NO_MEMORY;
+    }
+
+    stack->top = node->next;
+    task* t = node->task_data;
+    free(node);
+
+    date due;
+    if (t->repeat.kind != RECUR_NONE && t->due_date_set && recurNext(&t->repeat, t->duedate, &due) == 0) {
+        task** link = findLink(list, t->name);
+        if (link && (*link)->repeat.kind != RECUR_NONE && (*link)->due_date_set &&
+            compareDates((*link)->duedate, due) == 0) {
+            task* next = *link;
+            *link = next->next;
+            if (index) todoIndexRemove(index, next);
+            if (next->reminder_entries) reminderCancel(next);
+            feedRecord(FEED_DELETE, next, NULL, 0);
+            free(next);
+        }
+    }
+
+    t->status = PENDING;
+    t->completed = 0;
+    t->next = list->head;
+    list->head = t;
+    reminderwheel* wheel = reminderDefaultIfStarted();
+    if (wheel && t->reminder_count > 0) reminderSchedule(wheel, t);
+    feedRecord(FEED_UNDO, t, NULL, 0);
+    undoRecordUndo(t);
+    if (out) *out = t;
+    return TODO_OK;
+}
+
+/*
+todoDelete() - Removes a task from the list and frees it
+ - Time: O(n), Space: O(1)
+ - Example: todoDelete(&tasks, NULL, "Old Task") -> TODO_OK
+ */
+todostatus todoDelete(tasklist* list, todoindex* index, const char* name) {
+    task** link = findLink(list, name);
+    if (!link) return TODO_NOT_FOUND;
+
+    task* t = *link;
+    *link = t->next;
+    if (index) todoIndexRemove(index, t);
+    if (t->reminder_entries) reminderCancel(t);
+    feedRecord(FEED_DELETE, t, NULL, 0);
+    undoRecordDelete(t);
+    free(t);
+    return TODO_OK;
+}
+
+static todostatus checkTag(const char* tag) {
+    if (tag[0] == '\0' || strlen(tag) >= MAX_TAG_LENGTH) return TODO_INVALID_TAG;
+    return TODO_OK;
+}
+
+/*
+todoAddTag() - Adds a tag to a task
+ - Time: O(MAX_TAGS), Space: O(1)
+ - Returns TODO_DUPLICATE if the task already has it, TODO_TAGS_FULL at MAX_TAGS
+ - Example: todoAddTag(t, "work") -> TODO_OK
+ */
+todostatus todoAddTag(task* t, const char* tag) {
+    if (checkTag(tag) != TODO_OK) return TODO_INVALID_TAG;
+    for (int i = 0; i < t->tag_count; i++) {
+        if (strcmp(t->tags[i], tag) == 0) return TODO_DUPLICATE;
+    }
+    if (t->tag_count >= MAX_TAGS) return TODO_TAGS_FULL;
+
+    undoRecordFields(t, UNDO_TAGS, NULL);
+    // Fill the slot before counting it, so concurrent readers never see it half written
+    strcpy(t->tags[t->tag_count], tag);
+    __atomic_store_n(&t->tag_count, t->tag_count + 1, __ATOMIC_RELEASE);
+    feedRecord(FEED_TAG, t, tag, 0);
+    return TODO_OK;
+}
+
+/*
+todoReplaceTag() - Replaces the tag at position (0-based)
+ - Time: O(1), Space: O(1)
+ - Example: todoReplaceTag(t, 0, "home") -> TODO_OK
+ */
+todostatus todoReplaceTag(task* t, int position, const char* tag) {
+    if (position < 0 || position >= t->tag_count) return TODO_NOT_FOUND;
+    if (checkTag(tag) != TODO_OK) return TODO_INVALID_TAG;
+    undoRecordFields(t, UNDO_TAGS, NULL);
+    feedRecord(FEED_UNTAG, t, t->tags[position], 0);
+    strcpy(t->tags[position], tag);
+    feedRecord(FEED_TAG, t, tag, 0);
+    return TODO_OK;
+}
+
+/*
+todoRemoveTag() - Removes a tag from a task, keeping the order of the rest
+ - Time: O(MAX_TAGS), Space: O(1)
+ - Example: todoRemoveTag(t, "work") -> TODO_OK, TODO_NOT_FOUND if t lacks it
+ */
+todostatus todoRemoveTag(task* t, const char* tag) {
+    int position = 0;
+    while (position < t->tag_count && strcmp(t->tags[position], tag) != 0) position++;
+    if (position == t->tag_count) return TODO_NOT_FOUND;
+
+    undoRecordFields(t, UNDO_TAGS, NULL);
+    feedRecord(FEED_UNTAG, t, tag, 0);
+    for (int i = position; i < t->tag_count - 1; i++) strcpy(t->tags[i], t->tags[i + 1]);
+    __atomic_store_n(&t->tag_count, t->tag_count - 1, __ATOMIC_RELEASE);
+    return TODO_OK;
+}
+
+/*
+todoClearCompleted() - Frees every completed task
+ - Time: O(n), Space: O(1)
+ - Returns the number of tasks freed
+ */
+int todoClearCompleted(completedstack* stack) {
+    int cleared = 0;
+    stacknode* node = stack->top;
+    while (node) {
+        stacknode* next = node->next;
+        if (node->task_data) feedRecord(FEED_CLEAR, node->task_data, NULL, 0);
+        free(node->task_data);
+        free(node);
+        node = next;
+        cleared++;
+    }
+    stack->top = NULL;
+    return cleared;
+}
+
+/*
+todoBulk() - Applies one action to every active task matching query, in one pass
+ - Time: O(n) for the walk plus O(1) per match, Space: O(1)
+ - Completions and deletions unlink as the walk passes, so retiring
+   thousands of tasks costs one traversal instead of one findLink() each.
+   Each match keeps its side effects: reminders are cancelled, the change
+   feed records it, and completed recurring tasks get their next
+   occurrence once the walk is over (so new tasks are never visited).
+ - index may be NULL; removed names leave it in O(1) each
+ - today dates the completions and the new occurrences' status
+ - The changes are one undo group (see undo.h)
+ - Returns TODO_INVALID_TAG or TODO_INVALID_PRIORITY before changing
+   anything, TODO_NO_MEMORY if a completion could not be stacked (the
+   tasks before it are done); result counts matches and changes
+ - Sample Case:
+    Input: query {TODO_MATCH_TAG, "sprint-4"}, op {TODO_BULK_COMPLETE}
+    Output: TODO_OK, every sprint-4 task on the completed stack
+ */
+todostatus todoBulk(tasklist* list, completedstack* stack, todoindex* index, const todoquery* query,
+                    const todobulk* op, date today, todobulkresult* result) {
+    result->matched = result->changed = 0;
+    if ((op->action == TODO_BULK_TAG || op->action == TODO_BULK_UNTAG) &&
+        (!op->tag || checkTag(op->tag) != TODO_OK)) {
+        return TODO_INVALID_TAG;
+    }
+    if (op->action == TODO_BULK_PRIORITY && (op->priority < 1 || op->priority > 3)) {
+        return TODO_INVALID_PRIORITY;
+    }
+
+    todostatus status = TODO_OK;
+    int removed = 0;
+    task** link = &list->head;
+    undoGroupBegin();
+    task* t;
+    while ((t = *link) != NULL) {
+        if (!todoMatches(t, query)) {
+            link = &t->next;
+            continue;
+        }
+        result->matched++;
+
+        if (op->action == TODO_BULK_COMPLETE || op->action == TODO_BULK_DELETE) {
+            stacknode* node = NULL;
+            if (op->action == TODO_BULK_COMPLETE && !(node = (stacknode*)malloc(sizeof(stacknode)))) {
+                status = TODO_NO_MEMORY;
+                break;
+            }
+            *link = t->next;
+            t->next = NULL;
+            if (index) todoIndexRemove(index, t);
+            if (t->reminder_entries) reminderCancel(t);
+            removed++;
+            result->changed++;
+            if (node) {
+                t->status = COMPLETED;
+                t->completed = 1;
+                t->completed_date = today;
+                node->task_data = t;
+                node->next = stack->top;
+                stack->top = node;
+                feedRecord(FEED_COMPLETE, t, NULL, 0);
+                undoRecordComplete(t);
+            } else {
+                feedRecord(FEED_DELETE, t, NULL, 0);
+                undoRecordDelete(t);
+                free(t);
+            }
+            continue;
+        }
+
+        if (op->action == TODO_BULK_TAG) {
+            if (todoAddTag(t, op->tag) == TODO_OK) result->changed++;
+        } else if (op->action == TODO_BULK_UNTAG) {
+            if (todoRemoveTag(t, op->tag) == TODO_OK) result->changed++;
+        } else if (t->priority != op->priority) {
+            int previous = t->priority;
+            undoRecordFields(t, UNDO_PRIORITY, NULL);
+            t->priority = op->priority;
+            feedRecord(FEED_PRIORITY, t, NULL, previous);
+            result->changed++;
+        }
+        link = &t->next;
+    }
+
+    // The tasks just completed are the top of the stack, newest first
+    if (op->action == TODO_BULK_COMPLETE) {
+        stacknode* node = stack->top;
+        for (int i = 0; i < removed && node; i++, node = node->next) {
+            task* done = node->task_data;
+            todoAddOccurrence(list, index, done, today, NULL);
+        }
+    }
+    undoGroupEnd();
+    return status;
+}
+
+// ===== Counting and search =====
+
+/*
+todoCount() - Counts tasks by state and (active) priority
+ - Time: O(n), Space: O(1)
+ - A task is overdue if marked so or if its due date is before today
+ */
+void todoCount(task* head, completedstack* stack, date today, todocounts* counts) {
+    memset(counts, 0, sizeof(*counts));
+    for (task* t = head; t; t = t->next) {
+        if (t->completed) {
+            counts->completed++;
+            continue;
+        }
+        if (t->status == OVERDUE || todoStatusForDate(t, today) == OVERDUE) counts->overdue++;
+        else counts->pending++;
+
+        if (t->priority == 1) counts->high++;
+        else if (t->priority == 2) counts->medium++;
+        else if (t->priority == 3) counts->low++;
+    }
+    for (stacknode* node = stack->top; node; node = node->next) {
+        if (node->task_data) counts->completed++;
+    }
+}
+
+/*
+todoMatches() - Tests a task against a search query
+ - Time: O(m) for text matches, O(1) otherwise, Space: O(1)
+ - TODO_MATCH_EXPRESSION runs the query's compiled program (see query.h)
+ - Example: query {TODO_MATCH_TAG, "work"} -> 1 for tasks tagged "work"
+ */
+int todoMatches(const task* t, const todoquery* query) {
+    int tag_count = __atomic_load_n(&t->tag_count, __ATOMIC_ACQUIRE);
+    switch (query->type) {
+        case TODO_MATCH_ALL:
+            return 1;
+        case TODO_MATCH_NAME:
+            return strstr(t->name, query->text) != NULL;
+        case TODO_MATCH_DESCRIPTION:
+            return strstr(t->description, query->text) != NULL;
+        case TODO_MATCH_KEYWORD:
+            if (strstr(t->name, query->text) || strstr(t->description, query->text)) return 1;
+            for (int i = 0; i < tag_count; i++) {
+                if (strstr(t->tags[i], query->text)) return 1;
+            }
+            return 0;
+        case TODO_MATCH_TAG:
+            for (int i = 0; i < tag_count; i++) {
+                if (strcmp(t->tags[i], query->text) == 0) return 1;
+            }
+            return 0;
+        case TODO_MATCH_PRIORITY:
+            return t->priority >= query->min_priority && t->priority <= query->max_priority;
+        case TODO_MATCH_STATUS:
+            return (TaskStatus)__atomic_load_n(&t->status, __ATOMIC_RELAXED) == query->status;
+        case TODO_MATCH_DUE_RANGE:
+            return t->due_date_set && compareDates(t->duedate, query->from) >= 0 &&
+                   compareDates(t->duedate, query->to) <= 0;
+        case TODO_MATCH_NO_DUE_DATE:
+            return !t->due_date_set;
+        case TODO_MATCH_EXPRESSION:
+            return queryRun(query->program, t);
+    }
+    return 0;
+}
+
+// ===== Import =====
+
+// Removes leading and trailing whitespace in place
+static void trimText(char* s) {
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+
+    char* start = s;
+    while (*start && isspace((unsigned char)*start)) start++;
+    if (start != s) memmove(s, start, strlen(start) + 1);
+}
+
+/*
+todoParseTaskLine() - Parses "name,description,priority,DD/MM/YYYY"
+ - Time: O(m), Space: O(1)
+ - name must hold 100 bytes and description 300; both are trimmed.
+   The values are returned as written, without validation.
+ - Example: "Study, Read ch. 3, 1, 10/05/2025" -> TODO_OK
+ */
+todostatus todoParseTaskLine(const char* line, char* name, char* description,
+                             int* priority, date* due) {
+    if (sscanf(line, " %99[^,],%299[^,],%d,%d/%d/%d", name, description, priority,
+               &due->day, &due->month, &due->year) != 6) {
+        return TODO_PARSE_ERROR;
+    }
+    trimText(name);
+    trimText(description);
+    return TODO_OK;
+}
+
+/*
+todoImportFile() - Adds tasks from a file written in the import format
+ - Time: O(n + m) with a name index, Space: O(n)
+ - Header lines ("===", "TO-DO") and short lines are skipped. Duplicate
+   names are skipped, invalid dates become no due date and invalid
+   priorities become Medium; result counts each case.
+ - A fifth field after the date makes the task recurring, in the form read
+   by recurParse(): "Laundry,Wash and fold,3,06/01/2025,weekly mon,thu".
+   Rules with invalid values are left off (result->invalid_rules); any
+   other fifth field (an archive status) is ignored as before.
+ - The tasks are not recorded in the change feed; callers that keep them
+   use feedRecordAdded()
+ - Returns TODO_IO_ERROR if the file cannot be read
+ - Sample Case:
+    Input: tasks_import.txt with 12 task lines, 1 already in the list
+    Output: TODO_OK, result = {imported 11, duplicates 1}
+ */
+todostatus todoImportFile(tasklist* list, const char* filename, date today,
+                          todoimportresult* result) {
+    memset(result, 0, sizeof(*result));
+    FILE* file = fopen(filename, "r");
+    if (!file) return TODO_IO_ERROR;
+
+    todoindex index = {NULL, 0, 0};
+    if (todoIndexBuild(&index, list->head) != 0) {
+        fclose(file);
+        return TODO_NO_MEMORY;
+    }
+
+    todostatus status = TODO_OK;
+    char line[500], name[100], description[300];
+    int priority;
+    date due;
+
+    int first_line = 1;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int header = first_line && strstr(line, "TO-DO") != NULL;
+        first_line = 0;
+        if (header || strstr(line, "===") != NULL || strlen(line) < 5) {
+            continue;
+        }
+        if (todoParseTaskLine(line, name, description, &priority, &due) != TODO_OK) {
+            result->unparsed_lines++;
+            continue;
+        }
+        if (todoIndexFind(&index, name)) {
+            result->duplicates++;
+            continue;
+        }
+
+        int has_date = isValidDate(due.day, due.month, due.year);
+        if (!has_date) result->invalid_dates++;
+        if (priority < 1 || priority > 3) {
+            result->invalid_priorities++;
+            priority = 2;
+        }
+
+        task* added;
+        status = addTask(list, &index, name, description, priority, has_date ? &due : NULL, today, &added);
+        if (status == TODO_NO_MEMORY) break;
+        if (status == TODO_OK) {
+            result->imported++;
+            // An optional fifth field is a repeat rule, e.g. ",weekly mon,thu"
+            const char* rule_text = line;
+            for (int commas = 0; rule_text && commas < 4; commas++) {
+                rule_text = strchr(rule_text, ',');
+                if (rule_text) rule_text++;
+            }
+            recurrence rule;
+            int parsed = rule_text && has_date ? recurParse(rule_text, &rule) : -1;
+            if (parsed == 0) added->repeat = rule;
+            else if (parsed == -2) result->invalid_rules++;
+        } else {
+            result->unparsed_lines++;
+        }
+        status = TODO_OK;
+    }
+
+    if (status == TODO_OK && ferror(file)) status = TODO_IO_ERROR;
+    fclose(file);
+    todoIndexFree(&index);
+    return status;
+}
@@ -0,0 +1,162 @@
+#ifndef LIBTODO_H
+#define LIBTODO_H
+
+// Core task operations with no terminal I/O: functions take parameters and
+// return results or status codes, so they can be called in loops, from
+// batch mode and from benchmarks. The menu in main.c is a front end over it.
+// Build as a static library with make libtodo.a (Makefile, LIBTODO_OBJS), or:
+//   gcc -c libtodo.c pool.c feed.c reminder.c recurrence.c undo.c query.c views.c && ar rcs libtodo.a libtodo.o pool.o feed.o reminder.o recurrence.o undo.o query.o views.o
+// make check links a program against the whole archive to keep the list complete.
+//
+// Threads: todoMatches() may run on other threads while a single writer calls
+// todoAdd(), todoAddTag() or todoRefreshStatuses() on the same list - those
+// publish their changes with atomic stores. Unlinked tasks must not be freed
+// while readers may hold them (see epoch.h). Whole-list scans and index
+// builds of long lists run in chunks on the background pool (pool.h) and
+// return when every chunk is done. Changes are recorded in the change feed
+// when one is set (see feed.h); completing, undoing and deleting keep the
+// task's reminders in step (see reminder.h), and completing a recurring
+// task adds its next occurrence (see recurrence.h). todoBulk() applies one
+// action to every task matching a query in a single pass over the list.
+// Changes are also recorded in the undo log when one is set (see undo.h).
+
+#include "task_management.h"
+
+typedef enum {
+    TODO_OK = 0,
+    TODO_NOT_FOUND,
+    TODO_DUPLICATE,
+    TODO_INVALID_NAME,
+    TODO_INVALID_PRIORITY,
+    TODO_INVALID_DATE,
+    TODO_INVALID_TAG,
+    TODO_TAGS_FULL,
+    TODO_INVALID_REMINDER,
+    TODO_REMINDERS_FULL,
+    TODO_INVALID_RECURRENCE,
+    TODO_EMPTY,
+    TODO_PARSE_ERROR,
+    TODO_NO_MEMORY,
+    TODO_IO_ERROR
+} todostatus;
+
+// Active tasks by name (open addressing), for O(1) lookups and duplicate checks
+typedef struct {
+    task** slots;
+    int cap;
+    int used;
+} todoindex;
+
+// Task counts by state and priority
+typedef struct {
+    int pending;
+    int overdue;
+    int completed;
+    int high;
+    int medium;
+    int low;
+} todocounts;
+
+typedef enum {
+    TODO_MATCH_ALL,
+    TODO_MATCH_NAME,         // name contains text
+    TODO_MATCH_DESCRIPTION,  // description contains text
+    TODO_MATCH_KEYWORD,      // name, description or a tag contains text
+    TODO_MATCH_TAG,          // has the tag text
+    TODO_MATCH_PRIORITY,     // min_priority <= priority <= max_priority
+    TODO_MATCH_STATUS,       // status == status
+    TODO_MATCH_DUE_RANGE,    // from <= due date <= to
+    TODO_MATCH_NO_DUE_DATE,
+    TODO_MATCH_EXPRESSION    // program (see query.h) accepts it
+} todomatch;
+
+struct queryprogram;
+
+typedef struct {
+    todomatch type;
+    const char* text;
+    int min_priority;
+    int max_priority;
+    TaskStatus status;
+    date from;
+    date to;
+    const struct queryprogram* program;
+} todoquery;
+
+typedef struct {
+    int imported;
+    int duplicates;          // skipped, name already in the list
+    int invalid_dates;       // imported without a due date
+    int invalid_priorities;  // imported as Medium
+    int unparsed_lines;
+    int invalid_rules;       // imported without repeating
+} todoimportresult;
+
+// What todoBulk() does to each matching task
+typedef enum {
+    TODO_BULK_COMPLETE,
+    TODO_BULK_DELETE,
+    TODO_BULK_TAG,       // adds tag
+    TODO_BULK_UNTAG,     // removes tag
+    TODO_BULK_PRIORITY   // sets priority
+} todobulkaction;
+
+typedef struct {
+    todobulkaction action;
+    const char* tag;
+    int priority;
+} todobulk;
+
+typedef struct {
+    int matched;
+    int changed;   // matches the action changed (a tag already there is not a change)
+} todobulkresult;
+
+const char* todoStatusText(todostatus status);
+
+// Tasks
+todostatus todoCreateTask(const char* name, const char* description, int priority,
+                          const date* due, date today, task** out);
+task* todoFindTask(tasklist* list, const char* name);
+todostatus todoAdd(tasklist* list, todoindex* index, const char* name, const char* description,
+                   int priority, const date* due, date today, task** out);
+todostatus todoComplete(tasklist* list, completedstack* stack, todoindex* index,
+                        const char* name, date today, task** out);
+todostatus todoAddOccurrence(tasklist* list, todoindex* index, const task* t, date today, task** out);
+todostatus todoUndo(tasklist* list, completedstack* stack, todoindex* index, task** out);
+todostatus todoDelete(tasklist* list, todoindex* index, const char* name);
+todostatus todoAddTag(task* t, const char* tag);
+todostatus todoReplaceTag(task* t, int position, const char* tag);
+todostatus todoRemoveTag(task* t, const char* tag);
+int todoClearCompleted(completedstack* stack);
+
+// Dates and scheduling
+long todoDayNumber(date d);
+date todoDateFromDay(long day);
+int todoWeekday(date d);
+TaskStatus todoStatusForDate(const task* t, date today);
+int todoRefreshStatuses(task* head, date today);
+int todoAutoPriority(task* t, date today);
+int todoAutoPriorityAdjust(task* head, date today);
+
+// Counting and search
+void todoCount(task* head, completedstack* stack, date today, todocounts* counts);
+int todoMatches(const task* t, const todoquery* query);
+todostatus todoBulk(tasklist* list, completedstack* stack, todoindex* index, const todoquery* query,
+                    const todobulk* op, date today, todobulkresult* result);
+
+// Name index
+unsigned int todoNameHash(const char* name);
+int todoIndexBuild(todoindex* index, task* head);
+task* todoIndexFind(const todoindex* index, const char* name);
+int todoIndexInsert(todoindex* index, task* t);
+void todoIndexRemove(todoindex* index, const task* t);
+void todoIndexFree(todoindex* index);
+
+// Import
+todostatus todoParseTaskLine(const char* line, char* name, char* description,
+                             int* priority, date* due);
+todostatus todoImportFile(tasklist* list, const char* filename, date today,
+                          todoimportresult* result);
+
+#endif
@@ -5,12 +5,36 @@
 #include "task_management.h"
 #include "searchandstat.h"
 #include "fileio.h"
+#include "benchmark.h"
+#include "batch.h"
+#include "server.h"
+#include "cluster.h"
+#include "snapshot.h"
+#include "pool.h"
+#include "reminder.h"
+#include "undo.h"
+#include "feed.h"
+#include "plan.h"
+#include "views.h"
+#include "rank.h"
 
 tasklist tasks = {NULL};
 completedstack doneStack = {NULL};
 
 date currentDate;
 
+// Undo/redo history of the interactive session (options 5 and 20)
+undolog history;
+
+// Changes of the interactive session, so the query planner's and ranked
+// search's indexes are rebuilt only after something changed
+changefeed changes;
+planindex planner;
+rankindex ranking;
+
+// Saved searches kept current as tasks change (option 21)
+viewset saved;
+
 void pause() {
     printf("\nPress Enter to continue...");
     getchar();
@@ -35,6 +59,50 @@ int checkForLoops(tasklist* list) {
     return 0;  // No loops found
 }
 
+// Asks for an expression and shows the plan for it, timed against a scan;
+// today is the session date due<today and overdue compare with
+static void explainQuery(date today) {
+    char expression[QUERY_TEXT_MAX];
+    char error[80];
+    queryprogram program;
+
+    printf("Query to explain (Enter to skip): ");
+    if (fgets(expression, sizeof(expression), stdin) == NULL) return;
+    expression[strcspn(expression, "\n")] = 0;
+    if (!expression[0]) return;
+    if (queryCompile(expression, today, 0, &program, error, sizeof(error)) != TODO_OK) {
+        printf("Invalid expression: %s.\n", error);
+        return;
+    }
+    double start = benchNow();
+    int rebuilt = planRefresh(&planner, &tasks, &doneStack);
+    double build = benchNow() - start;
+    int* rows = (int*)malloc(sizeof(int) * (planner.count ? planner.count : 1));
+    if (rebuilt < 0 || !rows) {
+        printf("Memory allocation failed.\n");
+        free(rows);
+        return;
+    }
+
+    queryplan plan;
+    char text[4096];
+    start = benchNow();
+    planQuery(&planner, &program, &plan);
+    planExecute(&planner, &plan, &program, rows, planner.count);
+    double planned = benchNow() - start;
+    planExplain(&planner, &plan, &program, text, sizeof(text));
+    printf("%s", text);
+
+    long scanned = 0;
+    start = benchNow();
+    for (long i = 0; i < planner.count; i++) scanned += queryRun(&program, planner.rows[i]);
+    double scan = benchNow() - start;
+    printf("  planned %.3f ms, scan %.3f ms (%ld matches)%s\n", planned * 1000, scan * 1000, scanned,
+           rebuilt ? "" : ", indexes were current");
+    if (rebuilt) printf("  indexes rebuilt first in %.3f ms\n", build * 1000);
+    free(rows);
+}
+
 void debugTaskList() {
     printf("\n=== Debugging Task List ===\n");
     
@@ -94,6 +162,28 @@ void debugTaskList() {
     } else {
         printf("Completed task count: %d\n", count);
     }
+
+    // Background pool load, for choosing TODOLIST_POOL_WORKERS
+    taskpool* pool = poolDefaultIfStarted();
+    if (pool) poolPrintStats(pool);
+    else printf("Background pool: not started\n");
+
+    // Undo log use, for choosing TODOLIST_UNDO_BYTES
+    printf("Undo log: %ld to undo, %ld to redo, %zu of %zu bytes, %lld evicted\n",
+           history.undo_count, history.redo_count, history.bytes, history.budget, history.evicted);
+
+    // Expression searches and the plans chosen for them
+    planlogentry recent[PLAN_LOG_SIZE];
+    int logged = planLogRead(recent, PLAN_LOG_SIZE);
+    printf("Query planner: %ld tasks indexed in %.2f ms%s\n", planner.count, planner.build_ms,
+           planner.built ? "" : " (not built yet)");
+    for (int i = 0; i < logged; i++) {
+        printf("  %8.3f ms  %5ld matches  %-32s  %s", recent[i].ms, recent[i].matches, recent[i].summary,
+               recent[i].expression);
+        if (recent[i].build_ms > 0) printf("  (indexes rebuilt first: %.2f ms)", recent[i].build_ms);
+        printf("\n");
+    }
+    explainQuery(currentDate);
     
     printf("=== End Debugging ===\n\n");
 }
@@ -104,7 +194,7 @@ void displayMenu() {
     printf("2. View Tasks (Standard/Simplified/By Tag)\n");
     printf("3. Edit Task\n");
     printf("4. Mark Task as Completed\n");
-    printf("5. Undo Last Completed Task\n");
+    printf("5. Undo Last Change\n");
     printf("6. Delete Task\n");
     printf("7. Search Tasks\n");
     printf("8. View Statistics (All/Week/Month)\n");
@@ -115,17 +205,104 @@ void displayMenu() {
     printf("13. Simulate Day Change\n");
     printf("14. Time Period Summary (Week/Month)\n");
     printf("15. Add Tag to Task\n");
+    printf("17. Export Archive File\n");
+    printf("18. Set Reminder\n");
+    printf("19. Bulk Actions (Complete/Delete/Tag/Priority)\n");
+    printf("20. Redo Last Undone Change\n");
+    printf("21. Saved Views (Searches Kept Up to Date)\n");
     printf("0. Exit\n");
     printf("Select an option: ");
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
     int choice;
 
+    // todolist --batch [file]: run commands without the menu (stdin if no file)
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        int result = runBatch(&tasks, &doneStack, argc >= 3 ? argv[2] : NULL);
+        poolShutdownDefault();
+        freeTasks(&tasks);
+        freeStack(&doneStack);
+        return result;
+    }
+
+    // todolist --serve [socket]: own the list and answer clients on a Unix socket
+    if (argc >= 2 && strcmp(argv[1], "--serve") == 0) {
+        int result = runServer(&tasks, &doneStack, argc >= 3 ? argv[2] : SERVER_DEFAULT_SOCKET);
+        poolShutdownDefault();
+        freeTasks(&tasks);
+        freeStack(&doneStack);
+        return result;
+    }
+
+    // todolist --follow primary-socket [socket]: read-only copy of a --serve process
+    if (argc >= 2 && strcmp(argv[1], "--follow") == 0) {
+        if (argc < 3) {
+            printf("Usage: todolist --follow primary-socket [socket]\n");
+            return 1;
+        }
+        int result = runFollower(&tasks, &doneStack, argv[2], argc >= 4 ? argv[3] : SERVER_DEFAULT_SOCKET);
+        poolShutdownDefault();
+        freeTasks(&tasks);
+        freeStack(&doneStack);
+        return result;
+    }
+
+    // todolist --snapshot /name [stats|query|find name]: read what a server published
+    if (argc >= 2 && strcmp(argv[1], "--snapshot") == 0) {
+        if (argc < 3) {
+            printf("Usage: todolist --snapshot /name [stats|query|find name]\n");
+            return 1;
+        }
+        return runSnapshotReader(argv[2], argc >= 4 ? argv[3] : "stats", argc >= 5 ? argv[4] : NULL);
+    }
+
+    // todolist --router socket node-socket...: one list spread over --serve nodes
+    if (argc >= 2 && strcmp(argv[1], "--router") == 0) {
+        if (argc < 4) {
+            printf("Usage: todolist --router socket node-socket...\n");
+            return 1;
+        }
+        return runRouter(argv[2], (const char* const*)argv + 3, argc - 3);
+    }
+
+    // todolist --cluster [socket] [nodes]: start local nodes and a router in front
+    if (argc >= 2 && strcmp(argv[1], "--cluster") == 0) {
+        int nodes = argc >= 4 ? atoi(argv[3]) : 3;
+        return runCluster(argc >= 3 ? argv[2] : SERVER_DEFAULT_SOCKET, nodes);
+    }
+
+    // todolist --loadgen [socket] [requests]: measure a running server
+    if (argc >= 2 && strcmp(argv[1], "--loadgen") == 0) {
+        int requests = argc >= 4 ? atoi(argv[3]) : 20000;
+        return runLoadGenerator(argc >= 3 ? argv[2] : SERVER_DEFAULT_SOCKET, requests > 0 ? requests : 20000);
+    }
+
     currentDate = getToday();
 
+    // History for undo/redo, capped at TODOLIST_UNDO_BYTES (default 1 MB)
+    const char* undo_bytes = getenv("TODOLIST_UNDO_BYTES");
+    long budget = undo_bytes ? atol(undo_bytes) : 0;
+    undoInit(&history, budget > 0 ? (size_t)budget : UNDO_DEFAULT_BUDGET);
+    undoSetDefault(&history);
+
+    // The change feed tells the query planner and ranked search when to
+    // rebuild their indexes
+    planInit(&planner);
+    if (feedInit(&changes, 0) == 0) feedSetDefault(&changes);
+    planSetDefault(&planner);
+    rankInit(&ranking);
+    rankSetDefault(&ranking);
+
+    // Saved views follow every change from here on
+    viewsInit(&saved, currentDate);
+    viewsLoad(&saved, VIEWS_DEFAULT_FILE, &tasks, &doneStack);
+    viewsSetDefault(&saved);
+
     while (1) {
+        reportBackgroundExport();
+        checkReminders(tasks.head, currentDate);
         displayMenu();
         scanf("%d", &choice);
         getchar(); // flush newline
@@ -136,7 +313,7 @@ int main() {
                 pause();
                 break;
             case 2: 
-                view_combined(&tasks, currentDate);  // Combined view function
+                view_combined(&tasks, &doneStack, currentDate);  // Combined view function
                 pause();
                 break;
             case 3: {
@@ -144,7 +321,7 @@ int main() {
                 printf("Enter task name to edit: ");
                 fgets(name, sizeof(name), stdin);
                 name[strcspn(name, "\n")] = 0;
-                edit(&tasks, name);
+                edit(&tasks, name, currentDate);
                 pause();
                 break;
             }
@@ -153,12 +330,12 @@ int main() {
                 printf("Enter task name to complete: ");
                 fgets(name, sizeof(name), stdin);
                 name[strcspn(name, "\n")] = 0;
-                complete(&tasks, &doneStack, name);
+                complete(&tasks, &doneStack, name, currentDate);
                 pause();
                 break;
             }
             case 5:
-                undoCompleted(&tasks, &doneStack);
+                undoLastChange(&tasks, &doneStack, currentDate);
                 pause();
                 break;
             case 6: {
@@ -171,7 +348,7 @@ int main() {
                 break;
             }
             case 7: {
-                searchTasks(tasks.head, &doneStack, NULL);  // Pass NULL as keyword
+                searchTasks(tasks.head, &doneStack, NULL, currentDate);  // Pass NULL as keyword
                 pause();
                 break;
             }
@@ -206,8 +383,16 @@ int main() {
                 if (strlen(filename) == 0) {
                     strcpy(filename, "tasks_export.txt");
                 }
+
+                char buffer[32];
+                int backups = 0;
+                printf("Keep how many previous exports as %s.1, .2, ... (default: 0): ", filename);
+                if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
+                    sscanf(buffer, "%d", &backups);
+                }
+                setExportBackups(backups);
                 
-                exportTasksTxt(tasks.head, &doneStack, filename);
+                exportTasksBackground(tasks.head, &doneStack, filename);
                 pause();
                 break;
             }
@@ -217,6 +402,8 @@ int main() {
                 break;
             case 13:
                 simulateDayChange(tasks.head, &currentDate);
+                // Views naming "today" are rescanned for the new day
+                viewsRefresh(&saved, &tasks, &doneStack, currentDate);
                 pause();
                 break;
             case 14:
@@ -233,12 +420,80 @@ int main() {
                 break;
             }
             
+            case 16:  // Hidden performance analysis
+                runPerformanceAnalysis();
+                pause();
+                break;
+            case 17: {
+                char archive[100], filename[100], buffer[32];
+                printf("Enter archive file to export (default: tasks_archive.txt): ");
+                fgets(archive, sizeof(archive), stdin);
+                archive[strcspn(archive, "\n")] = 0;
+                if (strlen(archive) == 0) {
+                    strcpy(archive, "tasks_archive.txt");
+                }
+
+                printf("Enter filename for export (default: archive_export.txt): ");
+                fgets(filename, sizeof(filename), stdin);
+                filename[strcspn(filename, "\n")] = 0;
+                if (strlen(filename) == 0) {
+                    strcpy(filename, "archive_export.txt");
+                }
+
+                int memory_mb = 256;
+                printf("Memory limit in MB (default: 256): ");
+                if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
+                    int value;
+                    if (sscanf(buffer, "%d", &value) == 1 && value > 0) {
+                        memory_mb = value;
+                    }
+                }
+
+                exportArchiveTxt(archive, filename, (size_t)memory_mb * 1024 * 1024);
+                pause();
+                break;
+            }
+            case 18: {
+                char name[100];
+                printf("Enter task name to set a reminder: ");
+                fgets(name, sizeof(name), stdin);
+                name[strcspn(name, "\n")] = 0;
+                add_reminder_to_task(&tasks, name, currentDate);
+                pause();
+                break;
+            }
+            case 19:
+                bulkTasks(&tasks, &doneStack, currentDate);
+                pause();
+                break;
+            case 20:
+                redoLastChange(&tasks, &doneStack, currentDate);
+                pause();
+                break;
+            case 21:
+                savedViews(&tasks, &doneStack, currentDate);
+                pause();
+                break;
             case 99:  // Hidden debug option
                 debugTaskList();
                 pause();
                 break;
             case 0:
                 printf("Exiting...\n");
+                finishBackgroundExport();
+                poolShutdownDefault();
+                undoSetDefault(NULL);
+                undoFree(&history);
+                planSetDefault(NULL);
+                planFree(&planner);
+                rankSetDefault(NULL);
+                rankFree(&ranking);
+                viewsSetDefault(NULL);
+                viewsFree(&saved);
+                if (feedDefault() == &changes) {
+                    feedSetDefault(NULL);
+                    feedFree(&changes);
+                }
                 freeTasks(&tasks);
                 freeStack(&doneStack);
                 exit(0);
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+// POSIX only promises 16 iovecs per writev() call (_XOPEN_IOV_MAX)
+#define WRITE_BLOCKS_MAX 16
+#include "outbuf.h"
+
+
+/*
+outbufInit() - Allocates an output buffer for a file descriptor
+ - Time: O(1), Space: O(cap)
+ - Example: outbufInit(&buf, fd, OUTBUF_DEFAULT_SIZE) -> 0 on success, -1 on failure
+ */
+int outbufInit(outbuf* b, int fd, size_t cap) {
+    if (cap < 1024) cap = 1024;
+    b->data = (char*)malloc(cap);
+    b->len = 0;
+    b->cap = b->data ? cap : 0;
+    b->fd = fd;
+    b->error = 0;
+    return b->data ? 0 : -1;
+}
+
+/*
+outbufFree() - Releases the buffer memory (does not flush or close fd)
+ - Time: O(1), Space: O(1)
+ */
+void outbufFree(outbuf* b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+}
+
+/*
+writeAll() - Writes the whole block, retrying on partial writes and EINTR
+ - Time: O(n), Space: O(1)
+ - Example: writeAll(fd, "abc", 3) -> 0 (all bytes written), -1 on error
+ */
+int writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        long written = (long)write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+/*
+writeBlocks() - Writes the contents of several buffers in order with writev()
+ - Time: O(total bytes), Space: O(count)
+ - Buffers are written as-is (their fd is ignored) and emptied afterwards
+ - Example: writeBlocks(fd, chunks, 3) -> chunk 0, 1, 2 bytes in one syscall
+ */
+int writeBlocks(int fd, outbuf* blocks[], int count) {
+#ifdef _WIN32
+    for (int i = 0; i < count; i++) {
+        if (writeAll(fd, blocks[i]->data, blocks[i]->len) != 0) return -1;
+        blocks[i]->len = 0;
+    }
+    return 0;
+#else
+    struct iovec iov[WRITE_BLOCKS_MAX];
+    int i = 0;
+
+    while (i < count) {
+        int n = 0;
+        while (i + n < count && n < WRITE_BLOCKS_MAX) {
+            iov[n].iov_base = blocks[i + n]->data;
+            iov[n].iov_len = blocks[i + n]->len;
+            n++;
+        }
+
+        // writev may stop part way through; skip what was written and retry
+        struct iovec* pending = iov;
+        int left = n;
+        while (left > 0) {
+            ssize_t written = writev(fd, pending, left);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            while (left > 0 && (size_t)written >= pending->iov_len) {
+                written -= (ssize_t)pending->iov_len;
+                pending++;
+                left--;
+            }
+            if (left > 0) {
+                pending->iov_base = (char*)pending->iov_base + written;
+                pending->iov_len -= (size_t)written;
+            }
+        }
+
+        for (int j = 0; j < n; j++) blocks[i + j]->len = 0;
+        i += n;
+    }
+    return 0;
+#endif
+}
+
+/*
+outbufFlush() - Writes buffered bytes to the file descriptor
+ - Time: O(n), Space: O(1)
+ - Example: outbufFlush(&buf) -> one write() call for the whole buffer
+ */
+int outbufFlush(outbuf* b) {
+    if (b->fd < 0 || b->len == 0) return b->error ? -1 : 0;
+
+    if (writeAll(b->fd, b->data, b->len) != 0) {
+        b->error = 1;
+    }
+    b->len = 0;
+    return b->error ? -1 : 0;
+}
+
+/*
+outbufReserve() - Makes room for n more bytes and returns the write position
+ - Time: O(1) amortized, Space: O(1)
+ - Flushes to the fd when full; memory-only buffers grow by doubling instead.
+   The caller advances b->len by the bytes it actually used.
+ */
+char* outbufReserve(outbuf* b, size_t n) {
+    if (b->len + n <= b->cap) return b->data + b->len;
+
+    if (b->fd >= 0) {
+        outbufFlush(b);
+        if (n <= b->cap) return b->data;
+    }
+
+    size_t new_cap = b->cap ? b->cap : 1024;
+    while (new_cap < b->len + n) new_cap *= 2;
+    char* grown = (char*)realloc(b->data, new_cap);
+    if (!grown) {
+        b->error = 1;
+        return NULL;
+    }
+    b->data = grown;
+    b->cap = new_cap;
+    return b->data + b->len;
+}
+
+/*
+outbufPut() - Appends n raw bytes
+ - Time: O(n), Space: O(1)
+ */
+void outbufPut(outbuf* b, const char* s, size_t n) {
+    char* p = outbufReserve(b, n);
+    if (!p) return;
+    memcpy(p, s, n);
+    b->len += n;
+}
+
+/*
+outbufPuts() - Appends a NUL-terminated string
+ - Time: O(n), Space: O(1)
+ */
+void outbufPuts(outbuf* b, const char* s) {
+    outbufPut(b, s, strlen(s));
+}
+
+/*
+outbufPutPadded() - Appends a left-justified string, same as printf("%-*s")
+ - Time: O(n), Space: O(1)
+ - Example: outbufPutPadded(&buf, "High", 10) -> "High      "
+ */
+void outbufPutPadded(outbuf* b, const char* s, int width) {
+    size_t n = strlen(s);
+    size_t pad = (width > 0 && (size_t)width > n) ? (size_t)width - n : 0;
+    char* p = outbufReserve(b, n + pad);
+    if (!p) return;
+    memcpy(p, s, n);
+    memset(p + n, ' ', pad);
+    b->len += n + pad;
+}
+
+// Writes the digits of v (v >= 0) right-aligned to end, returns start pointer
+static char* formatDigits(char* end, unsigned long v) {
+    do {
+        *--end = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    return end;
+}
+
+/*
+outbufPutInt() - Appends a left-justified integer, same as printf("%-*d")
+ - Time: O(digits), Space: O(1)
+ - Example: outbufPutInt(&buf, 7, 3) -> "7  "
+ */
+void outbufPutInt(outbuf* b, long value, int width) {
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    unsigned long mag = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    char* start = formatDigits(end, mag);
+    if (value < 0) *--start = '-';
+
+    size_t n = (size_t)(end - start);
+    size_t pad = (width > 0 && (size_t)width > n) ? (size_t)width - n : 0;
+    char* p = outbufReserve(b, n + pad);
+    if (!p) return;
+    memcpy(p, start, n);
+    memset(p + n, ' ', pad);
+    b->len += n + pad;
+}
+
+/*
+outbufPutZeroPadded() - Appends an integer padded with zeros, same as printf("%0*d")
+ - Time: O(digits), Space: O(1)
+ - Example: outbufPutZeroPadded(&buf, 5, 2) -> "05"
+ */
+void outbufPutZeroPadded(outbuf* b, long value, int digits) {
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    unsigned long mag = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    char* start = formatDigits(end, mag);
+
+    // printf counts the sign as part of the field width
+    int width = value < 0 ? digits - 1 : digits;
+    if (width > 20) width = 20;
+    while (end - start < width) *--start = '0';
+    if (value < 0) *--start = '-';
+
+    outbufPut(b, start, (size_t)(end - start));
+}
+
+/*
+outbufPutDate() - Appends a date as DD/MM/YYYY
+ - Time: O(1), Space: O(1)
+ - Example: outbufPutDate(&buf, {2, 5, 2025}) -> "02/05/2025"
+ */
+void outbufPutDate(outbuf* b, date d) {
+    // Fast path for ordinary dates, no division loop needed
+    if (d.day >= 0 && d.day < 100 && d.month >= 0 && d.month < 100 &&
+        d.year >= 0 && d.year < 10000) {
+        char* p = outbufReserve(b, 10);
+        if (!p) return;
+        p[0] = (char)('0' + d.day / 10);
+        p[1] = (char)('0' + d.day % 10);
+        p[2] = '/';
+        p[3] = (char)('0' + d.month / 10);
+        p[4] = (char)('0' + d.month % 10);
+        p[5] = '/';
+        p[6] = (char)('0' + d.year / 1000);
+        p[7] = (char)('0' + d.year / 100 % 10);
+        p[8] = (char)('0' + d.year / 10 % 10);
+        p[9] = (char)('0' + d.year % 10);
+        b->len += 10;
+        return;
+    }
+
+    outbufPutZeroPadded(b, d.day, 2);
+    outbufPut(b, "/", 1);
+    outbufPutZeroPadded(b, d.month, 2);
+    outbufPut(b, "/", 1);
+    outbufPutZeroPadded(b, d.year, 4);
+}
@@ -0,0 +1,35 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+#include "scheduler.h"
+
+// Default size of an output buffer (flushed with one write() when full)
+#define OUTBUF_DEFAULT_SIZE (256 * 1024)
+
+// Output buffer: collects formatted text and writes it out in large blocks.
+// fd < 0 means memory only - the buffer grows instead of flushing.
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+    int fd;
+    int error;  // set when a write() fails
+} outbuf;
+
+int outbufInit(outbuf* b, int fd, size_t cap);
+void outbufFree(outbuf* b);
+int outbufFlush(outbuf* b);
+char* outbufReserve(outbuf* b, size_t n);
+
+void outbufPut(outbuf* b, const char* s, size_t n);
+void outbufPuts(outbuf* b, const char* s);
+void outbufPutPadded(outbuf* b, const char* s, int width);
+void outbufPutInt(outbuf* b, long value, int width);
+void outbufPutZeroPadded(outbuf* b, long value, int digits);
+void outbufPutDate(outbuf* b, date d);
+
+int writeAll(int fd, const char* data, size_t len);
+int writeBlocks(int fd, outbuf* blocks[], int count);
+
+#endif
@@ -0,0 +1,964 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+#include "plan.h"
+#include "feed.h"
+
+// Cost model, in units of one queryRun() on a task
+#define PLAN_ROW_COST 1.0          // rechecking a candidate (or scanning a task)
+#define PLAN_POSTING_COST 0.05     // reading one posting while intersecting
+#define PLAN_SORT_COST 0.01        // per posting per halving, sorting a due range by row
+#define PLAN_MONTHS_MAX (12 * 200) // wider spreads of due dates get no histogram
+
+#define PLAN_TAG_TERMS 32          // tags ANDed side by side in a tag expression
+
+struct plantag {
+    char name[MAX_TAG_LENGTH];     // "" for an empty slot
+    bitmap rows;
+};
+
+struct plangram {
+    unsigned int key;              // trigram | 1 << 24; 0 for an empty slot
+    int* rows;
+    long count, capacity;
+};
+
+static planindex* default_planner = NULL;
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static planlogentry query_log[PLAN_LOG_SIZE];
+static long logged = 0;
+
+static double planNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Month number of a date key (year * 12 + month - 1)
+static long keyMonth(long key) {
+    return key / 512 * 12 + (key / 32 % 16) - 1;
+}
+
+// Halvings from x down to 1, for the log factors of the cost model
+static int halvings(double x) {
+    int n = 0;
+    for (; x > 1; x /= 2) n++;
+    return n;
+}
+
+static unsigned int hashText(const char* text) {
+    unsigned int hash = 2166136261u;
+    for (; *text; text++) hash = (hash ^ (unsigned char)*text) * 16777619u;
+    return hash;
+}
+
+// Appends row to a posting list unless it already ends with it
+static int appendRow(int** rows, long* count, long* capacity, int row) {
+    if (*count && (*rows)[*count - 1] == row) return 0;
+    if (*count == *capacity) {
+        long grown = *capacity ? *capacity * 2 : 4;
+        int* bigger = (int*)realloc(*rows, sizeof(int) * grown);
+        if (!bigger) return -1;
+        *rows = bigger;
+        *capacity = grown;
+    }
+    (*rows)[(*count)++] = row;
+    return 0;
+}
+
+static plantag* findTag(const planindex* set, const char* name) {
+    if (!set->tag_slots) return NULL;
+    unsigned int mask = (unsigned int)set->tag_slots - 1;
+    for (unsigned int i = hashText(name) & mask;; i = (i + 1) & mask) {
+        plantag* slot = &set->tags[i];
+        if (!slot->name[0]) return NULL;
+        if (strcmp(slot->name, name) == 0) return slot;
+    }
+}
+
+static plangram* findGram(const planindex* set, unsigned int key) {
+    if (!set->gram_slots) return NULL;
+    unsigned long mask = (unsigned long)set->gram_slots - 1;
+    for (unsigned long i = (key * 2654435761u) & mask;; i = (i + 1) & mask) {
+        plangram* slot = &set->grams[i];
+        if (!slot->key) return NULL;
+        if (slot->key == key) return slot;
+    }
+}
+
+// Doubles the tag table
+static int growTags(planindex* set) {
+    int slots = set->tag_slots ? set->tag_slots * 2 : 64;
+    plantag* old = set->tags;
+    int old_slots = set->tag_slots;
+    set->tags = (plantag*)calloc((size_t)slots, sizeof(plantag));
+    if (!set->tags) {
+        set->tags = old;
+        return -1;
+    }
+    set->tag_slots = slots;
+    for (int i = 0; i < old_slots; i++) {
+        if (!old[i].name[0]) continue;
+        unsigned int mask = (unsigned int)slots - 1;
+        unsigned int j = hashText(old[i].name) & mask;
+        while (set->tags[j].name[0]) j = (j + 1) & mask;
+        set->tags[j] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+// Doubles the trigram table
+static int growGrams(planindex* set) {
+    long slots = set->gram_slots ? set->gram_slots * 2 : 1024;
+    plangram* old = set->grams;
+    long old_slots = set->gram_slots;
+    set->grams = (plangram*)calloc((size_t)slots, sizeof(plangram));
+    if (!set->grams) {
+        set->grams = old;
+        return -1;
+    }
+    set->gram_slots = slots;
+    for (long i = 0; i < old_slots; i++) {
+        if (!old[i].key) continue;
+        unsigned long mask = (unsigned long)slots - 1;
+        unsigned long j = (old[i].key * 2654435761u) & mask;
+        while (set->grams[j].key) j = (j + 1) & mask;
+        set->grams[j] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+static int addTag(planindex* set, const char* name, int row) {
+    plantag* slot = findTag(set, name);
+    if (!slot) {
+        if ((set->tag_count + 1) * 2 > set->tag_slots && growTags(set) != 0) return -1;
+        unsigned int mask = (unsigned int)set->tag_slots - 1;
+        unsigned int i = hashText(name) & mask;
+        while (set->tags[i].name[0]) i = (i + 1) & mask;
+        slot = &set->tags[i];
+        strncpy(slot->name, name, MAX_TAG_LENGTH - 1);
+        set->tag_count++;
+    }
+    return bitmapAdd(&slot->rows, (unsigned int)row);
+}
+
+// Adds row under every trigram of text
+static int addGrams(planindex* set, const char* text, int row) {
+    size_t length = strlen(text);
+    for (size_t i = 0; i + 3 <= length; i++) {
+        unsigned int key = ((unsigned char)text[i] << 16 | (unsigned char)text[i + 1] << 8 |
+                            (unsigned char)text[i + 2]) | 1u << 24;
+        plangram* slot = findGram(set, key);
+        if (!slot) {
+            if ((set->gram_count + 1) * 2 > set->gram_slots && growGrams(set) != 0) return -1;
+            unsigned long mask = (unsigned long)set->gram_slots - 1;
+            unsigned long j = (key * 2654435761u) & mask;
+            while (set->grams[j].key) j = (j + 1) & mask;
+            slot = &set->grams[j];
+            slot->key = key;
+            set->gram_count++;
+        }
+        long before = slot->count;
+        if (appendRow(&slot->rows, &slot->count, &slot->capacity, row) != 0) return -1;
+        set->postings += slot->count - before;
+    }
+    return 0;
+}
+
+static int compareDue(const void* a, const void* b) {
+    const plandue* x = (const plandue*)a;
+    const plandue* y = (const plandue*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->row - y->row;
+}
+
+static int compareRows(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+/*
+planInit() - Makes an empty index set
+ - Time: O(1), Space: O(1)
+ - Example: planindex set; planInit(&set); planBuild(&set, &list, &stack);
+ */
+void planInit(planindex* set) {
+    memset(set, 0, sizeof(*set));
+}
+
+/*
+planFree() - Frees the indexes (the tasks are not touched) and empties the set
+ - Time: O(tags + trigrams), Space: O(1)
+ */
+void planFree(planindex* set) {
+    for (int i = 0; i < set->tag_slots; i++) bitmapFree(&set->tags[i].rows);
+    for (long i = 0; i < set->gram_slots; i++) free(set->grams[i].rows);
+    free(set->tags);
+    free(set->grams);
+    free(set->rows);
+    free(set->due);
+    free(set->no_due);
+    free(set->month_counts);
+    planInit(set);
+}
+
+/*
+planSetDefault() - Sets the index set searchTasks() plans expressions with (NULL: none)
+ - Time: O(1), Space: O(1)
+ */
+void planSetDefault(planindex* set) {
+    __atomic_store_n(&default_planner, set, __ATOMIC_RELEASE);
+}
+
+/*
+planDefault() - The index set searchTasks() plans with, or NULL
+ - Time: O(1), Space: O(1)
+ */
+planindex* planDefault() {
+    return __atomic_load_n(&default_planner, __ATOMIC_ACQUIRE);
+}
+
+/*
+planBuild() - Indexes every task of the list and the completed stack
+ - Time: O(n * text length) for the trigrams plus O(d log d) to sort the
+   d due dates, Space: O(n * distinct trigrams per task)
+ - Rows are the list in order, then the stack from the top, the order
+   searchTasks() prints them in
+ - Returns 0, or -1 if out of memory (the set is left empty)
+ - Example: planBuild(&set, &list, &stack) -> set.count == tasks + completed
+ */
+int planBuild(planindex* set, tasklist* list, completedstack* stack) {
+    double start = planNowMs();
+    changefeed* feed = feedDefault();
+    unsigned long built_at = feed ? feedHead(feed) : 0;
+    planFree(set);
+
+    long count = 0;
+    for (task* t = list->head; t; t = t->next) count++;
+    long active = count;
+    for (stacknode* node = stack->top; node; node = node->next) count += node->task_data != NULL;
+
+    set->rows = (task**)malloc(sizeof(task*) * (count ? count : 1));
+    set->due = (plandue*)malloc(sizeof(plandue) * (count ? count : 1));
+    if (!set->rows || !set->due) goto failed;
+    for (task* t = list->head; t; t = t->next) set->rows[set->count++] = t;
+    for (stacknode* node = stack->top; node; node = node->next) {
+        if (node->task_data) set->rows[set->count++] = node->task_data;
+    }
+    set->active = active;
+
+    long no_due_capacity = 0;
+    for (long row = 0; row < count; row++) {
+        task* t = set->rows[row];
+        set->priority_counts[t->priority >= 1 && t->priority <= 3 ? t->priority : 0]++;
+        if ((unsigned)t->status < 3) set->status_counts[t->status]++;
+
+        int tag_count = __atomic_load_n(&t->tag_count, __ATOMIC_ACQUIRE);
+        for (int i = 0; i < tag_count; i++) {
+            if (t->tags[i][0] && addTag(set, t->tags[i], (int)row) != 0) goto failed;
+            if (addGrams(set, t->tags[i], (int)row) != 0) goto failed;
+        }
+        if (addGrams(set, t->name, (int)row) != 0 || addGrams(set, t->description, (int)row) != 0) {
+            goto failed;
+        }
+        if (t->due_date_set) {
+            set->due[set->due_count++] = (plandue){queryDateKey(t->duedate), (int)row};
+        } else if (appendRow(&set->no_due, &set->no_due_count, &no_due_capacity, (int)row) != 0) {
+            goto failed;
+        }
+    }
+    qsort(set->due, (size_t)set->due_count, sizeof(plandue), compareDue);
+
+    // Due dates by month, for estimating ranges without searching them
+    if (set->due_count) {
+        long first = keyMonth(set->due[0].key);
+        long months = keyMonth(set->due[set->due_count - 1].key) - first + 1;
+        if (months <= PLAN_MONTHS_MAX) {
+            set->month_counts = (long*)calloc((size_t)months, sizeof(long));
+            if (!set->month_counts) goto failed;
+            set->month_base = first;
+            set->months = (int)months;
+            for (long i = 0; i < set->due_count; i++) set->month_counts[keyMonth(set->due[i].key) - first]++;
+        }
+    }
+
+    set->built_at = built_at;
+    set->built = 1;
+    set->build_ms = planNowMs() - start;
+    return 0;
+
+failed:
+    planFree(set);
+    return -1;
+}
+
+/*
+planRefresh() - Rebuilds the set if a change was recorded since it was built
+ - Time: O(1) when current, else that of planBuild()
+ - With no change feed set there is no way to tell, so it always rebuilds
+ - Returns 1 if it rebuilt, 0 if the set was current, -1 if out of memory
+ - Example: planRefresh(&set, &list, &stack) -> 0 after a search, 1 after an edit
+ */
+int planRefresh(planindex* set, tasklist* list, completedstack* stack) {
+    changefeed* feed = feedDefault();
+    if (set->built && feed && feedHead(feed) == set->built_at) return 0;
+    return planBuild(set, list, stack) == 0 ? 1 : -1;
+}
+
+// Whether ACCEPT can be reached from pc without passing instruction skip
+static int reachesAccept(const queryprogram* program, int pc, int skip, unsigned char* seen) {
+    if (pc == QUERY_ACCEPT) return 1;
+    if (pc < 0 || pc == skip || seen[pc]) return 0;
+    seen[pc] = 1;
+    const queryinsn* insn = &program->code[pc];
+    return reachesAccept(program, insn->on_true, skip, seen) ||
+           reachesAccept(program, insn->on_false, skip, seen);
+}
+
+// Whether every task the program accepts passes instruction i, so the
+// rows failing it can be left out before running the program
+static int isNecessary(const queryprogram* program, int i) {
+    unsigned char seen[QUERY_MAX_TERMS];
+    memset(seen, 0, sizeof(seen));
+    if (reachesAccept(program, program->entry, i, seen)) return 0;
+    memset(seen, 0, sizeof(seen));
+    return !reachesAccept(program, program->code[i].on_false, QUERY_REJECT, seen);
+}
+
+// Rows with a due date in [low, high], from the month histogram (days of a
+// partly covered month counted pro rata)
+static long estimateDue(const planindex* set, long low, long high) {
+    if (!set->due_count || low > high) return 0;
+    if (!set->months) return set->due_count / 2;
+    long first = 0, last = set->months - 1;
+    int first_day = 1, last_day = 31;
+    if (low > 1) {
+        first = keyMonth(low) - set->month_base;
+        first_day = (int)(low % 32);
+        if (first < 0) first = 0, first_day = 1;
+    }
+    if (high != LONG_MAX) {
+        last = keyMonth(high) - set->month_base;
+        last_day = (int)(high % 32);
+        if (last >= set->months) last = set->months - 1, last_day = 31;
+    }
+    double rows = 0;
+    for (long m = first; m <= last; m++) {
+        int from = m == first ? first_day : 1;
+        int to = m == last ? last_day : 31;
+        if (to >= from) rows += set->month_counts[m] * (to - from + 1) / 31.0;
+    }
+    return (long)(rows + 0.5);
+}
+
+static unsigned int gramKey(const char* text) {
+    return ((unsigned char)text[0] << 16 | (unsigned char)text[1] << 8 | (unsigned char)text[2]) | 1u << 24;
+}
+
+// Fills in the estimate and cost of a probe for instruction step->insn
+static void estimateStep(const planindex* set, const queryinsn* insn, planstep* step) {
+    int log_rows = halvings((double)set->count + 2);
+    step->estimate = 0;
+    step->cost = 0;
+    if (step->probe == PLAN_TAG) {
+        plantag* tag = findTag(set, insn->text);
+        step->estimate = tag ? bitmapCardinality(&tag->rows) : 0;
+        step->cost = log_rows + step->estimate * PLAN_POSTING_COST;
+    } else if (step->probe == PLAN_NO_DUE) {
+        step->estimate = set->no_due_count;
+        step->cost = step->estimate * PLAN_POSTING_COST;
+    } else if (step->probe == PLAN_DUE) {
+        step->estimate = estimateDue(set, insn->low, insn->high);
+        step->cost = 2 * log_rows +
+                     step->estimate * (PLAN_POSTING_COST + PLAN_SORT_COST * halvings((double)step->estimate + 2));
+    } else {
+        // A row holding the text holds all its trigrams: at most the
+        // shortest of their lists, and all of them are read
+        size_t length = strlen(insn->text);
+        long shortest = LONG_MAX, read = 0;
+        for (size_t i = 0; i + 3 <= length; i++) {
+            plangram* gram = findGram(set, gramKey(insn->text + i));
+            long rows = gram ? gram->count : 0;
+            if (rows < shortest) shortest = rows;
+            read += rows;
+        }
+        step->estimate = shortest;
+        step->cost = log_rows + read * PLAN_POSTING_COST;
+    }
+}
+
+/*
+planQuery() - Chooses how to answer a compiled expression from the set's statistics
+ - Time: O(t^2) for t tests (each checked for being necessary over the
+   program's jumps) plus the trigrams of text terms, Space: O(1)
+ - A test is a usable probe if every match must pass it and an index
+   holds the rows passing it: tag:, due: ranges, due:none, and name:,
+   desc: and bare words of 3 or more bytes (by trigrams). Tests under OR or
+   NOT, and priority, status and done: tests, are left to the recheck.
+ - The cost of using the k most selective probes is reading their
+   postings plus rechecking N * (product of their selectivities)
+   candidates; the cheapest k is chosen, 0 (a scan) if none beats N.
+ - Example: "tag:work \"number 12\"" on 200000 tasks -> probe the text's
+   trigrams (~1100 rows), then intersect with tag:work if that is cheaper
+ */
+void planQuery(const planindex* set, const queryprogram* program, queryplan* plan) {
+    memset(plan, 0, sizeof(*plan));
+    plan->rows = set->count;
+    plan->scan_cost = set->count * PLAN_ROW_COST;
+    plan->cost = plan->scan_cost;
+    plan->estimate = set->count;
+
+    for (int i = 0; i < program->length; i++) {
+        const queryinsn* insn = &program->code[i];
+        int probe;
+        if (insn->op == Q_TAG) probe = PLAN_TAG;
+        else if (insn->op == Q_DUE) probe = PLAN_DUE;
+        else if (insn->op == Q_NO_DUE) probe = PLAN_NO_DUE;
+        else if ((insn->op == Q_NAME || insn->op == Q_DESCRIPTION || insn->op == Q_KEYWORD) &&
+                 strlen(insn->text) >= 3) probe = PLAN_TEXT;
+        else continue;
+        if (!isNecessary(program, i)) continue;
+
+        planstep step = {i, probe, 0, 0, -1};
+        estimateStep(set, insn, &step);
+        // Keep the steps ordered by estimate
+        int at = plan->usable++;
+        while (at > 0 && plan->steps[at - 1].estimate > step.estimate) {
+            plan->steps[at] = plan->steps[at - 1];
+            at--;
+        }
+        plan->steps[at] = step;
+    }
+
+    double probes = 0, fraction = 1;
+    for (int k = 0; k < plan->usable; k++) {
+        probes += plan->steps[k].cost;
+        fraction *= set->count ? (double)plan->steps[k].estimate / set->count : 0;
+        long candidates = (long)(set->count * fraction + 0.5);
+        if (candidates > plan->steps[0].estimate) candidates = plan->steps[0].estimate;
+        double cost = probes + candidates * PLAN_ROW_COST;
+        if (cost < plan->cost) {
+            plan->cost = cost;
+            plan->chosen = k + 1;
+            plan->estimate = candidates;
+        }
+    }
+}
+
+// Keeps the rows of a (sorted) that are also in b (sorted); returns how many.
+// A much longer b is binary searched rather than walked.
+static long intersectRows(int* a, long n, const int* b, long m) {
+    long kept = 0, j = 0;
+    if (m > n * 16) {
+        for (long i = 0; i < n && j < m; i++) {
+            long low = j, high = m;
+            while (low < high) {
+                long mid = low + (high - low) / 2;
+                if (b[mid] < a[i]) low = mid + 1;
+                else high = mid;
+            }
+            j = low;
+            if (j < m && b[j] == a[i]) a[kept++] = a[i];
+        }
+        return kept;
+    }
+    for (long i = 0; i < n && j < m;) {
+        if (a[i] < b[j]) i++;
+        else if (a[i] > b[j]) j++;
+        else {
+            a[kept++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    return kept;
+}
+
+// Rows passing a step's test (a superset for text), sorted, in a new array;
+// returns how many, or -1 if out of memory
+static long probeRows(const planindex* set, const queryinsn* insn, int probe, int** out) {
+    const int* source = NULL;
+    long count = 0;
+    if (probe == PLAN_TAG) {
+        plantag* tag = findTag(set, insn->text);
+        count = tag ? bitmapCardinality(&tag->rows) : 0;
+        *out = (int*)malloc(sizeof(int) * (count ? count : 1));
+        if (!*out) return -1;
+        if (tag) bitmapToArray(&tag->rows, (unsigned int*)*out, count);
+        return count;
+    } else if (probe == PLAN_NO_DUE) {
+        source = set->no_due;
+        count = set->no_due_count;
+    } else if (probe == PLAN_DUE) {
+        long low = 0, high = set->due_count;
+        while (low < high) {
+            long mid = low + (high - low) / 2;
+            if (set->due[mid].key < insn->low) low = mid + 1;
+            else high = mid;
+        }
+        long first = low;
+        high = set->due_count;
+        while (low < high) {
+            long mid = low + (high - low) / 2;
+            if (set->due[mid].key <= insn->high) low = mid + 1;
+            else high = mid;
+        }
+        count = low - first;
+        *out = (int*)malloc(sizeof(int) * (count ? count : 1));
+        if (!*out) return -1;
+        for (long i = 0; i < count; i++) (*out)[i] = set->due[first + i].row;
+        qsort(*out, (size_t)count, sizeof(int), compareRows);
+        return count;
+    } else {
+        // Start from the shortest trigram list and intersect the rest
+        size_t length = strlen(insn->text);
+        const plangram* shortest = NULL;
+        for (size_t i = 0; i + 3 <= length; i++) {
+            const plangram* gram = findGram(set, gramKey(insn->text + i));
+            if (!gram) {
+                shortest = NULL;
+                break;
+            }
+            if (!shortest || gram->count < shortest->count) shortest = gram;
+        }
+        // A trigram missing from the index means no row can match
+        count = shortest ? shortest->count : 0;
+        *out = (int*)malloc(sizeof(int) * (count ? count : 1));
+        if (!*out) return -1;
+        if (!count) return 0;
+        memcpy(*out, shortest->rows, sizeof(int) * count);
+        for (size_t i = 0; i + 3 <= length && count; i++) {
+            const plangram* gram = findGram(set, gramKey(insn->text + i));
+            if (gram != shortest) count = intersectRows(*out, count, gram->rows, gram->count);
+        }
+        return count;
+    }
+    *out = (int*)malloc(sizeof(int) * (count ? count : 1));
+    if (!*out) return -1;
+    if (count) memcpy(*out, source, sizeof(int) * count);
+    return count;
+}
+
+/*
+planExecute() - Runs a plan: probes and intersects its steps, then rechecks the candidates
+ - Time: O(postings read + candidates * one queryRun()), or O(n) queryRun()
+   calls for a scan, Space: O(rows of the first step)
+ - Writes up to max matching rows (indexes into set->rows, ascending) to
+   out and returns the number of matches; fills in plan->candidates,
+   plan->matches and each step's actual rows. Falls back to a scan if out
+   of memory. The set must be current (planRefresh()).
+ - Example: planExecute(&set, &plan, &program, rows, set.count) -> 42
+ */
+long planExecute(const planindex* set, queryplan* plan, const queryprogram* program, int* out, long max) {
+    int* candidates = NULL;
+    long n = 0;
+    int scan = plan->chosen == 0;
+    for (int k = 0; k < plan->usable; k++) plan->steps[k].actual = -1;
+
+    for (int k = 0; k < plan->chosen; k++) {
+        planstep* step = &plan->steps[k];
+        int* rows;
+        long count = probeRows(set, &program->code[step->insn], step->probe, &rows);
+        if (count < 0) {
+            scan = 1;   // out of memory part way: scan instead
+            break;
+        }
+        step->actual = count;
+        if (k == 0) {
+            candidates = rows;
+            n = count;
+        } else {
+            n = intersectRows(candidates, n, rows, count);
+            free(rows);
+        }
+        if (n == 0) break;
+    }
+
+    long matches = 0;
+    plan->candidates = scan ? set->count : n;
+    for (long i = 0; i < plan->candidates; i++) {
+        int row = scan ? (int)i : candidates[i];
+        if (!queryRun(program, set->rows[row])) continue;
+        if (matches < max) out[matches] = row;
+        matches++;
+    }
+    free(candidates);
+    plan->matches = matches;
+    return matches;
+}
+
+static void boundText(long key, char* text, size_t size) {
+    if (key <= 1 || key == LONG_MAX) text[0] = '\0';
+    else snprintf(text, size, "%02ld/%02ld/%04ld", key % 32, key / 32 % 16, key / 512);
+}
+
+// Writes a step's test as it would be written in an expression
+static void stepText(const planstep* step, const queryprogram* program, char* text, size_t size) {
+    const queryinsn* insn = &program->code[step->insn];
+    char low[24], high[24];
+    switch (insn->op) {
+        case Q_TAG: snprintf(text, size, "tag:%s", insn->text); break;
+        case Q_NO_DUE: snprintf(text, size, "due:none"); break;
+        case Q_DUE:
+            boundText(insn->low, low, sizeof(low));
+            boundText(insn->high, high, sizeof(high));
+            snprintf(text, size, "due:%s..%s", low, high);
+            break;
+        case Q_NAME: snprintf(text, size, "name:\"%s\"", insn->text); break;
+        case Q_DESCRIPTION: snprintf(text, size, "desc:\"%s\"", insn->text); break;
+        default: snprintf(text, size, "\"%s\"", insn->text); break;
+    }
+}
+
+/*
+planSummary() - One line naming the access path, e.g. "intersect tag:work + due:..01/06/2026"
+ - Time: O(steps), Space: O(1)
+ - Returns text
+ */
+const char* planSummary(const queryplan* plan, const queryprogram* program, char* text, size_t size) {
+    if (plan->chosen == 0) {
+        snprintf(text, size, "scan");
+        return text;
+    }
+    size_t used = (size_t)snprintf(text, size, "%s ", plan->chosen == 1 ? "probe" : "intersect");
+    for (int k = 0; k < plan->chosen && used < size; k++) {
+        char step[80];
+        stepText(&plan->steps[k], program, step, sizeof(step));
+        used += (size_t)snprintf(text + used, size - used, "%s%s", k ? " + " : "", step);
+    }
+    return text;
+}
+
+/*
+planExplain() - Describes the statistics, the probes considered and the plan chosen
+ - Time: O(steps), Space: O(1)
+ - Run the plan first (planExecute()) to see actual rows next to the estimates
+ - Returns the length written (truncated to size)
+ - Sample Case:
+    Plan: probe "number 12" (trigrams), recheck ~1111 of 200000 tasks
+      cost 1470 against 200000 for a scan
+      probe               index        est. rows    cost   actual
+      "number 12"         trigrams          1111     359     1111  used
+      tag:work            tag list         66667    3334        -
+ */
+int planExplain(const planindex* set, const queryplan* plan, const queryprogram* program,
+                char* text, size_t size) {
+    static const char* const indexes[] = {"tag list", "due dates", "no due", "trigrams"};
+    char summary[160];
+    size_t used = 0;
+    int n;
+
+    planSummary(plan, program, summary, sizeof(summary));
+    if (plan->chosen) {
+        n = snprintf(text, size, "Plan: %s, recheck ~%ld of %ld tasks\n", summary, plan->estimate, plan->rows);
+    } else {
+        n = snprintf(text, size, "Plan: scan all %ld tasks%s\n", plan->rows,
+                     plan->usable ? "" : " (no test every match must pass has an index)");
+    }
+    used += (size_t)n;
+    n = snprintf(text + (used < size ? used : size), used < size ? size - used : 0,
+                 "  cost %.0f against %.0f for a scan\n", plan->cost, plan->scan_cost);
+    used += (size_t)n;
+    n = snprintf(text + (used < size ? used : size), used < size ? size - used : 0,
+                 "  statistics: %d tags, %ld trigrams (%ld postings), %ld due dates over %d months, "
+                 "%ld without\n", set->tag_count, set->gram_count, set->postings, set->due_count,
+                 set->months, set->no_due_count);
+    used += (size_t)n;
+    if (plan->usable) {
+        n = snprintf(text + (used < size ? used : size), used < size ? size - used : 0,
+                     "  %-24s %-10s %9s %8s %8s\n", "probe", "index", "est. rows", "cost", "actual");
+        used += (size_t)n;
+    }
+    for (int k = 0; k < plan->usable; k++) {
+        const planstep* step = &plan->steps[k];
+        char label[80], actual[24] = "-";
+        stepText(step, program, label, sizeof(label));
+        if (step->actual >= 0) snprintf(actual, sizeof(actual), "%ld", step->actual);
+        n = snprintf(text + (used < size ? used : size), used < size ? size - used : 0,
+                     "  %-24.24s %-10s %9ld %8.0f %8s%s\n", label, indexes[step->probe], step->estimate,
+                     step->cost, actual, k < plan->chosen ? "  used" : "");
+        used += (size_t)n;
+    }
+    if (plan->matches || plan->candidates) {
+        n = snprintf(text + (used < size ? used : size), used < size ? size - used : 0,
+                     "  ran: %ld candidates rechecked, %ld matches\n", plan->candidates, plan->matches);
+        used += (size_t)n;
+    }
+    return (int)(used < size ? used : (size ? size - 1 : 0));
+}
+
+// A tag expression's value while it is evaluated: the rows are borrowed
+// (a tag's bitmap) or owned; negated means every row NOT in them
+typedef struct {
+    bitmap owned;
+    const bitmap* borrowed;
+    int negated;
+} tagvalue;
+
+typedef struct {
+    const planindex* set;
+    const char* p;
+    char* error;
+    size_t size;
+    todostatus status;
+} tagparser;
+
+static const bitmap no_rows = {NULL, 0, 0};
+
+static const bitmap* valueRows(const tagvalue* v) {
+    return v->borrowed ? v->borrowed : &v->owned;
+}
+
+static void releaseValue(tagvalue* v) {
+    bitmapFree(&v->owned);
+    v->borrowed = &no_rows;
+}
+
+// Takes result as v's rows
+static void ownValue(tagvalue* v, bitmap* result) {
+    bitmapFree(&v->owned);
+    v->owned = *result;
+    v->borrowed = NULL;
+}
+
+static int tagFail(tagparser* q, todostatus status, const char* message) {
+    if (q->status == TODO_OK) {
+        q->status = status;
+        if (q->error && q->size) snprintf(q->error, q->size, "%s", message);
+    }
+    return -1;
+}
+
+// Whether p starts with the keyword word (any case) followed by a word end
+static int atKeyword(const char* p, const char* word) {
+    size_t n = strlen(word);
+    return strncasecmp(p, word, n) == 0 && (p[n] == '\0' || p[n] == '(' || p[n] == ')' || isspace((unsigned char)p[n]));
+}
+
+static void skipSpaces(tagparser* q) {
+    while (isspace((unsigned char)*q->p)) q->p++;
+}
+
+// Turns a negated value into the rows it stands for
+static int materialize(tagparser* q, tagvalue* v) {
+    bitmap all, result;
+    bitmapInit(&all);
+    if (bitmapFill(&all, (unsigned int)q->set->count) != 0 || bitmapAndNot(&all, valueRows(v), &result) != 0) {
+        bitmapFree(&all);
+        return tagFail(q, TODO_NO_MEMORY, "out of memory");
+    }
+    bitmapFree(&all);
+    ownValue(v, &result);
+    v->negated = 0;
+    return 0;
+}
+
+static int tagOr(tagparser* q, tagvalue* out);
+
+// tag, "tag", NOT unary, -unary or ( or-expression )
+static int tagUnary(tagparser* q, tagvalue* out) {
+    bitmapInit(&out->owned);
+    out->borrowed = &no_rows;
+    out->negated = 0;
+    skipSpaces(q);
+    if (atKeyword(q->p, "NOT") || (*q->p == '-' && q->p[1] && !isspace((unsigned char)q->p[1]))) {
+        q->p += *q->p == '-' ? 1 : 3;
+        if (tagUnary(q, out) != 0) return -1;
+        out->negated ^= 1;
+        return 0;
+    }
+    if (*q->p == '(') {
+        q->p++;
+        if (tagOr(q, out) != 0) return -1;
+        skipSpaces(q);
+        if (*q->p != ')') {
+            releaseValue(out);
+            return tagFail(q, TODO_PARSE_ERROR, "missing ')'");
+        }
+        q->p++;
+        return 0;
+    }
+    if (*q->p == ')') return tagFail(q, TODO_PARSE_ERROR, "unexpected ')'");
+    if (*q->p == '\0' || atKeyword(q->p, "AND") || atKeyword(q->p, "OR")) {
+        return tagFail(q, TODO_PARSE_ERROR, "expected a tag");
+    }
+
+    char name[MAX_TAG_LENGTH];
+    size_t n = 0;
+    if (*q->p == '"') {
+        const char* close = strchr(q->p + 1, '"');
+        if (!close) return tagFail(q, TODO_PARSE_ERROR, "missing closing quote");
+        n = (size_t)(close - q->p - 1);
+        if (n >= sizeof(name)) n = sizeof(name) - 1;
+        memcpy(name, q->p + 1, n);
+        q->p = close + 1;
+    } else {
+        for (; *q->p && *q->p != '(' && *q->p != ')' && !isspace((unsigned char)*q->p); q->p++) {
+            if (n < sizeof(name) - 1) name[n++] = *q->p;
+        }
+    }
+    name[n] = '\0';
+    plantag* tag = findTag(q->set, name);
+    out->borrowed = tag ? &tag->rows : &no_rows;
+    return 0;
+}
+
+// unary [AND] unary ...: the plain tags ANDed and the NOT ones taken away
+// in one bitmapAndMany() pass; with only NOT ones, NOT (a OR b ...)
+static int tagAnd(tagparser* q, tagvalue* out) {
+    tagvalue terms[PLAN_TAG_TERMS];
+    int n = 0, failed = 0;
+    for (;;) {
+        if (n == PLAN_TAG_TERMS) {
+            failed = tagFail(q, TODO_PARSE_ERROR, "too many tags");
+            break;
+        }
+        if (tagUnary(q, &terms[n]) != 0) {
+            failed = -1;
+            break;
+        }
+        n++;
+        skipSpaces(q);
+        if (atKeyword(q->p, "AND")) q->p += 3;
+        else if (*q->p == '\0' || *q->p == ')' || atKeyword(q->p, "OR")) break;
+    }
+
+    const bitmap* with[PLAN_TAG_TERMS];
+    const bitmap* without[PLAN_TAG_TERMS];
+    int with_count = 0, without_count = 0;
+    for (int i = 0; i < n && !failed; i++) {
+        if (terms[i].negated) without[without_count++] = valueRows(&terms[i]);
+        else with[with_count++] = valueRows(&terms[i]);
+    }
+    if (!failed && n == 1) {
+        *out = terms[0];
+        bitmapInit(&terms[0].owned);
+    } else if (!failed) {
+        bitmap result;
+        int status;
+        bitmapInit(&out->owned);
+        out->borrowed = NULL;
+        out->negated = with_count == 0;
+        if (with_count) {
+            status = bitmapAndMany(with, with_count, without, without_count, &result) < 0;
+        } else {
+            // NOT a AND NOT b is NOT (a OR b)
+            status = bitmapOr(without[0], without[1], &result) != 0;
+            for (int i = 2; i < without_count && !status; i++) {
+                bitmap wider;
+                status = bitmapOr(&result, without[i], &wider) != 0;
+                bitmapFree(&result);
+                result = wider;
+            }
+        }
+        if (status) failed = tagFail(q, TODO_NO_MEMORY, "out of memory");
+        else out->owned = result;
+    }
+    for (int i = 0; i < n; i++) releaseValue(&terms[i]);
+    return failed;
+}
+
+// and-expression OR and-expression ...
+static int tagOr(tagparser* q, tagvalue* out) {
+    if (tagAnd(q, out) != 0) return -1;
+    skipSpaces(q);
+    while (atKeyword(q->p, "OR")) {
+        q->p += 2;
+        tagvalue next;
+        bitmap result;
+        if (tagAnd(q, &next) != 0) {
+            releaseValue(out);
+            return -1;
+        }
+        if ((out->negated && materialize(q, out) != 0) || (next.negated && materialize(q, &next) != 0) ||
+            (bitmapOr(valueRows(out), valueRows(&next), &result) != 0 &&
+             tagFail(q, TODO_NO_MEMORY, "out of memory"))) {
+            releaseValue(&next);
+            releaseValue(out);
+            return -1;
+        }
+        ownValue(out, &result);
+        releaseValue(&next);
+        skipSpaces(q);
+    }
+    return 0;
+}
+
+/*
+planTagQuery() - Rows whose tags satisfy a tag expression, from the tag bitmaps
+ - Time: O(containers of the tags named + 1024 words per pair of dense
+   containers), independent of how many tasks are tested, Space: O(result)
+ - Tags are ANDed by AND or by standing side by side; NOT or a leading -
+   negates, OR and parentheses as in query expressions, "quotes" for a tag
+   named like a keyword. An unknown tag matches nothing.
+ - result is made fresh (free it with bitmapFree()); rows below set->active
+   are in the list, the rest completed. bitmapCardinality() and
+   bitmapRank() count them without listing them.
+ - Returns TODO_OK, TODO_PARSE_ERROR (error says why) or TODO_NO_MEMORY
+ - Example: planTagQuery(&set, "work AND urgent AND NOT waiting", &rows, error, sizeof(error))
+ */
+todostatus planTagQuery(const planindex* set, const char* expression, bitmap* result,
+                        char* error, size_t size) {
+    tagparser q = {set, expression, error, size, TODO_OK};
+    tagvalue value;
+    bitmapInit(result);
+    if (error && size) error[0] = '\0';
+    if (tagOr(&q, &value) != 0) return q.status;
+    skipSpaces(&q);
+    if (*q.p) {
+        releaseValue(&value);
+        tagFail(&q, TODO_PARSE_ERROR, "unexpected ')'");
+        return q.status;
+    }
+    if (value.negated && materialize(&q, &value) != 0) {
+        releaseValue(&value);
+        return q.status;
+    }
+    if (value.borrowed) {
+        // A single tag: copy its bitmap
+        if (bitmapOr(value.borrowed, &no_rows, result) != 0) return TODO_NO_MEMORY;
+    } else {
+        *result = value.owned;
+    }
+    return TODO_OK;
+}
+
+/*
+planLogQuery() - Remembers a planned query for the debug menu (the last PLAN_LOG_SIZE)
+ - Time: O(1), Space: O(1)
+ - ms is the time to plan and run it; build_ms that of the rebuild before it (0 if none)
+ */
+void planLogQuery(const char* expression, const queryplan* plan, const queryprogram* program,
+                  double ms, double build_ms) {
+    planlogentry entry;
+    snprintf(entry.expression, sizeof(entry.expression), "%s", expression);
+    planSummary(plan, program, entry.summary, sizeof(entry.summary));
+    entry.matches = plan->matches;
+    entry.ms = ms;
+    entry.build_ms = build_ms;
+    pthread_mutex_lock(&log_lock);
+    query_log[logged++ % PLAN_LOG_SIZE] = entry;
+    pthread_mutex_unlock(&log_lock);
+}
+
+/*
+planLogRead() - Copies the logged queries, newest first
+ - Time: O(max), Space: O(1)
+ - Returns how many were copied
+ */
+int planLogRead(planlogentry entries[], int max) {
+    int n = 0;
+    pthread_mutex_lock(&log_lock);
+    for (long i = logged - 1; i >= 0 && i >= logged - PLAN_LOG_SIZE && n < max; i--) {
+        entries[n++] = query_log[i % PLAN_LOG_SIZE];
+    }
+    pthread_mutex_unlock(&log_lock);
+    return n;
+}
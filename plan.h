@@ -0,0 +1,128 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+// Query planner: indexes over the tasks, statistics kept with them, and a
+// cost model that picks how to answer a query expression (see query.h).
+//
+// The index set holds every task (active, then completed) as numbered
+// rows, with
+//  - a compressed bitmap of rows per tag (bitmap.h), whose count is the
+//    tag's cardinality
+//  - the rows with a due date sorted by it, and a histogram of due dates
+//    by month for estimating ranges
+//  - the rows with no due date
+//  - a trigram index over name, description and tags: the rows containing
+//    each 3-byte sequence, so a text term of 3 or more bytes narrows to the
+//    rows holding all of its trigrams
+//  - counts by priority and by status
+//
+// planQuery() finds the tests a match cannot fail (the conjuncts of the
+// expression), estimates the rows each one leaves, and chooses between a
+// full scan, one index probe and an intersection of posting lists (the
+// most selective first, as many as give the lowest estimated cost). The
+// candidates are rechecked with the whole program, so any plan gives the
+// same matches. planExplain() describes the choice.
+//
+// planTagQuery() answers tag expressions such as
+//     work AND urgent AND NOT waiting
+// with the tag bitmaps alone: the ANDed tags smallest first, then each
+// NOT tag taken away, with OR and parentheses as in query expressions.
+//
+// The set is rebuilt by planRefresh() when the change feed (feed.h) has
+// moved since it was built, so it follows every recorded change without
+// hooks of its own; without a feed it is rebuilt on every refresh.
+
+#include "libtodo.h"
+#include "query.h"
+#include "bitmap.h"
+
+#define PLAN_LOG_SIZE 8
+
+typedef struct plantag plantag;
+typedef struct plangram plangram;
+
+typedef struct {
+    long key;                // date key of the due date
+    int row;
+} plandue;
+
+typedef struct {
+    task** rows;             // active tasks in list order, then completed ones
+    long count;
+    long active;             // rows before this are in the list
+    plantag* tags;           // open-addressed by tag
+    int tag_slots;
+    int tag_count;
+    plangram* grams;         // open-addressed by trigram
+    long gram_slots;
+    long gram_count;
+    long postings;           // rows listed under all trigrams
+    plandue* due;            // sorted by key
+    long due_count;
+    int* no_due;
+    long no_due_count;
+    long month_base;         // year * 12 + month - 1 of month_counts[0]
+    int months;
+    long* month_counts;
+    long priority_counts[4];
+    long status_counts[3];
+    unsigned long built_at;  // feed head when built
+    int built;
+    double build_ms;
+} planindex;
+
+// Ways to narrow the rows
+typedef enum {
+    PLAN_TAG,                // tag posting list
+    PLAN_DUE,                // range of the sorted due dates
+    PLAN_NO_DUE,             // rows without a due date
+    PLAN_TEXT                // trigram posting lists
+} planprobe;
+
+typedef struct {
+    int insn;                // the program's test it serves
+    int probe;               // planprobe
+    long estimate;           // rows it is expected to leave
+    double cost;             // of reading them
+    long actual;             // rows it left, once run
+} planstep;
+
+typedef struct {
+    planstep steps[QUERY_MAX_TERMS];   // usable probes, most selective first
+    int usable;
+    int chosen;              // steps used; 0 is a full scan
+    long rows;
+    long estimate;           // candidates the chosen steps leave
+    double scan_cost;
+    double cost;             // of the chosen plan
+    long candidates;         // once run
+    long matches;
+} queryplan;
+
+// A query run through the planner, for the debug menu
+typedef struct {
+    char expression[80];
+    char summary[80];
+    long matches;
+    double ms;               // to plan and run it
+    double build_ms;         // to rebuild the indexes first, 0 if they were current
+} planlogentry;
+
+void planInit(planindex* set);
+void planFree(planindex* set);
+void planSetDefault(planindex* set);
+planindex* planDefault();
+int planBuild(planindex* set, tasklist* list, completedstack* stack);
+int planRefresh(planindex* set, tasklist* list, completedstack* stack);
+void planQuery(const planindex* set, const queryprogram* program, queryplan* plan);
+long planExecute(const planindex* set, queryplan* plan, const queryprogram* program, int* out, long max);
+int planExplain(const planindex* set, const queryplan* plan, const queryprogram* program,
+                char* text, size_t size);
+const char* planSummary(const queryplan* plan, const queryprogram* program, char* text, size_t size);
+todostatus planTagQuery(const planindex* set, const char* expression, bitmap* result,
+                        char* error, size_t size);
+void planLogQuery(const char* expression, const queryplan* plan, const queryprogram* program,
+                  double ms, double build_ms);
+int planLogRead(planlogentry entries[], int max);
+
+#endif
@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+#include "pool.h"
+
+#define POOL_DEQUE_MASK (POOL_DEQUE_SIZE - 1)
+
+struct pooljob {
+    pooltaskfn fn;       // a single job, or NULL for a range
+    poolrangefn range;
+    void* arg;
+    long begin;
+    long end;
+    long grain;
+    poolgroup* group;
+    pooljob* next;       // injection queue link
+};
+
+// The worker the current thread is, NULL outside a pool
+static __thread poolworker* current_worker;
+
+static double poolNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Waits a little longer the longer there has been nothing to do
+static void poolIdle(int rounds) {
+#ifdef _WIN32
+    Sleep(rounds < 64 ? 0 : 1);
+#else
+    if (rounds < 64) {
+        sched_yield();
+    } else {
+        struct timespec pause = {0, 50 * 1000};
+        nanosleep(&pause, NULL);
+    }
+#endif
+}
+
+// ===== Per-worker deque (Chase-Lev) =====
+
+// Owner only: adds a job at the bottom; -1 if the deque is full
+static int dequePush(poolworker* w, pooljob* job) {
+    pooldeque* d = &w->deque;
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    if (b - t >= POOL_DEQUE_SIZE) return -1;
+
+    __atomic_store_n(&d->slots[b & POOL_DEQUE_MASK], job, __ATOMIC_RELAXED);
+    // Seq-cst so a worker about to sleep either sees the job or is woken
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_SEQ_CST);
+    if (b + 1 - t > w->max_depth) __atomic_store_n(&w->max_depth, b + 1 - t, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// Owner only: takes the newest job, racing thieves only for the last one
+static pooljob* dequeTake(pooldeque* d) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_SEQ_CST);
+    long t = __atomic_load_n(&d->top, __ATOMIC_SEQ_CST);
+    if (t > b) {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    pooljob* job = __atomic_load_n(&d->slots[b & POOL_DEQUE_MASK], __ATOMIC_RELAXED);
+    if (t == b) {
+        if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            job = NULL;  // a thief got it
+        }
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return job;
+}
+
+// Any thread: takes the oldest job; NULL if empty or another thief won
+static pooljob* dequeSteal(pooldeque* d) {
+    long t = __atomic_load_n(&d->top, __ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_SEQ_CST);
+    if (t >= b) return NULL;
+
+    pooljob* job = __atomic_load_n(&d->slots[t & POOL_DEQUE_MASK], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return job;
+}
+
+// ===== Queues and waking =====
+
+static pooljob* takeInjected(taskpool* pool) {
+    if (__atomic_load_n(&pool->injected, __ATOMIC_SEQ_CST) == 0) return NULL;
+    pthread_mutex_lock(&pool->lock);
+    pooljob* job = pool->inject_head;
+    if (job) {
+        pool->inject_head = job->next;
+        if (!pool->inject_head) pool->inject_tail = NULL;
+        __atomic_store_n(&pool->injected, pool->injected - 1, __ATOMIC_SEQ_CST);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return job;
+}
+
+// True if any deque or the injection queue holds a job
+static int hasWork(taskpool* pool) {
+    if (__atomic_load_n(&pool->injected, __ATOMIC_SEQ_CST) > 0) return 1;
+    for (int i = 0; i < pool->worker_count; i++) {
+        pooldeque* d = &pool->workers[i].deque;
+        if (__atomic_load_n(&d->bottom, __ATOMIC_SEQ_CST) > __atomic_load_n(&d->top, __ATOMIC_SEQ_CST)) return 1;
+    }
+    return 0;
+}
+
+// Wakes one sleeping worker, if any
+static void wakeWorker(taskpool* pool) {
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) == 0) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+pushJob() - Queues a job on the caller's own deque, or the injection queue
+ - Time: O(1), Space: O(1)
+ - Returns -1 if a worker's deque is full (the caller runs the job itself)
+ */
+static int pushJob(taskpool* pool, pooljob* job) {
+    poolworker* self = current_worker;
+    if (self && self->pool == pool) {
+        if (dequePush(self, job) != 0) return -1;
+    } else {
+        job->next = NULL;
+        pthread_mutex_lock(&pool->lock);
+        if (pool->inject_tail) pool->inject_tail->next = job;
+        else pool->inject_head = job;
+        pool->inject_tail = job;
+        __atomic_store_n(&pool->injected, pool->injected + 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    wakeWorker(pool);
+    return 0;
+}
+
+/*
+findJob() - Own deque first, then the injection queue, then steals
+ - Time: O(workers), Space: O(1)
+ - self is NULL for a thread outside the pool helping in poolWait()
+ */
+static pooljob* findJob(taskpool* pool, poolworker* self) {
+    pooljob* job = self ? dequeTake(&self->deque) : NULL;
+    if (job) return job;
+    if ((job = takeInjected(pool)) != NULL) return job;
+
+    int start = self ? self->id + 1 : 0;
+    for (int i = 0; i < pool->worker_count; i++) {
+        poolworker* victim = &pool->workers[(start + i) % pool->worker_count];
+        if (victim == self) continue;
+        if ((job = dequeSteal(&victim->deque)) != NULL) {
+            if (self) __atomic_store_n(&self->steals, self->steals + 1, __ATOMIC_RELAXED);
+            return job;
+        }
+    }
+    return NULL;
+}
+
+/*
+runJob() - Runs a job and marks it done in its group
+ - Time: O(job), Space: O(log(range / grain)) jobs queued
+ - A range splits off its upper half until it is one grain long; the halves
+   sit at the bottom of the deque, where idle workers steal the biggest
+   (oldest) ones first
+ */
+static void runJob(taskpool* pool, pooljob* job) {
+    if (job->range) {
+        while (job->end - job->begin > job->grain) {
+            long mid = job->begin + (job->end - job->begin) / 2;
+            pooljob* half = (pooljob*)malloc(sizeof(pooljob));
+            if (!half) break;
+            *half = *job;
+            half->begin = mid;
+            __atomic_fetch_add(&job->group->pending, 1, __ATOMIC_RELAXED);
+            if (pushJob(pool, half) != 0) {
+                __atomic_fetch_sub(&job->group->pending, 1, __ATOMIC_RELAXED);
+                free(half);
+                break;
+            }
+            job->end = mid;
+        }
+        job->range(job->arg, job->begin, job->end);
+    } else {
+        job->fn(job->arg);
+    }
+
+    poolgroup* group = job->group;
+    free(job);
+    // Last touch of the group: a waiter may return and free it right after
+    __atomic_fetch_sub(&group->pending, 1, __ATOMIC_RELEASE);
+}
+
+static void* poolWorkerMain(void* arg) {
+    poolworker* self = (poolworker*)arg;
+    taskpool* pool = self->pool;
+    current_worker = self;
+
+    for (;;) {
+        pooljob* job = findJob(pool, self);
+        if (job) {
+            double start = poolNow();
+            runJob(pool, job);
+            long long ns = (long long)((poolNow() - start) * 1e9);
+            __atomic_store_n(&self->busy_ns, self->busy_ns + ns, __ATOMIC_RELAXED);
+            __atomic_store_n(&self->jobs, self->jobs + 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        // Announce sleeping before the last look, so a push either shows
+        // up in that look or bumps the generation and wakes us
+        pthread_mutex_lock(&pool->lock);
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        unsigned long generation = pool->generation;
+        __atomic_fetch_add(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (!hasWork(pool)) {
+            pthread_mutex_lock(&pool->lock);
+            while (pool->generation == generation && !pool->stop) pthread_cond_wait(&pool->wake, &pool->lock);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        __atomic_fetch_sub(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    }
+    current_worker = NULL;
+    return NULL;
+}
+
+// ===== Public interface =====
+
+/*
+poolInit() - Starts a pool of worker threads
+ - Time: O(workers), Space: O(workers * POOL_DEQUE_SIZE)
+ - workers <= 0 means one per core; at most POOL_MAX_WORKERS
+ - Returns 0 on success, -1 if no worker could be started
+ */
+int poolInit(taskpool* pool, int workers) {
+    if (workers <= 0) {
+#ifdef _WIN32
+        workers = 4;
+#else
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 0 ? (int)cores : 1;
+#endif
+    }
+    if (workers > POOL_MAX_WORKERS) workers = POOL_MAX_WORKERS;
+
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pool->started = poolNow();
+
+    // Deques exist before any thread starts, since workers steal from all of them
+    for (int i = 0; i < workers; i++) {
+        poolworker* w = &pool->workers[i];
+        w->pool = pool;
+        w->id = i;
+        w->deque.slots = (pooljob**)calloc(POOL_DEQUE_SIZE, sizeof(pooljob*));
+        if (!w->deque.slots) break;
+        pool->worker_count++;
+    }
+    int started = 0;
+    for (int i = 0; i < pool->worker_count; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, poolWorkerMain, &pool->workers[i]) != 0) break;
+        started++;
+    }
+    if (started < pool->worker_count) {
+        // Deques of workers that never started stay empty and are skipped by thieves
+        for (int i = started; i < pool->worker_count; i++) free(pool->workers[i].deque.slots);
+        pool->worker_count = started;
+    }
+    if (started == 0) {
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->wake);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+poolShutdown() - Runs every queued job, then stops and joins the workers
+ - Time: O(queued jobs), Space: O(1)
+ */
+void poolShutdown(taskpool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        free(pool->workers[i].deque.slots);
+        pool->workers[i].deque.slots = NULL;
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+}
+
+static taskpool default_pool;
+static int default_state;  // 0 not started, 1 running, -1 failed to start
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void startDefault() {
+    const char* env = getenv("TODOLIST_POOL_WORKERS");
+    int workers = env ? atoi(env) : 0;
+    __atomic_store_n(&default_state, poolInit(&default_pool, workers) == 0 ? 1 : -1, __ATOMIC_RELEASE);
+}
+
+/*
+poolDefault() - The shared background pool, started on first use
+ - Time: O(workers) the first time, O(1) after, Space: O(workers)
+ - Sized by TODOLIST_POOL_WORKERS if set, else one worker per core
+ - Returns NULL if it could not start; callers then do the work themselves
+ */
+taskpool* poolDefault() {
+    pthread_once(&default_once, startDefault);
+    return __atomic_load_n(&default_state, __ATOMIC_ACQUIRE) == 1 ? &default_pool : NULL;
+}
+
+/*
+poolDefaultIfStarted() - The shared pool if something has started it, else NULL
+ - Time: O(1), Space: O(1)
+ */
+taskpool* poolDefaultIfStarted() {
+    return __atomic_load_n(&default_state, __ATOMIC_ACQUIRE) == 1 ? &default_pool : NULL;
+}
+
+/*
+poolShutdownDefault() - Stops the shared pool if it was started
+ - Time: O(queued jobs), Space: O(1)
+ - Called once before exit
+ */
+void poolShutdownDefault() {
+    if (poolDefaultIfStarted()) {
+        poolShutdown(&default_pool);
+        __atomic_store_n(&default_state, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static pooljob* newJob(poolgroup* group, pooltaskfn fn, poolrangefn range, void* arg,
+                       long begin, long end, long grain) {
+    pooljob* job = (pooljob*)malloc(sizeof(pooljob));
+    if (!job) return NULL;
+    job->fn = fn;
+    job->range = range;
+    job->arg = arg;
+    job->begin = begin;
+    job->end = end;
+    job->grain = grain;
+    job->group = group;
+    job->next = NULL;
+    return job;
+}
+
+/*
+poolSubmit() - Queues fn(arg) to run on the pool as part of group
+ - Time: O(1), Space: O(1)
+ - With no pool (NULL) or no memory, fn runs on the calling thread before
+   this returns; returns 0 if queued, -1 if it ran here
+ - Example: poolSubmit(poolDefault(), &group, writeReport, &report) -> 0
+ */
+int poolSubmit(taskpool* pool, poolgroup* group, pooltaskfn fn, void* arg) {
+    pooljob* job = pool ? newJob(group, fn, NULL, arg, 0, 0, 0) : NULL;
+    if (!job) {
+        fn(arg);
+        return -1;
+    }
+    __atomic_fetch_add(&group->pending, 1, __ATOMIC_RELAXED);
+    if (pushJob(pool, job) != 0) {
+        runJob(pool, job);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+poolFor() - Runs fn(arg, begin, end) over [0, count) in stealable chunks
+ - Time: O(count / grain) jobs, Space: O(log(count / grain)) per worker
+ - The range is split in halves as it runs, down to grain items per call,
+   so any worker that runs dry steals the largest piece left
+ - Like poolSubmit(), runs on the calling thread without a pool or memory;
+   wait for the group before using the results
+ - Example: poolFor(pool, &group, 1000000, 8192, refreshRange, &scan) -> 0
+ */
+int poolFor(taskpool* pool, poolgroup* group, long count, long grain, poolrangefn fn, void* arg) {
+    if (count <= 0) return 0;
+    if (grain < 1) grain = 1;
+    pooljob* job = pool ? newJob(group, NULL, fn, arg, 0, count, grain) : NULL;
+    if (!job) {
+        fn(arg, 0, count);
+        return -1;
+    }
+    __atomic_fetch_add(&group->pending, 1, __ATOMIC_RELAXED);
+    if (pushJob(pool, job) != 0) {
+        runJob(pool, job);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+poolWait() - Returns once every job of group has finished
+ - Time: O(remaining jobs), Space: O(1)
+ - The waiting thread runs queued jobs itself meanwhile, so waiting from a
+   worker cannot deadlock and a one-core machine still makes progress
+ */
+void poolWait(taskpool* pool, poolgroup* group) {
+    if (!pool) return;
+    poolworker* self = current_worker && current_worker->pool == pool ? current_worker : NULL;
+    int idle = 0;
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        pooljob* job = findJob(pool, self);
+        if (job) {
+            runJob(pool, job);
+            if (!self) __atomic_fetch_add(&pool->caller_jobs, 1, __ATOMIC_RELAXED);
+            idle = 0;
+        } else {
+            poolIdle(idle++);
+        }
+    }
+}
+
+/*
+poolIsDone() - Checks a group without waiting
+ - Time: O(1), Space: O(1)
+ */
+int poolIsDone(poolgroup* group) {
+    return __atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) == 0;
+}
+
+/*
+poolGetStats() - Utilization and queue depth of each worker since poolInit()
+ - Time: O(workers), Space: O(1)
+ - Values are read while workers run, so they are a close snapshot
+ */
+void poolGetStats(taskpool* pool, poolstats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->workers = pool->worker_count;
+    stats->seconds = poolNow() - pool->started;
+    for (int i = 0; i < pool->worker_count; i++) {
+        poolworker* w = &pool->workers[i];
+        long long busy = __atomic_load_n(&w->busy_ns, __ATOMIC_RELAXED);
+        long depth = __atomic_load_n(&w->deque.bottom, __ATOMIC_RELAXED) -
+                     __atomic_load_n(&w->deque.top, __ATOMIC_RELAXED);
+        stats->utilization[i] = stats->seconds > 0 ? busy / (stats->seconds * 1e9) : 0;
+        stats->jobs[i] = __atomic_load_n(&w->jobs, __ATOMIC_RELAXED);
+        stats->steals[i] = __atomic_load_n(&w->steals, __ATOMIC_RELAXED);
+        stats->depth[i] = depth > 0 ? depth : 0;
+        stats->max_depth[i] = __atomic_load_n(&w->max_depth, __ATOMIC_RELAXED);
+    }
+    stats->injected = __atomic_load_n(&pool->injected, __ATOMIC_RELAXED);
+    stats->caller_jobs = __atomic_load_n(&pool->caller_jobs, __ATOMIC_RELAXED);
+}
+
+/*
+poolPrintStats() - Prints one line per worker, for sizing the pool
+ - Time: O(workers), Space: O(1)
+ - Sample Case:
+    Output:
+      worker   busy %       jobs     steals  queued  max queued
+           0     72.4        318         41       0          12
+ */
+void poolPrintStats(taskpool* pool) {
+    poolstats stats;
+    poolGetStats(pool, &stats);
+    printf("Pool: %d workers, up %.1f s, %ld jobs waiting to be picked up, %lld run by waiting callers\n",
+           stats.workers, stats.seconds, stats.injected, stats.caller_jobs);
+    printf("%6s %8s %10s %10s %7s %11s\n", "worker", "busy %", "jobs", "steals", "queued", "max queued");
+    for (int i = 0; i < stats.workers; i++) {
+        printf("%6d %8.1f %10lld %10lld %7ld %11ld\n", i, stats.utilization[i] * 100,
+               stats.jobs[i], stats.steals[i], stats.depth[i], stats.max_depth[i]);
+    }
+}
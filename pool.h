@@ -0,0 +1,89 @@
+#ifndef POOL_H
+#define POOL_H
+
+// Work-stealing thread pool for background and maintenance jobs.
+// Each worker owns a deque: it pushes and pops jobs at the bottom, and idle
+// workers steal from the top of the others', so a large job split into
+// chunks spreads over every worker without a shared queue to fight over.
+// Jobs submitted from threads outside the pool go through one locked
+// injection queue.
+//
+//   poolgroup group = {0};
+//   poolFor(pool, &group, count, 4096, scanRange, &args);
+//   poolWait(pool, &group);   // the caller helps run jobs while it waits
+
+#include <pthread.h>
+
+#define POOL_MAX_WORKERS 32
+#define POOL_DEQUE_SIZE 4096   // per worker, a power of two
+
+typedef void (*pooltaskfn)(void* arg);
+typedef void (*poolrangefn)(void* arg, long begin, long end);
+
+typedef struct pooljob pooljob;
+
+// Jobs waited for together; start from {0}
+typedef struct {
+    long pending;
+} poolgroup;
+
+// Chase-Lev deque: the owner works at bottom, thieves take from top
+typedef struct {
+    long top;
+    char pad[64 - sizeof(long)];
+    long bottom;
+    pooljob** slots;
+} pooldeque;
+
+typedef struct {
+    pthread_t thread;
+    struct taskpool* pool;
+    int id;
+    pooldeque deque;
+    long long busy_ns;   // time spent running jobs
+    long long jobs;
+    long long steals;
+    long max_depth;      // deepest the deque has been
+} poolworker;
+
+typedef struct taskpool {
+    poolworker workers[POOL_MAX_WORKERS];
+    int worker_count;
+    pthread_mutex_t lock;    // injection queue and sleeping workers
+    pthread_cond_t wake;
+    pooljob* inject_head;
+    pooljob* inject_tail;
+    long injected;           // jobs in the injection queue
+    int sleepers;
+    unsigned long generation;  // bumped on every wake-up
+    int stop;
+    double started;
+    long long caller_jobs;   // jobs run by threads waiting in poolWait()
+} taskpool;
+
+// Snapshot for sizing the pool
+typedef struct {
+    int workers;
+    double seconds;          // since poolInit()
+    double utilization[POOL_MAX_WORKERS];  // busy share of seconds, 0..1
+    long long jobs[POOL_MAX_WORKERS];
+    long long steals[POOL_MAX_WORKERS];
+    long depth[POOL_MAX_WORKERS];          // jobs queued now
+    long max_depth[POOL_MAX_WORKERS];
+    long injected;           // jobs waiting in the injection queue
+    long long caller_jobs;
+} poolstats;
+
+int poolInit(taskpool* pool, int workers);
+void poolShutdown(taskpool* pool);
+taskpool* poolDefault();
+taskpool* poolDefaultIfStarted();
+void poolShutdownDefault();
+int poolSubmit(taskpool* pool, poolgroup* group, pooltaskfn fn, void* arg);
+int poolFor(taskpool* pool, poolgroup* group, long count, long grain, poolrangefn fn, void* arg);
+void poolWait(taskpool* pool, poolgroup* group);
+int poolIsDone(poolgroup* group);
+void poolGetStats(taskpool* pool, poolstats* stats);
+void poolPrintStats(taskpool* pool);
+
+#endif
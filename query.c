@@ -0,0 +1,533 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "query.h"
+
+#define QUERY_NODES (QUERY_MAX_TERMS * 3)
+
+static const char* const op_names[] = {"priority", "status", "due", "due", "done", "tag", "name", "desc", "keyword"};
+static const int op_costs[] = {1, 1, 1, 1, 1, 4, 8, 16, 32};
+
+enum { NODE_LEAF, NODE_AND, NODE_OR, NODE_NOT };
+enum { TOK_END, TOK_TERM, TOK_AND, TOK_OR, TOK_NOT, TOK_OPEN, TOK_CLOSE };
+
+typedef struct {
+    int kind;
+    int first;               // first child
+    int next;                // next sibling
+    int cost;
+    queryinsn leaf;
+} querynode;
+
+typedef struct {
+    const char* p;
+    int token;
+    char field[16];          // TOK_TERM: field name, "" for a bare word
+    char* value;             // TOK_TERM: in the program's text
+    size_t used;             // of the program's text
+    queryprogram* program;
+    querynode nodes[QUERY_NODES];
+    int count;
+    int leaves;
+    date today;
+    char* error;
+    size_t size;
+    int failed;
+} queryparser;
+
+/*
+queryDateKey() - Key that orders dates like compareDates(), as programs store them
+ - Time: O(1), Space: O(1)
+ - Example: queryDateKey(1/1/2025) < queryDateKey(2/1/2025); 0 is before every real date
+ */
+long queryDateKey(date d) {
+    return (long)d.year * 512 + d.month * 32 + d.day;
+}
+
+static date keyDate(long key) {
+    date d = {(int)(key % 32), (int)(key / 32 % 16), (int)(key / 512)};
+    return d;
+}
+
+// Records the first error; the rest of the parse is skipped
+static void fail(queryparser* q, const char* message, const char* detail) {
+    if (q->failed) return;
+    q->failed = 1;
+    if (q->error && q->size) {
+        if (detail) snprintf(q->error, q->size, "%s '%s'", message, detail);
+        else snprintf(q->error, q->size, "%s", message);
+    }
+}
+
+// Copies n bytes of text into the program, NULL if it is full
+static char* keepText(queryparser* q, const char* text, size_t n) {
+    if (q->used + n + 1 > sizeof(q->program->text)) {
+        fail(q, "query too long", NULL);
+        return NULL;
+    }
+    char* kept = q->program->text + q->used;
+    memcpy(kept, text, n);
+    kept[n] = '\0';
+    q->used += n + 1;
+    return kept;
+}
+
+static int isWordEnd(char c) {
+    return c == '\0' || c == '(' || c == ')' || isspace((unsigned char)c);
+}
+
+// Reads the next token
+static void advance(queryparser* q) {
+    while (isspace((unsigned char)*q->p)) q->p++;
+    q->field[0] = '\0';
+    q->value = NULL;
+    char c = *q->p;
+    if (c == '\0') {
+        q->token = TOK_END;
+        return;
+    }
+    if (c == '(' || c == ')') {
+        q->token = c == '(' ? TOK_OPEN : TOK_CLOSE;
+        q->p++;
+        return;
+    }
+    if (c == '-' && !isWordEnd(q->p[1])) {
+        q->token = TOK_NOT;
+        q->p++;
+        return;
+    }
+
+    // A word, its field before the first ':', a quoted value kept whole
+    const char* start = q->p;
+    const char* colon = NULL;
+    while (!isWordEnd(*q->p) && *q->p != '"') {
+        if (*q->p == ':' && !colon) colon = q->p;
+        q->p++;
+    }
+    const char* value = colon ? colon + 1 : start;
+    size_t length;
+    if (*q->p == '"' && q->p == value) {
+        const char* close = strchr(q->p + 1, '"');
+        if (!close) {
+            fail(q, "missing closing quote", NULL);
+            q->token = TOK_END;
+            return;
+        }
+        value = q->p + 1;
+        length = (size_t)(close - value);
+        q->p = close + 1;
+    } else {
+        while (!isWordEnd(*q->p)) q->p++;
+        length = (size_t)(q->p - value);
+    }
+
+    if (!colon) {
+        size_t n = (size_t)(q->p - start);
+        if (start[0] != '"') {
+            if (n == 3 && strncasecmp(start, "AND", 3) == 0) q->token = TOK_AND;
+            else if (n == 2 && strncasecmp(start, "OR", 2) == 0) q->token = TOK_OR;
+            else if (n == 3 && strncasecmp(start, "NOT", 3) == 0) q->token = TOK_NOT;
+            else q->token = TOK_TERM;
+            if (q->token != TOK_TERM) return;
+        }
+    } else {
+        size_t n = (size_t)(colon - start);
+        if (n >= sizeof(q->field)) n = sizeof(q->field) - 1;
+        for (size_t i = 0; i < n; i++) q->field[i] = (char)tolower((unsigned char)start[i]);
+        q->field[n] = '\0';
+    }
+    q->token = TOK_TERM;
+    q->value = keepText(q, value, length);
+    if (!q->value) q->token = TOK_END;
+}
+
+static int newNode(queryparser* q, int kind) {
+    if (q->count >= QUERY_NODES) {
+        fail(q, "query too long", NULL);
+        return -1;
+    }
+    querynode* node = &q->nodes[q->count];
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->first = node->next = -1;
+    return q->count++;
+}
+
+// A priority: 1-3 or high/medium/low, 0 if neither
+static int parsePriority(const char* text) {
+    if (strcmp(text, "1") == 0 || strcasecmp(text, "high") == 0) return 1;
+    if (strcmp(text, "2") == 0 || strcasecmp(text, "medium") == 0) return 2;
+    if (strcmp(text, "3") == 0 || strcasecmp(text, "low") == 0) return 3;
+    return 0;
+}
+
+// A date key: DD/MM/YYYY or "today", 0 if neither
+static long parseDate(queryparser* q, const char* text) {
+    if (strcasecmp(text, "today") == 0) return queryDateKey(q->today);
+    date d;
+    char extra;
+    if (sscanf(text, "%d/%d/%d%c", &d.day, &d.month, &d.year, &extra) != 3 ||
+        !isValidDate(d.day, d.month, d.year)) {
+        return 0;
+    }
+    return queryDateKey(d);
+}
+
+// Splits value at ".." into *low and *high (each NULL if left open);
+// returns 1 if it was a range
+static int splitRange(char* value, char** low, char** high) {
+    char* dots = strstr(value, "..");
+    if (!dots) {
+        *low = *high = value;
+        return 0;
+    }
+    *dots = '\0';
+    *low = value[0] ? value : NULL;
+    *high = dots[2] ? dots + 2 : NULL;
+    return 1;
+}
+
+// Fills in the test for the current term
+static void parseTerm(queryparser* q, queryinsn* leaf) {
+    const char* field = q->field;
+    char* value = q->value;
+    char *low, *high, written[64];
+    snprintf(written, sizeof(written), "%s", value);
+    if (value[0] == '\0') {
+        fail(q, "empty value for", field[0] ? field : "keyword");
+        return;
+    }
+    leaf->text = value;
+
+    if (field[0] == '\0') {
+        leaf->op = Q_KEYWORD;
+    } else if (strcmp(field, "name") == 0) {
+        leaf->op = Q_NAME;
+    } else if (strcmp(field, "desc") == 0 || strcmp(field, "description") == 0) {
+        leaf->op = Q_DESCRIPTION;
+    } else if (strcmp(field, "tag") == 0) {
+        leaf->op = Q_TAG;
+    } else if (strcmp(field, "priority") == 0) {
+        leaf->op = Q_PRIORITY;
+        splitRange(value, &low, &high);
+        leaf->low = low ? parsePriority(low) : 1;
+        leaf->high = high ? parsePriority(high) : 3;
+        if (!leaf->low || !leaf->high) fail(q, "bad priority", written);
+        if (leaf->low > leaf->high) {
+            long swap = leaf->low;
+            leaf->low = leaf->high;
+            leaf->high = swap;
+        }
+    } else if (strcmp(field, "status") == 0) {
+        leaf->op = Q_STATUS;
+        if (strcasecmp(value, "pending") == 0) leaf->status = PENDING;
+        else if (strcasecmp(value, "overdue") == 0) leaf->status = OVERDUE;
+        else if (strcasecmp(value, "completed") == 0 || strcasecmp(value, "done") == 0) leaf->status = COMPLETED;
+        else fail(q, "unknown status", value);
+    } else if (strcmp(field, "due") == 0 || strcmp(field, "done") == 0) {
+        leaf->op = field[1] == 'u' ? Q_DUE : Q_DONE;
+        if (leaf->op == Q_DUE && strcasecmp(value, "none") == 0) {
+            leaf->op = Q_NO_DUE;
+            return;
+        }
+        splitRange(value, &low, &high);
+        leaf->low = low ? parseDate(q, low) : 1;
+        leaf->high = high ? parseDate(q, high) : LONG_MAX;
+        if (!leaf->low || !leaf->high) fail(q, "bad date", written);
+        leaf->text = NULL;
+    } else {
+        fail(q, "unknown field", field);
+    }
+}
+
+static int parseOr(queryparser* q);
+
+// term | NOT unary | ( or )
+static int parseUnary(queryparser* q) {
+    if (q->failed) return -1;
+    if (q->token == TOK_NOT) {
+        advance(q);
+        int child = parseUnary(q);
+        int node = newNode(q, NODE_NOT);
+        if (child < 0 || node < 0) return -1;
+        q->nodes[node].first = child;
+        q->nodes[node].cost = q->nodes[child].cost;
+        return node;
+    }
+    if (q->token == TOK_OPEN) {
+        advance(q);
+        int inner = parseOr(q);
+        if (q->token != TOK_CLOSE) {
+            fail(q, "missing ')'", NULL);
+            return -1;
+        }
+        advance(q);
+        return inner;
+    }
+    if (q->token != TOK_TERM) {
+        fail(q, q->token == TOK_CLOSE ? "unexpected ')'" : "expected a search term", NULL);
+        return -1;
+    }
+    if (++q->leaves > QUERY_MAX_TERMS) {
+        fail(q, "too many terms", NULL);
+        return -1;
+    }
+    int node = newNode(q, NODE_LEAF);
+    if (node < 0) return -1;
+    parseTerm(q, &q->nodes[node].leaf);
+    q->nodes[node].cost = op_costs[q->nodes[node].leaf.op];
+    advance(q);
+    return q->failed ? -1 : node;
+}
+
+// Parses operands joined by kind (AND: also side by side) into one node
+static int parseList(queryparser* q, int kind) {
+    int first = kind == NODE_AND ? parseUnary(q) : parseList(q, NODE_AND);
+    if (first < 0) return -1;
+    int last = first, count = 1, cost = q->nodes[first].cost;
+    for (;;) {
+        if (kind == NODE_OR && q->token != TOK_OR) break;
+        if (kind == NODE_AND && q->token != TOK_AND && q->token != TOK_TERM &&
+            q->token != TOK_NOT && q->token != TOK_OPEN) {
+            break;
+        }
+        if (q->token == TOK_AND || q->token == TOK_OR) advance(q);
+        int next = kind == NODE_AND ? parseUnary(q) : parseList(q, NODE_AND);
+        if (next < 0) return -1;
+        q->nodes[last].next = next;
+        last = next;
+        count++;
+        cost += q->nodes[next].cost;
+    }
+    if (count == 1) return first;
+    int node = newNode(q, kind);
+    if (node < 0) return -1;
+    q->nodes[node].first = first;
+    q->nodes[node].cost = cost;
+    return node;
+}
+
+static int parseOr(queryparser* q) {
+    return parseList(q, NODE_OR);
+}
+
+// Emits node so it goes to on_true or on_false; returns its first
+// instruction. Code is emitted last test first, so targets already exist.
+static int emit(queryparser* q, int index, int on_true, int on_false, int keep_order) {
+    querynode* node = &q->nodes[index];
+    if (node->kind == NODE_LEAF) {
+        queryinsn* insn = &q->program->code[q->program->length];
+        *insn = node->leaf;
+        insn->on_true = (short)on_true;
+        insn->on_false = (short)on_false;
+        return q->program->length++;
+    }
+    if (node->kind == NODE_NOT) return emit(q, node->first, on_false, on_true, keep_order);
+
+    int children[QUERY_NODES];
+    int count = 0;
+    for (int child = node->first; child >= 0; child = q->nodes[child].next) {
+        // Cheapest first; ties keep the order written
+        int at = count++;
+        while (!keep_order && at > 0 && q->nodes[children[at - 1]].cost > q->nodes[child].cost) {
+            children[at] = children[at - 1];
+            at--;
+        }
+        children[at] = child;
+    }
+    int entry = node->kind == NODE_AND ? on_true : on_false;
+    for (int i = count - 1; i >= 0; i--) {
+        entry = node->kind == NODE_AND ? emit(q, children[i], entry, on_false, keep_order)
+                                       : emit(q, children[i], on_true, entry, keep_order);
+    }
+    return entry;
+}
+
+/*
+queryCompile() - Parses a query expression into a program for queryRun()
+ - Time: O(m) for an expression of m characters, Space: O(1)
+ - today stands in for "today" in dates. QUERY_KEEP_ORDER tests terms in
+   the order written instead of cheapest first.
+ - An empty expression matches every task
+ - Returns TODO_OK, or TODO_PARSE_ERROR with a message in error (if given)
+ - Sample Case:
+    Input: "desc:invoice AND priority:1 AND NOT status:overdue"
+    Output: TODO_OK; the program tests priority, then status, then the
+            description, stopping at the first that fails
+ */
+todostatus queryCompile(const char* expression, date today, int options, queryprogram* program,
+                        char* error, size_t size) {
+    queryparser* q = (queryparser*)calloc(1, sizeof(queryparser));
+    if (!q) return TODO_NO_MEMORY;
+    memset(program, 0, sizeof(*program));
+    program->entry = QUERY_ACCEPT;
+    if (error && size) error[0] = '\0';
+    q->p = expression;
+    q->program = program;
+    q->today = today;
+    q->error = error;
+    q->size = size;
+
+    advance(q);
+    if (q->token != TOK_END) {
+        int root = parseOr(q);
+        if (!q->failed && q->token != TOK_END) {
+            fail(q, q->token == TOK_CLOSE ? "unexpected ')'" : "unexpected text", NULL);
+        }
+        if (!q->failed) {
+            int entry = emit(q, root, QUERY_ACCEPT, QUERY_REJECT, options & QUERY_KEEP_ORDER);
+            // Reverse, so the program reads in the order it runs
+            int n = program->length;
+            for (int i = 0; i < n / 2; i++) {
+                queryinsn swap = program->code[i];
+                program->code[i] = program->code[n - 1 - i];
+                program->code[n - 1 - i] = swap;
+            }
+            for (int i = 0; i < n; i++) {
+                if (program->code[i].on_true >= 0) program->code[i].on_true = (short)(n - 1 - program->code[i].on_true);
+                if (program->code[i].on_false >= 0) program->code[i].on_false = (short)(n - 1 - program->code[i].on_false);
+            }
+            program->entry = n - 1 - entry;
+        }
+    }
+    int failed = q->failed;
+    free(q);
+    if (failed) {
+        memset(program, 0, sizeof(*program));
+        program->entry = QUERY_REJECT;
+        return TODO_PARSE_ERROR;
+    }
+    return TODO_OK;
+}
+
+// Whether t has exactly the tag text
+static int hasTag(const task* t, const char* text, int contains) {
+    int tag_count = __atomic_load_n(&t->tag_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < tag_count; i++) {
+        if (contains ? strstr(t->tags[i], text) != NULL : strcmp(t->tags[i], text) == 0) return 1;
+    }
+    return 0;
+}
+
+/*
+queryRun() - Tests a task against a compiled query
+ - Time: O(tests made), one integer compare each for priority, status and
+   dates, a scan of the text for text terms, Space: O(1)
+ - Safe from any number of threads at once, as todoMatches() is
+ - Example: queryRun(&program, t) -> 1 if t matches
+ */
+int queryRun(const queryprogram* program, const task* t) {
+    int pc = program->entry;
+    while (pc >= 0) {
+        const queryinsn* insn = &program->code[pc];
+        int hit = 0;
+        switch (insn->op) {
+            case Q_PRIORITY:
+                hit = t->priority >= insn->low && t->priority <= insn->high;
+                break;
+            case Q_STATUS:
+                hit = (TaskStatus)__atomic_load_n(&t->status, __ATOMIC_RELAXED) == insn->status;
+                break;
+            case Q_DUE:
+                if (t->due_date_set) {
+                    long key = queryDateKey(t->duedate);
+                    hit = key >= insn->low && key <= insn->high;
+                }
+                break;
+            case Q_NO_DUE:
+                hit = !t->due_date_set;
+                break;
+            case Q_DONE:
+                if (t->completed && t->completed_date.year) {
+                    long key = queryDateKey(t->completed_date);
+                    hit = key >= insn->low && key <= insn->high;
+                }
+                break;
+            case Q_TAG:
+                hit = hasTag(t, insn->text, 0);
+                break;
+            case Q_NAME:
+                hit = strstr(t->name, insn->text) != NULL;
+                break;
+            case Q_DESCRIPTION:
+                hit = strstr(t->description, insn->text) != NULL;
+                break;
+            case Q_KEYWORD:
+                hit = strstr(t->name, insn->text) || strstr(t->description, insn->text) ||
+                      hasTag(t, insn->text, 1);
+                break;
+        }
+        pc = hit ? insn->on_true : insn->on_false;
+    }
+    return pc == QUERY_ACCEPT;
+}
+
+// Writes a jump target
+static const char* targetText(int target, char* text, size_t size) {
+    if (target == QUERY_ACCEPT) return "match";
+    if (target == QUERY_REJECT) return "no match";
+    snprintf(text, size, "%d", target);
+    return text;
+}
+
+// Writes the date bound of a range, empty if open
+static void boundText(long key, char* text, size_t size) {
+    if (key <= 1 || key == LONG_MAX) {
+        text[0] = '\0';
+        return;
+    }
+    date d = keyDate(key);
+    snprintf(text, size, "%02d/%02d/%04d", d.day, d.month, d.year);
+}
+
+/*
+queryFormat() - Lists a compiled query, one test per line, in the order run
+ - Time: O(length), Space: O(1)
+ - Returns the number of characters written (as snprintf, at most size - 1)
+ - Sample Case:
+    Input: "tag:work desc:invoice"
+    Output:
+       0  tag "work"                   yes: 1         no: no match
+       1  desc "invoice"               yes: match     no: no match
+ */
+int queryFormat(const queryprogram* program, char* text, size_t size) {
+    static const char* const status_names[] = {"pending", "overdue", "completed"};
+    size_t used = 0;
+    if (size) text[0] = '\0';
+    if (program->length == 0) {
+        int n = snprintf(text, size, "%s\n", program->entry == QUERY_ACCEPT ? "every task" : "no task");
+        return n < (int)size ? n : (int)size - 1;
+    }
+    for (int i = 0; i < program->length && used + 1 < size; i++) {
+        const queryinsn* insn = &program->code[i];
+        char test[160], yes[12], no[12], low[16], high[16];
+        switch (insn->op) {
+            case Q_PRIORITY:
+                snprintf(test, sizeof(test), "priority %ld..%ld", insn->low, insn->high);
+                break;
+            case Q_STATUS:
+                snprintf(test, sizeof(test), "status %s",
+                         insn->status <= COMPLETED ? status_names[insn->status] : "?");
+                break;
+            case Q_NO_DUE:
+                snprintf(test, sizeof(test), "due none");
+                break;
+            case Q_DUE:
+            case Q_DONE:
+                boundText(insn->low, low, sizeof(low));
+                boundText(insn->high, high, sizeof(high));
+                snprintf(test, sizeof(test), "%s %s..%s", op_names[insn->op], low, high);
+                break;
+            default:
+                snprintf(test, sizeof(test), "%s \"%s\"", op_names[insn->op], insn->text);
+        }
+        int n = snprintf(text + used, size - used, "%2d  %-28s yes: %-9s no: %s\n", i, test,
+                         targetText(insn->on_true, yes, sizeof(yes)),
+                         targetText(insn->on_false, no, sizeof(no)));
+        if (n < 0) break;
+        used += (size_t)n < size - used ? (size_t)n : size - used - 1;
+    }
+    return (int)used;
+}
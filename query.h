@@ -0,0 +1,70 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+// Query expressions: several criteria in one search, e.g.
+//     tag:work AND priority:1..2 AND NOT status:overdue
+//     (name:report OR desc:"quarterly review") due:01/05/2025..31/05/2025
+//     done:..today AND -tag:home
+// Fields are name, desc, tag, priority, status, due and done (the day a
+// task was completed); a bare word matches name, description or a tag.
+// Terms side by side are ANDed; AND binds tighter than OR; NOT (or a
+// leading -) negates; parentheses group. Ranges are low..high with either
+// end left open.
+//
+// queryCompile() parses an expression once into a flat program: one test
+// per instruction, each naming the instruction to go to when it holds and
+// when it does not, so evaluation stops as soon as the outcome is known.
+// Within each AND and OR the cheap tests (priority, status, dates) are put
+// before tag and text searches, so most tasks are rejected by an integer
+// compare. queryRun() then costs no parsing, allocation or recursion.
+// A todoquery of type TODO_MATCH_EXPRESSION runs a program, so searches,
+// bulk actions and batch queries all take expressions.
+
+#include "libtodo.h"
+
+#define QUERY_MAX_TERMS 32
+#define QUERY_TEXT_MAX 512
+
+// Jump targets that end a run
+#define QUERY_ACCEPT (-1)
+#define QUERY_REJECT (-2)
+
+// Tests an instruction can make, in rough order of cost
+typedef enum {
+    Q_PRIORITY,      // low <= priority <= high
+    Q_STATUS,        // status == status
+    Q_DUE,           // has a due date, low <= its key <= high
+    Q_NO_DUE,        // has no due date
+    Q_DONE,          // completed, low <= key of the day it was <= high
+    Q_TAG,           // has the tag text
+    Q_NAME,          // name contains text
+    Q_DESCRIPTION,   // description contains text
+    Q_KEYWORD        // name, description or a tag contains text
+} queryop;
+
+// Compile options
+#define QUERY_KEEP_ORDER 1   // test in the order written (for comparison)
+
+typedef struct {
+    unsigned char op;        // queryop
+    unsigned char status;    // TaskStatus for status tests
+    short on_true;           // next instruction, or QUERY_ACCEPT / QUERY_REJECT
+    short on_false;
+    long low, high;          // priority or date key range
+    const char* text;        // into the program's text
+} queryinsn;
+
+typedef struct queryprogram {
+    queryinsn code[QUERY_MAX_TERMS];
+    int length;
+    int entry;               // first instruction
+    char text[QUERY_TEXT_MAX];
+} queryprogram;             // text terms point into it: do not copy one
+
+todostatus queryCompile(const char* expression, date today, int options, queryprogram* program,
+                        char* error, size_t size);
+int queryRun(const queryprogram* program, const task* t);
+int queryFormat(const queryprogram* program, char* text, size_t size);
+long queryDateKey(date d);
+
+#endif
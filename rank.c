@@ -0,0 +1,408 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "rank.h"
+#include "feed.h"
+
+typedef struct {
+    int row;
+    unsigned short name_count;     // times the word is in the name
+    unsigned short desc_count;     // and in the description
+} rankposting;
+
+struct rankword {
+    char text[RANK_WORD_MAX];      // "" for an empty slot
+    rankposting* postings;         // by row
+    long count, capacity;
+    double idf;
+    double bound;                  // highest score a task gets from the word
+};
+
+static rankindex* default_ranking = NULL;
+
+static double rankNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static unsigned long hashWord(const char* text) {
+    unsigned long hash = 2166136261u;
+    for (; *text; text++) hash = (hash ^ (unsigned char)*text) * 16777619u;
+    return hash;
+}
+
+// Whether byte c is part of a word: letters, digits and bytes of UTF-8 sequences
+static int wordByte(unsigned char c) {
+    return c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Copies the next word at *p into word (lowercased, cut to RANK_WORD_MAX - 1
+// bytes) and moves *p past it; returns its length, 0 at the end
+static int nextWord(const char** p, char word[RANK_WORD_MAX]) {
+    const unsigned char* s = (const unsigned char*)*p;
+    while (*s && !wordByte(*s)) s++;
+    int n = 0;
+    for (; wordByte(*s); s++) {
+        if (n < RANK_WORD_MAX - 1) word[n++] = (char)(*s >= 'A' && *s <= 'Z' ? *s + ('a' - 'A') : *s);
+    }
+    word[n] = '\0';
+    *p = (const char*)s;
+    return n;
+}
+
+static rankword* findWord(const rankindex* set, const char* text) {
+    if (!set->word_slots) return NULL;
+    unsigned long mask = (unsigned long)set->word_slots - 1;
+    for (unsigned long i = hashWord(text) & mask;; i = (i + 1) & mask) {
+        rankword* slot = &set->words[i];
+        if (!slot->text[0]) return NULL;
+        if (strcmp(slot->text, text) == 0) return slot;
+    }
+}
+
+// Doubles the word table
+static int growWords(rankindex* set) {
+    long slots = set->word_slots ? set->word_slots * 2 : 1024;
+    rankword* old = set->words;
+    long old_slots = set->word_slots;
+    set->words = (rankword*)calloc((size_t)slots, sizeof(rankword));
+    if (!set->words) {
+        set->words = old;
+        return -1;
+    }
+    set->word_slots = slots;
+    for (long i = 0; i < old_slots; i++) {
+        if (!old[i].text[0]) continue;
+        unsigned long mask = (unsigned long)slots - 1;
+        unsigned long j = hashWord(old[i].text) & mask;
+        while (set->words[j].text[0]) j = (j + 1) & mask;
+        set->words[j] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+// Counts word in row's name (field 0) or description (field 1)
+static int addWord(rankindex* set, const char* text, int row, int field) {
+    rankword* word = findWord(set, text);
+    if (!word) {
+        if ((set->word_count + 1) * 2 > set->word_slots && growWords(set) != 0) return -1;
+        unsigned long mask = (unsigned long)set->word_slots - 1;
+        unsigned long i = hashWord(text) & mask;
+        while (set->words[i].text[0]) i = (i + 1) & mask;
+        word = &set->words[i];
+        strcpy(word->text, text);
+        set->word_count++;
+    }
+    if (!word->count || word->postings[word->count - 1].row != row) {
+        if (word->count == word->capacity) {
+            long grown = word->capacity ? word->capacity * 2 : 4;
+            rankposting* bigger = (rankposting*)realloc(word->postings, sizeof(rankposting) * grown);
+            if (!bigger) return -1;
+            word->postings = bigger;
+            word->capacity = grown;
+        }
+        word->postings[word->count++] = (rankposting){row, 0, 0};
+        set->postings++;
+    }
+    rankposting* posting = &word->postings[word->count - 1];
+    unsigned short* count = field ? &posting->desc_count : &posting->name_count;
+    if (*count < 65535) (*count)++;
+    return 0;
+}
+
+// Indexes the words of text for row; returns how many there were, -1 if out of memory
+static long addField(rankindex* set, const char* text, int row, int field) {
+    char word[RANK_WORD_MAX];
+    long words = 0;
+    while (nextWord(&text, word)) {
+        if (addWord(set, word, row, field) != 0) return -1;
+        words++;
+    }
+    return words;
+}
+
+// Score of one posting of word
+static double scorePosting(const rankindex* set, const rankword* word, const rankposting* posting) {
+    double tf = RANK_NAME_WEIGHT * posting->name_count / set->name_norms[posting->row] +
+                RANK_DESC_WEIGHT * posting->desc_count / set->desc_norms[posting->row];
+    return word->idf * tf / (RANK_K1 + tf);
+}
+
+/*
+rankInit() - Makes an empty index
+ - Time: O(1), Space: O(1)
+ - Example: rankindex set; rankInit(&set); rankBuild(&set, &list, &stack);
+ */
+void rankInit(rankindex* set) {
+    memset(set, 0, sizeof(*set));
+}
+
+/*
+rankFree() - Frees the index (the tasks are not touched) and empties it
+ - Time: O(words), Space: O(1)
+ */
+void rankFree(rankindex* set) {
+    for (long i = 0; i < set->word_slots; i++) free(set->words[i].postings);
+    free(set->words);
+    free(set->rows);
+    free(set->name_norms);
+    free(set->desc_norms);
+    rankInit(set);
+}
+
+/*
+rankSetDefault() - Sets the index searchTasks() ranks with (NULL: none)
+ - Time: O(1), Space: O(1)
+ */
+void rankSetDefault(rankindex* set) {
+    __atomic_store_n(&default_ranking, set, __ATOMIC_RELEASE);
+}
+
+/*
+rankDefault() - The index searchTasks() ranks with, or NULL
+ - Time: O(1), Space: O(1)
+ */
+rankindex* rankDefault() {
+    return __atomic_load_n(&default_ranking, __ATOMIC_ACQUIRE);
+}
+
+/*
+rankBuild() - Indexes the words of every task's name and description
+ - Time: O(total words), Space: O(distinct words per task, summed)
+ - Rows are the list in order, then the stack from the top
+ - Returns 0, or -1 if out of memory (the index is left empty)
+ - Example: rankBuild(&set, &list, &stack) -> set.count == tasks + completed
+ */
+int rankBuild(rankindex* set, tasklist* list, completedstack* stack) {
+    double start = rankNowMs();
+    changefeed* feed = feedDefault();
+    unsigned long built_at = feed ? feedHead(feed) : 0;
+    rankFree(set);
+
+    long count = 0;
+    for (task* t = list->head; t; t = t->next) count++;
+    long active = count;
+    for (stacknode* node = stack->top; node; node = node->next) count += node->task_data != NULL;
+
+    set->rows = (task**)malloc(sizeof(task*) * (count ? count : 1));
+    set->name_norms = (float*)malloc(sizeof(float) * (count ? count : 1));
+    set->desc_norms = (float*)malloc(sizeof(float) * (count ? count : 1));
+    if (!set->rows || !set->name_norms || !set->desc_norms) goto failed;
+    for (task* t = list->head; t; t = t->next) set->rows[set->count++] = t;
+    for (stacknode* node = stack->top; node; node = node->next) {
+        if (node->task_data) set->rows[set->count++] = node->task_data;
+    }
+    set->active = active;
+
+    // Lengths first, turned into factors once the averages are known
+    double name_words = 0, desc_words = 0;
+    for (long row = 0; row < count; row++) {
+        long name = addField(set, set->rows[row]->name, (int)row, 0);
+        long desc = addField(set, set->rows[row]->description, (int)row, 1);
+        if (name < 0 || desc < 0) goto failed;
+        set->name_norms[row] = (float)name;
+        set->desc_norms[row] = (float)desc;
+        name_words += name;
+        desc_words += desc;
+    }
+    set->average_name = count ? name_words / count : 0;
+    set->average_desc = count ? desc_words / count : 0;
+    for (long row = 0; row < count; row++) {
+        set->name_norms[row] = (float)(1 - RANK_B + (set->average_name > 0 ? RANK_B * set->name_norms[row] / set->average_name : 0));
+        set->desc_norms[row] = (float)(1 - RANK_B + (set->average_desc > 0 ? RANK_B * set->desc_norms[row] / set->average_desc : 0));
+    }
+
+    for (long i = 0; i < set->word_slots; i++) {
+        rankword* word = &set->words[i];
+        if (!word->text[0]) continue;
+        word->idf = log(1 + (count - word->count + 0.5) / (word->count + 0.5));
+        for (long p = 0; p < word->count; p++) {
+            double score = scorePosting(set, word, &word->postings[p]);
+            if (score > word->bound) word->bound = score;
+        }
+    }
+
+    set->built_at = built_at;
+    set->built = 1;
+    set->build_ms = rankNowMs() - start;
+    return 0;
+
+failed:
+    rankFree(set);
+    return -1;
+}
+
+/*
+rankRefresh() - Rebuilds the index if a change was recorded since it was built
+ - Time: O(1) when current, else that of rankBuild()
+ - With no change feed set there is no way to tell, so it always rebuilds
+ - Returns 1 if it rebuilt, 0 if the index was current, -1 if out of memory
+ */
+int rankRefresh(rankindex* set, tasklist* list, completedstack* stack) {
+    changefeed* feed = feedDefault();
+    if (set->built && feed && feedHead(feed) == set->built_at) return 0;
+    return rankBuild(set, list, stack) == 0 ? 1 : -1;
+}
+
+// First position from `from` on whose row is at least row: doubling steps,
+// then a binary search between the last two
+static long seekRow(const rankword* word, long from, long row) {
+    long low = from, high = from, step = 1;
+    while (high < word->count && word->postings[high].row < row) {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    if (high > word->count) high = word->count;
+    while (low < high) {
+        long middle = low + (high - low) / 2;
+        if (word->postings[middle].row < row) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+// Whether hit a ranks below hit b: lower score, or the same score and a later row
+static int ranksBelow(const rankhit* a, const rankhit* b) {
+    return a->score < b->score || (a->score == b->score && a->row > b->row);
+}
+
+// Restores the min-heap order from position i down
+static void siftDown(rankhit* heap, int size, int i) {
+    for (;;) {
+        int lowest = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && ranksBelow(&heap[left], &heap[lowest])) lowest = left;
+        if (right < size && ranksBelow(&heap[right], &heap[lowest])) lowest = right;
+        if (lowest == i) return;
+        rankhit swap = heap[i];
+        heap[i] = heap[lowest];
+        heap[lowest] = swap;
+        i = lowest;
+    }
+}
+
+static void siftUp(rankhit* heap, int i) {
+    while (i > 0 && ranksBelow(&heap[i], &heap[(i - 1) / 2])) {
+        rankhit swap = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = swap;
+        i = (i - 1) / 2;
+    }
+}
+
+static int compareHits(const void* a, const void* b) {
+    const rankhit* x = (const rankhit*)a;
+    const rankhit* y = (const rankhit*)b;
+    if (ranksBelow(x, y)) return 1;
+    return ranksBelow(y, x) ? -1 : 0;
+}
+
+/*
+rankSearch() - The k best matches for the words of text, best first
+ - Time: O(k log k + the postings read * log k); with MaxScore only the
+   lists of words that can still lift a task into the top k are walked,
+   and the others are searched (O(log) each) for the tasks found, Space: O(1)
+ - A task matches if it holds any of the words; ties go to the earlier
+   row. RANK_EXHAUSTIVE walks every list whole, with the same results.
+ - Returns the number of hits (at most k) written to hits
+ - Sample Case:
+    Input: "quarterly report", k = 2, over "Quarterly report" (name),
+           "Report" (name, description "draft the quarterly numbers") and
+           5000 tasks whose descriptions mention a report
+    Output: 2; "Quarterly report", then "Report": both words, and in the name
+ */
+int rankSearch(const rankindex* set, const char* text, int k, int options, rankhit* hits,
+               rankstats* stats) {
+    const rankword* words[RANK_QUERY_WORDS];
+    long cursors[RANK_QUERY_WORDS];
+    double reach[RANK_QUERY_WORDS];    // bounds of words 0..i summed
+    double scores[RANK_QUERY_WORDS];
+    char word[RANK_WORD_MAX];
+    int n = 0;
+    rankstats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    while (n < RANK_QUERY_WORDS && nextWord(&text, word)) {
+        const rankword* found = findWord(set, word);
+        int repeated = 0;
+        for (int i = 0; i < n; i++) repeated |= words[i] == found;
+        if (found && !repeated) words[n++] = found;
+    }
+    if (k <= 0 || n == 0) return 0;
+
+    // Weakest word first
+    for (int i = 1; i < n; i++) {
+        const rankword* moving = words[i];
+        int j = i;
+        for (; j > 0 && words[j - 1]->bound > moving->bound; j--) words[j] = words[j - 1];
+        words[j] = moving;
+    }
+    for (int i = 0; i < n; i++) {
+        cursors[i] = 0;
+        reach[i] = (i ? reach[i - 1] : 0) + words[i]->bound;
+        stats->postings += words[i]->count;
+    }
+    stats->words = n;
+
+    int size = 0;
+    int essential = 0;         // words before this cannot lift a task into the top k alone
+    for (;;) {
+        long row = -1;
+        for (int i = essential; i < n; i++) {
+            if (cursors[i] < words[i]->count && (row < 0 || words[i]->postings[cursors[i]].row < row)) {
+                row = words[i]->postings[cursors[i]].row;
+            }
+        }
+        if (row < 0) break;
+
+        double partial = 0;
+        for (int i = essential; i < n; i++) {
+            scores[i] = 0;
+            if (cursors[i] < words[i]->count && words[i]->postings[cursors[i]].row == row) {
+                scores[i] = scorePosting(set, words[i], &words[i]->postings[cursors[i]++]);
+                partial += scores[i];
+                stats->read++;
+            }
+        }
+        int dropped = 0;
+        for (int i = essential - 1; i >= 0; i--) {
+            scores[i] = 0;
+            if (size == k && partial + reach[i] <= hits[0].score) {
+                dropped = 1;
+                break;
+            }
+            cursors[i] = seekRow(words[i], cursors[i], row);
+            stats->read++;
+            if (cursors[i] < words[i]->count && words[i]->postings[cursors[i]].row == row) {
+                scores[i] = scorePosting(set, words[i], &words[i]->postings[cursors[i]]);
+                partial += scores[i];
+            }
+        }
+        stats->scored++;
+        if (dropped) continue;
+
+        // Summed in one order, so every way of reaching a task scores it alike
+        rankhit hit = {set->rows[row], row, 0};
+        for (int i = 0; i < n; i++) hit.score += scores[i];
+        if (size < k) {
+            hits[size] = hit;
+            siftUp(hits, size++);
+        } else if (ranksBelow(&hits[0], &hit)) {
+            hits[0] = hit;
+            siftDown(hits, size, 0);
+        } else {
+            continue;
+        }
+        if (size == k && !(options & RANK_EXHAUSTIVE)) {
+            while (essential < n && reach[essential] <= hits[0].score) essential++;
+        }
+    }
+
+    qsort(hits, (size_t)size, sizeof(rankhit), compareHits);
+    return size;
+}
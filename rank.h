@@ -0,0 +1,87 @@
+#ifndef RANK_H
+#define RANK_H
+
+// Ranked text search: the K tasks that best match some words, best first.
+//
+// Tasks are scored with BM25 over two fields (BM25F). For each query
+// word, its count in the name (weighted RANK_NAME_WEIGHT) and in the
+// description (weighted RANK_DESC_WEIGHT) are each divided by how long
+// that field is against the average. The sum tf is scored
+// idf * tf / (RANK_K1 + tf), where idf = ln(1 + (N - df + 0.5) / (df + 0.5))
+// for a word in df of N tasks. Words found in few tasks count for more,
+// each further repeat counts for less, and a short name holding the word
+// beats a long description holding it.
+//
+// The index holds every task (active, then completed) as numbered rows:
+//  - for each word (lowercased letters and digits) its postings, in row
+//    order: the row and the word's count in name and description
+//  - per word, its idf and the highest score any task gets from it
+//  - per row, the two length factors
+// and is rebuilt by rankRefresh() when the change feed (feed.h) has moved,
+// like the query planner's (plan.h).
+//
+// rankSearch() keeps the best K so far in a min-heap, whose top is the
+// score to beat. Words are ordered by their highest score (MaxScore).
+// Once the weakest words together cannot reach the score to beat, a task
+// holding only those words cannot make the top K. Their lists are then
+// no longer walked, only searched for the tasks the stronger words bring
+// up. Even that search stops as soon as what is left to add cannot beat
+// the K-th score. A word found in half of all tasks is thus mostly never
+// read.
+
+#include "libtodo.h"
+
+#define RANK_WORD_MAX 24        // words are cut to 23 bytes
+#define RANK_QUERY_WORDS 16
+#define RANK_DEFAULT_K 10
+#define RANK_NAME_WEIGHT 3.0
+#define RANK_DESC_WEIGHT 1.0
+#define RANK_K1 1.2
+#define RANK_B 0.75
+
+// Search options
+#define RANK_EXHAUSTIVE 1       // score every task holding a word (for comparison)
+
+typedef struct rankword rankword;
+
+typedef struct {
+    task** rows;             // active tasks in list order, then completed ones
+    long count;
+    long active;             // rows before this are in the list
+    float* name_norms;       // 1 - b + b * length / average length, per row
+    float* desc_norms;
+    rankword* words;         // open-addressed by word
+    long word_slots;
+    long word_count;
+    long postings;
+    double average_name;     // words per name
+    double average_desc;
+    unsigned long built_at;  // feed head when built
+    int built;
+    double build_ms;
+} rankindex;
+
+typedef struct {
+    task* t;
+    long row;
+    double score;
+} rankhit;
+
+// What a search did, for the benchmark and the debug menu
+typedef struct {
+    int words;               // query words found in the index
+    long postings;           // postings of those words
+    long scored;             // tasks looked at
+    long read;               // postings read or searched for
+} rankstats;
+
+void rankInit(rankindex* set);
+void rankFree(rankindex* set);
+void rankSetDefault(rankindex* set);
+rankindex* rankDefault();
+int rankBuild(rankindex* set, tasklist* list, completedstack* stack);
+int rankRefresh(rankindex* set, tasklist* list, completedstack* stack);
+int rankSearch(const rankindex* set, const char* text, int k, int options, rankhit* hits,
+               rankstats* stats);
+
+#endif
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "recurrence.h"
+
+static const char* const weekday_names[] = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+
+static int daysInMonth(int month, int year) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+static int validRule(const recurrence* rule) {
+    switch (rule->kind) {
+        case RECUR_NONE:
+        case RECUR_DAILY: return 1;
+        case RECUR_WEEKLY: return rule->weekdays != 0 && rule->weekdays < 0x80;
+        case RECUR_MONTHLY: return rule->n >= 1 && rule->n <= 31;
+        case RECUR_EVERY: return rule->n >= 1 && rule->n <= RECUR_MAX_EVERY;
+    }
+    return 0;
+}
+
+/*
+recurNext() - The occurrence that follows `after`
+ - Time: O(1), Space: O(1)
+ - For the calendar rules after may be any day; for RECUR_EVERY it must be
+   an occurrence (the series counts on from it)
+ - Returns 0, or -1 for a task that does not repeat
+ - Sample Case:
+    Input: monthly on day 31, after 31/01/2025
+    Output: 0, next = 28/02/2025
+ */
+int recurNext(const recurrence* rule, date after, date* next) {
+    long day = todoDayNumber(after);
+    switch (rule->kind) {
+        case RECUR_DAILY:
+            *next = todoDateFromDay(day + 1);
+            return 0;
+        case RECUR_EVERY:
+            *next = todoDateFromDay(day + rule->n);
+            return 0;
+        case RECUR_WEEKLY: {
+            int weekday = todoWeekday(after);
+            for (int i = 1; i <= 7; i++) {
+                if (rule->weekdays & (1 << ((weekday + i) % 7))) {
+                    *next = todoDateFromDay(day + i);
+                    return 0;
+                }
+            }
+            return -1;
+        }
+        case RECUR_MONTHLY: {
+            date d = after;
+            int wanted = rule->n < daysInMonth(d.month, d.year) ? rule->n : daysInMonth(d.month, d.year);
+            if (d.day >= wanted) {
+                if (++d.month > 12) {
+                    d.month = 1;
+                    d.year++;
+                }
+                wanted = rule->n < daysInMonth(d.month, d.year) ? rule->n : daysInMonth(d.month, d.year);
+            }
+            d.day = wanted;
+            *next = d;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+recurSet() - Gives t a repeat rule (RECUR_NONE stops it repeating)
+ - Time: O(1), Space: O(1)
+ - A task without a due date gets the first occurrence on or after today.
+   Its reminders are not rescheduled here; callers that moved the due date
+   do that.
+ - Returns TODO_INVALID_RECURRENCE for an unknown kind, an empty weekday
+   mask, a day of the month outside 1-31 or an interval outside
+   1-RECUR_MAX_EVERY
+ - Example: recurSet(t, &(recurrence){RECUR_WEEKLY, 0x09, 0}, today) -> TODO_OK, Mondays and Thursdays
+ */
+todostatus recurSet(task* t, const recurrence* rule, date today) {
+    if (!validRule(rule)) return TODO_INVALID_RECURRENCE;
+    if (rule->kind != RECUR_NONE && !t->due_date_set) {
+        date first = today;
+        if (rule->kind != RECUR_EVERY) recurNext(rule, todoDateFromDay(todoDayNumber(today) - 1), &first);
+        t->duedate = first;
+        t->due_date_set = 1;
+    }
+    t->repeat = *rule;
+    return TODO_OK;
+}
+
+/*
+recurExpand() - Occurrences of t due from `from` to `to` (inclusive), in order
+ - Time: O(occurrences), Space: O(1)
+ - The first is t's own due date; the rest follow from the rule. Occurrences
+   before from are skipped without walking them. A task that does not
+   repeat gives its due date if it is in the window.
+ - Returns the number written to out (at most max)
+ - Sample Case:
+    Input: daily task due 05/05/2025, window 01/05/2025 to 07/05/2025
+    Output: 3 (05/05, 06/05, 07/05)
+ */
+int recurExpand(const task* t, date from, date to, date out[], int max) {
+    if (!t->due_date_set || max <= 0) return 0;
+    long low = todoDayNumber(from), high = todoDayNumber(to);
+    long day = todoDayNumber(t->duedate);
+    date d = t->duedate;
+    if (day > high) return 0;
+
+    int count = 0;
+    if (day >= low) {
+        out[count++] = d;
+    } else if (t->repeat.kind == RECUR_NONE) {
+        return 0;
+    } else {
+        // First occurrence inside the window
+        if (t->repeat.kind == RECUR_EVERY) {
+            day += (low - day + t->repeat.n - 1) / t->repeat.n * t->repeat.n;
+            d = todoDateFromDay(day);
+        } else {
+            recurNext(&t->repeat, todoDateFromDay(low - 1), &d);
+            day = todoDayNumber(d);
+        }
+        if (day > high) return 0;
+        out[count++] = d;
+    }
+    if (t->repeat.kind == RECUR_NONE) return count;
+
+    while (count < max) {
+        recurNext(&t->repeat, d, &d);
+        if (todoDayNumber(d) > high) break;
+        out[count++] = d;
+    }
+    return count;
+}
+
+// Weekday number (0 Monday) of a name or number 1-7, -1 if neither
+static int parseWeekday(const char* word) {
+    if (word[0] >= '1' && word[0] <= '7' && word[1] == '\0') return word[0] - '1';
+    for (int i = 0; i < 7; i++) {
+        if (strncmp(word, weekday_names[i], 3) == 0) return i;
+    }
+    return -1;
+}
+
+// The number in word, or 0 (never valid) if it is out of range
+static unsigned short boundedNumber(const char* word) {
+    int value = atoi(word);
+    return (unsigned short)(value >= 1 && value <= RECUR_MAX_EVERY ? value : 0);
+}
+
+/*
+recurParse() - Reads a rule written by recurFormat() or typed by hand
+ - Time: O(m), Space: O(1)
+ - "daily", "weekly mon,thu" (or "weekly 1 4"), "monthly 15", "every 3 days",
+   "none"; case does not matter
+ - Returns 0, -1 if the text is not a rule, or -2 if it names a rule with
+   invalid values ("monthly 40", "weekly fun")
+ - Example: recurParse("Weekly on Mon,Thu", &rule) -> 0, {RECUR_WEEKLY, 0x09, 0}
+ */
+int recurParse(const char* text, recurrence* rule) {
+    char buffer[RECUR_TEXT_MAX * 2];
+    char* words[16];
+    int count = 0;
+
+    snprintf(buffer, sizeof(buffer), "%s", text);
+    for (char* p = buffer; *p; p++) *p = (char)tolower((unsigned char)*p);
+    char* p = buffer;
+    while (*p && count < 16) {
+        while (*p && strchr(" ,\t\r\n", *p)) *p++ = '\0';
+        if (!*p) break;
+        words[count++] = p;
+        while (*p && !strchr(" ,\t\r\n", *p)) p++;
+    }
+    if (count == 0) return -1;
+
+    recurrence parsed = {RECUR_NONE, 0, 0};
+    int next = 1;
+    if (count > 1 && strcmp(words[1], "on") == 0) next = 2;
+    if (strcmp(words[0], "none") == 0) {
+        // no rule
+    } else if (strcmp(words[0], "daily") == 0) {
+        parsed.kind = RECUR_DAILY;
+    } else if (strcmp(words[0], "weekly") == 0) {
+        parsed.kind = RECUR_WEEKLY;
+        for (int i = next; i < count; i++) {
+            int weekday = parseWeekday(words[i]);
+            if (weekday < 0) return -2;
+            parsed.weekdays |= (unsigned char)(1 << weekday);
+        }
+    } else if (strcmp(words[0], "monthly") == 0) {
+        parsed.kind = RECUR_MONTHLY;
+        if (next < count && strcmp(words[next], "day") == 0) next++;
+        if (next >= count) return -2;
+        parsed.n = boundedNumber(words[next]);
+    } else if (strcmp(words[0], "every") == 0) {
+        parsed.kind = RECUR_EVERY;
+        if (count < 2) return -2;
+        parsed.n = boundedNumber(words[1]);
+    } else {
+        return -1;
+    }
+    if (!validRule(&parsed)) return -2;
+    *rule = parsed;
+    return 0;
+}
+
+/*
+recurFormat() - Writes a rule as text
+ - Time: O(1), Space: O(1)
+ - Returns text
+ - Example: {RECUR_MONTHLY, 0, 15} -> "monthly on day 15"
+ */
+const char* recurFormat(const recurrence* rule, char* text, size_t size) {
+    switch (rule->kind) {
+        case RECUR_DAILY:
+            snprintf(text, size, "daily");
+            break;
+        case RECUR_WEEKLY: {
+            size_t used = (size_t)snprintf(text, size, "weekly on");
+            const char* separator = " ";
+            for (int i = 0; i < 7 && used < size; i++) {
+                if (!(rule->weekdays & (1 << i))) continue;
+                used += (size_t)snprintf(text + used, size - used, "%s%c%s", separator,
+                                         toupper((unsigned char)weekday_names[i][0]), weekday_names[i] + 1);
+                separator = ",";
+            }
+            break;
+        }
+        case RECUR_MONTHLY:
+            snprintf(text, size, "monthly on day %d", rule->n);
+            break;
+        case RECUR_EVERY:
+            snprintf(text, size, "every %d days", rule->n);
+            break;
+        default:
+            snprintf(text, size, "none");
+    }
+    return text;
+}
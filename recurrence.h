@@ -0,0 +1,30 @@
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+// Recurring tasks: a task with a repeat rule (daily, weekly on some
+// weekdays, monthly on day N, every N days) stands for a whole series, but
+// only its next occurrence exists - the task itself, due on that date.
+// Completing it (todoComplete()) creates the following occurrence, and
+// undoing the completion takes that one away again. Views over a date
+// window get the occurrences inside it from recurExpand(), computed on the
+// fly and never stored, so a daily chore costs one task however far ahead
+// a summary looks.
+
+#include "libtodo.h"
+
+#define RECUR_MAX_EVERY 366
+#define RECUR_TEXT_MAX 48
+
+// One occurrence of a task inside a window
+typedef struct {
+    task* task_data;
+    date due;
+} occurrence;
+
+todostatus recurSet(task* t, const recurrence* rule, date today);
+int recurNext(const recurrence* rule, date after, date* next);
+int recurExpand(const task* t, date from, date to, date out[], int max);
+int recurParse(const char* text, recurrence* rule);
+const char* recurFormat(const recurrence* rule, char* text, size_t size);
+
+#endif
@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reminder.h"
+
+#define REMINDER_MASK (REMINDER_SLOTS - 1)
+
+static reminderwheel* default_wheel;
+
+/*
+reminderWheelInit() - Creates an empty wheel standing at today
+ - Time: O(1), Space: O(1)
+ - Example: reminderWheelInit(&wheel, currentDate)
+ */
+void reminderWheelInit(reminderwheel* wheel, date today) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = todoDayNumber(today);
+}
+
+// Links e at the front of *head
+static void pushEntry(reminderentry** head, reminderentry* e) {
+    e->next = *head;
+    if (e->next) e->next->link = &e->next;
+    e->link = head;
+    *head = e;
+}
+
+// Puts e in the ready list if its day has come, else in the lowest level whose span reaches it
+static void wheelInsert(reminderwheel* wheel, reminderentry* e) {
+    long delta = e->day - wheel->now;
+    if (delta <= 0) {
+        e->level = -1;
+        e->slot = 0;
+        pushEntry(&wheel->ready, e);
+        return;
+    }
+    int level = 0;
+    while (level < REMINDER_LEVELS - 1 && delta >= 1L << (REMINDER_SLOT_BITS * (level + 1))) level++;
+    // Past the top level's span the slot index wraps; the entry is then
+    // cascaded early and simply goes back into the top level
+    e->level = level;
+    e->slot = (int)((e->day >> (REMINDER_SLOT_BITS * level)) & REMINDER_MASK);
+    wheel->occupied[level] |= 1ULL << e->slot;
+    pushEntry(&wheel->slots[level][e->slot], e);
+}
+
+static void wheelUnlink(reminderwheel* wheel, reminderentry* e) {
+    *e->link = e->next;
+    if (e->next) e->next->link = e->link;
+    if (e->level >= 0 && !wheel->slots[e->level][e->slot]) {
+        wheel->occupied[e->level] &= ~(1ULL << e->slot);
+    }
+}
+
+// Removes e from its task's list of entries
+static void taskUnlink(reminderentry* e) {
+    reminderentry** p = &e->task_data->reminder_entries;
+    while (*p && *p != e) p = &(*p)->sibling;
+    if (*p) *p = e->sibling;
+}
+
+static void releaseEntry(reminderwheel* wheel, reminderentry* e) {
+    e->next = wheel->spare;
+    wheel->spare = e;
+}
+
+// Schedules one reminder of t; returns 0, or -1 if out of memory
+static int scheduleEntry(reminderwheel* wheel, task* t, int days_before) {
+    reminderentry* e = wheel->spare;
+    if (e) {
+        wheel->spare = e->next;
+    } else {
+        e = (reminderentry*)malloc(sizeof(reminderentry));
+        if (!e) return -1;
+    }
+    e->wheel = wheel;
+    e->task_data = t;
+    e->day = todoDayNumber(t->duedate) - days_before;
+    e->days_before = days_before;
+    e->sibling = t->reminder_entries;
+    t->reminder_entries = e;
+    wheelInsert(wheel, e);
+    wheel->pending++;
+    return 0;
+}
+
+/*
+reminderWheelFree() - Frees every entry of the wheel
+ - Time: O(pending), Space: O(1)
+ - The tasks that still have entries in it must still be allocated: their
+   entry lists are cleared
+ */
+void reminderWheelFree(reminderwheel* wheel) {
+    reminderentry* lists[REMINDER_LEVELS * REMINDER_SLOTS + 1];
+    int count = 0;
+    for (int level = 0; level < REMINDER_LEVELS; level++) {
+        for (int slot = 0; slot < REMINDER_SLOTS; slot++) lists[count++] = wheel->slots[level][slot];
+    }
+    lists[count++] = wheel->ready;
+    for (int i = 0; i < count; i++) {
+        for (reminderentry* e = lists[i]; e; e = e->next) e->task_data->reminder_entries = NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        while (lists[i]) {
+            reminderentry* next = lists[i]->next;
+            free(lists[i]);
+            lists[i] = next;
+        }
+    }
+    while (wheel->spare) {
+        reminderentry* next = wheel->spare->next;
+        free(wheel->spare);
+        wheel->spare = next;
+    }
+    memset(wheel, 0, sizeof(*wheel));
+}
+
+/*
+reminderDefault() - The program's wheel, started at today on first use
+ - Time: O(1), Space: O(1)
+ - For the interactive program only (not thread-safe); NULL if out of memory
+ */
+reminderwheel* reminderDefault(date today) {
+    if (!default_wheel) {
+        default_wheel = (reminderwheel*)malloc(sizeof(reminderwheel));
+        if (default_wheel) reminderWheelInit(default_wheel, today);
+    }
+    return default_wheel;
+}
+
+/*
+reminderDefaultIfStarted() - The program's wheel, or NULL if no reminder was ever set
+ - Time: O(1), Space: O(1)
+ */
+reminderwheel* reminderDefaultIfStarted() {
+    return default_wheel;
+}
+
+/*
+reminderAdd() - Gives t a reminder days_before its due date and schedules it
+ - Time: O(MAX_REMINDERS), Space: O(1)
+ - A reminder whose day has already come fires on the next advance
+ - Returns TODO_INVALID_REMINDER without a due date or outside
+   0..REMINDER_MAX_DAYS, TODO_DUPLICATE if t has it, TODO_REMINDERS_FULL
+   at MAX_REMINDERS
+ - Example: reminderAdd(wheel, t, 3) -> TODO_OK, fires 3 days before t is due
+ */
+todostatus reminderAdd(reminderwheel* wheel, task* t, int days_before) {
+    if (!t->due_date_set || days_before < 0 || days_before > REMINDER_MAX_DAYS) {
+        return TODO_INVALID_REMINDER;
+    }
+    for (int i = 0; i < t->reminder_count; i++) {
+        if (t->reminder_days[i] == days_before) return TODO_DUPLICATE;
+    }
+    if (t->reminder_count >= MAX_REMINDERS) return TODO_REMINDERS_FULL;
+    if (scheduleEntry(wheel, t, days_before) != 0) return TODO_NO_MEMORY;
+    t->reminder_days[t->reminder_count++] = (unsigned char)days_before;
+    return TODO_OK;
+}
+
+/*
+reminderCancel() - Drops every scheduled reminder of t (its offsets stay)
+ - Time: O(MAX_REMINDERS), Space: O(1)
+ - Called before t is completed, deleted or freed, or its due date changes
+ */
+void reminderCancel(task* t) {
+    while (t->reminder_entries) {
+        reminderentry* e = t->reminder_entries;
+        t->reminder_entries = e->sibling;
+        wheelUnlink(e->wheel, e);
+        e->wheel->pending--;
+        releaseEntry(e->wheel, e);
+    }
+}
+
+/*
+reminderSchedule() - Schedules t's reminders again from its current due date
+ - Time: O(MAX_REMINDERS), Space: O(1)
+ - For a changed due date, or a task back from the completed stack. Days
+   already past are skipped; without a due date nothing is scheduled.
+ - Returns the number scheduled, or -1 if out of memory
+ */
+int reminderSchedule(reminderwheel* wheel, task* t) {
+    reminderCancel(t);
+    if (!t->due_date_set) return 0;
+    int count = 0;
+    long due = todoDayNumber(t->duedate);
+    for (int i = 0; i < t->reminder_count; i++) {
+        if (due - t->reminder_days[i] < wheel->now) continue;
+        if (scheduleEntry(wheel, t, t->reminder_days[i]) != 0) return -1;
+        count++;
+    }
+    return count;
+}
+
+typedef struct {
+    reminder* items;
+    int count;
+    int cap;
+} firedlist;
+
+// Fires every entry of the list at *head
+static void fireList(reminderwheel* wheel, reminderentry** head, firedlist* out) {
+    reminderentry* e = *head;
+    *head = NULL;
+    while (e) {
+        reminderentry* next = e->next;
+        if (out->count == out->cap) {
+            int cap = out->cap ? out->cap * 2 : 16;
+            reminder* items = (reminder*)realloc(out->items, sizeof(reminder) * cap);
+            if (items) {
+                out->items = items;
+                out->cap = cap;
+            }
+        }
+        if (out->count < out->cap) {
+            out->items[out->count].task_data = e->task_data;
+            out->items[out->count].days_before = e->days_before;
+            out->count++;
+        }
+        taskUnlink(e);
+        wheel->pending--;
+        wheel->fired++;
+        releaseEntry(wheel, e);
+        e = next;
+    }
+}
+
+// Moves the date back to day: every entry is placed again from there
+static void rewindWheel(reminderwheel* wheel, long day) {
+    reminderentry* all = NULL;
+    reminderentry** heads[REMINDER_LEVELS * REMINDER_SLOTS + 1];
+    int count = 0;
+    for (int level = 0; level < REMINDER_LEVELS; level++) {
+        for (int slot = 0; slot < REMINDER_SLOTS; slot++) heads[count++] = &wheel->slots[level][slot];
+        wheel->occupied[level] = 0;
+    }
+    heads[count++] = &wheel->ready;
+    for (int i = 0; i < count; i++) {
+        while (*heads[i]) {
+            reminderentry* e = *heads[i];
+            *heads[i] = e->next;
+            e->next = all;
+            all = e;
+        }
+    }
+    wheel->now = day;
+    while (all) {
+        reminderentry* next = all->next;
+        wheelInsert(wheel, all);
+        all = next;
+    }
+}
+
+// Digest order: due date, then name, then the nearest reminder first
+static int compareFired(const void* a, const void* b) {
+    const reminder* x = (const reminder*)a;
+    const reminder* y = (const reminder*)b;
+    int c = compareDates(x->task_data->duedate, y->task_data->duedate);
+    if (c != 0) return c;
+    c = strcmp(x->task_data->name, y->task_data->name);
+    if (c != 0) return c;
+    return x->days_before - y->days_before;
+}
+
+/*
+reminderAdvance() - Moves the wheel to today and collects what fired
+ - Time: O(fired + levels * 64 per level span crossed), Space: O(fired)
+ - Empty stretches are skipped a level at a time, so a jump of months visits
+   a few dozen slots; each reminder is moved down at most
+   REMINDER_LEVELS - 1 times. Moving back in time places every pending
+   entry again (O(pending)); nothing fired is brought back.
+ - *fired is set to a malloc'd array, sorted by due date, with one entry per
+   task (its nearest reminder) when several of its reminders fire together;
+   NULL when nothing fired. Returns its length.
+ - Sample Case:
+    Input: reminders 7 and 1 days before "Essay" (due 20/05/2025),
+           wheel at 01/05/2025, today 19/05/2025
+    Output: 1, {Essay, 1}
+ */
+int reminderAdvance(reminderwheel* wheel, date today, reminder** fired) {
+    long target = todoDayNumber(today);
+    firedlist out = {NULL, 0, 0};
+
+    if (target < wheel->now) rewindWheel(wheel, target);
+    fireList(wheel, &wheel->ready, &out);
+
+    while (wheel->now < target) {
+        if (!wheel->occupied[0]) {
+            // Nothing can happen before the next boundary of the lowest busy level
+            int level = 1;
+            while (level < REMINDER_LEVELS && !wheel->occupied[level]) level++;
+            long skip = target;
+            if (level < REMINDER_LEVELS) {
+                int shift = REMINDER_SLOT_BITS * level;
+                skip = (((wheel->now >> shift) + 1) << shift) - 1;
+                if (skip > target) skip = target;
+            }
+            if (skip > wheel->now) {
+                wheel->now = skip;
+                continue;
+            }
+        }
+
+        wheel->now++;
+        for (int level = REMINDER_LEVELS - 1; level > 0; level--) {
+            int shift = REMINDER_SLOT_BITS * level;
+            if (wheel->now & ((1L << shift) - 1)) continue;
+            int slot = (int)((wheel->now >> shift) & REMINDER_MASK);
+            reminderentry* e = wheel->slots[level][slot];
+            wheel->slots[level][slot] = NULL;
+            wheel->occupied[level] &= ~(1ULL << slot);
+            while (e) {
+                reminderentry* next = e->next;
+                wheelInsert(wheel, e);
+                wheel->cascaded++;
+                e = next;
+            }
+        }
+        int slot = (int)(wheel->now & REMINDER_MASK);
+        if (wheel->occupied[0] & (1ULL << slot)) {
+            wheel->occupied[0] &= ~(1ULL << slot);
+            fireList(wheel, &wheel->slots[0][slot], &out);
+        }
+        // Entries cascaded straight into the ready list are due today too
+        fireList(wheel, &wheel->ready, &out);
+    }
+
+    if (out.count > 1) {
+        qsort(out.items, out.count, sizeof(reminder), compareFired);
+        int kept = 1;
+        for (int i = 1; i < out.count; i++) {
+            if (out.items[i].task_data != out.items[kept - 1].task_data) out.items[kept++] = out.items[i];
+        }
+        out.count = kept;
+    }
+    *fired = out.items;
+    return out.count;
+}
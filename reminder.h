@@ -0,0 +1,64 @@
+#ifndef REMINDER_H
+#define REMINDER_H
+
+// Reminders: a task may carry up to MAX_REMINDERS offsets, in days before its
+// due date. Each one still to fire waits in a hierarchical timer wheel keyed
+// by day: level 0 has a slot per day for the next 64 days, level 1 a slot per
+// 64 days for the next 4096, and so on. Advancing the date visits only the
+// slots it passes and skips stretches where a level is empty, and a reminder
+// moves down at most REMINDER_LEVELS - 1 levels before it fires, so each one
+// costs O(1) amortized however far the date jumps. Entries point at their
+// task: completing or deleting a task cancels them, and changing its due date
+// schedules them again (libtodo.c and edit() do both).
+//
+// The interactive program keeps one wheel (reminderDefault()), started when
+// the first reminder is set; checkReminders() (scheduler.c) advances it to
+// the current date and prints what fired as one digest.
+
+#include "libtodo.h"
+
+#define REMINDER_LEVELS 4
+#define REMINDER_SLOT_BITS 6
+#define REMINDER_SLOTS (1 << REMINDER_SLOT_BITS)
+#define REMINDER_MAX_DAYS 365
+
+struct reminderentry {
+    struct reminderentry* next;      // in its slot
+    struct reminderentry** link;     // what points at it, for O(1) unlinking
+    struct reminderentry* sibling;   // the task's next entry
+    struct reminderwheel* wheel;
+    task* task_data;
+    long day;                        // day number it fires on, see todoDayNumber()
+    int days_before;
+    int level;                       // -1 in the ready list
+    int slot;
+};
+typedef struct reminderentry reminderentry;
+
+typedef struct reminderwheel {
+    reminderentry* slots[REMINDER_LEVELS][REMINDER_SLOTS];
+    unsigned long long occupied[REMINDER_LEVELS];  // bit per non-empty slot
+    reminderentry* ready;            // due on or before now, fire on the next advance
+    reminderentry* spare;            // freed entries, reused
+    long now;                        // last day processed
+    long pending;
+    long long fired;
+    long long cascaded;              // moves to a lower level
+} reminderwheel;
+
+// A fired reminder, for the digest
+typedef struct {
+    task* task_data;
+    int days_before;
+} reminder;
+
+void reminderWheelInit(reminderwheel* wheel, date today);
+void reminderWheelFree(reminderwheel* wheel);
+reminderwheel* reminderDefault(date today);
+reminderwheel* reminderDefaultIfStarted();
+todostatus reminderAdd(reminderwheel* wheel, task* t, int days_before);
+int reminderSchedule(reminderwheel* wheel, task* t);
+void reminderCancel(task* t);
+int reminderAdvance(reminderwheel* wheel, date today, reminder** fired);
+
+#endif
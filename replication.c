@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#endif
+#include "replication.h"
+#include "server.h"
+
+#ifndef _WIN32
+
+// A follower that takes longer than this to take a write, or a primary
+// that takes longer to answer "follow", counts as gone
+#define REPL_TIMEOUT_S 10
+
+struct replfollower {
+    int fd;
+    outbuf pending;   // journal lines for the next round (journal lock)
+    outbuf sending;   // the round being written (sender thread only)
+    int dead;         // dropped; removed by the sender (journal lock)
+    int failed;       // a write failed (sender thread only)
+    int in_round;     // gets the current round (sender thread only)
+    replfollower* next;
+};
+
+// Wall clock in milliseconds, comparable between processes
+static long long replNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void replSleep(int ms) {
+    struct timespec pause = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&pause, NULL);
+}
+
+// Appends one stream line: "<seq> <ms> <shard> <command>"
+static void replPutEntry(outbuf* out, unsigned long seq, long long ms, int shard, const char* line) {
+    char prefix[64];
+    int n = snprintf(prefix, sizeof(prefix), "%lu %lld %d ", seq, ms, shard);
+    outbufPut(out, prefix, (size_t)n);
+    outbufPuts(out, line);
+    outbufPut(out, "\n", 1);
+}
+
+// Appends the commands that recreate t on its shard, completing it if asked
+static void replPutTask(outbuf* out, unsigned long seq, long long ms, int shard,
+                        const task* t, int completed) {
+    char line[BATCH_LINE_MAX];
+    if (batchTaskLine(line, sizeof(line), "add", t) < 0) return;
+    replPutEntry(out, seq, ms, shard, line);
+    for (int i = 0; i < t->tag_count; i++) {
+        snprintf(line, sizeof(line), "tag|%s|%s", t->name, t->tags[i]);
+        replPutEntry(out, seq, ms, shard, line);
+    }
+    if (completed) {
+        snprintf(line, sizeof(line), "complete|%s", t->name);
+        replPutEntry(out, seq, ms, shard, line);
+    }
+}
+
+/*
+replSnapshot() - Writes a shard set as stream lines that rebuild it
+ - Time: O(n), Space: O(n) for the walk in reverse
+ - Per shard the date first; then completed tasks oldest first, in the
+   order of the undo log, so undo on the follower takes the same ones;
+   then active tasks oldest first, so each list keeps its order
+ - Caller holds every shard's writer mutex and the undo lock
+ - Returns 0, or -1 if out of memory
+ */
+static int replSnapshot(outbuf* out, shardset* set, unsigned long seq) {
+    long long ms = replNowMs();
+    char line[BATCH_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "SNAPSHOT %d %lu\n", set->count, seq);
+    outbufPut(out, line, (size_t)n);
+
+    long total = 0;
+    for (int s = 0; s < set->count; s++) {
+        date today = set->stores[s].today;
+        snprintf(line, sizeof(line), "today|%02d/%02d/%04d", today.day, today.month, today.year);
+        replPutEntry(out, seq, ms, s, line);
+        total += set->stores[s].linked;
+        for (stacknode* node = set->stacks[s].top; node; node = node->next) total++;
+    }
+    const void** walk = (const void**)malloc(sizeof(void*) * (total + 1));
+    if (!walk) return -1;
+
+    // Completions the log covers are the top of each shard's stack; the
+    // rest lie below them and are older
+    stacknode* cursor[SHARD_MAX];
+    for (int s = 0; s < set->count; s++) cursor[s] = set->stacks[s].top;
+    long covered = 0;
+    for (long i = set->undo_count - 1; i >= 0; i--) {
+        int s = set->undo_log[i];
+        if (!cursor[s]) continue;
+        walk[covered++] = cursor[s];
+        cursor[s] = cursor[s]->next;
+    }
+    for (int s = 0; s < set->count; s++) {
+        long below = covered;
+        for (stacknode* node = cursor[s]; node; node = node->next) walk[below++] = node;
+        for (long i = below - 1; i >= covered; i--) {
+            const stacknode* node = (const stacknode*)walk[i];
+            if (node->task_data) replPutTask(out, seq, ms, s, node->task_data, 1);
+        }
+    }
+    for (long i = covered - 1; i >= 0; i--) {
+        const stacknode* node = (const stacknode*)walk[i];
+        if (node->task_data) {
+            replPutTask(out, seq, ms, shardOf(set, node->task_data->name), node->task_data, 1);
+        }
+    }
+
+    for (int s = 0; s < set->count; s++) {
+        long active = 0;
+        for (const task* t = set->lists[s].head; t; t = t->next) {
+            if (!t->completed) walk[active++] = t;
+        }
+        while (active > 0) replPutTask(out, seq, ms, s, (const task*)walk[--active], 0);
+    }
+    free(walk);
+    n = snprintf(line, sizeof(line), "END %lu\n", seq);
+    outbufPut(out, line, (size_t)n);
+    return out->error ? -1 : 0;
+}
+
+static void freeFollower(replfollower* f) {
+    close(f->fd);
+    outbufFree(&f->pending);
+    outbufFree(&f->sending);
+    free(f);
+}
+
+// True if some follower has lines waiting or is waiting to be removed
+static int replHasWork(repljournal* journal) {
+    for (replfollower* f = journal->followers; f; f = f->next) {
+        if (f->pending.len > 0 || f->dead) return 1;
+    }
+    return 0;
+}
+
+/*
+replSender() - Writes the journal to the followers, one round at a time
+ - Time: O(bytes), Space: O(bytes pending)
+ - Each round swaps every follower's pending lines out under the lock and
+   writes them without it, after a HEAD line giving the newest change in
+   the round; when nothing changes a HEAD goes out every REPL_HEARTBEAT_MS.
+   Followers whose writes fail or that fell too far behind are closed.
+ */
+static void* replSender(void* arg) {
+    repljournal* journal = (repljournal*)arg;
+    pthread_mutex_lock(&journal->lock);
+    while (!journal->stop) {
+        if (!replHasWork(journal)) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += REPL_HEARTBEAT_MS * 1000000L;
+            until.tv_sec += until.tv_nsec / 1000000000L;
+            until.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&journal->wake, &journal->lock, &until);
+            if (journal->stop) break;
+        }
+
+        char head[64];
+        int n = snprintf(head, sizeof(head), "HEAD %lu %lld\n",
+                         __atomic_load_n(&journal->seq, __ATOMIC_RELAXED), journal->seq_ms);
+        for (replfollower* f = journal->followers; f; f = f->next) {
+            f->in_round = !f->dead;
+            if (f->dead) continue;
+            outbuf swap = f->sending;
+            f->sending = f->pending;
+            f->pending = swap;
+        }
+        // Attaching only adds at the front, and only this thread removes
+        replfollower* first = journal->followers;
+        pthread_mutex_unlock(&journal->lock);
+
+        // HEAD goes first, so a follower applying the round knows how far behind it is
+        for (replfollower* f = first; f; f = f->next) {
+            if (!f->in_round) continue;
+            if (f->sending.error || writeAll(f->fd, head, (size_t)n) != 0 ||
+                writeAll(f->fd, f->sending.data, f->sending.len) != 0) {
+                f->failed = 1;
+            }
+            f->sending.len = 0;
+        }
+
+        pthread_mutex_lock(&journal->lock);
+        replfollower** link = &journal->followers;
+        while (*link) {
+            replfollower* f = *link;
+            if (f->dead || f->failed) {
+                *link = f->next;
+                freeFollower(f);
+                __atomic_sub_fetch(&journal->follower_count, 1, __ATOMIC_RELEASE);
+            } else {
+                link = &f->next;
+            }
+        }
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return NULL;
+}
+
+/*
+replJournalStart() - Prepares a journal and starts its sender thread
+ - Time: O(1), Space: O(1)
+ - Hook it to a shard set with shardSetJournal(set, replRecord, journal)
+ - Returns 0 on success, -1 if the thread could not be started
+ */
+int replJournalStart(repljournal* journal) {
+    memset(journal, 0, sizeof(*journal));
+    pthread_mutex_init(&journal->lock, NULL);
+    pthread_cond_init(&journal->wake, NULL);
+    if (pthread_create(&journal->sender, NULL, replSender, journal) != 0) {
+        pthread_cond_destroy(&journal->wake);
+        pthread_mutex_destroy(&journal->lock);
+        return -1;
+    }
+    journal->running = 1;
+    return 0;
+}
+
+/*
+replJournalStop() - Stops the sender and disconnects every follower
+ - Time: O(followers), Space: O(1)
+ - Lines not sent yet are dropped; no changes may be journaled meanwhile
+ */
+void replJournalStop(repljournal* journal) {
+    if (!journal->running) return;
+    pthread_mutex_lock(&journal->lock);
+    journal->stop = 1;
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->lock);
+    pthread_join(journal->sender, NULL);
+
+    while (journal->followers) {
+        replfollower* f = journal->followers;
+        journal->followers = f->next;
+        freeFollower(f);
+    }
+    journal->follower_count = 0;
+    pthread_cond_destroy(&journal->wake);
+    pthread_mutex_destroy(&journal->lock);
+    journal->running = 0;
+}
+
+/*
+replRecord() - batchjournalfn that numbers a change and queues it for every follower
+ - Time: O(1) with no followers, O(followers + length) otherwise, Space: O(length)
+ - Called with the shard's writer mutex held, so each shard's changes are
+   numbered in the order they were made. With no followers it only counts.
+ - Sample Case:
+    Input: replRecord(&journal, 2, "complete|Report") as change 41
+    Output: each follower gets "41 1760000000000 2 complete|Report"
+ */
+void replRecord(void* context, int shard, const char* line) {
+    repljournal* journal = (repljournal*)context;
+    // Followers are only added while every shard is locked, so a writer
+    // that sees none here cannot miss one
+    if (__atomic_load_n(&journal->follower_count, __ATOMIC_ACQUIRE) == 0) {
+        __atomic_add_fetch(&journal->seq, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    long long ms = replNowMs();
+    pthread_mutex_lock(&journal->lock);
+    unsigned long seq = __atomic_add_fetch(&journal->seq, 1, __ATOMIC_RELAXED);
+    journal->seq_ms = ms;
+    for (replfollower* f = journal->followers; f; f = f->next) {
+        if (f->dead) continue;
+        if (f->pending.len > REPL_MAX_PENDING) {
+            f->dead = 1;
+            journal->dropped++;
+            continue;
+        }
+        replPutEntry(&f->pending, seq, ms, shard, line);
+        if (f->pending.error) f->dead = 1;
+    }
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->lock);
+}
+
+/*
+replAttach() - Makes a connected client a follower: a snapshot, then every change
+ - Time: O(n) for the snapshot, Space: O(n) until it is sent
+ - Every shard is locked while the snapshot is taken, so it is exactly the
+   state after the journal's current seq. The fd must be blocking; the
+   journal owns it from now on, even if attaching fails.
+ - Returns 0, or -1 if out of memory (the fd is closed)
+ */
+int replAttach(repljournal* journal, shardset* set, int fd) {
+    replfollower* f = (replfollower*)calloc(1, sizeof(replfollower));
+    if (!f || outbufInit(&f->pending, -1, 64 * 1024) != 0) {
+        free(f);
+        close(fd);
+        return -1;
+    }
+    if (outbufInit(&f->sending, -1, 64 * 1024) != 0) {
+        outbufFree(&f->pending);
+        free(f);
+        close(fd);
+        return -1;
+    }
+    f->fd = fd;
+    struct timeval timeout = {REPL_TIMEOUT_S, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    shardLockAll(set);
+    pthread_mutex_lock(&set->undo_lock);
+    pthread_mutex_lock(&journal->lock);
+    // Changes made while nobody followed were not timed; count them as of now
+    journal->seq_ms = replNowMs();
+    int status = replSnapshot(&f->pending, set, journal->seq);
+    if (status == 0) {
+        f->next = journal->followers;
+        journal->followers = f;
+        journal->attached++;
+        __atomic_add_fetch(&journal->follower_count, 1, __ATOMIC_RELEASE);
+        pthread_cond_signal(&journal->wake);
+    }
+    pthread_mutex_unlock(&journal->lock);
+    pthread_mutex_unlock(&set->undo_lock);
+    shardUnlockAll(set);
+
+    if (status != 0) freeFollower(f);
+    return status;
+}
+
+// Connects to the primary, asks to follow and reads the snapshot header
+static int replConnect(replstream* stream) {
+    int fd = serverConnect(stream->primary);
+    if (fd < 0) return -1;
+    struct timeval timeout = {REPL_TIMEOUT_S, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // One byte at a time, so nothing after the header is read here; a HEAD
+    // line may come first
+    char header[128];
+    int shards = 0;
+    unsigned long seq = 0;
+    int found = writeAll(fd, "follow\n", 7) != 0 ? -1 : 0;
+    while (found == 0) {
+        size_t n = 0;
+        while (n < sizeof(header) - 1 && read(fd, &header[n], 1) == 1 && header[n] != '\n') n++;
+        header[n] = '\0';
+        if (sscanf(header, "SNAPSHOT %d %lu", &shards, &seq) == 2) found = 1;
+        else if (strncmp(header, "HEAD ", 5) != 0) found = -1;
+    }
+    if (found != 1 || shards < 1) {
+        close(fd);
+        return -1;
+    }
+    stream->shards = shards;
+    stream->snapshot_seq = seq;
+    stream->in_len = 0;
+    __atomic_store_n(&stream->fd, fd, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Empties the copy before the snapshot that follows the header
+static void replBeginSnapshot(replstream* stream) {
+    shardReset(stream->set);
+    stream->loading = 1;
+    stream->snapshots++;
+    __atomic_store_n(&stream->applied, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stream->head_ms, replNowMs(), __ATOMIC_RELAXED);
+    __atomic_store_n(&stream->head, stream->snapshot_seq, __ATOMIC_RELEASE);
+}
+
+// Moves the head position on after a HEAD line, and applied after a change
+static void replAdvance(replstream* stream, unsigned long seq, long long ms, int is_head) {
+    if (seq > stream->head) {
+        __atomic_store_n(&stream->head_ms, ms, __ATOMIC_RELAXED);
+        __atomic_store_n(&stream->head, seq, __ATOMIC_RELEASE);
+    }
+    if (!is_head && !stream->loading && seq > stream->applied) __atomic_store_n(&stream->applied, seq, __ATOMIC_RELEASE);
+}
+
+// Applies one stream line; answers go to scratch and are thrown away
+static void replApplyLine(replstream* stream, char* line, outbuf* scratch) {
+    char* rest;
+    if (strncmp(line, "HEAD ", 5) == 0) {
+        unsigned long seq = strtoul(line + 5, &rest, 10);
+        replAdvance(stream, seq, strtoll(rest, NULL, 10), 1);
+        return;
+    }
+    if (strncmp(line, "END ", 4) == 0) {
+        stream->loading = 0;
+        __atomic_store_n(&stream->applied, stream->snapshot_seq, __ATOMIC_RELEASE);
+        return;
+    }
+    unsigned long seq = strtoul(line, &rest, 10);
+    long long ms = strtoll(rest, &rest, 10);
+    int shard = (int)strtol(rest, &rest, 10);
+    if (rest == line || *rest != ' ') {
+        stream->failed++;
+        return;
+    }
+    if (!shardApply(stream->set, shard, rest + 1, scratch)) stream->failed++;
+    scratch->len = 0;
+    replAdvance(stream, seq, ms, 0);
+}
+
+/*
+replReceiver() - Follower thread: reads the stream and applies it
+ - Time: O(bytes) plus the commands, Space: O(REPL_INPUT_SIZE)
+ - When the primary goes away the copy keeps answering as it was; every
+   REPL_RETRY_MS the thread tries again and loads a fresh snapshot
+ */
+static void* replReceiver(void* arg) {
+    replstream* stream = (replstream*)arg;
+    outbuf scratch;
+    if (outbufInit(&scratch, -1, 4096) != 0) return NULL;
+    int warned = 0;
+
+    while (!__atomic_load_n(&stream->stop, __ATOMIC_RELAXED)) {
+        if (stream->fd < 0) {
+            if (replConnect(stream) != 0) {
+                replSleep(REPL_RETRY_MS);
+                continue;
+            }
+            if (stream->shards != stream->set->count) {
+                if (!warned) {
+                    printf("%s now has %d shards and this follower %d; not following it.\n",
+                           stream->primary, stream->shards, stream->set->count);
+                    fflush(stdout);
+                    warned = 1;
+                }
+                close(stream->fd);
+                __atomic_store_n(&stream->fd, -1, __ATOMIC_RELEASE);
+                replSleep(REPL_RETRY_MS);
+                continue;
+            }
+            warned = 0;
+            replBeginSnapshot(stream);
+        }
+
+        struct pollfd input = {stream->fd, POLLIN, 0};
+        if (poll(&input, 1, REPL_HEARTBEAT_MS) <= 0) continue;
+        ssize_t n = read(stream->fd, stream->in + stream->in_len, sizeof(stream->in) - stream->in_len);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (n <= 0) {
+            close(stream->fd);
+            __atomic_store_n(&stream->fd, -1, __ATOMIC_RELEASE);
+            continue;
+        }
+        stream->in_len += (size_t)n;
+
+        char* start = stream->in;
+        char* end = stream->in + stream->in_len;
+        char* newline;
+        while ((newline = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+            *newline = '\0';
+            replApplyLine(stream, start, &scratch);
+            start = newline + 1;
+        }
+        stream->in_len = (size_t)(end - start);
+        memmove(stream->in, start, stream->in_len);
+        if (stream->in_len == sizeof(stream->in)) {
+            // Not a stream this follower understands: start over
+            close(stream->fd);
+            __atomic_store_n(&stream->fd, -1, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (stream->fd >= 0) close(stream->fd);
+    stream->fd = -1;
+    outbufFree(&scratch);
+    return NULL;
+}
+
+/*
+replStreamConnect() - Asks a server to be followed and learns its shard count
+ - Time: O(1), Space: O(1)
+ - Set up a shard set with stream->shards shards, then call replStreamStart()
+ - Returns 0, or -1 if nobody answers on primary
+ */
+int replStreamConnect(replstream* stream, const char* primary) {
+    memset(stream, 0, sizeof(*stream));
+    stream->primary = primary;
+    stream->fd = -1;
+    return replConnect(stream);
+}
+
+/*
+replStreamStart() - Starts applying the stream to set
+ - Time: O(1), Space: O(1)
+ - set must have the primary's shard count and should start empty
+ - Returns 0 on success, -1 if the thread could not be started
+ */
+int replStreamStart(replstream* stream, shardset* set) {
+    stream->set = set;
+    replBeginSnapshot(stream);
+    if (pthread_create(&stream->thread, NULL, replReceiver, stream) != 0) return -1;
+    stream->running = 1;
+    return 0;
+}
+
+void replStreamStop(replstream* stream) {
+    if (stream->running) {
+        __atomic_store_n(&stream->stop, 1, __ATOMIC_RELAXED);
+        pthread_join(stream->thread, NULL);
+        stream->running = 0;
+    } else if (stream->fd >= 0) {
+        close(stream->fd);
+        stream->fd = -1;
+    }
+}
+
+/*
+replStreamLag() - Answers the lag command
+ - Time: O(1), Space: O(1)
+ - lag_ops is how many changes the primary has reported that are not
+   applied here yet; lag_ms how long the newest of them has existed, 0
+   when caught up. While a snapshot loads, applied stays 0.
+ - Example: "OK applied=1200 head=1250 lag_ops=50 lag_ms=3 connected=1"
+ */
+void replStreamLag(replstream* stream, outbuf* out) {
+    unsigned long applied = __atomic_load_n(&stream->applied, __ATOMIC_ACQUIRE);
+    unsigned long head = __atomic_load_n(&stream->head, __ATOMIC_ACQUIRE);
+    long long head_ms = __atomic_load_n(&stream->head_ms, __ATOMIC_RELAXED);
+    unsigned long behind = head > applied ? head - applied : 0;
+    long long ms = behind > 0 ? replNowMs() - head_ms : 0;
+    char line[160];
+    int n = snprintf(line, sizeof(line), "OK applied=%lu head=%lu lag_ops=%lu lag_ms=%lld connected=%d\n",
+                     applied, head, behind, ms > 0 ? ms : 0,
+                     __atomic_load_n(&stream->fd, __ATOMIC_ACQUIRE) >= 0);
+    outbufPut(out, line, (size_t)n);
+}
+
+#else
+
+int replJournalStart(repljournal* journal) {
+    memset(journal, 0, sizeof(*journal));
+    return -1;
+}
+
+void replJournalStop(repljournal* journal) {
+    (void)journal;
+}
+
+void replRecord(void* context, int shard, const char* line) {
+    (void)context;
+    (void)shard;
+    (void)line;
+}
+
+int replAttach(repljournal* journal, shardset* set, int fd) {
+    (void)journal;
+    (void)set;
+    (void)fd;
+    return -1;
+}
+
+int replStreamConnect(replstream* stream, const char* primary) {
+    (void)stream;
+    (void)primary;
+    return -1;
+}
+
+int replStreamStart(replstream* stream, shardset* set) {
+    (void)stream;
+    (void)set;
+    return -1;
+}
+
+void replStreamStop(replstream* stream) {
+    (void)stream;
+}
+
+void replStreamLag(replstream* stream, outbuf* out) {
+    (void)stream;
+    outbufPuts(out, "OK applied=0 head=0 lag_ops=0 lag_ms=0 connected=0\n");
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+// Log shipping from a server to read-only followers on the same machine.
+// The server journals every change its shards make as the batch command
+// that repeats it (see batchjournalfn). A client that sends "follow" gets a
+// snapshot of the tasks, then the journal as it grows. A follower
+// (todolist --follow) applies the stream to its own shards and answers
+// query, stats, export and lag. Stream lines:
+//   SNAPSHOT <shards> <seq>         a full copy follows; the follower starts empty
+//   <seq> <ms> <shard> <command>    one change; snapshot lines carry the header's seq
+//   END <seq>                       the copy is complete, as of change seq
+//   HEAD <seq> <ms>                 the newest change, sent before each round and when idle
+// <ms> is the server's wall clock when the change was made, which is only
+// comparable with the follower's clock on the same machine.
+
+#include <pthread.h>
+#include "shard.h"
+
+// A follower this many bytes behind is dropped; it reconnects and starts
+// again from a snapshot
+#define REPL_MAX_PENDING (64 * 1024 * 1024)
+#define REPL_HEARTBEAT_MS 200
+#define REPL_RETRY_MS 500
+#define REPL_INPUT_SIZE (64 * 1024)
+
+typedef struct replfollower replfollower;
+
+// Server side: the journal and the followers reading it
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    unsigned long seq;          // changes journaled so far
+    long long seq_ms;           // when the newest one was made
+    int follower_count;         // read without the lock, to skip the work when 0
+    replfollower* followers;
+    pthread_t sender;
+    int running;
+    int stop;
+    long attached;              // followers that ever attached
+    long dropped;               // followers dropped for falling behind
+} repljournal;
+
+// Follower side: the stream being applied
+typedef struct {
+    const char* primary;
+    shardset* set;
+    int fd;                     // -1 while the primary is unreachable
+    int shards;                 // the primary's shard count
+    unsigned long snapshot_seq; // seq of the snapshot being loaded
+    int loading;                // snapshot lines still arriving
+    pthread_t thread;
+    int running;
+    int stop;
+    unsigned long applied;      // seq of the last change applied
+    unsigned long head;         // newest seq the primary reported
+    long long head_ms;          // primary clock of that change
+    long snapshots;             // full copies loaded
+    long failed;                // changes that did not apply here
+    char in[REPL_INPUT_SIZE];
+    size_t in_len;
+} replstream;
+
+int replJournalStart(repljournal* journal);
+void replJournalStop(repljournal* journal);
+void replRecord(void* context, int shard, const char* line);
+int replAttach(repljournal* journal, shardset* set, int fd);
+int replStreamConnect(replstream* stream, const char* primary);
+int replStreamStart(replstream* stream, shardset* set);
+void replStreamStop(replstream* stream);
+void replStreamLag(replstream* stream, outbuf* out);
+
+#endif
@@ -4,69 +4,10 @@
 #include <time.h>
 #include "scheduler.h"
 #include "task_management.h"
-
-/*
-compareDates() - Compares two dates
- - Time: O(1), Space: O(1)
- - Sample Case:
-    Input: 
-      d1 = {10, 5, 2025}
-      d2 = {15, 5, 2025}
-    Output: -5 (d1 is earlier than d2)
- */
-int compareDates(date d1, date d2) {
-    if (d1.year != d2.year) return d1.year - d2.year;
-    if (d1.month != d2.month) return d1.month - d2.month;
-    return d1.day - d2.day;
-}
-
-/*
-getToday() - Gets current system date
- - Time: O(1), Space: O(1)
- - Example: getToday() -> returns {2, 5, 2025} (current date)
- */
-date getToday() {
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    date today = {t->tm_mday, t->tm_mon + 1, t->tm_year + 1900}; 
-    return today;  
-}
-
-/*
-isValidDate() - Validates date format
- - Time: O(1), Space: O(1)
- - Sample Case:
-    Input: day=31, month=2, year=2025
-    Output: 0 (invalid - February doesn't have 31 days)
- */
-int isValidDate(int day, int month, int year) {
-    if (year < 1900 || month < 1 || month > 12 || day < 1)
-        return 0;
-        
-    // Days in each month
-    int daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    
-    // Adjust for leap years
-    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || (year % 400 == 0)))
-        daysInMonth[2] = 29;
-        
-    return day <= daysInMonth[month];
-}
-
-/*
-setDueDate() - Sets due date for a task
- - Time: O(1), Space: O(1)
- - Example: setDueDate(task_ptr, 10, 5, 2025) -> sets task due date
- */
-void setDueDate(task* t, int day, int month, int year) {
-    if (t) {
-        t->duedate.day = day;
-        t->duedate.month = month;
-        t->duedate.year = year;
-        t->due_date_set = 1;
-    }
-}
-
+#include "libtodo.h"
+#include "feed.h"
+#include "reminder.h"
+#include "undo.h"
 
 
 /*
@@ -75,13 +16,18 @@ adjustPriority() - Upgrades overdue tasks to high priority
  - Example: adjustPriority(tasks, today) -> overdue tasks become priority 1
  */
 void adjustPriority(task* head, date today) {
+    undoGroupBegin();
     while (head) {
         if (!head->completed && head->due_date_set && compareDates(today, head->duedate) > 0 && head->priority != 1) {
+            int previous = head->priority;
+            undoRecordFields(head, UNDO_PRIORITY, NULL);
             head->priority = 1;
+            feedRecord(FEED_PRIORITY, head, NULL, previous);
             printf("Priority adjusted to HIGH for overdue task: %s\n", head->name);
         }
         head = head->next;
     }
+    undoGroupEnd();
 }
 
 /*
@@ -93,57 +39,24 @@ clearcompletedtask() - Removes all completed tasks
     Output: "All completed tasks cleared."
  */
 void clearcompletedtask(stacknode** top_ptr) { 
-    stacknode* current = *top_ptr;
-    stacknode* temp;
-
-    if (current == NULL) {
+    if (*top_ptr == NULL) {
         printf("No completed tasks to clear.\n");
         return;
     }
 
     printf("Clearing all completed tasks...\n");
-    while (current != NULL) {
-        temp = current;
-        current = current->next;
-
-        // Free the dynamically allocated task data first
-        if (temp->task_data) { 
-            free(temp->task_data);
-        }
-        // free the stack node itself
-        free(temp);
-    }
-
+    completedstack stack = {*top_ptr};
+    todoClearCompleted(&stack);
     *top_ptr = NULL; // Set the top pointer to NULL
     printf("All completed tasks cleared.\n");
 }
 
 
-/*
-updateTaskStatuses() - Updates task status based on due date
- - Time: O(n), Space: O(1)
- - Example: updateTaskStatuses(tasks, today) -> marks overdue tasks
- */
-void updateTaskStatuses(task* head, date today) {
-    task* current = head;
-    while (current) {
-        if (!current->completed && current->due_date_set) {
-            // Check if task is overdue
-            if (compareDates(today, current->duedate) > 0) {
-                current->status = OVERDUE;
-            } 
-            // Check if task is due soon (within 2 days)
-            else if (isDateSoon(today, current->duedate, 2)) {
-                current->status = PENDING;  // Still pending but will mark as urgent in display
-            }
-        }
-        current = current->next;
-    }
-}
 
 /*
 autoPriorityAdjust() - Auto-adjusts priority based on due date
  - Time: O(n), Space: O(1)
+ - The raises are one undo group (see undo.h)
  - Sample Case:
     Input: Task "Essay" with Medium priority, due tomorrow
     Output:
@@ -151,104 +64,15 @@ autoPriorityAdjust() - Auto-adjusts priority based on due date
       Task priority changed from 2 to 1
  */
 void autoPriorityAdjust(task* head, date today) {
-    task* current = head;
-    while (current) {
-        if (!current->completed && current->due_date_set) {
-            // Calculate days until due
-            int daysUntilDue = getDaysBetween(today, current->duedate);
-            
-            // Auto-adjust priority based on due date
-            if (daysUntilDue < 0) {
-                // Overdue tasks are always high priority
-                if (current->priority != 1) {
-                    current->priority = 1;
-                    printf("Priority for '%s' auto-adjusted to HIGH \n", current->name);
-                }
-            }
-            else if (daysUntilDue <= 2) {
-                // Tasks due within 2 days are at least medium priority
-                if (current->priority > 1) {
-                    current->priority = 1;
-                    printf("Priority for '%s' auto-adjusted to HIGH \n", current->name);
-                }
-            }
-            else if (daysUntilDue <= 1) {
-                // Tasks due tomorrow are high priority
-                if (current->priority != 1) {
-                    current->priority = 1;
-                    printf("Priority for '%s' auto-adjusted to HIGH \n", current->name);
-                }
-            }
+    undoGroupBegin();
+    for (task* current = head; current; current = current->next) {
+        if (todoAutoPriority(current, today)) {
+            printf("Priority for '%s' auto-adjusted to HIGH \n", current->name);
         }
-        current = current->next;
     }
+    undoGroupEnd();
 }
 
-/*
-getDaysBetween() - Calculates days between two dates
- - Time: O(1), Space: O(1)
- - Sample Case:
-    Input:
-      d1 = {1, 5, 2025}
-      d2 = {5, 5, 2025}
-    Output: 4 (days difference)
- */
-int getDaysBetween(date d1, date d2) {
-    // Check if dates are valid
-    
-    // Approximate days in each month (ignoring leap years)
-    const int daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    
-    // Convert dates to days since year 0 
-    int days1 = d1.year * 365 + d1.day;
-    int days2 = d2.year * 365 + d2.day;
-    
-    // Add days for months
-    for (int i = 1; i < d1.month; i++) days1 += daysInMonth[i];
-    for (int i = 1; i < d2.month; i++) days2 += daysInMonth[i];
-    
-    // Add leap years 
-    days1 += d1.year / 4;
-    days2 += d2.year / 4;
-    
-    return days2 - days1;
-}
-
-/*
-isDateSoon() - Checks if date is within threshold days
- - Time: O(1), Space: O(1)
- - Example: isDateSoon(today, duedate, 2) -> true if due within 2 days
- */
-int isDateSoon(date today, date duedate, int daysThreshold) {
-    // Check if due date is valid
-    
-    // If years are different
-    if (duedate.year > today.year) {
-        if (duedate.month == 1 && today.month == 12) {
-            // Special case: December -> January transition
-            return (31 - today.day + duedate.day) <= daysThreshold;
-        }
-        return 0; // Not soon if more than a month away
-    }
-    
-    // If within same year but different months
-    if (duedate.month > today.month) {
-        if (duedate.month - today.month == 1) {
-            // Tasks due early next month
-            int daysInCurrentMonth;
-            switch (today.month) {
-                case 2: daysInCurrentMonth = 28; break; // Simplified, ignoring leap years
-                case 4: case 6: case 9: case 11: daysInCurrentMonth = 30; break;
-                default: daysInCurrentMonth = 31;
-            }
-            return (daysInCurrentMonth - today.day + duedate.day) <= daysThreshold;
-        }
-        return 0; // Not soon if more than a month away
-    }
-    
-    // Same month, just compare days
-    return (duedate.day - today.day) <= daysThreshold && (duedate.day - today.day) >= 0;
-}
 
 /*
 simulateDayChange() - Changes system date for testing
@@ -297,6 +121,9 @@ void simulateDayChange(task* head, date* currentDate) {
     
     // Auto-adjust priorities based on due dates
     autoPriorityAdjust(head, newDate);
+
+    // Reminders that came due on the way, however far the date moved
+    checkReminders(head, newDate);
     
     // Create arrays to store tasks by status
     task* overdue_tasks[100];
@@ -394,22 +221,39 @@ void simulateDayChange(task* head, date* currentDate) {
 }
 
 
+
 /*
-isDateWithinDays() - Checks if date within range
- - Time: O(1), Space: O(1)
+checkReminders() - Fires the reminders due by today and prints them as one digest
+ - Time: O(fired log fired + slots crossed), Space: O(fired)
+ - Does nothing until a reminder has been set. The wheel (reminder.h) holds
+   the tasks it reminds about, so head is not scanned.
  - Sample Case:
-    Input:
-      today = {1, 5, 2025}
-      check_date = {5, 5, 2025}
-      days = 7
-    Output: 1 (date is within 7 days)
+    Input: "Essay" due 20/05/2025 with a reminder 2 days before, today 18/05/2025
+    Output:
+      === Reminders for 18/05/2025 (1) ===
+      Essay                     due 20/05/2025  in 2 days
  */
-int isDateWithinDays(date today, date check_date, int days) {
-    // Calculate total days for both dates 
-    int today_days = today.year * 365 + today.month * 30 + today.day;
-    int check_days = check_date.year * 365 + check_date.month * 30 + check_date.day;
-    
-    // Check if the date is within the specified range
-    int diff = check_days - today_days;
-    return (diff >= 0 && diff <= days);
-}
\ No newline at end of file
+void checkReminders(task* head, date today) {
+    (void)head;
+    reminderwheel* wheel = reminderDefaultIfStarted();
+    if (!wheel) return;
+
+    reminder* fired;
+    int count = reminderAdvance(wheel, today, &fired);
+    if (count == 0) return;
+
+    printf("\n=== Reminders for %02d/%02d/%04d (%d) ===\n", today.day, today.month, today.year, count);
+    long day = todoDayNumber(today);
+    for (int i = 0; i < count; i++) {
+        task* t = fired[i].task_data;
+        long days = todoDayNumber(t->duedate) - day;
+        char when[32];
+        if (days > 1) snprintf(when, sizeof(when), "in %ld days", days);
+        else if (days == 1) snprintf(when, sizeof(when), "tomorrow");
+        else if (days == 0) snprintf(when, sizeof(when), "today");
+        else snprintf(when, sizeof(when), "OVERDUE by %ld days", -days);
+        printf("%-25s due %02d/%02d/%04d  %s\n", t->name, t->duedate.day, t->duedate.month,
+               t->duedate.year, when);
+    }
+    free(fired);
+}
@@ -1,38 +1,61 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdbool.h>
 #include "scheduler.h"       
 #include "task_management.h"
 #include "searchandstat.h"
+#include "libtodo.h"
+#include "recurrence.h"
+#include "query.h"
+#include "plan.h"
+#include "views.h"
+#include "rank.h"
 
 
-/*
-searchTasks() - Search tasks by multiple criteria
- - Time: O(n), Space: O(1)
- - Sample Case:
-    Input:
-      Choice: 7 (Keyword search)
-      Keyword: "project"
-    Output:
-      --- Pending Tasks ---
-      Name: Final Project
-      Description: Complete capstone project
-      Tags: academic, important
-      -------------------------
-      --- Completed Tasks ---
-      Name: Project Proposal
-      -------------------------
- */
-void searchTasks(task* head, completedstack* stack, const char* keyword) {
+// Prints a search result, with its tags if asked
+static void printResult(task* t, int show_tags) {
+    printTaskInfo(t);
+    // Add tag information to output
+    if (show_tags && t->tag_count > 0) {
+        printf("Tags: ");
+        for (int i = 0; i < t->tag_count; i++) {
+            printf("%s%s", t->tags[i], (i < t->tag_count - 1) ? ", " : "\n");
+        }
+        printf("-------------------------\n");
+    }
+}
+
+// Prints the task if it matches a search query, returns 1 if it did
+static int printMatch(task* t, const todoquery* query, int show_tags) {
+    if (!todoMatches(t, query)) return 0;
+    printResult(t, show_tags);
+    return 1;
+}
+
+// Prints matching tasks from the list (head) and/or the completed stack (node)
+static int printMatches(task* head, stacknode* node, const todoquery* query, int show_tags) {
     int found = 0;
+    for (; head; head = head->next) found += printMatch(head, query, show_tags);
+    for (; node; node = node->next) found += printMatch(node->task_data, query, show_tags);
+    return found;
+}
+
+// Asks for a filter as the search menu offers them and prints the results
+// header; returns the option chosen (1-8, or 9 for a ranked search if
+// offered), or 0 after a message if aborted. An expression (option 8) is
+// compiled into program, with today for due<today and overdue; the words
+// of a ranked search go to text.
+static int readQuery(todoquery* query, queryprogram* program, date today, char* text, size_t size, int ranked) {
     int search_option;
     int min_priority = 0, max_priority = 0;
     date start_date = {0}, end_date = {0};
-    char new_keyword[100] = {0};
     char buffer[100];
+    char error[80];
+    *query = (todoquery){TODO_MATCH_ALL, text, 0, 0, PENDING, {0}, {0}, program};
+    text[0] = '\0';
     
-    printf("\n=== Task Search ===\n");
     printf("Search by:\n");
     printf("1. Name\n");
     printf("2. Description\n");
@@ -41,11 +64,13 @@ void searchTasks(task* head, completedstack* stack, const char* keyword) {
     printf("5. Due Date Range\n");
     printf("6. Tasks with No Due Date\n");
     printf("7. Keyword (search all fields)\n");
-    printf("Enter your choice (1-7): ");
+    printf("8. Expression (e.g. tag:work priority:1..2 NOT status:overdue)\n");
+    if (ranked) printf("9. Best Matches for Some Words (ranked by name, then description)\n");
+    printf("Enter your choice (1-%d): ", ranked ? 9 : 8);
     
     if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &search_option) != 1) {
         printf("Invalid input. Search aborted.\n");
-        return;
+        return 0;
     }
     
     // search criteria based on option
@@ -54,57 +79,33 @@ void searchTasks(task* head, completedstack* stack, const char* keyword) {
         case 2: // Description
             
             printf("Enter search keyword: ");
-            if (fgets(new_keyword, sizeof(new_keyword), stdin) == NULL) {
+            if (fgets(text, size, stdin) == NULL) {
                 printf("Error reading keyword. Search aborted.\n");
-                return;
+                return 0;
             }
-            new_keyword[strcspn(new_keyword, "\n")] = 0;
+            text[strcspn(text, "\n")] = 0;
             
             // Check if keyword is empty
-            if (strlen(new_keyword) == 0) {
+            if (strlen(text) == 0) {
                 printf("Keyword cannot be empty. Search aborted.\n");
-                return;
-            }
-            
-            printf("\n=== Search Results for '%s' ===\n", new_keyword);
-            
-            // Search pending tasks
-            printf("--- Pending Tasks ---\n");
-            task* current = head;
-            while (current) {
-                if ((search_option == 1 && strstr(current->name, new_keyword)) ||
-                    (search_option == 2 && strstr(current->description, new_keyword))) {
-                    printTaskInfo(current);
-                    found = 1;
-                }
-                current = current->next;
+                return 0;
             }
             
-            // Search completed tasks
-            printf("--- Completed Tasks ---\n");
-            stacknode* node = stack->top;
-            while (node) {
-                task* t = node->task_data;
-                if ((search_option == 1 && strstr(t->name, new_keyword)) ||
-                    (search_option == 2 && strstr(t->description, new_keyword))) {
-                    printTaskInfo(t);
-                    found = 1;
-                }
-                node = node->next;
-            }
+            query->type = (search_option == 1) ? TODO_MATCH_NAME : TODO_MATCH_DESCRIPTION;
+            printf("\n=== Search Results for '%s' ===\n", text);
             break;
             
         case 3: // Priority Range
             printf("Enter priority from : ");
             if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &min_priority) != 1) {
                 printf("Invalid input. Search aborted.\n");
-                return;
+                return 0;
             }
             
             printf("Enter priority to : ");
             if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &max_priority) != 1) {
                 printf("Invalid input. Search aborted.\n");
-                return;
+                return 0;
             }
             
             if (min_priority > max_priority) {
@@ -114,30 +115,10 @@ void searchTasks(task* head, completedstack* stack, const char* keyword) {
                 max_priority = temp;
             }
             
+            query->type = TODO_MATCH_PRIORITY;
+            query->min_priority = min_priority;
+            query->max_priority = max_priority;
             printf("\n=== Search Results for Priority %d to %d ===\n", min_priority, max_priority);
-            
-            // Search pending tasks
-            printf("--- Pending Tasks ---\n");
-            current = head;
-            while (current) {
-                if (current->priority >= min_priority && current->priority <= max_priority) {
-                    printTaskInfo(current);
-                    found = 1;
-                }
-                current = current->next;
-            }
-            
-            // Search completed tasks
-            printf("--- Completed Tasks ---\n");
-            node = stack->top;
-            while (node) {
-                task* t = node->task_data;
-                if (t->priority >= min_priority && t->priority <= max_priority) {
-                    printTaskInfo(t);
-                    found = 1;
-                }
-                node = node->next;
-            }
             break;
             
         case 4: // Status
@@ -150,47 +131,22 @@ void searchTasks(task* head, completedstack* stack, const char* keyword) {
             
             if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &status_choice) != 1) {
                 printf("Invalid input. Search aborted.\n");
-                return;
+                return 0;
             }
             
-            TaskStatus search_status;
             switch(status_choice) {
-                case 1: search_status = PENDING; break;
-                case 2: search_status = COMPLETED; break;
-                case 3: search_status = OVERDUE; break;
+                case 1: query->status = PENDING; break;
+                case 2: query->status = COMPLETED; break;
+                case 3: query->status = OVERDUE; break;
                 default: 
                     printf("Invalid status choice.\n");
-                    return;
+                    return 0;
             }
+            query->type = TODO_MATCH_STATUS;
             
             printf("\n=== Search Results for Status: %s ===\n", 
-                  (search_status == PENDING) ? "Pending" : 
-                  (search_status == COMPLETED) ? "Completed" : "Overdue");
-            
-            // For completed tasks : search the stack
-            if (search_status == COMPLETED) {
-                printf("--- Completed Tasks ---\n");
-                stacknode* status_node = stack->top;
-                while (status_node) {
-                    task* t = status_node->task_data;
-                    if (t->status == search_status) {
-                        printTaskInfo(t);
-                        found = 1;
-                    }
-                    status_node = status_node->next;
-                }
-            } else {
-                // For PENDING/OVERDUE : search the main list
-                printf("--- Tasks ---\n");
-                task* status_current = head;
-                while (status_current) {
-                    if (status_current->status == search_status) {
-                        printTaskInfo(status_current);
-                        found = 1;
-                    }
-                    status_current = status_current->next;
-                }
-            }
+                  (query->status == PENDING) ? "Pending" : 
+                  (query->status == COMPLETED) ? "Completed" : "Overdue");
             break;
             
         case 5: // Due Date Range
@@ -198,203 +154,444 @@ void searchTasks(task* head, completedstack* stack, const char* keyword) {
             if (fgets(buffer, sizeof(buffer), stdin) == NULL || 
                 sscanf(buffer, "%d %d %d", &start_date.day, &start_date.month, &start_date.year) != 3) {
                 printf("Invalid date format. Search aborted.\n");
-                return;
+                return 0;
             }
             
             printf("Enter end date (DD MM YYYY): ");
             if (fgets(buffer, sizeof(buffer), stdin) == NULL || 
                 sscanf(buffer, "%d %d %d", &end_date.day, &end_date.month, &end_date.year) != 3) {
                 printf("Invalid date format. Search aborted.\n");
-                return;
+                return 0;
             }
             
             // Validate dates
             if (!isValidDate(start_date.day, start_date.month, start_date.year) || 
                 !isValidDate(end_date.day, end_date.month, end_date.year)) {
                 printf("Invalid date range. Search aborted.\n");
-                return;
+                return 0;
             }
             
             // Check if start date is after end date
             if (compareDates(start_date, end_date) > 0) {
                 printf("Error: Start date must be before end date. Search aborted.\n");
-                return;
+                return 0;
             }
             
+            query->type = TODO_MATCH_DUE_RANGE;
+            query->from = start_date;
+            query->to = end_date;
             printf("\n=== Search Results for Due Date from %02d/%02d/%04d to %02d/%02d/%04d ===\n",
                    start_date.day, start_date.month, start_date.year,
                    end_date.day, end_date.month, end_date.year);
-            
-            // Search pending tasks
-            printf("--- Pending Tasks ---\n");
-            task* date_current = head;
-            while (date_current) {
-                if (date_current->due_date_set) {
-                    // Check if task due date is within range
-                    if (compareDates(date_current->duedate, start_date) >= 0 && 
-                        compareDates(date_current->duedate, end_date) <= 0) {
-                        printTaskInfo(date_current);
-                        found = 1;
-                    }
-                }
-                date_current = date_current->next;
-            }
-            
-            // Search completed tasks
-            printf("--- Completed Tasks ---\n");
-            stacknode* date_node = stack->top;
-            while (date_node) {
-                task* t = date_node->task_data;
-                if (t->due_date_set) {
-                    // Check if task due date is within range
-                    if (compareDates(t->duedate, start_date) >= 0 && 
-                        compareDates(t->duedate, end_date) <= 0) {
-                        printTaskInfo(t);
-                        found = 1;
-                    }
-                }
-                date_node = date_node->next;
-            }
             break;
             
         case 6: // Tasks with No Due Date
+            query->type = TODO_MATCH_NO_DUE_DATE;
             printf("\n=== Tasks with No Due Date ===\n");
-            
-            // Search pending tasks
-            printf("--- Pending Tasks ---\n");
-            task* nodate_current = head;
-            while (nodate_current) {
-                if (!nodate_current->due_date_set) {
-                    printTaskInfo(nodate_current);
-                    found = 1;
-                }
-                nodate_current = nodate_current->next;
-            }
-            
-            // Search completed tasks
-            printf("--- Completed Tasks ---\n");
-            stacknode* nodate_node = stack->top;
-            while (nodate_node) {
-                task* t = nodate_node->task_data;
-                if (!t->due_date_set) {
-                    printTaskInfo(t);
-                    found = 1;
-                }
-                nodate_node = nodate_node->next;
-            }
             break;
             
         case 7: // Keyword search
             printf("Enter keyword to search in all fields: ");
-            if (fgets(new_keyword, sizeof(new_keyword), stdin) == NULL) {
+            if (fgets(text, size, stdin) == NULL) {
                 printf("Error reading keyword. Search aborted.\n");
-                return;
+                return 0;
             }
-            new_keyword[strcspn(new_keyword, "\n")] = 0;
-            
-            printf("\n=== Keyword Search Results for '%s' ===\n", new_keyword);
+            text[strcspn(text, "\n")] = 0;
             
-            // Search pending tasks
-            printf("--- Pending Tasks ---\n");
-            task* keyword_current = head;
-            while (keyword_current) {
-                // Check name, description, and tags
-                int found_in_task = 0;
-                
-                // Check name
-                if (strstr(keyword_current->name, new_keyword)) {
-                    found_in_task = 1;
-                }
-                
-                // Check description
-                if (!found_in_task && strstr(keyword_current->description, new_keyword)) {
-                    found_in_task = 1;
-                }
-                
-                // Check tags
-                if (!found_in_task) {
-                    for (int i = 0; i < keyword_current->tag_count; i++) {
-                        if (strstr(keyword_current->tags[i], new_keyword)) {
-                            found_in_task = 1;
-                            break;
-                        }
-                    }
-                }
-                
-                if (found_in_task) {
-                    printTaskInfo(keyword_current);
-                    // Add tag information to output
-                    if (keyword_current->tag_count > 0) {
-                        printf("Tags: ");
-                        for (int i = 0; i < keyword_current->tag_count; i++) {
-                            printf("%s%s", keyword_current->tags[i], 
-                                  (i < keyword_current->tag_count - 1) ? ", " : "\n");
-                        }
-                        printf("-------------------------\n");
-                    }
-                    found = 1;
-                }
-                
-                keyword_current = keyword_current->next;
+            query->type = TODO_MATCH_KEYWORD;
+            printf("\n=== Keyword Search Results for '%s' ===\n", text);
+            break;
+
+        case 8: // Expression
+            printf("Fields: name: desc: tag: priority: status: due: done:, a bare word searches all\n");
+            printf("Enter expression: ");
+            if (fgets(text, size, stdin) == NULL) {
+                printf("Error reading expression. Search aborted.\n");
+                return 0;
             }
-            
-            // Search completed tasks
-            printf("--- Completed Tasks ---\n");
-            stacknode* keyword_node = stack->top;
-            while (keyword_node) {
-                task* t = keyword_node->task_data;
-                
-                // Check name, description, and tags
-                int found_in_task = 0;
-                
-                // Check name
-                if (strstr(t->name, new_keyword)) {
-                    found_in_task = 1;
-                }
-                
-                // Check description
-                if (!found_in_task && strstr(t->description, new_keyword)) {
-                    found_in_task = 1;
-                }
-                
-                // Check tags
-                if (!found_in_task) {
-                    for (int i = 0; i < t->tag_count; i++) {
-                        if (strstr(t->tags[i], new_keyword)) {
-                            found_in_task = 1;
-                            break;
-                        }
-                    }
-                }
-                
-                if (found_in_task) {
-                    printTaskInfo(t);
-                    // Add tag information to output
-                    if (t->tag_count > 0) {
-                        printf("Tags: ");
-                        for (int i = 0; i < t->tag_count; i++) {
-                            printf("%s%s", t->tags[i], 
-                                  (i < t->tag_count - 1) ? ", " : "\n");
-                        }
-                        printf("-------------------------\n");
-                    }
-                    found = 1;
-                }
-                
-                keyword_node = keyword_node->next;
+            text[strcspn(text, "\n")] = 0;
+
+            if (queryCompile(text, today, 0, program, error, sizeof(error)) != TODO_OK) {
+                printf("Invalid expression: %s. Search aborted.\n", error);
+                return 0;
+            }
+            query->type = TODO_MATCH_EXPRESSION;
+            printf("\n=== Search Results for '%s' ===\n", text);
+            break;
+
+        case 9: // Ranked words
+            if (!ranked) {
+                printf("Invalid search option.\n");
+                return 0;
+            }
+            printf("Enter words to search for: ");
+            if (fgets(text, size, stdin) == NULL) {
+                printf("Error reading words. Search aborted.\n");
+                return 0;
             }
+            text[strcspn(text, "\n")] = 0;
+            printf("\n=== Best Matches for '%s' ===\n", text);
             break;
             
         default:
             printf("Invalid search option.\n");
+            return 0;
+    }
+    return search_option;
+}
+
+static double searchNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Answers an expression with the default query planner (plan.h) and prints
+// the matches as printMatches() would; returns the number found, or -1 if
+// there is no planner or it is out of memory (the caller then scans)
+static int printPlanned(task* head, completedstack* stack, const queryprogram* program, const char* text) {
+    planindex* set = planDefault();
+    tasklist list = {head};
+    if (!set) return -1;
+
+    double start = searchNowMs();
+    int rebuilt = planRefresh(set, &list, stack);
+    if (rebuilt < 0) return -1;
+    double build_ms = rebuilt ? searchNowMs() - start : 0;
+    int* rows = (int*)malloc(sizeof(int) * (set->count ? set->count : 1));
+    if (!rows) return -1;
+
+    queryplan plan;
+    start = searchNowMs();
+    planQuery(set, program, &plan);
+    long found = planExecute(set, &plan, program, rows, set->count);
+    planLogQuery(text, &plan, program, searchNowMs() - start, build_ms);
+
+    long i = 0;
+    printf("--- Pending Tasks ---\n");
+    for (; i < found && rows[i] < set->active; i++) printResult(set->rows[rows[i]], 1);
+    printf("--- Completed Tasks ---\n");
+    for (; i < found; i++) printResult(set->rows[rows[i]], 1);
+    free(rows);
+    return (int)found;
+}
+
+// Prints the RANK_DEFAULT_K tasks best matching the words of text, best
+// first, from the default ranked index (rank.h) or, without one, an index
+// built for this search; returns the number printed
+static int printRanked(task* head, completedstack* stack, const char* text) {
+    rankindex* set = rankDefault();
+    rankindex local;
+    tasklist list = {head};
+    rankhit hits[RANK_DEFAULT_K];
+    rankstats stats;
+
+    if (!set) {
+        rankInit(&local);
+        set = &local;
+    }
+    int rebuilt = rankRefresh(set, &list, stack);
+    if (rebuilt < 0) {
+        printf("Memory allocation failed.\n");
+        return 0;
+    }
+    double start = searchNowMs();
+    int found = rankSearch(set, text, RANK_DEFAULT_K, 0, hits, &stats);
+    double ms = searchNowMs() - start;
+
+    for (int i = 0; i < found; i++) {
+        printf("#%d  score %.3f%s\n", i + 1, hits[i].score, hits[i].row >= set->active ? "  (completed)" : "");
+        printResult(hits[i].t, 1);
+    }
+    if (found) {
+        printf("Top %d in %.3f ms, %ld of %ld postings read", found, ms, stats.read, stats.postings);
+        if (rebuilt && set != &local) printf("; index rebuilt in %.1f ms", set->build_ms);
+        printf("\n");
+    }
+    if (set == &local) rankFree(&local);
+    return found;
+}
+
+/*
+searchTasks() - Search tasks by multiple criteria
+ - Time: O(n), Space: O(1); an expression with a tag, due date or text
+   every match needs is answered from the planner's indexes (plan.h) when
+   they are cheaper than a scan, Space: O(n) for the result rows
+ - Option 8 combines criteria in one expression (see query.h), compiled
+   against today, the session date; option 9 lists the 10 best matches for
+   some words, scored by BM25 (see rank.h)
+ - Sample Case:
+    Input:
+      Choice: 7 (Keyword search)
+      Keyword: "project"
+    Output:
+      --- Pending Tasks ---
+      Name: Final Project
+      Description: Complete capstone project
+      Tags: academic, important
+      -------------------------
+      --- Completed Tasks ---
+      Name: Project Proposal
+      -------------------------
+ */
+void searchTasks(task* head, completedstack* stack, const char* keyword, date today) {
+    int found = 0;
+    char new_keyword[QUERY_TEXT_MAX];
+    todoquery query;
+    queryprogram program;
+    
+    printf("\n=== Task Search ===\n");
+    int search_option = readQuery(&query, &program, today, new_keyword, sizeof(new_keyword), 1);
+    if (search_option == 0) return;
+    
+    if (search_option == 4) {
+        // Completed tasks live in the stack, pending/overdue ones in the main list
+        if (query.status == COMPLETED) {
+            printf("--- Completed Tasks ---\n");
+            found = printMatches(NULL, stack->top, &query, 0);
+        } else {
+            printf("--- Tasks ---\n");
+            found = printMatches(head, NULL, &query, 0);
+        }
+        if (!found) {
+            printf("No matching tasks found.\n");
+        }
+        return;
+    }
+    
+    if (search_option == 9) {
+        if (printRanked(head, stack, new_keyword) == 0) printf("No matching tasks found.\n");
+        return;
+    }
+
+    if (search_option == 8) {
+        found = printPlanned(head, stack, &program, new_keyword);
+        if (found >= 0) {
+            if (!found) printf("No matching tasks found.\n");
             return;
+        }
+        found = 0;
+    }
+
+    // Search pending tasks, then completed tasks; keyword and expression
+    // results also list tags
+    printf("--- Pending Tasks ---\n");
+    found += printMatches(head, NULL, &query, search_option >= 7);
+    printf("--- Completed Tasks ---\n");
+    found += printMatches(NULL, stack->top, &query, search_option >= 7);
+    
+    if (!found) {
+        printf("No matching tasks found.\n");
     }
+}
+
+
+/*
+bulkTasks() - Completes, deletes, retags or reprioritizes every task matching a search
+ - Time: O(n), Space: O(1)
+ - The filter is chosen as in searchTasks(); the matching active tasks are
+   listed and the action runs on all of them in one pass (todoBulk()) once
+   confirmed
+ - Sample Case:
+    Input:
+      Choice: 7 (Keyword), keyword "sprint-4"
+      Action: 1 (Mark as Completed), confirm y
+    Output:
+      --- Tasks ---
+      (each matching task)
+      12 of 12 matching tasks completed.
+ */
+void bulkTasks(tasklist* list, completedstack* stack, date today) {
+    static const char* const done[] = {"completed", "deleted", "tagged", "untagged", "reprioritized"};
+    char text[QUERY_TEXT_MAX], tag[100];
+    char buffer[100];
+    todoquery query;
+    queryprogram program;
+    todobulk op = {TODO_BULK_COMPLETE, tag, 0};
+    int action;
+    
+    printf("\n=== Bulk Actions ===\n");
+    if (readQuery(&query, &program, today, text, sizeof(text), 0) == 0) return;
     
+    printf("--- Tasks ---\n");
+    int found = printMatches(list->head, NULL, &query, 1);
     if (!found) {
         printf("No matching tasks found.\n");
+        return;
+    }
+    
+    printf("\nAction for these %d task(s):\n", found);
+    printf("1. Mark as Completed\n");
+    printf("2. Delete\n");
+    printf("3. Add Tag\n");
+    printf("4. Remove Tag\n");
+    printf("5. Set Priority\n");
+    printf("Enter your choice (1-5): ");
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &action) != 1 ||
+        action < 1 || action > 5) {
+        printf("Invalid action. Nothing changed.\n");
+        return;
+    }
+    op.action = (todobulkaction)(action - 1);
+    
+    if (op.action == TODO_BULK_TAG || op.action == TODO_BULK_UNTAG) {
+        printf("Enter tag: ");
+        if (fgets(tag, sizeof(tag), stdin) == NULL) return;
+        tag[strcspn(tag, "\n")] = 0;
+    } else if (op.action == TODO_BULK_PRIORITY) {
+        printf("Enter new priority (1-High, 2-Medium, 3-Low): ");
+        if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &op.priority) != 1) {
+            printf("Invalid priority. Nothing changed.\n");
+            return;
+        }
+    }
+    
+    printf("Apply to %d task(s)? (y/n): ", found);
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL || (buffer[0] != 'y' && buffer[0] != 'Y')) {
+        printf("Nothing changed.\n");
+        return;
+    }
+    
+    todobulkresult result;
+    todostatus status = todoBulk(list, stack, NULL, &query, &op, today, &result);
+    if (status != TODO_OK && result.changed == 0) {
+        printf("Nothing changed: %s.\n", todoStatusText(status));
+        return;
+    }
+    printf("%d of %d matching tasks %s.\n", result.changed, result.matched, done[op.action]);
+    if (status != TODO_OK) {
+        printf("Stopped early: %s.\n", todoStatusText(status));
+    }
+}
+
+
+// Asks for a view by number or name; returns its position, or -1 after a message
+static int readView(viewset* set) {
+    char buffer[VIEWS_NAME_MAX + 8];
+    int number;
+    printf("Enter view number or name: ");
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL) return -1;
+    buffer[strcspn(buffer, "\n")] = 0;
+    int v = viewsFind(set, buffer);
+    if (v < 0 && sscanf(buffer, "%d", &number) == 1 && number >= 1 && number <= set->count) v = number - 1;
+    if (v < 0) printf("No view '%s'.\n", buffer);
+    return v;
+}
+
+// Active tasks first, then by due date (none last), then by name
+static int compareViewTasks(const void* a, const void* b) {
+    const task* x = *(task* const*)a;
+    const task* y = *(task* const*)b;
+    if (x->completed != y->completed) return x->completed - y->completed;
+    if (x->due_date_set != y->due_date_set) return y->due_date_set - x->due_date_set;
+    if (x->due_date_set) {
+        long dx = queryDateKey(x->duedate), dy = queryDateKey(y->duedate);
+        if (dx != dy) return dx < dy ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+// Lists a view's tasks, active then completed, each by due date
+static void openView(viewset* set, int v) {
+    double start = searchNowMs();
+    long count = viewsMembers(set, v, NULL, 0);
+    task** members = (task**)malloc(sizeof(task*) * (count ? count : 1));
+    if (!members) {
+        printf("Memory allocation failed.\n");
+        return;
     }
+    count = viewsMembers(set, v, members, count);
+    double ms = searchNowMs() - start;
+    qsort(members, (size_t)count, sizeof(task*), compareViewTasks);
+
+    long active = 0;
+    while (active < count && !members[active]->completed) active++;
+    printf("\n=== View '%s': %s ===\n", set->views[v]->name, set->views[v]->expression);
+    printf("%ld task(s) (%ld completed), opened in %.3f ms\n", count, count - active, ms);
+    printf("--- Pending Tasks ---\n");
+    for (long i = 0; i < active; i++) printResult(members[i], 1);
+    printf("--- Completed Tasks ---\n");
+    for (long i = active; i < count; i++) printResult(members[i], 1);
+    if (!count) printf("No matching tasks found.\n");
+    free(members);
 }
 
+/*
+savedViews() - Lists the saved views with their counts, and opens, saves or deletes one
+ - Time: O(changed tasks * views) to bring the views up to date, then
+   O(k log k) to open one of k tasks, Space: O(k)
+ - The views are the default view set (views.h), kept in VIEWS_DEFAULT_FILE
+ - Sample Case:
+    Input: choice 2, name "urgent work", expression "tag:work tag:urgent"
+    Output: Saved 'urgent work': 3 task(s).
+    Input (later): choice 1, view 1
+    Output:
+      === View 'urgent work': tag:work tag:urgent ===
+      3 task(s) (1 completed), opened in 0.004 ms
+ */
+void savedViews(tasklist* list, completedstack* stack, date today) {
+    viewset* set = viewsDefault();
+    char name[VIEWS_NAME_MAX + 8], expression[QUERY_TEXT_MAX], error[80];
+    char buffer[32];
+    int choice;
+
+    printf("\n=== Saved Views ===\n");
+    if (!set) {
+        printf("Saved views are not available.\n");
+        return;
+    }
+    if (viewsRefresh(set, list, stack, today) < 0) {
+        printf("Out of memory: some views will be rebuilt later.\n");
+    }
+    for (int v = 0; v < set->count; v++) {
+        printf("%d. %-24s %6ld task(s)   %s\n", v + 1, set->views[v]->name,
+               set->views[v]->members.count, set->views[v]->expression);
+    }
+    if (!set->count) printf("No saved views yet.\n");
+    printf("Kept current by %ld test(s) of changed tasks over %ld change(s), %ld full scan(s)\n",
+           set->tests, set->changes, set->scans);
+
+    printf("\n1. Open a View\n");
+    printf("2. Save a New View\n");
+    printf("3. Delete a View\n");
+    printf("Enter your choice (1-3): ");
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &choice) != 1) {
+        printf("Invalid choice.\n");
+        return;
+    }
+
+    if (choice == 1) {
+        int v = readView(set);
+        if (v >= 0) openView(set, v);
+    } else if (choice == 2) {
+        printf("Enter a name for the view: ");
+        if (fgets(name, sizeof(name), stdin) == NULL) return;
+        name[strcspn(name, "\n")] = 0;
+        printf("Fields: name: desc: tag: priority: status: due: done:, a bare word searches all\n");
+        printf("Enter expression: ");
+        if (fgets(expression, sizeof(expression), stdin) == NULL) return;
+        expression[strcspn(expression, "\n")] = 0;
+        if (viewsAdd(set, name, expression, list, stack, error, sizeof(error)) != TODO_OK) {
+            printf("View not saved: %s.\n", error);
+            return;
+        }
+        printf("Saved '%s': %ld task(s).\n", name, set->views[viewsFind(set, name)]->members.count);
+        if (viewsSave(set, VIEWS_DEFAULT_FILE) != TODO_OK) {
+            printf("Could not write %s; the view lasts this session only.\n", VIEWS_DEFAULT_FILE);
+        }
+    } else if (choice == 3) {
+        int v = readView(set);
+        if (v < 0) return;
+        snprintf(name, sizeof(name), "%s", set->views[v]->name);
+        viewsRemove(set, name);
+        printf("Deleted '%s'.\n", name);
+        if (viewsSave(set, VIEWS_DEFAULT_FILE) != TODO_OK) {
+            printf("Could not write %s.\n", VIEWS_DEFAULT_FILE);
+        }
+    } else {
+        printf("Invalid choice.\n");
+    }
+}
 
 /*
 printTaskInfo() - Displays detailed task information
@@ -423,6 +620,10 @@ void printTaskInfo(task* t) {
     } else {
         printf("Due Date: Not Set\n");
     }
+    if (t->repeat.kind != RECUR_NONE) {
+        char rule[RECUR_TEXT_MAX];
+        printf("Repeats: %s\n", recurFormat(&t->repeat, rule, sizeof(rule)));
+    }
     printf("-------------------------\n");
 }
 
@@ -433,31 +634,9 @@ showStats() - Shows overall task statistics
  - Example: showStats(tasks, stack, today) -> "Total: 10, Completed: 50%"
  */
 void showStats(task* head, completedstack* stack, date today) {
-    int total = 0, completed = 0, pending = 0, overdue = 0;
-    
-    // Count pending and overdue tasks
-    task* p = head;
-    while (p) {
-        if (p->completed) {
-            
-            completed++;
-        } else if (p->status == OVERDUE || 
-                   (p->due_date_set && compareDates(today, p->duedate) > 0)) {
-            overdue++;
-        } else {
-            pending++;
-        }
-        p = p->next;
-    }
-    
-    // Count completed tasks in stack
-    stacknode* s = stack->top;
-    while (s) {
-        if (s->task_data) {
-            completed++;
-        }
-        s = s->next;
-    }
+    todocounts counts;
+    todoCount(head, stack, today, &counts);
+    int total, completed = counts.completed, pending = counts.pending, overdue = counts.overdue;
     
     // Total tasks
     total = pending + completed + overdue;
@@ -610,22 +789,32 @@ void show_time_stats(task* head, completedstack* stack, date today, int period)
     printf("\n=== Task Statistics for %s ===\n", (period == 0) ? "This Week" : "This Month");
     
     // Count pending and overdue tasks for the specified period
+    // A recurring task counts once per occurrence in the period; those are
+    // all today or later, so pending
+    date period_end = todoDateFromDay(todoDayNumber(today) + days_period);
+    date dates[31];
     task* p = head;
     while (p) {
-        if (p->due_date_set && isDateWithinDays(today, p->duedate, days_period)) {
+        int times = 0;
+        if (p->repeat.kind != RECUR_NONE && !p->completed) {
+            times = recurExpand(p, today, period_end, dates, 31);
+        } else if (p->due_date_set && isDateWithinDays(today, p->duedate, days_period)) {
+            times = 1;
+        }
+        if (times > 0) {
             if (p->completed) {
-                completed++;
-            } else if (p->status == OVERDUE) {
-                overdue++;
+                completed += times;
+            } else if (p->status == OVERDUE && p->repeat.kind == RECUR_NONE) {
+                overdue += times;
             } else {
-                pending++;
+                pending += times;
             }
             
             // Count by priority
             switch (p->priority) {
-                case 1: high_priority++; break;
-                case 2: medium_priority++; break;
-                case 3: low_priority++; break;
+                case 1: high_priority += times; break;
+                case 2: medium_priority += times; break;
+                case 3: low_priority += times; break;
             }
         }
         p = p->next;
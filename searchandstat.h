@@ -5,7 +5,9 @@
 #include "task_management.h"
 
 
-void searchTasks(task* head, completedstack* stack, const char* keyword);
+void searchTasks(task* head, completedstack* stack, const char* keyword, date today);
+void bulkTasks(tasklist* list, completedstack* stack, date today);
+void savedViews(tasklist* list, completedstack* stack, date today);
 void showStats(task* head, completedstack* stack, date today);
 void show_time_stats(task* head, completedstack* stack, date today, int period);
 void doneToday(tasklist* list, completedstack* stack);
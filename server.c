@@ -0,0 +1,1060 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+// Workers wait with epoll, which reports only the ready connections;
+// elsewhere they fall back to poll(), which scans them all
+#define SERVER_EPOLL 1
+#endif
+#include "server.h"
+#include "batch.h"
+#include "shard.h"
+#include "feed.h"
+#include "replication.h"
+#include "snapshot.h"
+#include "benchmark.h"
+
+#ifndef _WIN32
+
+#define SERVER_MAX_WORKERS 16
+#define SERVER_BACKLOG 512
+#define SERVER_INPUT_SIZE (16 * 1024)
+// Stop reading from a client whose unsent responses pass this size
+#define SERVER_OUTPUT_LIMIT (1024 * 1024)
+#define SERVER_POLL_MS 200
+// Ready connections taken per epoll_wait()
+#define SERVER_EPOLL_EVENTS 256
+// Change feed subscribers: how often an idle one looks for events, how
+// often it is sent HEAD when there are none, and how long a write may block
+#define SERVER_FEED_POLL_MS 10
+#define SERVER_FEED_HEARTBEAT_MS 1000
+#define SERVER_FEED_TIMEOUT_S 2
+#define SERVER_FEED_BATCH 64
+
+// One client connection, owned by a single worker
+typedef struct {
+    int fd;
+    char in[SERVER_INPUT_SIZE];
+    size_t in_len;
+    int discarding;    // skipping the rest of an overlong line
+    outbuf out;
+    size_t out_sent;   // bytes of out already written
+    int closing;       // the client is done sending; close once out is written
+    shardsession session;
+    int slot;          // position in the worker's conns
+    int epoll_fd;      // the worker's epoll instance, -1 under poll()
+    unsigned int watching;  // epoll events registered for fd
+} connection;
+
+// A worker thread: its own event loop over the connections handed to it
+typedef struct {
+    pthread_t thread;
+    int wake[2];       // pipe: the listener writes accepted fds here
+    int epoll_fd;      // -1: the poll() loop
+    int reader_slots[SHARD_MAX];  // epoch slots for running queries without a lock
+    connection** conns;
+    int count;
+    int cap;
+} worker;
+
+static struct {
+    shardset shards;
+    batchingest ingest;
+    repljournal journal;
+    replstream* stream;  // set when following another server: read-only
+    changefeed feed;
+    int feeding;         // feed set up; subscribe is refused without it
+    int subscribers;     // feed sender threads running
+    snapwriter snapshot;
+    pthread_t publisher;
+    int publishing;
+    int publish_ms;
+    worker workers[SERVER_MAX_WORKERS];
+    int worker_count;
+    long long requests;
+} server;
+
+// Set by SIGINT/SIGTERM; the wait timeouts make every loop notice it
+static int server_stop;
+
+static void stopServer(int sig) {
+    (void)sig;
+    __atomic_store_n(&server_stop, 1, __ATOMIC_RELAXED);
+}
+
+static int stopping() {
+    return __atomic_load_n(&server_stop, __ATOMIC_RELAXED);
+}
+
+static int setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Fills in a Unix socket address, -1 if the path does not fit
+static int socketAddress(struct sockaddr_un* addr, const char* path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// Closing the fd also takes it out of the worker's epoll set
+static void closeConnection(worker* w, int i) {
+    connection* c = w->conns[i];
+    if (c->fd >= 0) close(c->fd);
+    outbufFree(&c->out);
+    free(c);
+    w->conns[i] = w->conns[--w->count];
+    if (i < w->count) w->conns[i]->slot = i;
+}
+
+#ifdef SERVER_EPOLL
+// The events a connection waits for: input while its unsent output is
+// below SERVER_OUTPUT_LIMIT, and room to write while it has output
+static unsigned int wantedEvents(const connection* c) {
+    unsigned int events = 0;
+    if (!c->closing && c->out.len - c->out_sent < SERVER_OUTPUT_LIMIT) events |= EPOLLIN;
+    if (c->out.len > c->out_sent) events |= EPOLLOUT;
+    return events;
+}
+#endif
+
+// Brings the connection's epoll registration in line with wantedEvents();
+// returns -1 if epoll refused it
+static int watchConnection(connection* c) {
+#ifdef SERVER_EPOLL
+    unsigned int events = wantedEvents(c);
+    if (c->epoll_fd < 0 || events == c->watching) return 0;
+    struct epoll_event change = {events, {.ptr = c}};
+    if (epoll_ctl(c->epoll_fd, EPOLL_CTL_MOD, c->fd, &change) != 0) return -1;
+    c->watching = events;
+#else
+    (void)c;
+#endif
+    return 0;
+}
+
+// Drops the fd from the worker's epoll set before another thread takes it
+static void unwatchConnection(connection* c) {
+#ifdef SERVER_EPOLL
+    if (c->epoll_fd >= 0 && c->fd >= 0) epoll_ctl(c->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+#else
+    (void)c;
+#endif
+}
+
+static int addConnection(worker* w, int fd) {
+    if (w->count == w->cap) {
+        int cap = w->cap ? w->cap * 2 : 64;
+        connection** grown = (connection**)realloc(w->conns, sizeof(connection*) * cap);
+        if (!grown) return -1;
+        w->conns = grown;
+        w->cap = cap;
+    }
+    connection* c = (connection*)calloc(1, sizeof(connection));
+    if (!c || outbufInit(&c->out, -1, 4096) != 0) {
+        free(c);
+        return -1;
+    }
+    c->fd = fd;
+    c->session.set = &server.shards;
+    c->session.out = &c->out;
+    memcpy(c->session.reader_slots, w->reader_slots, sizeof(w->reader_slots));
+    c->epoll_fd = w->epoll_fd;
+#ifdef SERVER_EPOLL
+    if (c->epoll_fd >= 0) {
+        struct epoll_event watch = {EPOLLIN, {.ptr = c}};
+        if (epoll_ctl(c->epoll_fd, EPOLL_CTL_ADD, fd, &watch) != 0) {
+            outbufFree(&c->out);
+            free(c);
+            return -1;
+        }
+        c->watching = EPOLLIN;
+    }
+#endif
+    c->slot = w->count;
+    w->conns[w->count++] = c;
+    return 0;
+}
+
+// Same error line batch mode gives for an overlong command
+static void lineTooLong(connection* c) {
+    c->session.line_number++;
+    c->session.errors++;
+    outbufPuts(&c->out, "ERR line ");
+    outbufPutInt(&c->out, c->session.line_number, 0);
+    outbufPuts(&c->out, ": line too long\n");
+}
+
+// Commands a follower refuses: its tasks only change through the stream
+static int isChange(const char* command) {
+    static const char* const words[] = {"add", "put", "complete", "undo", "delete", "tag", "bulk",
+                                        "import", "today", "clear", "follow"};
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        if (strcmp(command, words[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// follow - the connection becomes a replication stream (replAttach()),
+// after the answers already queued on it
+static void startFollower(connection* c) {
+    unwatchConnection(c);
+    int flags = fcntl(c->fd, F_GETFL, 0);
+    fcntl(c->fd, F_SETFL, flags & ~O_NONBLOCK);
+    if (writeAll(c->fd, c->out.data + c->out_sent, c->out.len - c->out_sent) != 0) {
+        close(c->fd);
+    } else {
+        replAttach(&server.journal, &server.shards, c->fd);
+    }
+    c->fd = -1;
+}
+
+// One client of the change feed, on its own thread
+typedef struct {
+    int fd;
+    unsigned long from;
+} subscriber;
+
+static void feedSleep(int ms) {
+    struct timespec pause = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&pause, NULL);
+}
+
+/*
+feedSender() - Writes the change feed to one subscriber until it goes away
+ - Time: O(1) per event, Space: O(SERVER_FEED_BATCH)
+ - Stream lines (see feedFormat() for events):
+     HEAD <seq>                         newest event, first and when idle
+     <seq> <ms> <type>|<name>|...       one event
+     LOST <count>                       events overwritten before they were sent
+ - The thread only reads the ring, so a subscriber that reads slowly falls
+   behind (and loses events) without holding up any writer; one that takes
+   nothing for SERVER_FEED_TIMEOUT_S is disconnected
+ */
+static void* feedSender(void* arg) {
+    subscriber* sub = (subscriber*)arg;
+    feedcursor cursor;
+    feedevent events[SERVER_FEED_BATCH];
+    char line[64 + sizeof(events[0].name) + FEED_DETAIL_MAX];
+    outbuf out;
+    unsigned long lost = 0;
+    int idle_ms = 0;
+
+    feedSubscribe(&server.feed, &cursor, sub->from);
+    if (outbufInit(&out, sub->fd, 64 * 1024) == 0) {
+        int len = snprintf(line, sizeof(line), "HEAD %lu\n", feedHead(&server.feed));
+        outbufPut(&out, line, (size_t)len);
+        while (!stopping() && !out.error) {
+            int n = feedRead(&cursor, events, SERVER_FEED_BATCH);
+            if (cursor.lost != lost) {
+                int len = snprintf(line, sizeof(line), "LOST %lu\n", cursor.lost - lost);
+                outbufPut(&out, line, (size_t)len);
+                lost = cursor.lost;
+            }
+            for (int i = 0; i < n; i++) {
+                int len = feedFormat(&events[i], line, sizeof(line) - 1);
+                if (len < 0) continue;
+                line[len++] = '\n';
+                outbufPut(&out, line, (size_t)len);
+            }
+            if (n == SERVER_FEED_BATCH) continue;
+            if (n > 0) idle_ms = 0;
+            if (idle_ms >= SERVER_FEED_HEARTBEAT_MS) {
+                int len = snprintf(line, sizeof(line), "HEAD %lu\n", feedHead(&server.feed));
+                outbufPut(&out, line, (size_t)len);
+                idle_ms = 0;
+            }
+            outbufFlush(&out);
+            feedSleep(SERVER_FEED_POLL_MS);
+            idle_ms += SERVER_FEED_POLL_MS;
+        }
+        outbufFree(&out);
+    }
+    close(sub->fd);
+    free(sub);
+    __atomic_sub_fetch(&server.subscribers, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// subscribe[|seq] - the connection becomes a change feed stream (feedSender()),
+// after the answers already queued on it
+static void startSubscriber(connection* c, const char* line) {
+    char from[32];
+    shardLineField(line, 1, from, sizeof(from));
+    subscriber* sub = (subscriber*)malloc(sizeof(subscriber));
+    pthread_t thread;
+    unwatchConnection(c);
+    int flags = fcntl(c->fd, F_GETFL, 0);
+    fcntl(c->fd, F_SETFL, flags & ~O_NONBLOCK);
+    struct timeval timeout = {SERVER_FEED_TIMEOUT_S, 0};
+    setsockopt(c->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    int started = 0;
+    if (sub && writeAll(c->fd, c->out.data + c->out_sent, c->out.len - c->out_sent) == 0) {
+        sub->fd = c->fd;
+        sub->from = strtoul(from, NULL, 10);
+        __atomic_add_fetch(&server.subscribers, 1, __ATOMIC_ACQ_REL);
+        started = pthread_create(&thread, NULL, feedSender, sub) == 0;
+        if (started) pthread_detach(thread);
+        else __atomic_sub_fetch(&server.subscribers, 1, __ATOMIC_RELEASE);
+    }
+    if (!started) {
+        free(sub);
+        close(c->fd);
+    }
+    c->fd = -1;
+}
+
+/*
+runRequest() - Executes one request line
+ - Time: see runBatch(), Space: O(1)
+ - query and stats run without locking, in parallel on different workers
+   and beside the writers; other commands take turns with commands on the
+   same shard only (shardExecute())
+ - A follower answers lag itself and refuses changes
+ - Returns 1 if the connection was handed over to replication or the
+   change feed
+ */
+static int runRequest(connection* c, char* line) {
+    c->session.line_number++;
+    __atomic_add_fetch(&server.requests, 1, __ATOMIC_RELAXED);
+    char command[16];
+    shardLineField(line, 0, command, sizeof(command));
+
+    if (!server.stream && strcmp(command, "follow") == 0) {
+        startFollower(c);
+        return 1;
+    }
+    if (server.feeding && strcmp(command, "subscribe") == 0) {
+        startSubscriber(c, line);
+        return 1;
+    }
+    if (server.stream && strcmp(command, "lag") == 0) {
+        replStreamLag(server.stream, &c->out);
+    } else if (server.stream && isChange(command)) {
+        batchsession err = {NULL, &c->out, c->session.line_number, 0, -1};
+        batchError(&err, "read-only follower", command);
+        c->session.errors++;
+    } else {
+        shardExecute(&c->session, line);
+    }
+    return 0;
+}
+
+/*
+readRequests() - Reads what the client sent and runs every complete line
+ - Time: O(bytes) plus the commands, Space: O(1)
+ - Clients may pipeline: all requests in the buffer are answered in order
+   and their responses leave in one write
+ - Returns -1 when the connection should be closed, 1 when it became a
+   replication stream (anything sent after follow is dropped)
+ */
+static int readRequests(connection* c) {
+    ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+    if (n == 0) {
+        c->closing = 1;
+        return 0;
+    }
+    if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    c->in_len += (size_t)n;
+
+    char* start = c->in;
+    char* end = c->in + c->in_len;
+    char* newline;
+    while ((newline = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        *newline = '\0';
+        if (c->discarding) {
+            c->discarding = 0;
+        } else {
+            if (newline > start && newline[-1] == '\r') newline[-1] = '\0';
+            if (newline - start >= BATCH_LINE_MAX) {
+                lineTooLong(c);
+            } else if (runRequest(c, start)) {
+                return 1;
+            }
+        }
+        start = newline + 1;
+    }
+
+    c->in_len = (size_t)(end - start);
+    memmove(c->in, start, c->in_len);
+    if (c->in_len == sizeof(c->in)) {
+        // No newline in a full buffer: answer once, then drop bytes up to the next one
+        if (!c->discarding) lineTooLong(c);
+        c->discarding = 1;
+        c->in_len = 0;
+    }
+    return c->out.error ? -1 : 0;
+}
+
+// Writes pending responses without blocking, -1 if the client went away
+static int writeResponses(connection* c) {
+    while (c->out_sent < c->out.len) {
+        ssize_t n = write(c->fd, c->out.data + c->out_sent, c->out.len - c->out_sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        c->out_sent += (size_t)n;
+    }
+    c->out.len = 0;
+    c->out_sent = 0;
+    return 0;
+}
+
+// Takes newly accepted fds from the listener
+static void takeConnections(worker* w) {
+    int fds[64];
+    ssize_t n;
+    while ((n = read(w->wake[0], fds, sizeof(fds))) > 0) {
+        for (int i = 0; i < n / (ssize_t)sizeof(int); i++) {
+            if (addConnection(w, fds[i]) != 0) close(fds[i]);
+        }
+    }
+}
+
+// Reads, answers and closes conns[i] as its wait reported: ready is set for
+// input, hang-up or error, error for an error alone. Returns 1 if the
+// connection was closed or handed over.
+static int serveConnection(worker* w, int i, int ready, int error) {
+    connection* c = w->conns[i];
+    int failed = 0;
+    if (ready) failed = c->closing ? error : readRequests(c) != 0;  // or handed over
+    if (!failed && c->out.len > c->out_sent) failed = writeResponses(c) != 0;
+    // A client that shut down its side still gets every answer
+    if (c->closing && c->out.len == c->out_sent) failed = 1;
+    if (!failed && watchConnection(c) != 0) failed = 1;
+    if (failed) closeConnection(w, i);
+    return failed;
+}
+
+// poll() loop: rebuilds the fd array and scans every connection each round
+static void pollConnections(worker* w) {
+    struct pollfd* fds = NULL;
+    int fds_cap = 0;
+
+    while (!stopping()) {
+        if (w->count + 1 > fds_cap) {
+            fds_cap = (w->count + 1) * 2;
+            struct pollfd* grown = (struct pollfd*)realloc(fds, sizeof(struct pollfd) * fds_cap);
+            if (!grown) break;
+            fds = grown;
+        }
+        fds[0].fd = w->wake[0];
+        fds[0].events = POLLIN;
+        for (int i = 0; i < w->count; i++) {
+            connection* c = w->conns[i];
+            fds[i + 1].fd = c->fd;
+            fds[i + 1].events = (!c->closing && c->out.len - c->out_sent < SERVER_OUTPUT_LIMIT) ? POLLIN : 0;
+            if (c->out.len > c->out_sent) fds[i + 1].events |= POLLOUT;
+        }
+
+        int polled = w->count;
+        if (poll(fds, (nfds_t)polled + 1, SERVER_POLL_MS) <= 0) continue;
+
+        // Walk backwards so closing (swap with last) does not skip anyone
+        for (int i = polled - 1; i >= 0; i--) {
+            short events = fds[i + 1].revents;
+            serveConnection(w, i, (events & (POLLIN | POLLHUP | POLLERR)) != 0, (events & POLLERR) != 0);
+        }
+        if (fds[0].revents & POLLIN) takeConnections(w);
+    }
+    free(fds);
+}
+
+#ifdef SERVER_EPOLL
+// epoll loop: each round touches only the connections that are ready, and
+// a connection's registration changes only when what it waits for does
+static void epollConnections(worker* w) {
+    struct epoll_event events[SERVER_EPOLL_EVENTS];
+
+    while (!stopping()) {
+        int ready = epoll_wait(w->epoll_fd, events, SERVER_EPOLL_EVENTS, SERVER_POLL_MS);
+        int wake = 0;
+        for (int e = 0; e < ready; e++) {
+            connection* c = (connection*)events[e].data.ptr;
+            if (!c) {
+                wake = 1;
+                continue;
+            }
+            unsigned int happened = events[e].events;
+            serveConnection(w, c->slot, (happened & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0,
+                            (happened & EPOLLERR) != 0);
+        }
+        if (wake) takeConnections(w);
+    }
+}
+#endif
+
+/*
+serverWorker() - Event loop of one worker thread
+ - Time: O(ready connections) per round with epoll (Linux), O(connections)
+   per round with the poll() fallback, Space: O(connections)
+ - A connection is only watched for input while its unsent output is below
+   SERVER_OUTPUT_LIMIT, so a slow reader cannot make the server buffer
+   without bound
+ */
+static void* serverWorker(void* arg) {
+    worker* w = (worker*)arg;
+
+    w->epoll_fd = -1;
+#ifdef SERVER_EPOLL
+    w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event wake = {EPOLLIN, {.ptr = NULL}};
+    if (w->epoll_fd >= 0 && epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->wake[0], &wake) != 0) {
+        close(w->epoll_fd);
+        w->epoll_fd = -1;
+    }
+    if (w->epoll_fd >= 0) epollConnections(w);
+    else pollConnections(w);
+#else
+    pollConnections(w);
+#endif
+
+    while (w->count > 0) closeConnection(w, w->count - 1);
+    free(w->conns);
+    if (w->epoll_fd >= 0) close(w->epoll_fd);
+    return NULL;
+}
+
+/*
+serverListen() - Creates a non-blocking listening Unix socket
+ - Time: O(1), Space: O(1)
+ - Replaces a stale socket file; prints why on failure
+ - Example: serverListen("/tmp/todo.sock") -> fd, or -1
+ */
+int serverListen(const char* path) {
+    struct sockaddr_un addr;
+    if (socketAddress(&addr, path) != 0) {
+        printf("Socket path is too long: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SERVER_BACKLOG) != 0) {
+        perror("Failed to listen on socket");
+        close(fd);
+        return -1;
+    }
+    setNonBlocking(fd);
+    return fd;
+}
+
+/*
+serverConnect() - Opens a blocking connection to a server's Unix socket
+ - Time: O(1), Space: O(1)
+ - Example: serverConnect("/tmp/todo.sock") -> fd, or -1 if nobody listens
+ */
+int serverConnect(const char* path) {
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (socketAddress(&addr, path) != 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One worker per core, up to SERVER_MAX_WORKERS
+static int workerCount() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : cores > SERVER_MAX_WORKERS ? SERVER_MAX_WORKERS : (int)cores;
+}
+
+/*
+serveClients() - Accepts connections until SIGINT/SIGTERM and deals them out
+ - Time: O(1) per connection, Space: O(workers)
+ - Starts server.worker_count workers, each with epoch slots in every
+   shard, and joins them before returning
+ */
+static void serveClients(int listen_fd) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServer;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int i = 0; i < server.worker_count; i++) {
+        worker* w = &server.workers[i];
+        if (pipe(w->wake) != 0) {
+            perror("pipe");
+            stopServer(0);
+            server.worker_count = i;
+            break;
+        }
+        setNonBlocking(w->wake[0]);
+        shardRegisterReaders(&server.shards, w->reader_slots);
+        pthread_create(&w->thread, NULL, serverWorker, w);
+    }
+
+    int next = 0;
+    struct pollfd listener = {listen_fd, POLLIN, 0};
+    while (!stopping()) {
+        if (poll(&listener, 1, SERVER_POLL_MS) <= 0) continue;
+        int fd;
+        while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+            setNonBlocking(fd);
+            if (write(server.workers[next].wake[1], &fd, sizeof(fd)) != (ssize_t)sizeof(fd)) close(fd);
+            next = (next + 1) % server.worker_count;
+        }
+    }
+
+    for (int i = 0; i < server.worker_count; i++) {
+        pthread_join(server.workers[i].thread, NULL);
+        close(server.workers[i].wake[0]);
+        close(server.workers[i].wake[1]);
+    }
+}
+
+// Tasks linked in all shards, marked ones included
+static int linkedTasks() {
+    int count = 0;
+    for (int s = 0; s < server.shards.count; s++) count += server.shards.stores[s].linked;
+    return count;
+}
+
+// Changes applied so far, to tell when the snapshot is out of date
+static unsigned long long changeCount() {
+    if (!server.stream) return __atomic_load_n(&server.journal.seq, __ATOMIC_RELAXED);
+    // A follower that reloads starts counting again
+    return ((unsigned long long)__atomic_load_n(&server.stream->snapshots, __ATOMIC_RELAXED) << 40) +
+           __atomic_load_n(&server.stream->applied, __ATOMIC_RELAXED);
+}
+
+// Publishes a new snapshot version every publish_ms while there are changes
+static void* snapshotPublisher(void* arg) {
+    (void)arg;
+    int slots[SHARD_MAX];
+    shardRegisterReaders(&server.shards, slots);
+    unsigned long long published = 0;
+    int first = 1;
+    struct timespec pause = {server.publish_ms / 1000, (server.publish_ms % 1000) * 1000000L};
+    while (!stopping()) {
+        unsigned long long changes = changeCount();
+        if ((first || changes != published) &&
+            snapPublishShards(&server.snapshot, &server.shards, slots, changes) == 0) {
+            published = changes;
+            first = 0;
+        }
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+// TODOLIST_SNAPSHOT=/name publishes the tasks to shared memory (see snapshot.h),
+// every TODOLIST_SNAPSHOT_MS (default SNAP_DEFAULT_MS) while they change
+static void startPublisher() {
+    const char* name = getenv("TODOLIST_SNAPSHOT");
+    if (!name || name[0] == '\0' || snapWriterOpen(&server.snapshot, name) != 0) return;
+    const char* interval = getenv("TODOLIST_SNAPSHOT_MS");
+    server.publish_ms = interval && atoi(interval) > 0 ? atoi(interval) : SNAP_DEFAULT_MS;
+    if (pthread_create(&server.publisher, NULL, snapshotPublisher, NULL) != 0) {
+        snapWriterClose(&server.snapshot);
+        return;
+    }
+    server.publishing = 1;
+    printf("Publishing snapshots as %s every %d ms\n", name, server.publish_ms);
+}
+
+// Joins the publisher (serveClients() has seen the stop signal) and removes the snapshot
+static void stopPublisher() {
+    if (!server.publishing) return;
+    pthread_join(server.publisher, NULL);
+    printf("Published %lld snapshot versions (last took %.1f ms).\n",
+           server.snapshot.published, server.snapshot.build_seconds * 1000);
+    snapWriterClose(&server.snapshot);
+    server.publishing = 0;
+}
+
+// Sets up the change feed (TODOLIST_FEED_EVENTS events, default
+// FEED_DEFAULT_EVENTS) once the tasks are loaded, so it holds changes only
+static void startFeed() {
+    const char* events = getenv("TODOLIST_FEED_EVENTS");
+    if (feedInit(&server.feed, events && atoi(events) > 0 ? atoi(events) : FEED_DEFAULT_EVENTS) != 0) {
+        printf("Memory allocation failed for the change feed; subscribe is off.\n");
+        return;
+    }
+    feedSetDefault(&server.feed);
+    server.feeding = 1;
+}
+
+// Waits for the feed senders (serveClients() has seen the stop signal)
+static void stopFeed() {
+    if (!server.feeding) return;
+    while (__atomic_load_n(&server.subscribers, __ATOMIC_ACQUIRE) > 0) feedSleep(SERVER_FEED_POLL_MS);
+    feedSetDefault(NULL);
+    printf("Recorded %lu changes in the change feed.\n", feedHead(&server.feed));
+    feedFree(&server.feed);
+    server.feeding = 0;
+}
+
+/*
+runServer() - Serves the task list to many clients over a Unix socket
+ - Time: O(1) per request plus the command, Space: O(connections)
+ - The protocol is the batch mode one (see runBatch()): one command per
+   line, one response per command, in order. Clients may send many
+   requests before reading the answers.
+ - The main thread accepts connections and deals them out to worker
+   threads, one per core (up to SERVER_MAX_WORKERS), each with its own
+   epoll loop (poll() where there is no epoll). The tasks are split into shards by name (one per worker,
+   or TODOLIST_SHARDS), each with its own lock, so writes to different
+   names run in parallel (see shard.h). Queries never wait for writers
+   (epoch reclamation, see batchExecuteShared()), and put requests go
+   through a lock-free ring to a single applier thread (batchIngestStart()).
+ - Every change is journaled; a client that sends follow becomes a
+   read-only follower (see replication.h and runFollower())
+ - Every change is also recorded in the change feed; a client that sends
+   subscribe[|seq] gets the events from seq on (or from now), see feedSender()
+ - With TODOLIST_SNAPSHOT=/name the tasks are also published to shared
+   memory for other processes to read (see snapshot.h)
+ - Runs until SIGINT/SIGTERM, then removes the socket file
+ - Returns 0 on a clean shutdown, 1 if the server could not start
+ - Sample Case:
+    $ ./todolist --serve /tmp/todo.sock &
+    $ printf 'add|Report|Q2|1|15/06/2025\nstats\n' | nc -U /tmp/todo.sock
+    OK
+    OK pending=1 overdue=0 completed=0 high=1 medium=0 low=0
+ */
+int runServer(tasklist* list, completedstack* stack, const char* path) {
+    server.worker_count = workerCount();
+    const char* env = getenv("TODOLIST_SHARDS");
+    int shards = env && atoi(env) > 0 ? atoi(env) : server.worker_count;
+
+    if (shardSetInit(&server.shards, list, stack, shards) != 0) {
+        printf("Memory allocation failed for server mode.\n");
+        return 1;
+    }
+    if (shardIngestStart(&server.shards, &server.ingest, TASKQUEUE_DEFAULT_SIZE) != 0) {
+        printf("Memory allocation failed for server mode.\n");
+        shardSetFree(&server.shards, list, stack);
+        return 1;
+    }
+    if (replJournalStart(&server.journal) != 0) {
+        printf("Memory allocation failed for server mode.\n");
+        batchIngestStop(&server.ingest);
+        shardSetFree(&server.shards, list, stack);
+        return 1;
+    }
+    shardSetJournal(&server.shards, replRecord, &server.journal);
+    int listen_fd = serverListen(path);
+    if (listen_fd < 0) {
+        batchIngestStop(&server.ingest);
+        replJournalStop(&server.journal);
+        shardSetFree(&server.shards, list, stack);
+        return 1;
+    }
+
+    printf("Serving %d tasks on %s with %d workers and %d shards (Ctrl+C to stop)\n",
+           linkedTasks(), path, server.worker_count, server.shards.count);
+    startFeed();
+    startPublisher();
+    fflush(stdout);
+    serveClients(listen_fd);
+    stopPublisher();
+    close(listen_fd);
+    unlink(path);
+    // Workers are gone, so nothing else is pushed while the ring drains
+    batchIngestStop(&server.ingest);
+    replJournalStop(&server.journal);
+    stopFeed();
+    printf("Server stopped after %lld requests (%lld tasks put in %lld batches).\n",
+           server.requests, server.ingest.applied, server.ingest.batches);
+    if (server.journal.attached > 0) {
+        printf("Journaled %lu changes for %ld followers (%ld dropped for falling behind).\n",
+               server.journal.seq, server.journal.attached, server.journal.dropped);
+    }
+
+    shardSetFree(&server.shards, list, stack);
+    return 0;
+}
+
+/*
+runFollower() - Serves a read-only copy of another server's tasks
+ - Time: O(n) for the first snapshot, then O(1) per change plus the command
+ - Connects to primary with follow, loads its snapshot and applies its
+   journal from then on, on its own thread (see replication.h). Clients of
+   path get query, stats and export answered from the copy, lag, the
+   change feed of the copy (subscribe), and an error for anything that
+   would change it. If the primary goes away the
+   copy stays as it was and is reloaded when the primary is back.
+ - Tasks in list and stack are not served; they are freed along with the copy
+ - Returns 0 on a clean shutdown, 1 if it could not start
+ - Sample Case:
+    $ ./todolist --serve /tmp/a.sock &
+    $ ./todolist --follow /tmp/a.sock /tmp/b.sock &
+    $ printf 'add|Report|Q2|1|15/06/2025\n' | nc -U /tmp/a.sock
+    OK
+    $ printf 'lag\nstats\n' | nc -U /tmp/b.sock
+    OK applied=1 head=1 lag_ops=0 lag_ms=0 connected=1
+    OK pending=1 overdue=0 completed=0 high=1 medium=0 low=0
+ */
+int runFollower(tasklist* list, completedstack* stack, const char* primary, const char* path) {
+    static replstream stream;
+    if (replStreamConnect(&stream, primary) != 0) {
+        printf("Could not follow %s: no server answered there.\n", primary);
+        return 1;
+    }
+    freeTasks(list);
+    freeStack(stack);
+    server.worker_count = workerCount();
+    if (shardSetInit(&server.shards, list, stack, stream.shards) != 0) {
+        printf("Memory allocation failed for follower mode.\n");
+        replStreamStop(&stream);
+        return 1;
+    }
+    if (replStreamStart(&stream, &server.shards) != 0) {
+        printf("Memory allocation failed for follower mode.\n");
+        replStreamStop(&stream);
+        shardSetFree(&server.shards, list, stack);
+        return 1;
+    }
+    int listen_fd = serverListen(path);
+    if (listen_fd < 0) {
+        replStreamStop(&stream);
+        shardSetFree(&server.shards, list, stack);
+        return 1;
+    }
+
+    server.stream = &stream;
+    printf("Following %s on %s with %d workers and %d shards (Ctrl+C to stop)\n",
+           primary, path, server.worker_count, server.shards.count);
+    startFeed();
+    startPublisher();
+    fflush(stdout);
+    serveClients(listen_fd);
+    stopPublisher();
+    close(listen_fd);
+    unlink(path);
+    replStreamStop(&stream);
+    stopFeed();
+    printf("Follower stopped after %lld requests (%lu changes applied, %ld snapshots loaded).\n",
+           server.requests, stream.applied, stream.snapshots);
+    server.stream = NULL;
+
+    shardSetFree(&server.shards, list, stack);
+    return 0;
+}
+
+// ===== Load generator =====
+
+#define LOAD_MAX_PIPELINE 64
+
+typedef struct {
+    pthread_t thread;
+    const char* path;
+    int id;
+    int requests;
+    int pipeline;      // requests in flight at once
+    double* latencies; // seconds, one per request
+    int done;
+    int failed;
+} loadclient;
+
+// Request i of a client: mostly reads, with adds and deletes of its own tasks
+static int loadRequest(char* line, size_t size, int id, int i, int* rows_expected) {
+    *rows_expected = 0;
+    switch (i % 10) {
+        case 0: return snprintf(line, size, "add|lg%d-%d|load test|%d|15/06/2025\n", id, i, 1 + i % 3);
+        case 5: return snprintf(line, size, "delete|lg%d-%d\n", id, i - 5);
+        case 1: case 6: return snprintf(line, size, "stats\n");
+        default:
+            *rows_expected = -1;  // "OK n" then n rows
+            return snprintf(line, size, "query|name|lg%d-%d\n", id, i - i % 10);
+    }
+}
+
+/*
+loadClient() - Sends requests and times each one until its response arrives
+ - Time: O(requests), Space: O(requests)
+ - Keeps `pipeline` requests in flight; with 1 it is a plain request/reply loop
+ */
+static void* loadClient(void* arg) {
+    loadclient* lc = (loadclient*)arg;
+    int fd = serverConnect(lc->path);
+    if (fd < 0) {
+        lc->failed = 1;
+        return NULL;
+    }
+
+    double sent_at[LOAD_MAX_PIPELINE];
+    int rows_expected[LOAD_MAX_PIPELINE];
+    char in[64 * 1024];
+    size_t in_len = 0;
+    int sent = 0, pending_rows = 0;
+
+    while (lc->done < lc->requests) {
+        // Top up the pipeline in a single write
+        char out[LOAD_MAX_PIPELINE * 64];
+        size_t out_len = 0;
+        while (sent < lc->requests && sent - lc->done < lc->pipeline) {
+            int slot = sent % LOAD_MAX_PIPELINE;
+            out_len += (size_t)loadRequest(out + out_len, sizeof(out) - out_len, lc->id, sent,
+                                           &rows_expected[slot]);
+            sent_at[slot] = benchNow();
+            sent++;
+        }
+        if (out_len > 0 && writeAll(fd, out, out_len) != 0) break;
+
+        ssize_t n = read(fd, in + in_len, sizeof(in) - in_len);
+        if (n <= 0) break;
+        in_len += (size_t)n;
+
+        // Match complete lines to requests; a query's rows follow its "OK n"
+        char* start = in;
+        char* newline;
+        while ((newline = memchr(start, '\n', (size_t)(in + in_len - start))) != NULL) {
+            int slot = lc->done % LOAD_MAX_PIPELINE;
+            int finished = 1;
+            if (pending_rows > 0) {
+                finished = --pending_rows == 0;
+            } else if (rows_expected[slot] < 0 && strncmp(start, "OK ", 3) == 0) {
+                pending_rows = atoi(start + 3);
+                finished = pending_rows == 0;
+            }
+            if (finished) {
+                lc->latencies[lc->done] = benchNow() - sent_at[slot];
+                lc->done++;
+            }
+            start = newline + 1;
+        }
+        in_len = (size_t)(in + in_len - start);
+        memmove(in, start, in_len);
+    }
+
+    close(fd);
+    if (lc->done < lc->requests) lc->failed = 1;
+    return NULL;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Runs `clients` threads against the server and prints one result row
+static int loadRound(const char* path, int clients, int requests, int pipeline) {
+    loadclient* lcs = (loadclient*)calloc((size_t)clients, sizeof(loadclient));
+    double* latencies = (double*)calloc((size_t)clients * requests, sizeof(double));
+    if (!lcs || !latencies) {
+        free(lcs);
+        free(latencies);
+        printf("Memory allocation failed.\n");
+        return -1;
+    }
+
+    double start = benchNow();
+    for (int i = 0; i < clients; i++) {
+        lcs[i] = (loadclient){0, path, i, requests, pipeline, latencies + (size_t)i * requests, 0, 0};
+        pthread_create(&lcs[i].thread, NULL, loadClient, &lcs[i]);
+    }
+    long total = 0;
+    int failed = 0;
+    for (int i = 0; i < clients; i++) {
+        pthread_join(lcs[i].thread, NULL);
+        failed |= lcs[i].failed;
+        // Pack finished requests so the percentiles skip unused slots
+        memmove(latencies + total, lcs[i].latencies, sizeof(double) * lcs[i].done);
+        total += lcs[i].done;
+    }
+    double elapsed = benchNow() - start;
+
+    qsort(latencies, (size_t)total, sizeof(double), compareDoubles);
+    if (total > 0) {
+        printf("%7d %8d %10ld %12.0f %10.1f %10.1f%s\n", clients, pipeline, total,
+               total / elapsed, latencies[total / 2] * 1e6,
+               latencies[total * 99 / 100] * 1e6, failed ? "  (errors)" : "");
+    } else {
+        printf("%7d %8d  could not connect to %s\n", clients, pipeline, path);
+    }
+    free(lcs);
+    free(latencies);
+    return failed ? -1 : 0;
+}
+
+/*
+runLoadGenerator() - Measures a running server at 1, 16 and 256 clients
+ - Time: O(clients * requests), Space: O(clients * requests)
+ - Each client sends 80% reads (query, stats) and 20% writes (add, delete
+   of its own tasks). The last row repeats 16 clients with 16 requests
+   pipelined per connection.
+ - Sample Case:
+    $ ./todolist --loadgen /tmp/todo.sock 20000
+    clients pipeline   requests        ops/s   p50 (us)   p99 (us)
+          1        1      20000        41230       22.1       48.0
+ */
+int runLoadGenerator(const char* path, int requests) {
+    static const int rounds[][2] = {{1, 1}, {16, 1}, {256, 1}, {16, 16}};
+    int failed = 0;
+
+    signal(SIGPIPE, SIG_IGN);
+    printf("%7s %8s %10s %12s %10s %10s\n", "clients", "pipeline", "requests", "ops/s", "p50 (us)", "p99 (us)");
+    for (int i = 0; i < 4; i++) {
+        int clients = rounds[i][0];
+        // Keep the total work per round similar
+        int per_client = clients > 1 ? requests / clients * 4 : requests;
+        if (per_client < 100) per_client = 100;
+        per_client -= per_client % 10;
+        failed |= loadRound(path, clients, per_client, rounds[i][1]) != 0;
+    }
+    return failed ? 1 : 0;
+}
+
+#else
+
+int runServer(tasklist* list, completedstack* stack, const char* path) {
+    (void)list;
+    (void)stack;
+    (void)path;
+    printf("Server mode needs Unix domain sockets and is not available on Windows.\n");
+    return 1;
+}
+
+int runLoadGenerator(const char* path, int requests) {
+    (void)path;
+    (void)requests;
+    printf("The load generator needs Unix domain sockets and is not available on Windows.\n");
+    return 1;
+}
+
+int runFollower(tasklist* list, completedstack* stack, const char* primary, const char* path) {
+    (void)list;
+    (void)stack;
+    (void)primary;
+    (void)path;
+    printf("Follower mode needs Unix domain sockets and is not available on Windows.\n");
+    return 1;
+}
+
+int serverListen(const char* path) {
+    (void)path;
+    return -1;
+}
+
+int serverConnect(const char* path) {
+    (void)path;
+    return -1;
+}
+
+#endif
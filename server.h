@@ -0,0 +1,15 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "task_management.h"
+
+// Default socket for --serve and --loadgen
+#define SERVER_DEFAULT_SOCKET "/tmp/todolist.sock"
+
+int runServer(tasklist* list, completedstack* stack, const char* path);
+int runFollower(tasklist* list, completedstack* stack, const char* primary, const char* path);
+int runLoadGenerator(const char* path, int requests);
+int serverListen(const char* path);
+int serverConnect(const char* path);
+
+#endif
@@ -0,0 +1,619 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "shard.h"
+#include "fileio.h"
+
+#define SHARD_MAX_KEYS 16
+
+// FNV-1a spreads names well in its low bits, which the name index inside
+// each shard uses; the shard is picked from mixed bits so each shard's
+// index still sees evenly spread hashes
+static unsigned int mixHash(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/*
+shardHash() - 32-bit hash of a name for spreading names over shards or nodes
+ - Time: O(length), Space: O(1)
+ - Example: shardHash("Report") -> same value in every process
+ */
+unsigned int shardHash(const char* name) {
+    return mixHash(todoNameHash(name));
+}
+
+/*
+shardOf() - The shard that owns a task name
+ - Time: O(length), Space: O(1)
+ - Example: shardOf(&set, "Report") -> 0 .. set->count - 1
+ */
+int shardOf(const shardset* set, const char* name) {
+    return (int)(shardHash(name) % (unsigned int)set->count);
+}
+
+// Records that a completion went to shard; caller holds undo_lock
+static int logCompletion(shardset* set, int shard) {
+    if (set->undo_count == set->undo_cap) {
+        long cap = set->undo_cap ? set->undo_cap * 2 : 1024;
+        unsigned char* grown = (unsigned char*)realloc(set->undo_log, (size_t)cap);
+        if (!grown) return -1;
+        set->undo_log = grown;
+        set->undo_cap = cap;
+    }
+    set->undo_log[set->undo_count++] = (unsigned char)shard;
+    return 0;
+}
+
+/*
+shardSetInit() - Moves a list and stack into count shards
+ - Time: O(n), Space: O(n) for the name indexes
+ - Tasks keep their order within each shard; the completion order of the
+   stack is kept in the undo log. list and stack are left empty until
+   shardSetFree() puts everything back.
+ - Returns 0 on success, -1 if out of memory (the tasks are given back)
+ */
+int shardSetInit(shardset* set, tasklist* list, completedstack* stack, int count) {
+    memset(set, 0, sizeof(*set));
+    set->count = count < 1 ? 1 : count > SHARD_MAX ? SHARD_MAX : count;
+
+    long stacked = 0;
+    for (stacknode* node = stack->top; node; node = node->next) stacked++;
+    stacknode** nodes = (stacknode**)malloc(sizeof(stacknode*) * (stacked ? stacked : 1));
+    if (!nodes) return -1;
+    long i = 0;
+    for (stacknode* node = stack->top; node; node = node->next) nodes[i++] = node;
+
+    // Oldest completion first, so each shard's stack ends up in the same order
+    pthread_mutex_init(&set->undo_lock, NULL);
+    for (i = stacked - 1; i >= 0; i--) {
+        int shard = nodes[i]->task_data ? shardOf(set, nodes[i]->task_data->name) : 0;
+        if (logCompletion(set, shard) != 0) {
+            free(nodes);
+            free(set->undo_log);
+            pthread_mutex_destroy(&set->undo_lock);
+            return -1;
+        }
+        nodes[i]->next = set->stacks[shard].top;
+        set->stacks[shard].top = nodes[i];
+    }
+    free(nodes);
+    stack->top = NULL;
+
+    task* tails[SHARD_MAX] = {NULL};
+    task* t = list->head;
+    while (t) {
+        task* next = t->next;
+        int shard = shardOf(set, t->name);
+        t->next = NULL;
+        if (tails[shard]) tails[shard]->next = t;
+        else set->lists[shard].head = t;
+        tails[shard] = t;
+        t = next;
+    }
+    list->head = NULL;
+
+    for (int s = 0; s < set->count; s++) {
+        if (batchStoreInit(&set->stores[s], &set->lists[s], &set->stacks[s]) != 0) {
+            while (--s >= 0) batchStoreFree(&set->stores[s]);
+            for (s = 0; s < set->count; s++) set->stores[s].list = NULL;
+            shardSetFree(set, list, stack);
+            return -1;
+        }
+        // Queries scan every shard, so keep the garbage left in all of them
+        // together near what one store would leave
+        set->stores[s].sweep_min = BATCH_SWEEP_MIN / set->count > 64 ? BATCH_SWEEP_MIN / set->count : 64;
+    }
+    return 0;
+}
+
+/*
+shardSetFree() - Frees the shards and puts every task back in list and stack
+ - Time: O(n), Space: O(1)
+ - The stack is rebuilt in completion order from the undo log; the list is
+   the shards' lists one after another. No commands may be running.
+ */
+void shardSetFree(shardset* set, tasklist* list, completedstack* stack) {
+    for (int s = 0; s < set->count; s++) {
+        if (set->stores[s].list) batchStoreFree(&set->stores[s]);
+    }
+
+    // The log read newest first gives the global stack top to bottom;
+    // anything it does not cover goes last, shard by shard
+    stacknode* order_top = NULL;
+    stacknode* order_tail = NULL;
+    for (long i = set->undo_count - 1 + set->count; i >= 0; i--) {
+        int s = i >= set->count ? set->undo_log[i - set->count] : i;
+        while (set->stacks[s].top) {
+            stacknode* node = set->stacks[s].top;
+            set->stacks[s].top = node->next;
+            node->next = NULL;
+            if (order_tail) order_tail->next = node;
+            else order_top = node;
+            order_tail = node;
+            if (i >= set->count) break;  // one node per log entry
+        }
+    }
+    if (order_tail) order_tail->next = stack->top;
+    if (order_top) stack->top = order_top;
+
+    task** link = &list->head;
+    while (*link) link = &(*link)->next;
+    for (int s = 0; s < set->count; s++) {
+        *link = set->lists[s].head;
+        while (*link) link = &(*link)->next;
+        set->lists[s].head = NULL;
+    }
+
+    free(set->undo_log);
+    set->undo_log = NULL;
+    set->undo_count = set->undo_cap = 0;
+    pthread_mutex_destroy(&set->undo_lock);
+}
+
+/*
+shardRegisterReaders() - Gets the calling thread an epoch slot in every shard
+ - Time: O(shards), Space: O(1)
+ - Call once per thread; sessions run on that thread copy the slots
+ */
+void shardRegisterReaders(shardset* set, int slots[]) {
+    for (int s = 0; s < set->count; s++) slots[s] = epochRegister(&set->stores[s].epoch);
+}
+
+static batchstore* routeTask(void* context, const task* t) {
+    shardset* set = (shardset*)context;
+    return &set->stores[shardOf(set, t->name)];
+}
+
+/*
+shardIngestStart() - One ingest ring for all shards (see batchIngestStart())
+ - Time: O(capacity), Space: O(capacity)
+ - The applier sends each task to its shard, locking each shard once per batch
+ - Returns 0 on success, -1 if the ring or thread could not be created
+ */
+int shardIngestStart(shardset* set, batchingest* ingest, int capacity) {
+    if (batchIngestStart(ingest, &set->stores[0], capacity) != 0) return -1;
+    ingest->route_context = set;
+    ingest->route = routeTask;
+    for (int s = 0; s < set->count; s++) set->stores[s].ingest = ingest;
+    return 0;
+}
+
+/*
+shardLineField() - Copies one '|' field of a command line without changing it
+ - Time: O(length), Space: O(1)
+ - Trimmed like the batch parser does; empty if the line has fewer fields
+ - Example: shardLineField("tag| Report |work", 1, name, sizeof(name)) -> "Report"
+ */
+void shardLineField(const char* line, int index, char* out, size_t size) {
+    for (int i = 0; i < index && line; i++) {
+        line = strchr(line, '|');
+        if (line) line++;
+    }
+    out[0] = '\0';
+    if (!line) return;
+    while (isspace((unsigned char)*line)) line++;
+    size_t n = strcspn(line, "|");
+    while (n > 0 && isspace((unsigned char)line[n - 1])) n--;
+    if (n >= size) n = size - 1;
+    memcpy(out, line, n);
+    out[n] = '\0';
+}
+
+// Runs line on one shard, answering into out; returns 1 if it succeeded
+static int runOnShard(shardsession* session, int shard, char* line, outbuf* out) {
+    batchsession sub = {&session->set->stores[shard], out, session->line_number, 0,
+                        session->reader_slots[shard]};
+    batchExecuteShared(&sub, line);
+    session->errors += sub.errors;
+    return sub.errors == 0;
+}
+
+// Logs the completions an "OK <n>" answer to bulk|complete reports for shard
+static void logBulkCompletions(shardset* set, int shard, const outbuf* answer, size_t start) {
+    if (answer->len - start < 3 || strncmp(answer->data + start, "OK ", 3) != 0) return;
+    long n = strtol(answer->data + start + 3, NULL, 10);
+    pthread_mutex_lock(&set->undo_lock);
+    for (long i = 0; i < n; i++) logCompletion(set, shard);
+    pthread_mutex_unlock(&set->undo_lock);
+}
+
+// True for a bulk line whose action is complete
+static int isBulkComplete(const char* line) {
+    char action[16];
+    shardLineField(line, 1, action, sizeof(action));
+    return strcmp(action, "complete") == 0;
+}
+
+// Sends the original line to every shard and merges the answers
+static void fanOut(shardsession* session, const char* line) {
+    shardset* set = session->set;
+    outbuf parts[SHARD_MAX];
+    char copy[BATCH_LINE_MAX];
+    int ready = 0;
+
+    for (; ready < set->count; ready++) {
+        if (outbufInit(&parts[ready], -1, 256) != 0) break;
+        snprintf(copy, sizeof(copy), "%s", line);
+        batchsession sub = {&set->stores[ready], &parts[ready], session->line_number, 0,
+                            session->reader_slots[ready]};
+        batchExecuteShared(&sub, copy);
+        if (sub.errors == 0 && strncmp(line, "bulk", 4) == 0 && isBulkComplete(line)) {
+            logBulkCompletions(set, ready, &parts[ready], 0);
+        }
+    }
+    if (ready < set->count) {
+        batchsession err = {NULL, session->out, session->line_number, 0, -1};
+        batchError(&err, "out of memory", NULL);
+        session->errors++;
+    } else if (shardGather(session->out, parts, set->count) != 0) {
+        session->errors++;
+    }
+    for (int s = 0; s < ready; s++) outbufFree(&parts[s]);
+}
+
+// undo - the newest completion in any shard
+static void shardUndo(shardsession* session, char* line) {
+    shardset* set = session->set;
+    pthread_mutex_lock(&set->undo_lock);
+    int shard = set->undo_count > 0 ? set->undo_log[--set->undo_count] : -1;
+    pthread_mutex_unlock(&set->undo_lock);
+
+    if (shard < 0) {
+        batchsession err = {NULL, session->out, session->line_number, 0, -1};
+        batchError(&err, "no completed tasks to undo", NULL);
+        session->errors++;
+        return;
+    }
+    runOnShard(session, shard, line, session->out);
+}
+
+// clear - every shard's completed tasks, and the log with them
+static void shardClear(shardsession* session, const char* line) {
+    fanOut(session, line);
+    pthread_mutex_lock(&session->set->undo_lock);
+    session->set->undo_count = 0;
+    pthread_mutex_unlock(&session->set->undo_lock);
+}
+
+/*
+shardLockAll() - Takes every shard's writer mutex, in shard order
+ - Time: O(shards), Space: O(1)
+ - For commands that need one consistent view of all shards
+ */
+void shardLockAll(shardset* set) {
+    for (int s = 0; s < set->count; s++) pthread_mutex_lock(&set->stores[s].writer);
+}
+
+void shardUnlockAll(shardset* set) {
+    for (int s = set->count - 1; s >= 0; s--) pthread_mutex_unlock(&set->stores[s].writer);
+}
+
+/*
+shardImport() - import|file: reads the file once and hands each task to its shard
+ - Time: O(n + m), Space: O(m) for the file's own duplicate check
+ - Answers "OK <imported>" like batch mode; names already active are skipped
+ */
+static void shardImport(shardsession* session, const char* file) {
+    shardset* set = session->set;
+    batchsession reply = {NULL, session->out, session->line_number, 0, -1};
+    tasklist incoming = {NULL};
+    todoimportresult result;
+
+    shardLockAll(set);
+    todostatus status = todoImportFile(&incoming, file, set->stores[0].today, &result);
+    long imported = 0;
+    int failed = 0;
+    task* t = incoming.head;
+    while (t) {
+        task* next = t->next;
+        int adopted = batchAdopt(&set->stores[shardOf(set, t->name)], t);
+        if (adopted == 0) imported++;
+        else free(t);
+        if (adopted < 0) failed = 1;
+        t = next;
+    }
+    shardUnlockAll(set);
+
+    if (failed || status != TODO_OK) {
+        batchError(&reply, failed ? "out of memory" : todoStatusText(status), failed ? NULL : file);
+        session->errors++;
+        return;
+    }
+    outbufPuts(session->out, "OK ");
+    outbufPutInt(session->out, imported, 0);
+    outbufPut(session->out, "\n", 1);
+}
+
+/*
+shardExport() - export|file: writes every shard's tasks as one report
+ - Time: O(n log n), Space: O(n) for copies of the active tasks
+ - All shards are locked while the file is written; active tasks are
+   copied into one list and completed ones are listed in completion order
+ */
+static void shardExport(shardsession* session, const char* file) {
+    shardset* set = session->set;
+    batchsession reply = {NULL, session->out, session->line_number, 0, -1};
+    tasklist all = {NULL};
+    completedstack done = {NULL};
+    stacknode* cursor[SHARD_MAX];
+    int failed = 0;
+
+    shardLockAll(set);
+    pthread_mutex_lock(&set->undo_lock);
+    task** link = &all.head;
+    for (int s = 0; s < set->count && !failed; s++) {
+        for (task* t = set->lists[s].head; t; t = t->next) {
+            if (t->completed) continue;
+            task* copy = (task*)malloc(sizeof(task));
+            if (!copy) {
+                failed = 1;
+                break;
+            }
+            *copy = *t;
+            copy->next = NULL;
+            *link = copy;
+            link = &copy->next;
+        }
+        cursor[s] = set->stacks[s].top;
+    }
+
+    // Oldest completion first onto the temporary stack, so the newest ends on top
+    stacknode** order = (stacknode**)malloc(sizeof(stacknode*) * (set->undo_count + 1));
+    long ordered = 0;
+    if (!order) failed = 1;
+    for (long i = set->undo_count - 1; i >= 0 && !failed; i--) {
+        int s = set->undo_log[i];
+        if (cursor[s]) {
+            order[ordered++] = cursor[s];
+            cursor[s] = cursor[s]->next;
+        }
+    }
+    for (long i = ordered - 1; i >= 0 && !failed; i--) {
+        stacknode* node = (stacknode*)malloc(sizeof(stacknode));
+        if (!node) {
+            failed = 1;
+            break;
+        }
+        node->task_data = order[i]->task_data;
+        node->next = done.top;
+        done.top = node;
+    }
+
+    int export_failed = 0;
+    if (!failed) {
+        outbufFlush(session->out);
+        export_failed = exportTasksTxt(all.head, &done, file) != 0;
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&set->undo_lock);
+    shardUnlockAll(set);
+
+    free(order);
+    while (done.top) {
+        stacknode* next = done.top->next;
+        free(done.top);
+        done.top = next;
+    }
+    freeTasks(&all);
+
+    if (failed) {
+        batchError(&reply, "out of memory", NULL);
+        session->errors++;
+        return;
+    }
+    if (export_failed) {
+        batchError(&reply, "export failed", file);
+        session->errors++;
+        return;
+    }
+    batchOk(&reply);
+}
+
+/*
+shardExecute() - Runs one command line on the shard set
+ - Time: O(1) for point commands, O(n) over all shards for query/stats/bulk,
+   Space: O(shards) response buffers for fanned-out commands
+ - Same commands and answers as runBatch(); query rows come shard by shard
+ - Sample Case:
+    Input: 4 shards, "add|Report|Q2|1|15/06/2025" then "stats"
+    Output:
+      OK
+      OK pending=1 overdue=0 completed=0 high=1 medium=0 low=0
+ */
+void shardExecute(shardsession* session, char* line) {
+    shardset* set = session->set;
+    char command[16], name[BATCH_LINE_MAX];
+    shardLineField(line, 0, command, sizeof(command));
+    if (command[0] == '\0' || command[0] == '#') return;
+
+    if (strcmp(command, "add") == 0 || strcmp(command, "put") == 0 || strcmp(command, "tag") == 0 ||
+        strcmp(command, "complete") == 0 || strcmp(command, "delete") == 0) {
+        shardLineField(line, 1, name, sizeof(name));
+        int shard = shardOf(set, name);
+        if (runOnShard(session, shard, line, session->out) && strcmp(command, "complete") == 0) {
+            pthread_mutex_lock(&set->undo_lock);
+            logCompletion(set, shard);
+            pthread_mutex_unlock(&set->undo_lock);
+        }
+    } else if (strcmp(command, "undo") == 0) {
+        shardUndo(session, line);
+    } else if (strcmp(command, "clear") == 0) {
+        shardClear(session, line);
+    } else if (strcmp(command, "query") == 0 || strcmp(command, "stats") == 0 ||
+               strcmp(command, "today") == 0 || strcmp(command, "bulk") == 0) {
+        fanOut(session, line);
+    } else if (strcmp(command, "import") == 0 || strcmp(command, "export") == 0) {
+        shardLineField(line, 1, name, sizeof(name));
+        if (name[0] == '\0') {
+            batchsession err = {NULL, session->out, session->line_number, 0, -1};
+            batchError(&err, "usage", command[0] == 'i' ? "import|file" : "export|file");
+            session->errors++;
+        } else if (command[0] == 'i') {
+            shardImport(session, name);
+        } else {
+            shardExport(session, name);
+        }
+    } else {
+        runOnShard(session, 0, line, session->out);  // unknown command
+    }
+}
+
+/*
+shardSetJournal() - Sends every shard's changes to one journal (see batchjournalfn)
+ - Time: O(shards), Space: O(1)
+ - Each shard passes its number as the store id; call before serving
+ */
+void shardSetJournal(shardset* set, batchjournalfn journal, void* context) {
+    for (int s = 0; s < set->count; s++) {
+        set->stores[s].journal = journal;
+        set->stores[s].journal_context = context;
+        set->stores[s].journal_id = s;
+    }
+}
+
+/*
+shardApply() - Runs a journaled command on the shard it came from
+ - Time: as the command, Space: O(1)
+ - For a follower repeating another set's journal: the line is not routed
+   again, so fanned-out commands (today, clear, bulk) arrive once per
+   shard. The undo log is kept as shardExecute() would. Answers go to out.
+ - Returns 1 if the command succeeded
+ */
+int shardApply(shardset* set, int shard, char* line, outbuf* out) {
+    if (shard < 0 || shard >= set->count) return 0;
+    char command[16];
+    shardLineField(line, 0, command, sizeof(command));
+
+    int bulk_complete = strcmp(command, "bulk") == 0 && isBulkComplete(line);
+    size_t start = out->len;
+    batchsession sub = {&set->stores[shard], out, 0, 0, -1};
+    batchExecuteShared(&sub, line);
+    if (sub.errors != 0) return 0;
+    if (bulk_complete) {
+        logBulkCompletions(set, shard, out, start);
+        return 1;
+    }
+
+    pthread_mutex_lock(&set->undo_lock);
+    if (strcmp(command, "complete") == 0) {
+        logCompletion(set, shard);
+    } else if (strcmp(command, "undo") == 0 || strcmp(command, "clear") == 0) {
+        // undo drops the shard's newest entry, clear all of them
+        int all = command[0] == 'c';
+        long kept = set->undo_count;
+        for (long i = set->undo_count - 1; i >= 0; i--) {
+            if (set->undo_log[i] != shard) continue;
+            memmove(&set->undo_log[i], &set->undo_log[i + 1], (size_t)(kept - i - 1));
+            kept--;
+            if (!all) break;
+        }
+        set->undo_count = kept;
+    }
+    pthread_mutex_unlock(&set->undo_lock);
+    return 1;
+}
+
+/*
+shardReset() - Empties every shard (see batchReset())
+ - Time: O(n), Space: O(1)
+ - Returns 0, or -1 if out of memory (some tasks are left)
+ */
+int shardReset(shardset* set) {
+    int status = 0;
+    for (int s = 0; s < set->count; s++) {
+        pthread_mutex_lock(&set->stores[s].writer);
+        if (batchReset(&set->stores[s]) != 0) status = -1;
+        pthread_mutex_unlock(&set->stores[s].writer);
+    }
+    pthread_mutex_lock(&set->undo_lock);
+    set->undo_count = 0;
+    pthread_mutex_unlock(&set->undo_lock);
+    return status;
+}
+
+/*
+shardGather() - Merges one command's answers from several stores or nodes
+ - Time: O(total bytes), Space: O(1)
+ - "OK" answers merge to "OK"; "OK <n>" answers to "OK <sum>" followed by
+   every part's rows; "OK key=value ..." answers (stats) to the sums per
+   key. If any part is an error, its first line is the answer.
+ - Returns 0, or -1 if a part was an error
+ - Sample Case:
+    Input: "OK 1\nA|...\n", "OK 2\nB|...\nC|...\n"
+    Output: "OK 3\nA|...\nB|...\nC|...\n"
+ */
+int shardGather(outbuf* out, outbuf parts[], int count) {
+    long total = 0;
+    int has_total = 0;
+    char keys[SHARD_MAX_KEYS][32];
+    long sums[SHARD_MAX_KEYS] = {0};
+    int key_count = 0;
+
+    for (int p = 0; p < count; p++) {
+        const char* data = parts[p].data;
+        const char* eol = parts[p].len ? (const char*)memchr(data, '\n', parts[p].len) : NULL;
+        size_t first = eol ? (size_t)(eol - data) : parts[p].len;
+        if (first >= 3 && strncmp(data, "ERR", 3) == 0) {
+            outbufPut(out, data, first);
+            outbufPut(out, "\n", 1);
+            return -1;
+        }
+
+        char head[512];
+        size_t n = first < sizeof(head) - 1 ? first : sizeof(head) - 1;
+        memcpy(head, data, n);
+        head[n] = '\0';
+        char* rest = head + (n >= 2 ? 2 : n);
+        while (*rest == ' ') rest++;
+        if (*rest == '\0') continue;
+        if (isdigit((unsigned char)*rest)) {
+            total += atol(rest);
+            has_total = 1;
+            continue;
+        }
+
+        // key=value pairs, summed by position
+        int k = 0;
+        char* token = rest;
+        while (*token && k < SHARD_MAX_KEYS) {
+            char* end = token + strcspn(token, " ");
+            char* equals = memchr(token, '=', (size_t)(end - token));
+            if (!equals) break;
+            if (k >= key_count) {
+                size_t length = (size_t)(equals - token);
+                if (length >= sizeof(keys[k])) length = sizeof(keys[k]) - 1;
+                memcpy(keys[k], token, length);
+                keys[k][length] = '\0';
+                key_count = k + 1;
+            }
+            sums[k++] += atol(equals + 1);
+            token = end;
+            while (*token == ' ') token++;
+        }
+    }
+
+    outbufPut(out, "OK", 2);
+    if (has_total) {
+        outbufPut(out, " ", 1);
+        outbufPutInt(out, total, 0);
+    }
+    for (int k = 0; k < key_count; k++) {
+        outbufPut(out, " ", 1);
+        outbufPuts(out, keys[k]);
+        outbufPut(out, "=", 1);
+        outbufPutInt(out, sums[k], 0);
+    }
+    outbufPut(out, "\n", 1);
+
+    for (int p = 0; p < count; p++) {
+        const char* eol = parts[p].len ? (const char*)memchr(parts[p].data, '\n', parts[p].len) : NULL;
+        if (eol) outbufPut(out, eol + 1, parts[p].len - (size_t)(eol + 1 - parts[p].data));
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+// Task store split into shards by a hash of the task name. Each shard is a
+// batchstore with its own list, completed stack, name index, counters,
+// writer lock and epoch domain, so writes to different shards never wait
+// for each other. Commands use the batch protocol (see runBatch()):
+//   add, put, complete, delete, tag   go to the one shard owning the name
+//   query, stats, today, clear, bulk  fan out to every shard and are merged
+//   import, export                    lock every shard
+//   undo                              uses a log of which shard each
+//                                     completion went to
+
+#include "batch.h"
+
+#define SHARD_MAX 64
+
+typedef struct {
+    int count;
+    batchstore stores[SHARD_MAX];
+    tasklist lists[SHARD_MAX];
+    completedstack stacks[SHARD_MAX];
+    pthread_mutex_t undo_lock;
+    unsigned char* undo_log;   // shard of each completion on a stack, oldest first
+    long undo_count;
+    long undo_cap;
+} shardset;
+
+// One command stream on a shard set
+typedef struct {
+    shardset* set;
+    outbuf* out;
+    long line_number;
+    long errors;
+    int reader_slots[SHARD_MAX];  // the running thread's epoch slot in each shard
+} shardsession;
+
+int shardSetInit(shardset* set, tasklist* list, completedstack* stack, int count);
+void shardSetFree(shardset* set, tasklist* list, completedstack* stack);
+unsigned int shardHash(const char* name);
+int shardOf(const shardset* set, const char* name);
+void shardLineField(const char* line, int index, char* out, size_t size);
+void shardRegisterReaders(shardset* set, int slots[]);
+int shardIngestStart(shardset* set, batchingest* ingest, int capacity);
+void shardExecute(shardsession* session, char* line);
+int shardGather(outbuf* out, outbuf parts[], int count);
+void shardLockAll(shardset* set);
+void shardUnlockAll(shardset* set);
+void shardSetJournal(shardset* set, batchjournalfn journal, void* context);
+int shardApply(shardset* set, int shard, char* line, outbuf* out);
+int shardReset(shardset* set);
+
+#endif
@@ -0,0 +1,495 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "snapshot.h"
+#include "libtodo.h"
+
+#ifndef _WIN32
+
+// Mapping a version can fail while the writer replaces it; try this often
+#define SNAP_ACQUIRE_TRIES 8
+// A name plus ".<version>"
+#define SNAP_OBJECT_MAX (SNAP_NAME_MAX + 24)
+
+static double snapNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Name of the object holding one version: "/name.<version>"
+static void versionName(char* out, size_t size, const char* name, unsigned long long version) {
+    snprintf(out, size, "%s.%llu", name, version);
+}
+
+/*
+snapWriterOpen() - Creates (or takes over) the control object of a snapshot name
+ - Time: O(1), Space: O(1)
+ - name is a POSIX shared memory name such as "/todolist". Versions carry
+   on from a previous writer's, whose last objects are removed.
+ - Returns 0, or -1 if shared memory is not available (the reason is printed)
+ */
+int snapWriterOpen(snapwriter* writer, const char* name) {
+    memset(writer, 0, sizeof(*writer));
+    if (name[0] != '/' || strlen(name) >= SNAP_NAME_MAX || strchr(name + 1, '/')) {
+        printf("Snapshot name must look like /todolist: %s\n", name);
+        return -1;
+    }
+    snprintf(writer->name, sizeof(writer->name), "%s", name);
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(snapcontrol)) != 0) {
+        perror("shm_open");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    void* mapped = mmap(NULL, sizeof(snapcontrol), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED || outbufInit(&writer->arena, -1, 64 * 1024) != 0) {
+        if (mapped != MAP_FAILED) munmap(mapped, sizeof(snapcontrol));
+        printf("Memory allocation failed for the snapshot.\n");
+        return -1;
+    }
+    writer->control = (snapcontrol*)mapped;
+
+    char object[SNAP_OBJECT_MAX];
+    if (writer->control->magic == SNAP_MAGIC) {
+        writer->version = writer->control->version;
+        for (unsigned long long v = writer->version; v > 0 && v + 2 > writer->version; v--) {
+            versionName(object, sizeof(object), name, v);
+            shm_unlink(object);
+        }
+    }
+    writer->control->magic = SNAP_MAGIC;
+    writer->control->writer_pid = (long long)getpid();
+    __atomic_store_n(&writer->control->version, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Copies a string into the arena, returns its offset (0 is the empty string)
+static unsigned int snapString0(snapwriter* writer, const char* s) {
+    if (s[0] == '\0') return 0;
+    unsigned int offset = (unsigned int)writer->arena.len;
+    outbufPut(&writer->arena, s, strlen(s) + 1);
+    return offset;
+}
+
+// Appends t's hot fields, reading them the way a query does
+static int snapAddTask(snapwriter* writer, const task* t, int completed) {
+    if (writer->task_count == writer->task_cap) {
+        int cap = writer->task_cap ? writer->task_cap * 2 : 1024;
+        snaptask* grown = (snaptask*)realloc(writer->tasks, sizeof(snaptask) * cap);
+        if (!grown) return -1;
+        writer->tasks = grown;
+        writer->task_cap = cap;
+    }
+    snaptask* st = &writer->tasks[writer->task_count++];
+    memset(st, 0, sizeof(*st));
+    st->name = snapString0(writer, t->name);
+    st->description = snapString0(writer, t->description);
+    st->hash = todoNameHash(t->name);
+    st->priority = t->priority;
+    st->due = t->duedate;
+    st->due_set = (unsigned char)(t->due_date_set != 0);
+    st->status = (unsigned char)(completed ? COMPLETED : __atomic_load_n(&t->status, __ATOMIC_RELAXED));
+    st->completed = (unsigned char)completed;
+    int tag_count = __atomic_load_n(&t->tag_count, __ATOMIC_ACQUIRE);
+    if (tag_count > MAX_TAGS) tag_count = MAX_TAGS;
+    for (int i = 0; i < tag_count; i++) st->tags[i] = snapString0(writer, t->tags[i]);
+    st->tag_count = (unsigned char)tag_count;
+    return 0;
+}
+
+// Builds the next version in private memory: every shard's active tasks,
+// then every shard's completed ones, each shard read inside an epoch
+static int snapCollect(snapwriter* writer, shardset* set, const int reader_slots[]) {
+    writer->task_count = 0;
+    writer->arena.len = 0;
+    outbufPut(&writer->arena, "", 1);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int s = 0; s < set->count; s++) {
+            batchstore* store = &set->stores[s];
+            int failed = 0;
+            epochEnter(&store->epoch, reader_slots[s]);
+            if (pass == 0) {
+                task* t = __atomic_load_n(&store->list->head, __ATOMIC_ACQUIRE);
+                for (; t && !failed; t = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE)) {
+                    if (!__atomic_load_n(&t->completed, __ATOMIC_ACQUIRE)) failed = snapAddTask(writer, t, 0);
+                }
+            } else {
+                stacknode* node = __atomic_load_n(&store->stack->top, __ATOMIC_ACQUIRE);
+                for (; node && !failed; node = node->next) {
+                    if (node->task_data) failed = snapAddTask(writer, node->task_data, 1);
+                }
+            }
+            epochExit(&store->epoch, reader_slots[s]);
+            if (failed) return -1;
+        }
+    }
+    return writer->arena.error ? -1 : 0;
+}
+
+/*
+snapPublishShards() - Publishes the shard set as the next snapshot version
+ - Time: O(n), Space: O(n) in private memory plus O(n) shared
+ - Reads the shards the way query does, inside epoch read sections, so no
+   writer waits for it. The version is built privately, copied into a new
+   shared memory object, and only then made current with one atomic store;
+   the version before the previous one is unlinked.
+ - reader_slots are the calling thread's (shardRegisterReaders())
+ - Returns 0, or -1 if out of memory or shared memory
+ - Example: snapPublishShards(&writer, &set, slots, journal.seq) -> 0, version 1
+ */
+int snapPublishShards(snapwriter* writer, shardset* set, const int reader_slots[], unsigned long long changes) {
+    double start = snapNow();
+    if (snapCollect(writer, set, reader_slots) != 0) return -1;
+
+    snapheader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAP_MAGIC;
+    header.version = writer->version + 1;
+    header.changes = changes;
+    // today only changes under the writer lock, and only for a moment
+    pthread_mutex_lock(&set->stores[0].writer);
+    header.today = set->stores[0].today;
+    pthread_mutex_unlock(&set->stores[0].writer);
+    for (int i = 0; i < writer->task_count; i++) {
+        const snaptask* st = &writer->tasks[i];
+        if (st->completed) {
+            header.completed++;
+            continue;
+        }
+        header.active_count++;
+        if (st->status == OVERDUE) header.overdue++;
+        else header.pending++;
+        if (st->priority == 1) header.high++;
+        else if (st->priority == 2) header.medium++;
+        else if (st->priority == 3) header.low++;
+    }
+    header.task_count = writer->task_count;
+    header.index_size = 16;
+    while (header.index_size < header.active_count * 2) header.index_size *= 2;
+    header.tasks_offset = (sizeof(snapheader) + 15) & ~15ULL;
+    header.index_offset = header.tasks_offset + sizeof(snaptask) * (unsigned long long)header.task_count;
+    header.arena_offset = header.index_offset + sizeof(unsigned int) * (unsigned long long)header.index_size;
+    header.arena_size = writer->arena.len;
+    header.size = header.arena_offset + header.arena_size;
+
+    char object[SNAP_OBJECT_MAX];
+    versionName(object, sizeof(object), writer->name, header.version);
+    shm_unlink(object);
+    int fd = shm_open(object, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)header.size) != 0) {
+        close(fd);
+        shm_unlink(object);
+        return -1;
+    }
+    char* image = (char*)mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        shm_unlink(object);
+        return -1;
+    }
+
+    memcpy(image + header.tasks_offset, writer->tasks, sizeof(snaptask) * (size_t)header.task_count);
+    memcpy(image + header.arena_offset, writer->arena.data, header.arena_size);
+    // The object starts zeroed, so empty slots are already 0
+    unsigned int* index = (unsigned int*)(image + header.index_offset);
+    unsigned int mask = (unsigned int)header.index_size - 1;
+    for (int i = 0; i < header.active_count; i++) {
+        unsigned int slot = writer->tasks[i].hash & mask;
+        while (index[slot] != 0) slot = (slot + 1) & mask;
+        index[slot] = (unsigned int)i + 1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header.published_ms = (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    memcpy(image, &header, sizeof(header));
+    munmap(image, header.size);
+
+    // Readers that already mapped an older version keep it; the one before
+    // the previous is removed, so at most two stay reachable by name
+    __atomic_store_n(&writer->control->version, header.version, __ATOMIC_RELEASE);
+    if (writer->version > 1) {
+        versionName(object, sizeof(object), writer->name, writer->version - 1);
+        shm_unlink(object);
+    }
+    writer->version = header.version;
+    writer->published++;
+    writer->build_seconds = snapNow() - start;
+    return 0;
+}
+
+/*
+snapWriterClose() - Removes the snapshot's objects and frees the writer
+ - Time: O(1), Space: O(1)
+ - Readers still mapping a version keep it until they close
+ */
+void snapWriterClose(snapwriter* writer) {
+    char object[SNAP_OBJECT_MAX];
+    for (unsigned long long v = writer->version; v > 0 && v + 2 > writer->version; v--) {
+        versionName(object, sizeof(object), writer->name, v);
+        shm_unlink(object);
+    }
+    if (writer->control) {
+        munmap(writer->control, sizeof(snapcontrol));
+        shm_unlink(writer->name);
+    }
+    outbufFree(&writer->arena);
+    free(writer->tasks);
+    memset(writer, 0, sizeof(*writer));
+}
+
+/*
+snapOpen() - Opens a published snapshot name for reading
+ - Time: O(1), Space: O(1)
+ - Returns 0, or -1 if no writer has created it
+ */
+int snapOpen(snapreader* reader, const char* name) {
+    memset(reader, 0, sizeof(*reader));
+    snprintf(reader->name, sizeof(reader->name), "%s", name);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return -1;
+    void* mapped = mmap(NULL, sizeof(snapcontrol), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return -1;
+    reader->control = (const snapcontrol*)mapped;
+    if (reader->control->magic != SNAP_MAGIC) {
+        snapClose(reader);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+snapAcquire() - The newest version, mapped read-only
+ - Time: O(1), Space: O(1) (the pages are the writer's)
+ - The view stays valid and unchanged until the next snapAcquire() or
+   snapClose(), however many versions the writer publishes meanwhile
+ - Returns NULL if nothing has been published yet
+ - Example: snapAcquire(&reader)->pending -> 1200
+ */
+const snapheader* snapAcquire(snapreader* reader) {
+    char object[SNAP_OBJECT_MAX];
+    for (int attempt = 0; attempt < SNAP_ACQUIRE_TRIES; attempt++) {
+        unsigned long long version = __atomic_load_n(&reader->control->version, __ATOMIC_ACQUIRE);
+        if (version == 0) return reader->view;
+        if (reader->view && reader->view->version == version) return reader->view;
+
+        versionName(object, sizeof(object), reader->name, version);
+        int fd = shm_open(object, O_RDONLY, 0);
+        if (fd < 0) continue;  // replaced since we read the version
+        struct stat info;
+        void* mapped = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(snapheader)) {
+            mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (mapped == MAP_FAILED) continue;
+        const snapheader* view = (const snapheader*)mapped;
+        if (view->magic != SNAP_MAGIC || view->size > (unsigned long long)info.st_size) {
+            munmap(mapped, (size_t)info.st_size);
+            continue;
+        }
+        if (reader->view) munmap((void*)reader->view, reader->view_size);
+        reader->view = view;
+        reader->view_size = (size_t)info.st_size;
+        return view;
+    }
+    return reader->view;
+}
+
+void snapClose(snapreader* reader) {
+    if (reader->view) munmap((void*)reader->view, reader->view_size);
+    if (reader->control) munmap((void*)reader->control, sizeof(snapcontrol));
+    reader->view = NULL;
+    reader->control = NULL;
+}
+
+/*
+snapTasks() - The task array of a version: active_count active tasks, then completed
+ - Time: O(1), Space: O(1)
+ */
+const snaptask* snapTasks(const snapheader* view) {
+    return (const snaptask*)((const char*)view + view->tasks_offset);
+}
+
+/*
+snapString() - A string of a version from its arena offset
+ - Time: O(1), Space: O(1)
+ - Example: snapString(view, snapTasks(view)[0].name) -> "Report"
+ */
+const char* snapString(const snapheader* view, unsigned int offset) {
+    return (const char*)view + view->arena_offset + offset;
+}
+
+/*
+snapFind() - Looks up an active task by name in a version's index
+ - Time: O(1) average, Space: O(1)
+ - Returns NULL if no active task has that name
+ */
+const snaptask* snapFind(const snapheader* view, const char* name) {
+    const unsigned int* index = (const unsigned int*)((const char*)view + view->index_offset);
+    const snaptask* tasks = snapTasks(view);
+    unsigned int hash = todoNameHash(name);
+    unsigned int mask = (unsigned int)view->index_size - 1;
+    for (unsigned int slot = hash & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+        const snaptask* st = &tasks[index[slot] - 1];
+        if (st->hash == hash && strcmp(snapString(view, st->name), name) == 0) return st;
+    }
+    return NULL;
+}
+
+// One row in the batch query format: name|description|priority|date|status|tags
+static void snapRow(outbuf* out, const snapheader* view, const snaptask* st) {
+    static const char* status_names[] = {"pending", "completed", "overdue"};
+    outbufPuts(out, snapString(view, st->name));
+    outbufPut(out, "|", 1);
+    outbufPuts(out, snapString(view, st->description));
+    outbufPut(out, "|", 1);
+    outbufPutInt(out, st->priority, 0);
+    outbufPut(out, "|", 1);
+    if (st->due_set) outbufPutDate(out, st->due);
+    else outbufPut(out, "-", 1);
+    outbufPut(out, "|", 1);
+    outbufPuts(out, status_names[st->status <= OVERDUE ? st->status : 0]);
+    outbufPut(out, "|", 1);
+    for (int i = 0; i < st->tag_count; i++) {
+        if (i > 0) outbufPut(out, ";", 1);
+        outbufPuts(out, snapString(view, st->tags[i]));
+    }
+    outbufPut(out, "\n", 1);
+}
+
+/*
+runSnapshotReader() - todolist --snapshot: answers from a published snapshot
+ - Time: O(1) for stats and find, O(n) for query, Space: O(1)
+ - Answers like the batch commands, without talking to the server:
+     stats        the counters, plus the version and its age
+     query        "OK <n>" and one row per task, completed ones last
+     find|name    "OK" and the task's row
+ - Returns 0, or 1 if the snapshot is missing or the task is not found
+ - Sample Case:
+    $ TODOLIST_SNAPSHOT=/todolist ./todolist --serve &
+    $ ./todolist --snapshot /todolist stats
+    OK pending=1 overdue=0 completed=0 high=1 medium=0 low=0 version=3 age_ms=41
+ */
+int runSnapshotReader(const char* name, const char* command, const char* argument) {
+    snapreader reader;
+    if (snapOpen(&reader, name) != 0) {
+        printf("ERR no snapshot published as %s\n", name);
+        return 1;
+    }
+    const snapheader* view = snapAcquire(&reader);
+    if (!view) {
+        printf("ERR no snapshot published as %s yet\n", name);
+        snapClose(&reader);
+        return 1;
+    }
+
+    outbuf out;
+    if (outbufInit(&out, 1, OUTBUF_DEFAULT_SIZE) != 0) {
+        snapClose(&reader);
+        return 1;
+    }
+    int result = 0;
+    if (strcmp(command, "query") == 0) {
+        outbufPuts(&out, "OK ");
+        outbufPutInt(&out, view->task_count, 0);
+        outbufPut(&out, "\n", 1);
+        const snaptask* tasks = snapTasks(view);
+        for (int i = 0; i < view->task_count; i++) snapRow(&out, view, &tasks[i]);
+    } else if (strcmp(command, "find") == 0) {
+        const snaptask* st = argument ? snapFind(view, argument) : NULL;
+        if (st) {
+            outbufPuts(&out, "OK\n");
+            snapRow(&out, view, st);
+        } else {
+            outbufPuts(&out, "ERR task not found: ");
+            outbufPuts(&out, argument ? argument : "");
+            outbufPut(&out, "\n", 1);
+            result = 1;
+        }
+    } else {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        long age = (long)((long long)now.tv_sec * 1000 + now.tv_nsec / 1000000 - view->published_ms);
+        char line[256];
+        int n = snprintf(line, sizeof(line),
+                         "OK pending=%ld overdue=%ld completed=%ld high=%ld medium=%ld low=%ld version=%llu age_ms=%ld\n",
+                         view->pending, view->overdue, view->completed, view->high, view->medium, view->low,
+                         view->version, age > 0 ? age : 0);
+        outbufPut(&out, line, (size_t)n);
+    }
+    outbufFlush(&out);
+    outbufFree(&out);
+    snapClose(&reader);
+    return result;
+}
+
+#else
+
+int snapWriterOpen(snapwriter* writer, const char* name) {
+    (void)name;
+    memset(writer, 0, sizeof(*writer));
+    printf("Snapshots need POSIX shared memory and are not available on Windows.\n");
+    return -1;
+}
+
+int snapPublishShards(snapwriter* writer, shardset* set, const int reader_slots[], unsigned long long changes) {
+    (void)writer;
+    (void)set;
+    (void)reader_slots;
+    (void)changes;
+    return -1;
+}
+
+void snapWriterClose(snapwriter* writer) {
+    (void)writer;
+}
+
+int snapOpen(snapreader* reader, const char* name) {
+    (void)name;
+    memset(reader, 0, sizeof(*reader));
+    return -1;
+}
+
+const snapheader* snapAcquire(snapreader* reader) {
+    (void)reader;
+    return NULL;
+}
+
+void snapClose(snapreader* reader) {
+    (void)reader;
+}
+
+const snaptask* snapTasks(const snapheader* view) {
+    return (const snaptask*)((const char*)view + view->tasks_offset);
+}
+
+const char* snapString(const snapheader* view, unsigned int offset) {
+    return (const char*)view + view->arena_offset + offset;
+}
+
+const snaptask* snapFind(const snapheader* view, const char* name) {
+    (void)view;
+    (void)name;
+    return NULL;
+}
+
+int runSnapshotReader(const char* name, const char* command, const char* argument) {
+    (void)name;
+    (void)command;
+    (void)argument;
+    printf("Snapshots need POSIX shared memory and are not available on Windows.\n");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Read-only snapshots of the task store in POSIX shared memory, for other
+// processes (dashboards, reports) that should not parse an export file.
+// A server started with TODOLIST_SNAPSHOT=/name publishes each version as
+// its own shared memory object "/name.<version>", written once and never
+// changed, and then stores the version number in the small control object
+// "/name". A reader maps the newest version and reads it in place; the
+// writer never waits for readers, and a mapping stays valid after the
+// writer moves on and unlinks the object.
+
+#include "shard.h"
+
+#define SNAP_MAGIC 0x31504e534f444f54ULL  // "TODOSNP1"
+#define SNAP_NAME_MAX 64
+#define SNAP_DEFAULT_MS 100
+
+// Control object: which version is current
+typedef struct {
+    unsigned long long magic;
+    unsigned long long version;  // 0 until the first publish; written atomically
+    long long writer_pid;
+} snapcontrol;
+
+// One task; strings are offsets into the arena, NUL-terminated
+typedef struct {
+    unsigned int name;
+    unsigned int description;
+    unsigned int tags[MAX_TAGS];
+    unsigned int hash;           // todoNameHash(name)
+    int priority;
+    date due;
+    unsigned char due_set;
+    unsigned char status;        // TaskStatus
+    unsigned char completed;     // on the completed stack rather than the list
+    unsigned char tag_count;
+} snaptask;
+
+// Start of every version object: the counters, then where the rest lies
+typedef struct {
+    unsigned long long magic;
+    unsigned long long version;
+    unsigned long long changes;  // change count of the store when taken
+    long long published_ms;      // wall clock
+    unsigned long long size;     // bytes in the object
+    date today;
+    long pending, overdue, completed, high, medium, low;
+    int task_count;              // active tasks first, then completed ones newest first
+    int active_count;
+    int index_size;              // slots in the name index, a power of two
+    unsigned long long tasks_offset;
+    unsigned long long index_offset;  // task number + 1 per slot, 0 if empty
+    unsigned long long arena_offset;
+    unsigned long long arena_size;
+} snapheader;
+
+// Writer side, owned by one thread
+typedef struct {
+    char name[SNAP_NAME_MAX];
+    snapcontrol* control;
+    unsigned long long version;
+    snaptask* tasks;             // the next version, built in private memory first
+    int task_count;
+    int task_cap;
+    outbuf arena;
+    long long published;         // versions published
+    double build_seconds;        // time spent on the last one
+} snapwriter;
+
+// Reader side: the version mapped now
+typedef struct {
+    char name[SNAP_NAME_MAX];
+    const snapcontrol* control;
+    const snapheader* view;
+    size_t view_size;
+} snapreader;
+
+int snapWriterOpen(snapwriter* writer, const char* name);
+int snapPublishShards(snapwriter* writer, shardset* set, const int reader_slots[], unsigned long long changes);
+void snapWriterClose(snapwriter* writer);
+
+int snapOpen(snapreader* reader, const char* name);
+const snapheader* snapAcquire(snapreader* reader);
+void snapClose(snapreader* reader);
+const snaptask* snapTasks(const snapheader* view);
+const char* snapString(const snapheader* view, unsigned int offset);
+const snaptask* snapFind(const snapheader* view, const char* name);
+int runSnapshotReader(const char* name, const char* command, const char* argument);
+
+#endif
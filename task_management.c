@@ -5,6 +5,12 @@
 #include <stdbool.h>
 #include "scheduler.h"
 #include "task_management.h"
+#include "libtodo.h"
+#include "feed.h"
+#include "reminder.h"
+#include "recurrence.h"
+#include "undo.h"
+#include "plan.h"
 #include "searchandstat.h" 
 
 
@@ -41,7 +47,7 @@ void sortTasksByDueDate(task* tasks[], int count) {
 
 /*
 add() - Adds a new task to the linked list
- - Steps: 1) Allocate memory 2) Get user input 3) Validate 4) Insert at head
+ - Steps: 1) Get user input 2) Validate 3) todoAdd() inserts at head
  - Time: O(n), Space: O(1)
  - Example: add(&tasks) -> prompts for task details -> adds to list
 
@@ -56,15 +62,6 @@ add() - Adds a new task to the linked list
     List now contains: "Complete Assignment" -> [previous tasks]
  */
 void add(tasklist* list) {
-    task* new_task = (task*)malloc(sizeof(task));
-    if (!new_task) {
-        printf("Memory allocation failed.\n");
-        return;
-    }
-
-    // Initialize tag-related fields right after allocation
-    new_task->tag_count = 0;  // Initialize with no tags
-
     char task_name[100];
     bool is_valid_name = false; 
 
@@ -73,7 +70,6 @@ void add(tasklist* list) {
         if (fgets(task_name, sizeof(task_name), stdin) == NULL) {
              // Handle potential input error 
              printf("Error reading input.\n");
-             free(new_task); // Clean up allocated memory
              return;
         }
         task_name[strcspn(task_name, "\n")] = 0; // Remove trailing newline
@@ -113,67 +109,57 @@ void add(tasklist* list) {
         // Loop continues if the name was invalid (empty, whitespace, or duplicate)
     } while (!is_valid_name);
 
-    // Copy validated name to the task struct
-    strcpy(new_task->name, task_name);
-
+    char description[300];
     printf("Enter task description: ");
-  
-    fgets(new_task->description, sizeof(new_task->description), stdin);
-    new_task->description[strcspn(new_task->description, "\n")] = 0;
+    if (fgets(description, sizeof(description), stdin) == NULL) description[0] = '\0';
+    description[strcspn(description, "\n")] = 0;
 
     printf("Enter priority (1-High, 2-Medium, 3-Low): ");
     
     char buffer[20];
-    int priority_input = 0;
+    int priority = 0;
     if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
-        if (sscanf(buffer, "%d", &priority_input) == 1) {
-             new_task->priority = priority_input;
-        } else {
+        if (sscanf(buffer, "%d", &priority) != 1) {
             printf("Invalid priority input. Setting to Medium (2).\n");
-            new_task->priority = 2;
+            priority = 2;
         }
     } else {
         printf("Error reading priority input. Setting to Medium (2).\n");
-        new_task->priority = 2; 
+        priority = 2; 
     }
-   
 
     // Validate priority range
-    if (new_task->priority < 1 || new_task->priority > 3) {
+    if (priority < 1 || priority > 3) {
         printf("Invalid priority value. Setting to Medium (2).\n");
-        new_task->priority = 2;
+        priority = 2;
     }
 
     // Get due date
+    date due;
+    int has_due_date = 0;
     printf("Enter due date (DD MM YYYY): ");
     if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
-        int day, month, year;
-        if (sscanf(buffer, "%d %d %d", &day, &month, &year) == 3) {
+        if (sscanf(buffer, "%d %d %d", &due.day, &due.month, &due.year) == 3) {
             // Validate date
-            if (isValidDate(day, month, year)) {
-                new_task->duedate.day = day;
-                new_task->duedate.month = month;
-                new_task->duedate.year = year;
-                new_task->due_date_set = 1;
+            if (isValidDate(due.day, due.month, due.year)) {
+                has_due_date = 1;
             } else {
                 printf("Invalid date (Day: %d, Month: %d, Year: %d). Due date not set.\n",
-                       day, month, year);
-                new_task->due_date_set = 0;
+                       due.day, due.month, due.year);
             }
         } else {
             printf("Invalid date format. Due date not set.\n");
-            new_task->due_date_set = 0;
         }
     } else {
         printf("Error reading date input. Due date not set.\n");
-        new_task->due_date_set = 0;
     }
 
-    new_task->completed = 0;
-    new_task->status = PENDING;  
-    new_task->next = list->head;
-    list->head = new_task;
-
+    todostatus status = todoAdd(list, NULL, task_name, description, priority,
+                                has_due_date ? &due : NULL, getToday(), NULL);
+    if (status != TODO_OK) {
+        printf("Error: %s.\n", todoStatusText(status));
+        return;
+    }
     printf("Task added successfully!\n");
 }
 
@@ -189,16 +175,14 @@ isTaskNameDuplicate() - Checks if task name already exists
       Returns 1 (duplicate found)
  */
 int isTaskNameDuplicate(tasklist* list, const char* name) {
-    task* current = list->head;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return 1; // Name exists
-        }
-        current = current->next;
-    }
-    return 0; // Name doesn't exist
+    return todoFindTask(list, name) != NULL;
 }
 
+// "Repeats: ..." under a recurring task
+static void printRepeat(const task* t) {
+    char text[RECUR_TEXT_MAX];
+    if (t->repeat.kind != RECUR_NONE) printf("Repeats: %s\n", recurFormat(&t->repeat, text, sizeof(text)));
+}
 
 /*
 view() - Displays tasks sorted by priority and due date
@@ -289,6 +273,7 @@ void view(tasklist* list, date today) {
             } else {
                 printf("Due Date: Not Set\n");
             }
+            printRepeat(overdue_tasks[i]);
             printf("-------------------------\n");
         }
     }
@@ -328,6 +313,7 @@ void view(tasklist* list, date today) {
             } else {
                 printf("Due Date: Not Set\n");
             }
+            printRepeat(high_priority[i]);
             printf("-------------------------\n");
         }
     } else {
@@ -371,6 +357,7 @@ void view(tasklist* list, date today) {
             } else {
                 printf("Due Date: Not Set\n");
             }
+            printRepeat(medium_priority[i]);
             printf("-------------------------\n");
         }
     } else {
@@ -414,6 +401,7 @@ void view(tasklist* list, date today) {
             } else {
                 printf("Due Date: Not Set\n");
             }
+            printRepeat(low_priority[i]);
             printf("-------------------------\n");
         }
     } else {
@@ -458,6 +446,8 @@ void view(tasklist* list, date today) {
 /*
 edit() - Modifies existing task details
  - Time: O(n), Space: O(1)
+ - A repeat rule given to a task without a due date starts on or after
+   today, the session date
  - Sample Case:
     Input:
       Task name: "Essay"
@@ -466,7 +456,7 @@ edit() - Modifies existing task details
     Output:
       Task priority updated.
  */
-void edit(tasklist* list, const char* taskname) {
+void edit(tasklist* list, const char* taskname, date today) {
     task* current = list->head;
     while (current) {
         if (strcmp(current->name, taskname) == 0) {
@@ -479,7 +469,8 @@ void edit(tasklist* list, const char* taskname) {
             printf("2. Description\n");
             printf("3. Priority\n");
             printf("4. Due Date\n");
-            printf("Enter your choice (1-4): ");
+            printf("5. Repeat\n");
+            printf("Enter your choice (1-5): ");
 
             
             if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &choice) != 1) {
@@ -553,7 +544,11 @@ void edit(tasklist* list, const char* taskname) {
 
                     // Only copy if the loop finished with a valid, different, non-duplicate name
                     if (format_valid_and_not_same) {
+                         char old_name[100];
+                         strcpy(old_name, current->name);
                          strcpy(current->name, new_name);
+                         undoRecordFields(current, UNDO_NAME, old_name);
+                         feedRecord(FEED_EDIT, current, old_name, 0);
                          printf("Task name updated.\n"); 
                     }
                     break;
@@ -562,8 +557,10 @@ void edit(tasklist* list, const char* taskname) {
                     printf("Enter new description: ");
                     // Assuming description can be empty or whitespace, no validation added here
                     // but you could add similar checks if needed.
+                    undoRecordFields(current, UNDO_DESCRIPTION, NULL);
                     fgets(current->description, sizeof(current->description), stdin);
                     current->description[strcspn(current->description, "\n")] = 0;
+                    feedRecord(FEED_EDIT, current, current->name, 0);
                     printf("Task description updated.\n");
                     break;
                 case 3: {
@@ -573,7 +570,9 @@ void edit(tasklist* list, const char* taskname) {
                         if (sscanf(buffer, "%d", &priority_input) == 1) {
                             // Validate priority range
                             if (priority_input >= 1 && priority_input <= 3) {
+                                undoRecordFields(current, UNDO_PRIORITY, NULL);
                                 current->priority = priority_input;
+                                feedRecord(FEED_EDIT, current, current->name, 0);
                                 printf("Task priority updated.\n");
                             } else {
                                 printf("Invalid priority value (%d). Priority not changed.\n", priority_input);
@@ -605,11 +604,16 @@ void edit(tasklist* list, const char* taskname) {
                                 if (fgets(buffer, sizeof(buffer), stdin) != NULL) {
                                     if (sscanf(buffer, "%d %d %d", &day, &month, &year) == 3) {
                                         if (isValidDate(day, month, year)) {
+                                            undoRecordFields(current, UNDO_DUE, NULL);
                                             current->duedate.day = day;
                                             current->duedate.month = month;
                                             current->duedate.year = year;
                                             current->due_date_set = 1;
                                             valid_date = 1;
+                                            if (current->reminder_count > 0 && reminderDefaultIfStarted()) {
+                                                reminderSchedule(reminderDefaultIfStarted(), current);
+                                            }
+                                            feedRecord(FEED_EDIT, current, current->name, 0);
                                             printf("Task due date updated.\n");
                                         } else {
                                             printf("Invalid date. Please enter a valid date.\n");
@@ -624,7 +628,10 @@ void edit(tasklist* list, const char* taskname) {
                             }
                         } else if (due_date_choice == 2) {
                             // Clear due date
+                            undoRecordFields(current, UNDO_DUE, NULL);
                             current->due_date_set = 0;
+                            if (current->reminder_entries) reminderCancel(current);
+                            feedRecord(FEED_EDIT, current, current->name, 0);
                             printf("Due date cleared.\n");
                         } else {
                             printf("Invalid choice. Due date not changed.\n");
@@ -634,6 +641,26 @@ void edit(tasklist* list, const char* taskname) {
                     }
                     break;
                 }
+                case 5: {
+                    char text[RECUR_TEXT_MAX], current_rule[RECUR_TEXT_MAX];
+                    recurrence rule;
+                    printf("Currently repeats: %s\n", recurFormat(&current->repeat, current_rule, sizeof(current_rule)));
+                    printf("Repeat (daily / weekly mon,thu / monthly 15 / every 3 days / none): ");
+                    if (fgets(text, sizeof(text), stdin) == NULL || recurParse(text, &rule) != 0) {
+                        printf("Invalid repeat rule. Task not updated.\n");
+                        break;
+                    }
+                    int had_due_date = current->due_date_set;
+                    undoRecordFields(current, UNDO_REPEAT | UNDO_DUE, NULL);
+                    recurSet(current, &rule, today);
+                    feedRecord(FEED_EDIT, current, current->name, 0);
+                    printf("Task now repeats: %s\n", recurFormat(&current->repeat, current_rule, sizeof(current_rule)));
+                    if (!had_due_date && current->due_date_set) {
+                        printf("First occurrence due %02d/%02d/%04d.\n",
+                               current->duedate.day, current->duedate.month, current->duedate.year);
+                    }
+                    break;
+                }
                 default:
                     printf("Invalid choice. Task not updated.\n");
                     return;
@@ -659,61 +686,58 @@ complete() - Moves task from active list to completed stack
       Stack: "Submit Report" -> NULL
     Output: "Task 'Submit Report' marked as completed!"
  */
-void complete(tasklist* list, completedstack* stack, const char* taskname) {
+void complete(tasklist* list, completedstack* stack, const char* taskname, date today) {
     if (!list || !stack || !taskname) {
         printf("Error: Invalid parameters for complete function.\n");
         return;
     }
     
-    task* current = list->head;
-    task* prev = NULL;
-    
-    // Find the task to complete
-    while (current && strcmp(current->name, taskname) != 0) {
-        prev = current;
-        current = current->next;
-    }
-    
-    if (!current) {
+    todostatus status = todoComplete(list, stack, NULL, taskname, today, NULL);
+    if (status == TODO_NOT_FOUND) {
         printf("Task not found: %s\n", taskname);
         return;
     }
-    
-    // Debug info
-    printf("Found task: %s (Priority: %d)\n", current->name, current->priority);
-    
-    // Allocate stack node first to check for memory issues
-    stacknode* node = (stacknode*)malloc(sizeof(stacknode));
-    if (!node) {
+    if (status != TODO_OK) {
         printf("Memory allocation failed for stack node. Task remains in list.\n");
         return;
     }
     
-    // Mark the task as completed
-    current->status = COMPLETED;
-    current->completed = 1;
-    
-    // Remove from list first
-    if (prev) {
-        prev->next = current->next;
-    } else {
-        list->head = current->next;
+    printf("Task '%s' marked as completed and moved to stack!\n", taskname);
+}
+
+// Undoes or redoes the newest change in the default log and says what it did.
+// The list is indexed once for the whole group, so each record finds its
+// task in O(1) (without memory for the index, by name search).
+static void applyLastChange(tasklist* list, completedstack* stack, int redo, date today) {
+    undolog* log = undoDefault();
+    undoresult result;
+    todoindex index = {NULL, 0, 0};
+    todostatus status = TODO_EMPTY;
+    if (log) {
+        todoindex* lookup = todoIndexBuild(&index, list->head) == 0 ? &index : NULL;
+        status = undoApply(log, redo, list, stack, lookup, today, &result);
+        todoIndexFree(&index);
+    }
+    if (status == TODO_EMPTY) {
+        printf("Nothing to %s.\n", redo ? "redo" : "undo");
+        return;
+    }
+    if (result.steps > 1) {
+        printf("%s %d changes (last: '%s' %s).\n", redo ? "Redid" : "Undid", result.steps, result.name, result.action);
+    } else if (result.steps == 1) {
+        printf("%s: '%s' %s.\n", redo ? "Redone" : "Undone", result.name, result.action);
+    }
+    if (status != TODO_OK) {
+        printf("Could not %s the change to '%s': %s. It was dropped.\n",
+               redo ? "redo" : "undo", result.name, todoStatusText(status));
     }
-    
-    // Clear the next pointer to avoid circular references
-    current->next = NULL;
-    
-    // Push onto stack
-    node->task_data = current;
-    node->next = stack->top;
-    stack->top = node;
-    
-    printf("Task '%s' marked as completed and moved to stack!\n", current->name);
 }
 
 /*
-undoCompleted() - Restores last completed task to active list
- - Time: O(1), Space: O(1)
+undoLastChange() - Reverses the newest change: an add, edit, tag, reminder,
+                   completion, deletion, bulk action or import
+ - Time: O(n) to index the list once, then O(1) per task changed found
+   by name, Space: O(n)
  - Sample Case:
     Before:
       Active: ["Task A"] -> NULL
@@ -721,31 +745,21 @@ undoCompleted() - Restores last completed task to active list
     After:
       Active: ["Completed Task"] -> ["Task A"] -> NULL
       Stack: NULL
-    Output: "Last completed task restored to the list."
+    Output: "Undone: 'Completed Task' restored."
  */
-void undoCompleted(tasklist* list, completedstack* stack) {
-    if (!stack->top) {
-        printf("No completed tasks to undo.\n");
-        return;
-    }
-
-    // Pop stack node
-    stacknode* node = stack->top;
-    stack->top = node->next;
-
-    // Get the task POINTER back
-    task* restored = node->task_data;
-
-    // Update task status back to pending
-    restored->status = PENDING;
-    restored->completed = 0;
-
-    // Add task back to the main list (at the head)
-    restored->next = list->head;
-    list->head = restored;
+void undoLastChange(tasklist* list, completedstack* stack, date today) {
+    applyLastChange(list, stack, 0, today);
+}
 
-    free(node); // Free ONLY the stack node wrapper, not the task data
-    printf("Last completed task restored to the list.\n");
+/*
+redoLastChange() - Makes the newest undone change again
+ - Time: O(n) to index the list once, then O(1) per task changed found
+   by name, Space: O(n)
+ - A new change after an undo discards what could be redone
+ - Example: complete "Essay", undo, redo -> "Redone: 'Essay' completed."
+ */
+void redoLastChange(tasklist* list, completedstack* stack, date today) {
+    applyLastChange(list, stack, 1, today);
 }
 
 /*
@@ -758,18 +772,10 @@ deleteTask() - Permanently removes task from list
     Output: "Task deleted."
  */
 void deleteTask(tasklist* list, const char* taskname) {
-    task* current = list->head, *prev = NULL;
-    while (current && strcmp(current->name, taskname) != 0) {
-        prev = current;
-        current = current->next;
-    }
-    if (!current) {
+    if (todoDelete(list, NULL, taskname) != TODO_OK) {
         printf("Task not found.\n");
         return;
     }
-    if (prev) prev->next = current->next;
-    else list->head = current->next;
-    free(current);
     printf("Task deleted.\n");
 }
 
@@ -837,6 +843,7 @@ void freeTasks(tasklist* list) {
     
     current = current->next;
     
+    if (temp->reminder_entries) reminderCancel(temp);
     free(temp);
     
     }
@@ -864,85 +871,120 @@ void freeStack(completedstack* stack) {
 }
 
 /*
-initQueue() - Initializes empty queue
- - Time: O(1), Space: O(1)
- - Example: initQueue(&queue) -> front=NULL, rear=NULL
+initQueue() - Initializes an empty ring with room for capacity tasks
+ - Time: O(capacity), Space: O(capacity)
+ - capacity is rounded up to a power of two; <= 0 means TASKQUEUE_DEFAULT_SIZE
+ - Returns 0 on success, -1 if out of memory
+ - Example: initQueue(&queue, 1000) -> 1024 free slots
  */
-void initQueue(taskqueue* q) {
-    q->front = q->rear = NULL;
+int initQueue(taskqueue* q, int capacity) {
+    unsigned long size = 2;
+    if (capacity <= 0) capacity = TASKQUEUE_DEFAULT_SIZE;
+    while (size < (unsigned long)capacity) size *= 2;
+
+    memset(q, 0, sizeof(*q));
+    q->slots = (queueslot*)malloc(sizeof(queueslot) * size);
+    if (!q->slots) return -1;
+    // Slot i is free for the producer that claims position i
+    for (unsigned long i = 0; i < size; i++) {
+        q->slots[i].seq = i;
+        q->slots[i].task_data = NULL;
+    }
+    q->mask = size - 1;
+    return 0;
 }
 
 
 /*
-enqueue() - Adds task to queue rear
- - Time: O(1), Space: O(1)
+enqueue() - Adds task to queue rear; safe from any number of threads
+ - Time: O(1) (a retry per producer that wins the race), Space: O(1)
+ - Returns 0 on success, -1 if the ring is full (nothing is added)
  - Sample Case:
     Input: Task to add
     Before: Queue: [Task1] -> [Task2]
     After: Queue: [Task1] -> [Task2] -> [NewTask]
  */
-void enqueue(taskqueue* q, task* t) {
-    queuenode* newNode = (queuenode*)malloc(sizeof(queuenode));
-    if (!newNode) {
-        printf("Memory allocation failed for queue node.\n");
-        return;
-    }
-    
-    newNode->task_data = t;
-    newNode->next = NULL;
-    
-    if (q->rear == NULL) {
-        q->front = q->rear = newNode;
-        return;
+int enqueue(taskqueue* q, task* t) {
+    unsigned long pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    queueslot* slot;
+
+    for (;;) {
+        slot = &q->slots[pos & q->mask];
+        unsigned long seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            // Free slot: claim the position, or reload it if another producer did
+            if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;  // the consumer has not read this slot's last lap yet
+        } else {
+            pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+        }
     }
-    
-    q->rear->next = newNode;
-    q->rear = newNode;
+
+    slot->task_data = t;
+    // Release: the consumer that sees the new sequence sees the task
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
 }
 
 /*
-dequeue() - Removes task from queue front
+dequeue() - Removes task from queue front; single consumer thread only
  - Time: O(1), Space: O(1)
  - Sample Case:
     Before: Queue: [Task1] -> [Task2] -> [Task3]
     After: Queue: [Task2] -> [Task3]
-    Output: Returns Task1
+    Output: Returns Task1 (NULL if the queue is empty)
  */
 task* dequeue(taskqueue* q) {
-    if (q->front == NULL)
+    unsigned long pos = q->head;
+    queueslot* slot = &q->slots[pos & q->mask];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
         return NULL;
-    
-    queuenode* temp = q->front;
-    task* t = temp->task_data;
-    
-    q->front = q->front->next;
-    
-    if (q->front == NULL)
-        q->rear = NULL;
-    
-    free(temp);
+
+    task* t = slot->task_data;
+    // Hand the slot to the producer one lap ahead
+    __atomic_store_n(&slot->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+    q->head = pos + 1;
     return t;
 }
 
 /*
-isQueueEmpty() - Checks if queue is empty
+dequeueBatch() - Removes up to max tasks from the front into out
+ - Time: O(max), Space: O(1)
+ - Stops early at a slot a producer has claimed but not filled yet
+ - Example: dequeueBatch(&queue, buffer, 256) -> number of tasks taken, 0 if empty
+ */
+int dequeueBatch(taskqueue* q, task* out[], int max) {
+    int count = 0;
+    task* t;
+    while (count < max && (t = dequeue(q)) != NULL) out[count++] = t;
+    return count;
+}
+
+/*
+isQueueEmpty() - Checks if queue is empty (as seen by the consumer)
  - Time: O(1), Space: O(1)
  - Example: isQueueEmpty(&queue) -> returns 1 if empty, 0 if not
  */
 int isQueueEmpty(taskqueue* q) {
-    return q->front == NULL;
+    return __atomic_load_n(&q->slots[q->head & q->mask].seq, __ATOMIC_ACQUIRE) != q->head + 1;
 }
 
 
 /*
 freeQueue() - Deallocates queue memory
- - Time: O(n), Space: O(1)
- - Example: freeQueue(&queue) -> frees all queue nodes
+ - Time: O(1), Space: O(1)
+ - Tasks still queued are not freed; drain the queue first
+ - Example: freeQueue(&queue) -> frees the ring
  */
 void freeQueue(taskqueue* q) {
-    while (!isQueueEmpty(q)) {
-        dequeue(q);
-    }
+    free(q->slots);
+    q->slots = NULL;
+    q->mask = 0;
 }
 
 /*
@@ -957,13 +999,7 @@ add_tag_to_task() - Adds tag to task (max 5 tags)
       "Tag 'urgent' added to task 'Research Paper'."
  */
 void add_tag_to_task(tasklist* list, const char* taskname) {
-    task* current = list->head;
-    
-    // Find the task
-    while (current && strcmp(current->name, taskname) != 0) {
-        current = current->next;
-    }
-    
+    task* current = todoFindTask(list, taskname);
     if (!current) {
         printf("Task '%s' not found.\n", taskname);
         return;
@@ -1010,7 +1046,10 @@ void add_tag_to_task(tasklist* list, const char* taskname) {
         new_tag[strcspn(new_tag, "\n")] = 0;
         
         // Replace tag
-        strcpy(current->tags[tag_index - 1], new_tag);
+        if (todoReplaceTag(current, tag_index - 1, new_tag) != TODO_OK) {
+            printf("Tag name cannot be empty.\n");
+            return;
+        }
         printf("Tag replaced successfully.\n");
         return;
     }
@@ -1078,18 +1117,12 @@ void add_tag_to_task(tasklist* list, const char* taskname) {
                 return;
             }
             
-            // Check if the selected tag already exists on this task
+            // Add the selected tag unless the task already has it
             char* selected_tag = unique_tags[tag_selection - 1];
-            for (int i = 0; i < current->tag_count; i++) {
-                if (strcmp(current->tags[i], selected_tag) == 0) {
-                    printf("This task already has the tag '%s'.\n", selected_tag);
-                    return;
-                }
+            if (todoAddTag(current, selected_tag) == TODO_DUPLICATE) {
+                printf("This task already has the tag '%s'.\n", selected_tag);
+                return;
             }
-            
-            // Add the selected tag to the task
-            strcpy(current->tags[current->tag_count], selected_tag);
-            current->tag_count++;
             printf("Tag '%s' added to task '%s'.\n", selected_tag, taskname);
         }
         else if (choice == 2) {
@@ -1105,17 +1138,11 @@ void add_tag_to_task(tasklist* list, const char* taskname) {
                 return;
             }
             
-            // Check if this tag already exists on this task
-            for (int i = 0; i < current->tag_count; i++) {
-                if (strcmp(current->tags[i], new_tag) == 0) {
-                    printf("This task already has the tag '%s'.\n", new_tag);
-                    return;
-                }
+            // Add tag to task unless it already has it
+            if (todoAddTag(current, new_tag) == TODO_DUPLICATE) {
+                printf("This task already has the tag '%s'.\n", new_tag);
+                return;
             }
-            
-            // Add tag to task
-            strcpy(current->tags[current->tag_count], new_tag);
-            current->tag_count++;
             printf("Tag '%s' added to task '%s'.\n", new_tag, taskname);
         }
         else {
@@ -1137,12 +1164,107 @@ void add_tag_to_task(tasklist* list, const char* taskname) {
         }
         
         // Add tag to task
-        strcpy(current->tags[current->tag_count], new_tag);
-        current->tag_count++;
+        todoAddTag(current, new_tag);
         printf("Tag '%s' added to task '%s'.\n", new_tag, taskname);
     }
 }
 
+/*
+add_reminder_to_task() - Adds a reminder some days before a task's due date (max 3)
+ - Time: O(n), Space: O(1)
+ - The reminder fires in the digest printed by checkReminders()
+ - Sample Case:
+    Input:
+      Task name: "Essay" (due 20/05/2025)
+      Days before: 2
+    Output:
+      "Reminder set for 'Essay' 2 days before its due date (18/05/2025)."
+ */
+void add_reminder_to_task(tasklist* list, const char* taskname, date today) {
+    task* current = todoFindTask(list, taskname);
+    if (!current) {
+        printf("Task '%s' not found.\n", taskname);
+        return;
+    }
+    if (!current->due_date_set) {
+        printf("Task '%s' has no due date. Set one first (Edit Task).\n", taskname);
+        return;
+    }
+
+    if (current->reminder_count > 0) {
+        printf("Current reminders: ");
+        for (int i = 0; i < current->reminder_count; i++) {
+            printf("%d day(s) before%s", current->reminder_days[i],
+                   (i < current->reminder_count - 1) ? ", " : "");
+        }
+        printf("\n");
+    }
+
+    printf("Remind how many days before the due date (0-%d): ", REMINDER_MAX_DAYS);
+    char buffer[16];
+    int days;
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL || sscanf(buffer, "%d", &days) != 1) {
+        printf("Invalid input. No reminder added.\n");
+        return;
+    }
+
+    task before = *current;
+    reminderwheel* wheel = reminderDefault(today);
+    todostatus status = wheel ? reminderAdd(wheel, current, days) : TODO_NO_MEMORY;
+    if (status == TODO_DUPLICATE) {
+        printf("This task already has a reminder %d day(s) before.\n", days);
+        return;
+    }
+    if (status != TODO_OK) {
+        printf("No reminder added: %s.\n", todoStatusText(status));
+        return;
+    }
+    undoRecordFields(&before, UNDO_REMINDERS, NULL);
+    date day = current->duedate;
+    for (int i = 0; i < days; i++) {
+        if (--day.day < 1) {
+            if (--day.month < 1) {
+                day.month = 12;
+                day.year--;
+            }
+            day.day = 31;
+            while (!isValidDate(day.day, day.month, day.year)) day.day--;
+        }
+    }
+    printf("Reminder set for '%s' %d day(s) before its due date (%02d/%02d/%04d).\n",
+           taskname, days, day.day, day.month, day.year);
+}
+
+// Prints a task as the tag views list it
+static void printTagged(const task* current) {
+    printf("Name: %s\n", current->name);
+    printf("Description: %s\n", current->description);
+    printf("Priority: %d\n", current->priority);
+
+    // Show correct status based on updated information
+    if (current->completed) {
+        printf("Status: Completed\n");
+    } else if (current->status == OVERDUE) {
+        printf("Status: Overdue\n");
+    } else {
+        printf("Status: Pending\n");
+    }
+
+    if (current->due_date_set) {
+        printf("Due Date: %02d/%02d/%04d\n",
+               current->duedate.day, current->duedate.month, current->duedate.year);
+    } else {
+        printf("Due Date: Not Set\n");
+    }
+
+    // Print all tags
+    printf("Tags: ");
+    for (int j = 0; j < current->tag_count; j++) {
+        printf("%s%s", current->tags[j], (j < current->tag_count - 1) ? ", " : "");
+    }
+    printf("\n-------------------------\n");
+}
+
 /*
 view_by_tag() - Shows all tasks with specific tag
  - Time: O(n), Space: O(1)
@@ -1162,34 +1284,7 @@ void view_by_tag(tasklist* list, const char* tag) {
         // Check if task has the specified tag
         for (int i = 0; i < current->tag_count; i++) {
             if (strcmp(current->tags[i], tag) == 0) {
-                // Print task details
-                printf("Name: %s\n", current->name);
-                printf("Description: %s\n", current->description);
-                printf("Priority: %d\n", current->priority);
-                
-                // Show correct status based on updated information
-                if (current->completed) {
-                    printf("Status: Completed\n");
-                } else if (current->status == OVERDUE) {
-                    printf("Status: Overdue\n");
-                } else {
-                    printf("Status: Pending\n");
-                }
-                
-                if (current->due_date_set) {
-                    printf("Due Date: %02d/%02d/%04d\n", 
-                           current->duedate.day, current->duedate.month, current->duedate.year);
-                } else {
-                    printf("Due Date: Not Set\n");
-                }
-                
-                // Print all tags
-                printf("Tags: ");
-                for (int j = 0; j < current->tag_count; j++) {
-                    printf("%s%s", current->tags[j], (j < current->tag_count - 1) ? ", " : "");
-                }
-                printf("\n-------------------------\n");
-                
+                printTagged(current);
                 found = 1;
                 break;  // Found the tag, no need to check other tags for this task
             }
@@ -1203,12 +1298,61 @@ void view_by_tag(tasklist* list, const char* tag) {
     }
 }
 
+/*
+view_by_tags() - Shows the active tasks whose tags satisfy a tag expression
+ - Time: O(containers of the tags named) to combine their bitmaps (see
+   planTagQuery()), plus O(n) to rebuild the indexes if anything changed,
+   then O(matches) to print, Space: O(matches)
+ - The counts come from the result bitmap; only the active matches are listed
+ - Example: view_by_tags(&tasks, &doneStack, "work AND urgent AND NOT waiting")
+    -> "2 active task(s) match (1 completed)", then the two tasks
+ */
+void view_by_tags(tasklist* list, completedstack* stack, const char* expression) {
+    planindex local;
+    planindex* set = planDefault();
+    bitmap rows;
+    char error[80];
+
+    updateTaskStatuses(list->head, getToday());
+    if (!set) {
+        planInit(&local);
+        set = &local;
+    }
+    todostatus status = planRefresh(set, list, stack) < 0
+                            ? TODO_NO_MEMORY
+                            : planTagQuery(set, expression, &rows, error, sizeof(error));
+    if (status == TODO_PARSE_ERROR) {
+        printf("Invalid tag expression: %s.\n", error);
+    } else if (status != TODO_OK) {
+        printf("Memory allocation failed.\n");
+    } else {
+        long active = bitmapRank(&rows, (unsigned int)set->active);
+        long total = bitmapCardinality(&rows);
+        unsigned int* matches = (unsigned int*)malloc(sizeof(unsigned int) * (active ? active : 1));
+
+        printf("\n=== Tasks with Tags '%s' ===\n", expression);
+        printf("%ld active task(s) match (%ld completed)\n", active, total - active);
+        if (!matches) {
+            printf("Memory allocation failed.\n");
+        } else {
+            // The active tasks are the first rows
+            long n = bitmapToArray(&rows, matches, active);
+            for (long i = 0; i < n; i++) printTagged(set->rows[matches[i]]);
+        }
+        if (active == 0) printf("No tasks found with tags '%s'.\n", expression);
+        free(matches);
+        bitmapFree(&rows);
+    }
+    if (set == &local) planFree(&local);
+}
+
 /*
 sort_by_tag() - Lists all tags and shows tasks for selected tag
  - Time: O(n²), Space: O(n)
- - Example: sort_by_tag(&tasks) -> shows tag menu, then tasks for chosen tag
+ - Instead of a number, tags can be combined: work AND urgent AND NOT waiting
+ - Example: sort_by_tag(&tasks, &doneStack) -> shows tag menu, then tasks for chosen tag
  */
-void sort_by_tag(tasklist* list) {
+void sort_by_tag(tasklist* list, completedstack* stack) {
     // First, get all unique tags from all tasks
     char unique_tags[100][MAX_TAG_LENGTH];  // Assume max 100 unique tags
     int tag_count = 0;
@@ -1245,11 +1389,16 @@ void sort_by_tag(tasklist* list) {
         printf("%d. %s\n", i + 1, unique_tags[i]);
     }
     
-    printf("Select a tag to view (1-%d): ", tag_count);
-    char buffer[10];
-    fgets(buffer, sizeof(buffer), stdin);
-    int selection;
-    sscanf(buffer, "%d", &selection);
+    printf("Select a tag to view (1-%d), or combine tags (e.g. work AND urgent AND NOT waiting): ", tag_count);
+    char buffer[200];
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL) buffer[0] = '\0';
+    buffer[strcspn(buffer, "\n")] = 0;
+    int selection = 0;
+    char rest;
+    if (sscanf(buffer, "%d %c", &selection, &rest) != 1 && buffer[strspn(buffer, " ")]) {
+        view_by_tags(list, stack, buffer);
+        return;
+    }
     
     if (selection < 1 || selection > tag_count) {
         printf("Invalid selection.\n");
@@ -1454,24 +1603,31 @@ view_weekly_summary() - Shows tasks due in next 7 days
 void view_weekly_summary(tasklist* list, date today) {
     task* current = list->head;
     int count = 0;
+    long first_day = todoDayNumber(today);
+    date last = todoDateFromDay(first_day + 7);
     
     printf("\n=== Tasks Due This Week (%02d/%02d/%04d to %02d/%02d/%04d) ===\n", 
            today.day, today.month, today.year,
-           today.day + 7, today.month, today.year); 
+           last.day, last.month, last.year); 
     
     printf("%-5s %-25s %-10s %-15s %-10s\n", "#", "Name", "Priority", "Due Date", "Days Left");
     printf("---------------------------------------------------------------\n");
     
-    // Create arrays to store tasks for each day of the week
-    task* days_tasks[8][50];
+    // Create arrays to store tasks for each day of the week; a recurring
+    // task is listed on every day it falls in the window
+    occurrence days_tasks[8][50];
     int days_tasks_count[8] = {0}; 
+    date dates[8];
     
     // First pass: collect tasks in arrays by day
     while (current) {
-        if (!current->completed && current->due_date_set) {
-            int daysDiff = getDaysBetween(today, current->duedate);
-            if (daysDiff >= 0 && daysDiff <= 7) {
-                days_tasks[daysDiff][days_tasks_count[daysDiff]++] = current;
+        if (!current->completed) {
+            int n = recurExpand(current, today, last, dates, 8);
+            for (int i = 0; i < n; i++) {
+                int daysDiff = (int)(todoDayNumber(dates[i]) - first_day);
+                if (days_tasks_count[daysDiff] < 50) {
+                    days_tasks[daysDiff][days_tasks_count[daysDiff]++] = (occurrence){current, dates[i]};
+                }
             }
         }
         current = current->next;
@@ -1482,13 +1638,14 @@ void view_weekly_summary(tasklist* list, date today) {
     
     for (int day = 0; day <= 7; day++) {
         for (int i = 0; i < days_tasks_count[day]; i++) {
-            task* t = days_tasks[day][i];
+            task* t = days_tasks[day][i].task_data;
+            date due = days_tasks[day][i].due;
             
             char date_str[15];
             sprintf(date_str, "%02d/%02d/%04d", 
-                    t->duedate.day, 
-                    t->duedate.month, 
-                    t->duedate.year);
+                    due.day, 
+                    due.month, 
+                    due.year);
             
             char priority_str[10];
             switch(t->priority) {
@@ -1567,9 +1724,9 @@ void view_time_summary(tasklist* list, date today) {
 /*
 view_combined() - Menu for standard/simplified/tag view
  - Time: O(n²), Space: O(n)
- - Example: view_combined(&tasks, today) -> shows menu, calls chosen view
+ - Example: view_combined(&tasks, &doneStack, today) -> shows menu, calls chosen view
  */
-void view_combined(tasklist* list, date today) {
+void view_combined(tasklist* list, completedstack* stack, date today) {
     int choice;
     char buffer[10];
     
@@ -1592,7 +1749,7 @@ void view_combined(tasklist* list, date today) {
             simplified_view(list, today);
             break;
         case 3:
-            sort_by_tag(list);  
+            sort_by_tag(list, stack);
             break;
         default:
             printf("Invalid option. Using standard view.\n");
@@ -1632,23 +1789,23 @@ void view_monthly_summary(tasklist* list, date today) {
     printf("%-5s %-25s %-10s %-15s %-10s\n", "#", "Name", "Priority", "Due Date", "Days Left");
     printf("---------------------------------------------------------------\n");
     
-    // Count tasks by week
+    // Count tasks by week; a recurring task counts once per occurrence
     int week_count[5] = {0}; // 5 weeks in a month 
-    task* week_tasks[5][50]; // Up to 50 tasks per week
+    occurrence week_tasks[5][50]; // Up to 50 tasks per week
     int week_tasks_count[5] = {0};
+    long first_day = todoDayNumber(today);
+    date month_end = {days_in_month, today.month, today.year};
+    date dates[31];
     
     // First pass: collect and count tasks by week
     while (current) {
-        if (!current->completed && current->due_date_set) {
-            // Check if the task is due this month
-            if (current->duedate.month == today.month && current->duedate.year == today.year) {
-                int daysDiff = getDaysBetween(today, current->duedate);
-                if (daysDiff >= 0) {
-                    int week = daysDiff / 7;
-                    if (week < 5) {
-                        week_tasks[week][week_tasks_count[week]++] = current;
-                        week_count[week]++;
-                    }
+        if (!current->completed) {
+            int n = recurExpand(current, today, month_end, dates, 31);
+            for (int i = 0; i < n; i++) {
+                int week = (int)(todoDayNumber(dates[i]) - first_day) / 7;
+                if (week < 5 && week_tasks_count[week] < 50) {
+                    week_tasks[week][week_tasks_count[week]++] = (occurrence){current, dates[i]};
+                    week_count[week]++;
                 }
             }
         }
@@ -1663,17 +1820,17 @@ void view_monthly_summary(tasklist* list, date today) {
         for (int i = 0; i < week_tasks_count[week] - 1; i++) {
             for (int j = 0; j < week_tasks_count[week] - i - 1; j++) {
                 // Primary sort by priority (1 is highest)
-                if (week_tasks[week][j]->priority > week_tasks[week][j+1]->priority) {
+                if (week_tasks[week][j].task_data->priority > week_tasks[week][j+1].task_data->priority) {
                     // Swap
-                    task* temp = week_tasks[week][j];
+                    occurrence temp = week_tasks[week][j];
                     week_tasks[week][j] = week_tasks[week][j+1];
                     week_tasks[week][j+1] = temp;
                 }
                 // Secondary sort by due date (if same priority)
-                else if (week_tasks[week][j]->priority == week_tasks[week][j+1]->priority &&
-                        compareDates(week_tasks[week][j]->duedate, week_tasks[week][j+1]->duedate) > 0) {
+                else if (week_tasks[week][j].task_data->priority == week_tasks[week][j+1].task_data->priority &&
+                        compareDates(week_tasks[week][j].due, week_tasks[week][j+1].due) > 0) {
                     // Swap
-                    task* temp = week_tasks[week][j];
+                    occurrence temp = week_tasks[week][j];
                     week_tasks[week][j] = week_tasks[week][j+1];
                     week_tasks[week][j+1] = temp;
                 }
@@ -1682,13 +1839,14 @@ void view_monthly_summary(tasklist* list, date today) {
         
      
         for (int i = 0; i < week_tasks_count[week]; i++) {
-            task* t = week_tasks[week][i];
+            task* t = week_tasks[week][i].task_data;
+            date due = week_tasks[week][i].due;
             
             char date_str[15];
             sprintf(date_str, "%02d/%02d/%04d", 
-                    t->duedate.day, 
-                    t->duedate.month, 
-                    t->duedate.year);
+                    due.day, 
+                    due.month, 
+                    due.year);
             
             char priority_str[10];
             switch(t->priority) {
@@ -1698,7 +1856,7 @@ void view_monthly_summary(tasklist* list, date today) {
                 default: strcpy(priority_str, "Unknown");
             }
             
-            int daysDiff = getDaysBetween(today, t->duedate);
+            int daysDiff = (int)(todoDayNumber(due) - first_day);
             char days_left[10];
             if (daysDiff == 0) {
                 strcpy(days_left, "Today");
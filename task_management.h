@@ -8,6 +8,26 @@
 #define MAX_TAGS 5
 #define MAX_TAG_LENGTH 20
 
+// Reminders per task, see reminder.h
+#define MAX_REMINDERS 3
+
+struct reminderentry;
+
+// Repeat rule of a recurring task, see recurrence.h
+typedef enum {
+    RECUR_NONE,
+    RECUR_DAILY,
+    RECUR_WEEKLY,     // on the weekdays in the mask
+    RECUR_MONTHLY,    // on day n (the last day in shorter months)
+    RECUR_EVERY       // every n days
+} recurkind;
+
+typedef struct {
+    unsigned char kind;       // recurkind
+    unsigned char weekdays;   // RECUR_WEEKLY: bit 0 Monday .. bit 6 Sunday
+    unsigned short n;         // RECUR_MONTHLY: day of the month; RECUR_EVERY: days
+} recurrence;
+
 // Task structure
 typedef struct task {
     char name[100];
@@ -17,10 +37,20 @@ typedef struct task {
     TaskStatus status;
     int due_date_set;
     int completed;
+    date completed_date;   // day it was completed (the caller's today), for queries
     
     // Tag fields
     char tags[MAX_TAGS][MAX_TAG_LENGTH];
     int tag_count;
+
+    // Reminder fields: days before the due date, and the wheel entries
+    // waiting to fire for them (NULL when none are scheduled)
+    unsigned char reminder_days[MAX_REMINDERS];
+    int reminder_count;
+    struct reminderentry* reminder_entries;
+
+    // Repeat rule; the due date is the next occurrence
+    recurrence repeat;
     
     struct task* next;
 } task;
@@ -39,21 +69,31 @@ typedef struct {
     stacknode* top;
 } completedstack;
 
-// Queue structures
-typedef struct queuenode {
+// Queue structures: a bounded lock-free ring. Any number of threads may
+// enqueue at once; a single thread dequeues. Each slot's sequence number
+// says whether it is free for the producer that claimed it or filled for
+// the consumer, so neither side takes a lock or allocates.
+#define TASKQUEUE_DEFAULT_SIZE 4096
+
+typedef struct {
+    unsigned long seq;
     task* task_data;
-    struct queuenode* next;
-} queuenode;
+} queueslot;
 
 typedef struct {
-    queuenode* front;
-    queuenode* rear;
+    queueslot* slots;
+    unsigned long mask;     // capacity - 1, capacity is a power of two
+    char pad_tail[64];      // producers and the consumer on separate cache lines
+    unsigned long tail;     // next slot to claim, shared by producers
+    char pad_head[64];
+    unsigned long head;     // next slot to read, consumer only
 } taskqueue;
 
 // Queue function prototypes
-void initQueue(taskqueue* q);
-void enqueue(taskqueue* q, task* t);
+int initQueue(taskqueue* q, int capacity);
+int enqueue(taskqueue* q, task* t);
 task* dequeue(taskqueue* q);
+int dequeueBatch(taskqueue* q, task* out[], int max);
 int isQueueEmpty(taskqueue* q);
 void freeQueue(taskqueue* q);
 
@@ -62,9 +102,10 @@ void sortTasksByDueDate(task* tasks[], int count);
 void add(tasklist* list);
 int isTaskNameDuplicate(tasklist* list, const char* name);
 void view(tasklist* list, date today);
-void edit(tasklist* list, const char* name);
-void complete(tasklist* list, completedstack* stack, const char* name);
-void undoCompleted(tasklist* list, completedstack* stack);
+void edit(tasklist* list, const char* name, date today);
+void complete(tasklist* list, completedstack* stack, const char* name, date today);
+void undoLastChange(tasklist* list, completedstack* stack, date today);
+void redoLastChange(tasklist* list, completedstack* stack, date today);
 void deleteTask(tasklist* list, const char* name);
 void freeTasks(tasklist* list);
 void freeStack(completedstack* stack);
@@ -74,12 +115,14 @@ void simplified_view(tasklist* list, date today);
 void view_weekly_summary(tasklist* list, date today);
 void view_monthly_summary(tasklist* list, date today);
 void add_tag_to_task(tasklist* list, const char* taskname);
+void add_reminder_to_task(tasklist* list, const char* taskname, date today);
 void view_by_tag(tasklist* list, const char* tag);
-void sort_by_tag(tasklist* list);
+void view_by_tags(tasklist* list, completedstack* stack, const char* expression);
+void sort_by_tag(tasklist* list, completedstack* stack);
 void text_converter(const char* input_text, tasklist* list);
 
 
-void view_combined(tasklist* list, date today);
+void view_combined(tasklist* list, completedstack* stack, date today);
 void view_time_summary(tasklist* list, date today);
 
 
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "batch.h"
+
+// Stress test for the shared batch store: lock-free readers against a
+// writer that retires memory through the epoch domain (epoch.h), then many
+// producers pushing through the lock-free ingest ring (taskqueue). Meant to
+// run under -fsanitize=thread (make tsan-check), which fails it on any data
+// race; on its own it checks that nothing retired leaks and no pushed task
+// is lost.
+//
+//   concurrency_stress [threads] [ops per thread]
+
+#define STRESS_TASKS 2000
+#define STRESS_MAX_THREADS 16
+
+static int failures = 0;
+
+static void expect(int ok, const char* what) {
+    if (!ok) {
+        fprintf(stderr, "concurrency_stress: %s\n", what);
+        failures++;
+    }
+}
+
+// Fills the list with tasks named "Task 0" .. "Task count-1", every third
+// one tagged work and every fifth overdue
+static void buildTasks(tasklist* list, int count) {
+    date today = {1, 6, 2025};
+    char name[32];
+    for (int i = 0; i < count; i++) {
+        date due = {1 + i % 28, i % 5 == 0 ? 5 : 7, 2025};
+        task* t;
+        snprintf(name, sizeof(name), "Task %d", i);
+        if (todoAdd(list, NULL, name, "stress", 1 + i % 3, &due, today, &t) != TODO_OK) return;
+        if (i % 3 == 0) todoAddTag(t, "work");
+    }
+}
+
+typedef struct {
+    pthread_t thread;
+    batchstore* store;
+    int id;
+    int ops;
+} stressworker;
+
+// Runs a 95/5 read/write mix of batch commands against the shared store
+static void* stressThread(void* arg) {
+    static const char* reads[] = {"stats", "query|tag|work", "query|name|Task 19", "query|status|overdue"};
+    stressworker* sw = (stressworker*)arg;
+    outbuf out;
+    char line[128];
+    unsigned int seed = 777u + (unsigned int)sw->id;
+
+    if (outbufInit(&out, -1, 64 * 1024) != 0) return NULL;
+    batchsession session = {sw->store, &out, 0, 0, epochRegister(&sw->store->epoch)};
+
+    for (int i = 0; i < sw->ops; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned int r = seed >> 8;
+        if (r % 100 < 95) {
+            snprintf(line, sizeof(line), "%s", reads[r / 100 % 4]);
+        } else {
+            // Each thread works on its own names; undo and clear free shared memory
+            int k = (int)(r / 100 % 64);
+            switch (r / 6400 % 6) {
+                case 0: snprintf(line, sizeof(line), "add|st%d-%d|stress|%d|15/06/2025", sw->id, k, 1 + k % 3); break;
+                case 1: snprintf(line, sizeof(line), "tag|st%d-%d|work", sw->id, k); break;
+                case 2: snprintf(line, sizeof(line), "complete|st%d-%d", sw->id, k); break;
+                case 3: snprintf(line, sizeof(line), "delete|st%d-%d", sw->id, k); break;
+                case 4: snprintf(line, sizeof(line), "undo"); break;
+                default: snprintf(line, sizeof(line), "%s", k == 0 ? "clear" : "today|01/06/2025"); break;
+            }
+        }
+        batchExecuteShared(&session, line);
+        out.len = 0;
+    }
+    outbufFree(&out);
+    return NULL;
+}
+
+// Readers and writers on one store; everything retired must be reclaimed
+static void stressReads(int threads, int ops) {
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    batchstore store;
+    stressworker workers[STRESS_MAX_THREADS];
+
+    buildTasks(&list, STRESS_TASKS);
+    if (batchStoreInit(&store, &list, &stack) != 0) {
+        expect(0, "store init");
+        freeTasks(&list);
+        return;
+    }
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (stressworker){0, &store, i, ops};
+        pthread_create(&workers[i].thread, NULL, stressThread, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++) pthread_join(workers[i].thread, NULL);
+
+    batchStoreFree(&store);
+    expect(store.epoch.retired > 0, "writers retired nothing");
+    expect(store.epoch.reclaimed == store.epoch.retired, "retired memory not reclaimed");
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+typedef struct {
+    pthread_t thread;
+    batchingest* ingest;
+    int id;
+    int count;
+} ingestproducer;
+
+// Pushes count tasks; every 8th one updates an earlier name
+static void* ingestProducer(void* arg) {
+    ingestproducer* p = (ingestproducer*)arg;
+    date today = {1, 6, 2025};
+    char name[32];
+    for (int k = 0; k < p->count; k++) {
+        date due = {1 + k % 28, 1 + k % 12, 2025};
+        task* t;
+        snprintf(name, sizeof(name), "in%d-%d", p->id, k % 8 == 7 ? k - 7 : k);
+        if (todoCreateTask(name, "ingest", 1 + k % 3, &due, today, &t) != TODO_OK) return NULL;
+        batchIngestPush(p->ingest, t);
+    }
+    return NULL;
+}
+
+// Producers through a small ring, so it fills and wraps; no task is lost
+static void stressIngest(int producers, int count) {
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    batchstore store;
+    batchingest ingest;
+    ingestproducer ps[STRESS_MAX_THREADS];
+
+    buildTasks(&list, STRESS_TASKS);
+    if (batchStoreInit(&store, &list, &stack) != 0 || batchIngestStart(&ingest, &store, 64) != 0) {
+        expect(0, "ingest start");
+        freeTasks(&list);
+        return;
+    }
+    for (int i = 0; i < producers; i++) {
+        ps[i] = (ingestproducer){0, &ingest, i, count};
+        pthread_create(&ps[i].thread, NULL, ingestProducer, &ps[i]);
+    }
+    for (int i = 0; i < producers; i++) pthread_join(ps[i].thread, NULL);
+    batchIngestStop(&ingest);
+
+    long active = 0;
+    for (task* t = list.head; t; t = t->next) active += !t->completed;
+    expect(ingest.applied == (long long)producers * count, "ingest lost tasks");
+    expect(active == STRESS_TASKS + (long)producers * (count - count / 8), "ingest left the wrong tasks");
+
+    batchStoreFree(&store);
+    freeTasks(&list);
+    freeStack(&stack);
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int ops = argc > 2 ? atoi(argv[2]) : 5000;
+    if (threads < 1 || threads > STRESS_MAX_THREADS) threads = 4;
+    if (ops < 1) ops = 5000;
+
+    stressReads(threads, ops);
+    stressIngest(threads, ops / 2);
+
+    if (failures) return 1;
+    printf("concurrency_stress: OK (%d threads, %d ops each)\n", threads, ops);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stddef.h>
+#include "libtodo.h"
+
+// Link test for libtodo.a: built against the whole archive, so a library
+// module that calls one left out of LIBTODO_OBJS fails to link. Runs a
+// few operations so a broken split also shows up at run time.
+
+static int failures = 0;
+
+static void expect(int ok, const char* what) {
+    if (!ok) {
+        fprintf(stderr, "libtodo_link: %s\n", what);
+        failures++;
+    }
+}
+
+int main(void) {
+    tasklist list = {NULL};
+    completedstack stack = {NULL};
+    date today = {1, 1, 2030};
+    date due = {5, 1, 2030};
+    task* t = NULL;
+
+    expect(todoAdd(&list, NULL, "Report", "Q1 numbers", 1, &due, today, &t) == TODO_OK, "add");
+    expect(todoAddTag(t, "work") == TODO_OK, "tag");
+    expect(todoAdd(&list, NULL, "Report", "again", 1, NULL, today, NULL) == TODO_DUPLICATE, "duplicate");
+    expect(todoComplete(&list, &stack, NULL, "Report", today, &t) == TODO_OK, "complete");
+    expect(list.head == NULL && stack.top && stack.top->task_data == t, "completed task on the stack");
+    expect(todoUndo(&list, &stack, NULL, &t) == TODO_OK && list.head == t, "undo");
+    expect(todoDelete(&list, NULL, "Report") == TODO_OK && list.head == NULL, "delete");
+
+    if (failures) return 1;
+    printf("libtodo_link: OK\n");
+    return 0;
+}
@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "undo.h"
+#include "feed.h"
+#include "reminder.h"
+
+// Longest record: a name key and every field of a task
+#define UNDO_RECORD_MAX 1024
+
+// What a record does when applied
+enum {
+    UNDO_OP_REMOVE,      // delete the task (reverses an add)
+    UNDO_OP_INSERT,      // add the task from its packed fields (reverses a delete)
+    UNDO_OP_COMPLETE,    // complete it again (reverses an undone completion)
+    UNDO_OP_UNCOMPLETE,  // bring it back from the stack top (reverses a completion)
+    UNDO_OP_FIELDS       // put the packed fields back (reverses an edit)
+};
+
+// data holds the name of the task the record applies to, then its fields
+struct undorecord {
+    undorecord* older;
+    undorecord* newer;       // undo stack only
+    unsigned int group;
+    unsigned short size;     // bytes of data
+    unsigned char op;
+    unsigned char fields;
+    unsigned char data[];
+};
+
+static undolog* default_log;
+
+/*
+undoInit() - Creates an empty log holding at most budget bytes of records
+ - Time: O(1), Space: O(1)
+ - Example: undoInit(&history, UNDO_DEFAULT_BUDGET)
+ */
+void undoInit(undolog* log, size_t budget) {
+    memset(log, 0, sizeof(*log));
+    log->budget = budget;
+    log->next_group = 1;
+    pthread_mutex_init(&log->lock, NULL);
+}
+
+static size_t recordBytes(const undorecord* r) {
+    return sizeof(undorecord) + r->size;
+}
+
+// Frees the redo stack; caller holds the lock
+static void clearRedo(undolog* log) {
+    while (log->redo) {
+        undorecord* older = log->redo->older;
+        log->bytes -= recordBytes(log->redo);
+        free(log->redo);
+        log->redo = older;
+    }
+    log->redo_count = 0;
+}
+
+/*
+undoClear() - Drops every record, keeping the budget
+ - Time: O(records), Space: O(1)
+ */
+void undoClear(undolog* log) {
+    pthread_mutex_lock(&log->lock);
+    clearRedo(log);
+    while (log->newest) {
+        undorecord* older = log->newest->older;
+        free(log->newest);
+        log->newest = older;
+    }
+    log->oldest = NULL;
+    log->bytes = 0;
+    log->undo_count = 0;
+    pthread_mutex_unlock(&log->lock);
+}
+
+/*
+undoFree() - Frees the log; unset it as the default first
+ - Time: O(records), Space: O(1)
+ */
+void undoFree(undolog* log) {
+    undoClear(log);
+    pthread_mutex_destroy(&log->lock);
+}
+
+/*
+undoSetDefault() - Sets the log the library records into (NULL: none)
+ - Time: O(1), Space: O(1)
+ */
+void undoSetDefault(undolog* log) {
+    __atomic_store_n(&default_log, log, __ATOMIC_RELEASE);
+}
+
+/*
+undoDefault() - The log the library records into, or NULL
+ - Time: O(1), Space: O(1)
+ */
+undolog* undoDefault() {
+    return __atomic_load_n(&default_log, __ATOMIC_ACQUIRE);
+}
+
+/*
+undoGroupBegin() - Starts a group: records made until undoGroupEnd() are undone together
+ - Time: O(1), Space: O(1)
+ - Groups nest; the outermost one counts
+ */
+void undoGroupBegin() {
+    undolog* log = undoDefault();
+    if (!log) return;
+    pthread_mutex_lock(&log->lock);
+    if (log->group_depth++ == 0) log->group = log->next_group++;
+    pthread_mutex_unlock(&log->lock);
+}
+
+// Drops the oldest groups until the log fits its budget, sparing the open
+// group; caller holds the lock
+static void evictOldest(undolog* log) {
+    while (log->bytes > log->budget && log->oldest && (log->group == 0 || log->oldest->group != log->group)) {
+        unsigned int group = log->oldest->group;
+        while (log->oldest && log->oldest->group == group) {
+            undorecord* r = log->oldest;
+            log->oldest = r->newer;
+            if (log->oldest) log->oldest->older = NULL;
+            else log->newest = NULL;
+            log->bytes -= recordBytes(r);
+            log->undo_count--;
+            log->evicted++;
+            free(r);
+        }
+    }
+    // Only the redo stack is left: it holds what was undone, keep it
+}
+
+/*
+undoGroupEnd() - Ends the group started by undoGroupBegin()
+ - Time: O(1) amortized, Space: O(1)
+ - A group larger than the whole budget is dropped here: it cannot be undone
+ */
+void undoGroupEnd() {
+    undolog* log = undoDefault();
+    if (!log) return;
+    pthread_mutex_lock(&log->lock);
+    if (log->group_depth > 0 && --log->group_depth == 0) {
+        log->group = 0;
+        evictOldest(log);
+    }
+    pthread_mutex_unlock(&log->lock);
+}
+
+// Appends s with its terminator, returns the bytes written
+static size_t putString(unsigned char* out, const char* s) {
+    size_t n = strlen(s) + 1;
+    memcpy(out, s, n);
+    return n;
+}
+
+// Packs key, then t's values of fields (name_value standing for t's name)
+static size_t packFields(unsigned char* out, const char* key, const task* t, unsigned int fields,
+                         const char* name_value) {
+    size_t n = putString(out, key);
+    if (fields & UNDO_NAME) n += putString(out + n, name_value);
+    if (fields & UNDO_DESCRIPTION) n += putString(out + n, t->description);
+    if (fields & UNDO_PRIORITY) out[n++] = (unsigned char)t->priority;
+    if (fields & UNDO_DUE) {
+        out[n++] = (unsigned char)(t->due_date_set != 0);
+        out[n++] = (unsigned char)t->duedate.day;
+        out[n++] = (unsigned char)t->duedate.month;
+        out[n++] = (unsigned char)(t->duedate.year & 0xff);
+        out[n++] = (unsigned char)((t->duedate.year >> 8) & 0xff);
+        out[n++] = (unsigned char)__atomic_load_n(&t->status, __ATOMIC_RELAXED);
+    }
+    if (fields & UNDO_REPEAT) {
+        out[n++] = t->repeat.kind;
+        out[n++] = t->repeat.weekdays;
+        out[n++] = (unsigned char)(t->repeat.n & 0xff);
+        out[n++] = (unsigned char)(t->repeat.n >> 8);
+    }
+    if (fields & UNDO_TAGS) {
+        out[n++] = (unsigned char)t->tag_count;
+        for (int i = 0; i < t->tag_count; i++) n += putString(out + n, t->tags[i]);
+    }
+    if (fields & UNDO_REMINDERS) {
+        out[n++] = (unsigned char)t->reminder_count;
+        memcpy(out + n, t->reminder_days, (size_t)t->reminder_count);
+        n += (size_t)t->reminder_count;
+    }
+    return n;
+}
+
+// Copies the packed fields after the key into t (the name into *name)
+static void unpackFields(const unsigned char* data, unsigned int fields, task* t, const char** name) {
+    const unsigned char* p = data + strlen((const char*)data) + 1;
+    if (fields & UNDO_NAME) {
+        *name = (const char*)p;
+        p += strlen(*name) + 1;
+    }
+    if (fields & UNDO_DESCRIPTION) {
+        snprintf(t->description, sizeof(t->description), "%s", (const char*)p);
+        p += strlen((const char*)p) + 1;
+    }
+    if (fields & UNDO_PRIORITY) t->priority = *p++;
+    if (fields & UNDO_DUE) {
+        t->due_date_set = p[0];
+        t->duedate.day = p[1];
+        t->duedate.month = p[2];
+        t->duedate.year = p[3] | (p[4] << 8);
+        __atomic_store_n(&t->status, (TaskStatus)p[5], __ATOMIC_RELAXED);
+        p += 6;
+    }
+    if (fields & UNDO_REPEAT) {
+        t->repeat.kind = p[0];
+        t->repeat.weekdays = p[1];
+        t->repeat.n = (unsigned short)(p[2] | (p[3] << 8));
+        p += 4;
+    }
+    if (fields & UNDO_TAGS) {
+        int count = *p++;
+        for (int i = 0; i < count; i++) {
+            snprintf(t->tags[i], MAX_TAG_LENGTH, "%s", (const char*)p);
+            p += strlen((const char*)p) + 1;
+        }
+        __atomic_store_n(&t->tag_count, count, __ATOMIC_RELEASE);
+    }
+    if (fields & UNDO_REMINDERS) {
+        t->reminder_count = *p++;
+        memcpy(t->reminder_days, p, (size_t)t->reminder_count);
+    }
+}
+
+// Allocates a record of op for the packed data; NULL if out of memory
+static undorecord* newRecord(int op, unsigned int fields, const unsigned char* data, size_t size,
+                             unsigned int group) {
+    undorecord* r = (undorecord*)malloc(sizeof(undorecord) + size);
+    if (!r) return NULL;
+    r->older = r->newer = NULL;
+    r->group = group;
+    r->size = (unsigned short)size;
+    r->op = (unsigned char)op;
+    r->fields = (unsigned char)fields;
+    memcpy(r->data, data, size);
+    return r;
+}
+
+// Puts r on top of the undo stack; caller holds the lock
+static void pushUndo(undolog* log, undorecord* r) {
+    r->older = log->newest;
+    r->newer = NULL;
+    if (log->newest) log->newest->newer = r;
+    else log->oldest = r;
+    log->newest = r;
+    log->bytes += recordBytes(r);
+    log->undo_count++;
+}
+
+static void pushRedo(undolog* log, undorecord* r) {
+    r->older = log->redo;
+    r->newer = NULL;
+    log->redo = r;
+    log->bytes += recordBytes(r);
+    log->redo_count++;
+}
+
+// Records a new change in the default log: the redo stack goes
+static void record(int op, const task* t, unsigned int fields, const char* key, const char* name_value) {
+    undolog* log = undoDefault();
+    if (!log || __atomic_load_n(&log->applying, __ATOMIC_ACQUIRE)) return;
+
+    unsigned char data[UNDO_RECORD_MAX];
+    size_t size = packFields(data, key, t, fields, name_value);
+    pthread_mutex_lock(&log->lock);
+    undorecord* r = newRecord(op, fields, data, size, log->group ? log->group : log->next_group++);
+    if (r) {
+        clearRedo(log);
+        pushUndo(log, r);
+        evictOldest(log);
+    }
+    pthread_mutex_unlock(&log->lock);
+}
+
+/*
+undoRecordAdd() - Records that t was added (undone by deleting it)
+ - Time: O(1), Space: O(name)
+ */
+void undoRecordAdd(const task* t) {
+    record(UNDO_OP_REMOVE, t, 0, t->name, NULL);
+}
+
+/*
+undoRecordAdded() - undoRecordAdd() for the newest `count` tasks of a list, as one group
+ - Time: O(count), Space: O(count) records
+ - For imports, which add tasks without todoAdd()
+ */
+void undoRecordAdded(task* head, int count) {
+    if (!undoDefault() || count <= 0) return;
+    undoGroupBegin();
+    for (task* t = head; t && count > 0; t = t->next, count--) undoRecordAdd(t);
+    undoGroupEnd();
+}
+
+/*
+undoRecordDelete() - Records that t is being deleted; call while t is still valid
+ - Time: O(1), Space: O(size of t's text)
+ */
+void undoRecordDelete(const task* t) {
+    record(UNDO_OP_INSERT, t, UNDO_ALL_FIELDS & ~UNDO_NAME, t->name, NULL);
+}
+
+/*
+undoRecordComplete() - Records that t was completed (undone by taking it off the stack)
+ - Time: O(1), Space: O(name)
+ */
+void undoRecordComplete(const task* t) {
+    record(UNDO_OP_UNCOMPLETE, t, 0, t->name, NULL);
+}
+
+/*
+undoRecordUndo() - Records that t came back from the completed stack
+ - Time: O(1), Space: O(name)
+ */
+void undoRecordUndo(const task* t) {
+    record(UNDO_OP_COMPLETE, t, 0, t->name, NULL);
+}
+
+/*
+undoRecordFields() - Records t's current values of fields, before they change
+ - Time: O(size of the fields), Space: the same
+ - Only the named fields are kept. A rename is recorded after it, with
+   UNDO_NAME and the old name: pass it as old_name (NULL otherwise), since
+   the record is found by the name the task has after the change
+ - Example: undoRecordFields(t, UNDO_PRIORITY, NULL); t->priority = 1;
+ */
+void undoRecordFields(const task* t, unsigned int fields, const char* old_name) {
+    fields &= UNDO_ALL_FIELDS;
+    if (!old_name) fields &= ~UNDO_NAME;
+    if (fields) record(UNDO_OP_FIELDS, t, fields, t->name, old_name);
+}
+
+// The active task called name
+static task* findActive(tasklist* list, todoindex* index, const char* name) {
+    return index ? todoIndexFind(index, name) : todoFindTask(list, name);
+}
+
+// Schedules t's reminders again after its due date or offsets changed
+static void rescheduleReminders(task* t) {
+    reminderwheel* wheel = reminderDefaultIfStarted();
+    if (wheel && t->reminder_count > 0) reminderSchedule(wheel, t);
+    else if (t->reminder_entries) reminderCancel(t);
+}
+
+// Applies r; on success *inverse is the record that reverses it
+static todostatus applyRecord(const undorecord* r, tasklist* list, completedstack* stack,
+                              todoindex* index, date today, undorecord** inverse,
+                              undoresult* result) {
+    const char* key = (const char*)r->data;
+    unsigned char data[UNDO_RECORD_MAX];
+    size_t size;
+    task* t;
+    snprintf(result->name, sizeof(result->name), "%s", key);
+
+    switch (r->op) {
+        case UNDO_OP_REMOVE:
+            if (!(t = findActive(list, index, key))) return TODO_NOT_FOUND;
+            size = packFields(data, key, t, UNDO_ALL_FIELDS & ~UNDO_NAME, NULL);
+            if (!(*inverse = newRecord(UNDO_OP_INSERT, UNDO_ALL_FIELDS & ~UNDO_NAME, data, size, r->group))) {
+                return TODO_NO_MEMORY;
+            }
+            todoDelete(list, index, key);
+            snprintf(result->action, sizeof(result->action), "removed");
+            return TODO_OK;
+
+        case UNDO_OP_INSERT:
+            if (findActive(list, index, key)) return TODO_DUPLICATE;
+            if (!(t = (task*)calloc(1, sizeof(task)))) return TODO_NO_MEMORY;
+            if (!(*inverse = newRecord(UNDO_OP_REMOVE, 0, r->data, strlen(key) + 1, r->group))) {
+                free(t);
+                return TODO_NO_MEMORY;
+            }
+            snprintf(t->name, sizeof(t->name), "%s", key);
+            unpackFields(r->data, r->fields, t, &key);
+            if (index && todoIndexInsert(index, t) != 0) {
+                free(*inverse);
+                free(t);
+                return TODO_NO_MEMORY;
+            }
+            t->next = list->head;
+            __atomic_store_n(&list->head, t, __ATOMIC_RELEASE);
+            rescheduleReminders(t);
+            feedRecord(FEED_ADD, t, NULL, 0);
+            snprintf(result->action, sizeof(result->action), "re-added");
+            return TODO_OK;
+
+        case UNDO_OP_COMPLETE:
+        case UNDO_OP_UNCOMPLETE: {
+            int completing = r->op == UNDO_OP_COMPLETE;
+            if (!completing && (!stack->top || !stack->top->task_data ||
+                                strcmp(stack->top->task_data->name, key) != 0)) {
+                return TODO_NOT_FOUND;
+            }
+            if (!(*inverse = newRecord(completing ? UNDO_OP_UNCOMPLETE : UNDO_OP_COMPLETE, 0,
+                                       r->data, strlen(key) + 1, r->group))) {
+                return TODO_NO_MEMORY;
+            }
+            todostatus status = completing ? todoComplete(list, stack, index, key, today, NULL)
+                                           : todoUndo(list, stack, index, NULL);
+            if (status != TODO_OK) {
+                free(*inverse);
+                return status;
+            }
+            snprintf(result->action, sizeof(result->action), completing ? "completed" : "restored");
+            return TODO_OK;
+        }
+
+        case UNDO_OP_FIELDS: {
+            if (!(t = findActive(list, index, key))) return TODO_NOT_FOUND;
+            const char* name = key;
+            task values = *t;
+            unpackFields(r->data, r->fields, &values, &name);
+            if ((r->fields & UNDO_NAME) && strcmp(name, key) != 0 && findActive(list, index, name)) {
+                return TODO_DUPLICATE;
+            }
+            // The reverse is found by the name the task is about to get back
+            size = packFields(data, name, t, r->fields, t->name);
+            if (!(*inverse = newRecord(UNDO_OP_FIELDS, r->fields, data, size, r->group))) {
+                return TODO_NO_MEMORY;
+            }
+            char old_name[sizeof(t->name)];
+            snprintf(old_name, sizeof(old_name), "%s", t->name);
+            if (r->fields & UNDO_NAME) {
+                if (index) todoIndexRemove(index, t);
+                snprintf(t->name, sizeof(t->name), "%s", name);
+                if (index) todoIndexInsert(index, t);
+            }
+            unpackFields(r->data, r->fields & ~UNDO_NAME, t, &name);
+            if (r->fields & (UNDO_DUE | UNDO_REMINDERS)) rescheduleReminders(t);
+            feedRecord(FEED_EDIT, t, old_name, 0);
+            snprintf(result->name, sizeof(result->name), "%s", t->name);
+            snprintf(result->action, sizeof(result->action), "edited");
+            return TODO_OK;
+        }
+    }
+    return TODO_PARSE_ERROR;
+}
+
+/*
+undoApply() - Undoes (redo = 0) or redoes (redo = 1) the newest group of changes
+ - Time: O(1) per record with an index, O(n) per record to find the task
+   by name without one, Space: O(1)
+ - Each record applied moves to the other stack as the record reversing it.
+   A record whose task is gone (cleared from the completed stack, or a
+   name taken since) is dropped with the rest of its group, and the
+   status says why.
+ - A completion made again is dated today
+ - Returns TODO_EMPTY if there is nothing to undo (or redo)
+ - Sample Case:
+    Input: "Essay" completed, then its priority raised by the scheduler
+    Output: undo -> priority back, undo -> "Essay" restored, redo -> priority raised again
+ */
+todostatus undoApply(undolog* log, int redo, tasklist* list, completedstack* stack,
+                     todoindex* index, date today, undoresult* result) {
+    memset(result, 0, sizeof(*result));
+    pthread_mutex_lock(&log->lock);
+    undorecord* top = redo ? log->redo : log->newest;
+    if (!top) {
+        pthread_mutex_unlock(&log->lock);
+        return TODO_EMPTY;
+    }
+    unsigned int group = top->group;
+    __atomic_store_n(&log->applying, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&log->lock);
+
+    todostatus status = TODO_OK;
+    for (;;) {
+        pthread_mutex_lock(&log->lock);
+        undorecord* r = redo ? log->redo : log->newest;
+        if (!r || r->group != group) {
+            pthread_mutex_unlock(&log->lock);
+            break;
+        }
+        // Off its stack first; it is freed once applied (or dropped)
+        if (redo) {
+            log->redo = r->older;
+            log->redo_count--;
+        } else {
+            log->newest = r->older;
+            if (log->newest) log->newest->newer = NULL;
+            else log->oldest = NULL;
+            log->undo_count--;
+        }
+        log->bytes -= recordBytes(r);
+        pthread_mutex_unlock(&log->lock);
+
+        undorecord* inverse = NULL;
+        if (status == TODO_OK) {
+            status = applyRecord(r, list, stack, index, today, &inverse, result);
+            if (status == TODO_OK) result->steps++;
+        }
+        free(r);
+        if (inverse) {
+            pthread_mutex_lock(&log->lock);
+            if (redo) pushUndo(log, inverse);
+            else pushRedo(log, inverse);
+            pthread_mutex_unlock(&log->lock);
+        }
+    }
+
+    pthread_mutex_lock(&log->lock);
+    evictOldest(log);
+    __atomic_store_n(&log->applying, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&log->lock);
+    return status;
+}
@@ -0,0 +1,81 @@
+#ifndef UNDO_H
+#define UNDO_H
+
+// Undo/redo log: each change to a task is recorded as the operation that
+// reverses it, holding only what that operation needs. A priority change
+// keeps the task's name and one byte; a deletion keeps the task's fields
+// packed end to end (about 40 bytes for a short task, not the whole
+// struct). Undoing applies the newest record and pushes the operation
+// that reverses *that* onto the redo stack, so undo and redo are the same
+// O(1) step in opposite directions (plus finding the task by name).
+// Changes made by one command - a bulk action, an import, the scheduler's
+// priority pass - share a group and are undone together.
+//
+// Record bytes are counted against a budget; when it is exceeded the
+// oldest groups are dropped. A new change clears the redo stack.
+//
+// libtodo.c, edit(), add_reminder_to_task(), imports and the scheduler
+// record into the log set with undoSetDefault(); with none set (batch
+// mode, the server) recording costs one atomic load. Recording takes the
+// log's mutex, so changes made on pool threads are safe to record.
+
+#include <pthread.h>
+#include <stddef.h>
+#include "libtodo.h"
+
+#define UNDO_DEFAULT_BUDGET (1024 * 1024)
+
+// Fields a record can restore
+enum {
+    UNDO_NAME = 1,
+    UNDO_DESCRIPTION = 2,
+    UNDO_PRIORITY = 4,
+    UNDO_DUE = 8,          // due date and status
+    UNDO_REPEAT = 16,
+    UNDO_TAGS = 32,
+    UNDO_REMINDERS = 64,
+    UNDO_ALL_FIELDS = 127
+};
+
+typedef struct undorecord undorecord;
+
+typedef struct {
+    undorecord* oldest;      // bottom of the undo stack
+    undorecord* newest;      // top of the undo stack
+    undorecord* redo;        // top of the redo stack
+    size_t bytes;            // records on both stacks, headers included
+    size_t budget;
+    long undo_count;
+    long redo_count;
+    long long evicted;       // records dropped for the budget
+    unsigned int group;      // group of the records being made
+    unsigned int next_group;
+    int group_depth;
+    int applying;            // set while undoApply() runs: nothing is recorded
+    pthread_mutex_t lock;
+} undolog;
+
+// What undoApply() did
+typedef struct {
+    int steps;               // records applied
+    char name[100];          // the task of the last one
+    char action[16];         // "removed", "re-added", "completed", "restored", "edited"
+} undoresult;
+
+void undoInit(undolog* log, size_t budget);
+void undoFree(undolog* log);
+void undoClear(undolog* log);
+void undoSetDefault(undolog* log);
+undolog* undoDefault();
+void undoGroupBegin();
+void undoGroupEnd();
+void undoRecordAdd(const task* t);
+void undoRecordAdded(task* head, int count);
+void undoRecordDelete(const task* t);
+void undoRecordComplete(const task* t);
+void undoRecordUndo(const task* t);
+void undoRecordFields(const task* t, unsigned int fields, const char* old_name);
+todostatus undoApply(undolog* log, int redo, tasklist* list, completedstack* stack,
+                     todoindex* index, date today, undoresult* result);
+
+#endif
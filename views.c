@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "views.h"
+
+static viewset* default_views = NULL;
+
+// Slot of t in a table of size mask + 1
+static long hashTask(const task* t, long mask) {
+    unsigned long long hash = (unsigned long long)(uintptr_t)t * 0x9E3779B97F4A7C15ull;
+    return (long)(hash >> 32) & mask;
+}
+
+// Slot holding t, or -1 if it is not in the set
+static long tasksSlot(const viewtasks* s, const task* t) {
+    if (!s->slot_count) return -1;
+    long mask = s->slot_count - 1;
+    for (long i = hashTask(t, mask);; i = (i + 1) & mask) {
+        long position = s->slots[i];
+        if (!position) return -1;
+        if (s->tasks[position - 1] == t) return i;
+    }
+}
+
+// Puts the task at position (1-based) into the first free slot of its run
+static void tasksPlace(viewtasks* s, long position) {
+    long mask = s->slot_count - 1;
+    long i = hashTask(s->tasks[position - 1], mask);
+    while (s->slots[i]) i = (i + 1) & mask;
+    s->slots[i] = position;
+}
+
+static int tasksRehash(viewtasks* s, long slot_count) {
+    long* slots = (long*)calloc((size_t)slot_count, sizeof(long));
+    if (!slots) return -1;
+    free(s->slots);
+    s->slots = slots;
+    s->slot_count = slot_count;
+    for (long position = 1; position <= s->count; position++) tasksPlace(s, position);
+    return 0;
+}
+
+// Adds t unless the set has it; 0, or -1 if out of memory
+static int tasksAdd(viewtasks* s, task* t) {
+    if (tasksSlot(s, t) >= 0) return 0;
+    if ((s->count + 1) * 2 > s->slot_count &&
+        tasksRehash(s, s->slot_count ? s->slot_count * 2 : 16) != 0) {
+        return -1;
+    }
+    if (s->count == s->capacity) {
+        long grown = s->capacity ? s->capacity * 2 : 16;
+        task** bigger = (task**)realloc(s->tasks, sizeof(task*) * grown);
+        if (!bigger) return -1;
+        s->tasks = bigger;
+        s->capacity = grown;
+    }
+    s->tasks[s->count++] = t;
+    tasksPlace(s, s->count);
+    return 0;
+}
+
+// Takes t out of the set, if it is there: the rest of its probe run moves
+// back over the hole, and the last task takes its place in the array
+static void tasksRemove(viewtasks* s, const task* t) {
+    long i = tasksSlot(s, t);
+    if (i < 0) return;
+    long position = s->slots[i];
+    long mask = s->slot_count - 1;
+    for (long j = (i + 1) & mask; s->slots[j]; j = (j + 1) & mask) {
+        long home = hashTask(s->tasks[s->slots[j] - 1], mask);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            s->slots[i] = s->slots[j];
+            i = j;
+        }
+    }
+    s->slots[i] = 0;
+
+    long last = s->count--;
+    if (position != last) {
+        task* moved = s->tasks[last - 1];
+        s->slots[tasksSlot(s, moved)] = position;
+        s->tasks[position - 1] = moved;
+    }
+}
+
+static void tasksClear(viewtasks* s) {
+    s->count = 0;
+    if (s->slot_count) memset(s->slots, 0, sizeof(long) * s->slot_count);
+}
+
+static void tasksFree(viewtasks* s) {
+    free(s->tasks);
+    free(s->slots);
+    memset(s, 0, sizeof(*s));
+}
+
+// Whether two compilations of one expression test the same things
+static int sameProgram(const queryprogram* a, const queryprogram* b) {
+    if (a->length != b->length || a->entry != b->entry) return 0;
+    for (int i = 0; i < a->length; i++) {
+        const queryinsn* x = &a->code[i];
+        const queryinsn* y = &b->code[i];
+        if (x->op != y->op || x->status != y->status || x->on_true != y->on_true ||
+            x->on_false != y->on_false || x->low != y->low || x->high != y->high) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Refills the stale views from every task; caller holds the lock.
+// Returns 0, or -1 if out of memory (those views stay stale).
+static int scanViews(viewset* set, tasklist* list, completedstack* stack) {
+    savedview* stale[VIEWS_MAX];
+    int n = 0;
+    for (int v = 0; v < set->count; v++) {
+        if (!set->views[v]->stale) continue;
+        stale[n++] = set->views[v];
+        tasksClear(&set->views[v]->members);
+    }
+    if (!n) return 0;
+
+    int failed = 0;
+    for (int v = 0; v < n; v++) {
+        savedview* view = stale[v];
+        for (task* t = list->head; t; t = t->next) {
+            if (queryRun(&view->program, t) && tasksAdd(&view->members, t) != 0) failed = 1;
+        }
+        for (stacknode* node = stack->top; node; node = node->next) {
+            task* t = node->task_data;
+            if (t && queryRun(&view->program, t) && tasksAdd(&view->members, t) != 0) failed = 1;
+        }
+        view->stale = failed;
+        set->scans++;
+    }
+    return failed ? -1 : 0;
+}
+
+/*
+viewsInit() - Makes an empty view set
+ - Time: O(1), Space: O(1)
+ - today is the day "today" in expressions means until viewsRefresh() is
+   given another
+ - Example: viewset views; viewsInit(&views, getToday()); viewsSetDefault(&views);
+ */
+void viewsInit(viewset* set, date today) {
+    memset(set, 0, sizeof(*set));
+    set->compiled = today;
+    pthread_mutex_init(&set->lock, NULL);
+}
+
+/*
+viewsFree() - Frees every view (the tasks are not touched)
+ - Time: O(views), Space: O(1)
+ - Unset it as the default first
+ */
+void viewsFree(viewset* set) {
+    for (int v = 0; v < set->count; v++) {
+        tasksFree(&set->views[v]->members);
+        free(set->views[v]);
+    }
+    tasksFree(&set->changed);
+    set->count = 0;
+    pthread_mutex_destroy(&set->lock);
+}
+
+/*
+viewsSetDefault() - Sets the view set feedRecord() keeps current (NULL: none)
+ - Time: O(1), Space: O(1)
+ */
+void viewsSetDefault(viewset* set) {
+    __atomic_store_n(&default_views, set, __ATOMIC_RELEASE);
+}
+
+/*
+viewsDefault() - The view set feedRecord() keeps current, or NULL
+ - Time: O(1), Space: O(1)
+ */
+viewset* viewsDefault() {
+    return __atomic_load_n(&default_views, __ATOMIC_ACQUIRE);
+}
+
+/*
+viewsRecord() - Notes a change to t for the default view set, if there is one
+ - Time: O(1) expected, O(views) for a deletion, Space: O(1)
+ - Called by feedRecord(). A deleted or cleared task leaves every view now;
+   any other change marks t to be tested at the next viewsRefresh().
+ */
+void viewsRecord(feedtype type, const task* t) {
+    viewset* set = viewsDefault();
+    if (!set) return;
+
+    pthread_mutex_lock(&set->lock);
+    set->changes++;
+    if (type == FEED_DELETE || type == FEED_CLEAR) {
+        tasksRemove(&set->changed, t);
+        for (int v = 0; v < set->count; v++) tasksRemove(&set->views[v]->members, t);
+    } else if (tasksAdd(&set->changed, (task*)t) != 0) {
+        // Without room to remember the change, every view is rebuilt
+        for (int v = 0; v < set->count; v++) set->views[v]->stale = 1;
+    }
+    pthread_mutex_unlock(&set->lock);
+}
+
+/*
+viewsFind() - Position of the view with that name, or -1
+ - Time: O(views), Space: O(1)
+ */
+int viewsFind(const viewset* set, const char* name) {
+    for (int v = 0; v < set->count; v++) {
+        if (strcmp(set->views[v]->name, name) == 0) return v;
+    }
+    return -1;
+}
+
+/*
+viewsAdd() - Saves an expression under a name and fills it from every task
+ - Time: O(n) for the one scan, Space: O(matches)
+ - Names are 1-39 characters without '|'. On failure a message goes to
+   error (if given): TODO_INVALID_NAME, TODO_DUPLICATE, TODO_PARSE_ERROR for
+   the expression, TODO_NO_MEMORY (also when VIEWS_MAX views are saved)
+ - Example: viewsAdd(&views, "today's work", "tag:work due:..today", &tasks, &doneStack, error, sizeof(error))
+ */
+todostatus viewsAdd(viewset* set, const char* name, const char* expression, tasklist* list,
+                    completedstack* stack, char* error, size_t size) {
+    char ignored[8];
+    if (!error) {
+        error = ignored;
+        size = sizeof(ignored);
+    }
+    if (!name[0] || strlen(name) >= VIEWS_NAME_MAX || strchr(name, '|')) {
+        snprintf(error, size, "names are 1-%d characters without '|'", VIEWS_NAME_MAX - 1);
+        return TODO_INVALID_NAME;
+    }
+    if (strlen(expression) >= QUERY_TEXT_MAX) {
+        snprintf(error, size, "expression too long");
+        return TODO_PARSE_ERROR;
+    }
+
+    pthread_mutex_lock(&set->lock);
+    todostatus status = TODO_OK;
+    savedview* view = NULL;
+    if (viewsFind(set, name) >= 0) {
+        snprintf(error, size, "a view named '%s' exists", name);
+        status = TODO_DUPLICATE;
+    } else if (set->count == VIEWS_MAX) {
+        snprintf(error, size, "at most %d views", VIEWS_MAX);
+        status = TODO_NO_MEMORY;
+    } else if (!(view = (savedview*)calloc(1, sizeof(savedview)))) {
+        snprintf(error, size, "out of memory");
+        status = TODO_NO_MEMORY;
+    } else if (queryCompile(expression, set->compiled, 0, &view->program, error, size) != TODO_OK) {
+        status = TODO_PARSE_ERROR;
+    }
+    if (status != TODO_OK) {
+        free(view);
+        pthread_mutex_unlock(&set->lock);
+        return status;
+    }
+
+    snprintf(view->name, sizeof(view->name), "%s", name);
+    snprintf(view->expression, sizeof(view->expression), "%s", expression);
+    view->stale = 1;
+    set->views[set->count++] = view;
+    // A view short of memory for its tasks is saved anyway and filled at a refresh
+    scanViews(set, list, stack);
+    pthread_mutex_unlock(&set->lock);
+    return TODO_OK;
+}
+
+/*
+viewsRemove() - Deletes the view with that name
+ - Time: O(views), Space: O(1)
+ - Example: viewsRemove(&views, "today's work") -> TODO_OK, TODO_NOT_FOUND if there is none
+ */
+todostatus viewsRemove(viewset* set, const char* name) {
+    pthread_mutex_lock(&set->lock);
+    int v = viewsFind(set, name);
+    if (v >= 0) {
+        tasksFree(&set->views[v]->members);
+        free(set->views[v]);
+        memmove(&set->views[v], &set->views[v + 1], sizeof(savedview*) * (set->count - v - 1));
+        set->count--;
+    }
+    pthread_mutex_unlock(&set->lock);
+    return v >= 0 ? TODO_OK : TODO_NOT_FOUND;
+}
+
+/*
+viewsRefresh() - Brings every view up to date with the changes recorded since the last refresh
+ - Time: O(changed tasks * views) tests, plus O(n) per view that names
+   "today" when the day has changed, Space: O(1)
+ - Each changed task is tested once against each saved program and added
+   to or taken out of the view; a task changed ten times is tested once.
+ - Returns the number of changed tasks tested, or -1 if out of memory
+   (the views short of memory are rebuilt at the next refresh)
+ - Sample Case:
+    Input: views "urgent" (tag:urgent) and "mine" (priority:1); "Report"
+           tagged urgent, then its priority set to 1
+    Output: 1; "Report" joins both views after two tests
+ */
+int viewsRefresh(viewset* set, tasklist* list, completedstack* stack, date today) {
+    pthread_mutex_lock(&set->lock);
+    if (queryDateKey(today) != queryDateKey(set->compiled)) {
+        // Only views whose tests moved with the day need scanning
+        for (int v = 0; v < set->count; v++) {
+            savedview* view = set->views[v];
+            queryprogram program;
+            if (queryCompile(view->expression, today, 0, &program, NULL, 0) != TODO_OK ||
+                sameProgram(&program, &view->program)) {
+                continue;
+            }
+            queryCompile(view->expression, today, 0, &view->program, NULL, 0);
+            view->stale = 1;
+        }
+        set->compiled = today;
+    }
+    int failed = scanViews(set, list, stack);
+
+    long tested = set->changed.count;
+    for (long i = 0; i < tested; i++) {
+        task* t = set->changed.tasks[i];
+        for (int v = 0; v < set->count; v++) {
+            savedview* view = set->views[v];
+            if (view->stale) continue;
+            if (queryRun(&view->program, t)) {
+                if (tasksAdd(&view->members, t) != 0) {
+                    view->stale = 1;
+                    failed = -1;
+                }
+            } else {
+                tasksRemove(&view->members, t);
+            }
+            set->tests++;
+        }
+    }
+    tasksClear(&set->changed);
+    pthread_mutex_unlock(&set->lock);
+    return failed ? -1 : (int)tested;
+}
+
+/*
+viewsMembers() - Copies up to max tasks of a view into out, in no particular order
+ - Time: O(k) for k matches, Space: O(1)
+ - Call viewsRefresh() first for the result as of now
+ - Returns the number of matches (more than max if out was too short)
+ - Example: viewsMembers(&views, 0, NULL, 0) -> the count alone
+ */
+long viewsMembers(viewset* set, int view, task** out, long max) {
+    pthread_mutex_lock(&set->lock);
+    long count = 0;
+    if (view >= 0 && view < set->count) {
+        viewtasks* members = &set->views[view]->members;
+        count = members->count;
+        if (max > count) max = count;
+        if (max > 0) memcpy(out, members->tasks, sizeof(task*) * max);
+    }
+    pthread_mutex_unlock(&set->lock);
+    return count;
+}
+
+/*
+viewsSave() - Writes the views' names and expressions, one "name|expression" line each
+ - Time: O(views), Space: O(1)
+ - Returns TODO_OK, or TODO_IO_ERROR if the file cannot be written
+ */
+todostatus viewsSave(const viewset* set, const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) return TODO_IO_ERROR;
+    for (int v = 0; v < set->count; v++) {
+        fprintf(file, "%s|%s\n", set->views[v]->name, set->views[v]->expression);
+    }
+    return fclose(file) == 0 ? TODO_OK : TODO_IO_ERROR;
+}
+
+/*
+viewsLoad() - Adds the views written by viewsSave()
+ - Time: O(views * n), Space: O(matches)
+ - Lines that do not make a view (no '|', a bad expression, a name in use)
+   are skipped
+ - Returns the number of views added, or -1 if the file cannot be opened
+ - Example: viewsLoad(&views, VIEWS_DEFAULT_FILE, &tasks, &doneStack) -> 3
+ */
+int viewsLoad(viewset* set, const char* filename, tasklist* list, completedstack* stack) {
+    FILE* file = fopen(filename, "r");
+    if (!file) return -1;
+
+    char line[VIEWS_NAME_MAX + QUERY_TEXT_MAX + 2];
+    int added = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* bar = strchr(line, '|');
+        if (!bar) continue;
+        *bar = '\0';
+        if (viewsAdd(set, line, bar + 1, list, stack, NULL, 0) == TODO_OK) added++;
+    }
+    fclose(file);
+    return added;
+}
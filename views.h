@@ -0,0 +1,76 @@
+#ifndef VIEWS_H
+#define VIEWS_H
+
+// Saved views: named query expressions (query.h) whose matching tasks are
+// kept as a set, so opening one lists its result without testing every
+// task again.
+//
+// feedRecord() tells the view set of every change as it is made. A changed
+// task is only marked; viewsRefresh() then tests each marked task against
+// the saved programs, once per change however many were made to it, and
+// adds it to or takes it out of each view. A deleted or cleared task
+// leaves every view at once, while its pointer is still valid. So the work
+// follows the changes, not the number of tasks: a full scan happens only
+// when a view is saved, and for a view naming "today" when the day changes.
+//
+// Members are held by task pointer. Every task freed while a set is the
+// default must be recorded first (FEED_DELETE or FEED_CLEAR), as the
+// library does; code that frees tasks of its own lists (benchmarks) unsets
+// the default while it runs.
+//
+// The names and expressions are kept in a text file, one "name|expression"
+// line per view, so the views outlast the session.
+
+#include <pthread.h>
+#include "libtodo.h"
+#include "query.h"
+#include "feed.h"
+
+#define VIEWS_MAX 32
+#define VIEWS_NAME_MAX 40
+#define VIEWS_DEFAULT_FILE "saved_views.txt"
+
+// A set of tasks: an array to list them, and an open-addressed table of
+// positions in it to find one
+typedef struct {
+    task** tasks;
+    long count;
+    long capacity;
+    long* slots;             // position + 1 in tasks, 0 for an empty slot
+    long slot_count;         // a power of two, or 0
+} viewtasks;
+
+typedef struct {
+    char name[VIEWS_NAME_MAX];
+    char expression[QUERY_TEXT_MAX];
+    queryprogram program;
+    viewtasks members;
+    int stale;               // needs a full scan
+} savedview;
+
+typedef struct {
+    savedview* views[VIEWS_MAX];   // allocated one by one: programs point into themselves
+    int count;
+    viewtasks changed;       // tasks changed since the last refresh
+    date compiled;           // day "today" was compiled as
+    long changes;            // changes recorded
+    long tests;              // programs run on changed tasks
+    long scans;              // full scans, one per view saved or rescanned
+    pthread_mutex_t lock;
+} viewset;
+
+void viewsInit(viewset* set, date today);
+void viewsFree(viewset* set);
+void viewsSetDefault(viewset* set);
+viewset* viewsDefault();
+void viewsRecord(feedtype type, const task* t);
+todostatus viewsAdd(viewset* set, const char* name, const char* expression, tasklist* list,
+                    completedstack* stack, char* error, size_t size);
+todostatus viewsRemove(viewset* set, const char* name);
+int viewsFind(const viewset* set, const char* name);
+int viewsRefresh(viewset* set, tasklist* list, completedstack* stack, date today);
+long viewsMembers(viewset* set, int view, task** out, long max);
+todostatus viewsSave(const viewset* set, const char* filename);
+int viewsLoad(viewset* set, const char* filename, tasklist* list, completedstack* stack);
+
+#endif